@@ -0,0 +1,132 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+// A recording has to give back the exact code units and chunks it was given,
+// lone surrogates included, and has to reject files that aren't recordings.
+
+#include "pch.h"
+#include "Asciicast.hpp"
+
+#include <random>
+
+#include <gtest/gtest.h>
+
+#include "Corpus.hpp"
+
+using namespace Microsoft::Terminal::Core;
+
+namespace
+{
+    using namespace std::chrono_literals;
+
+    std::vector<std::wstring> roundTrip(const std::vector<std::wstring>& chunks)
+    {
+        std::string recording;
+        Asciicast::AppendHeader(recording, 80, 24, 0);
+        for (size_t i = 0; i < chunks.size(); ++i)
+        {
+            Asciicast::AppendOutput(recording, i * 1ms, chunks[i]);
+        }
+
+        Asciicast::Reader reader{ std::move(recording) };
+        std::vector<std::wstring> result;
+        Asciicast::Event event{};
+        while (reader.Next(event))
+        {
+            EXPECT_EQ(L'o', event.type);
+            EXPECT_EQ(std::chrono::milliseconds(result.size()), event.time);
+            result.emplace_back(std::move(event.data));
+        }
+        return result;
+    }
+}
+
+TEST(AsciicastTests, RoundTripsEveryCodeUnit)
+{
+    std::wstring text;
+    for (uint32_t ch = 0; ch <= 0xFFFF; ++ch)
+    {
+        text.push_back(static_cast<wchar_t>(ch));
+    }
+    // Pairs, and pairs in the wrong order.
+    text.append(L"\xD83D\xDE00\xDE00\xD83D");
+
+    const std::vector<std::wstring> chunks{ text };
+    EXPECT_EQ(chunks, roundTrip(chunks));
+}
+
+TEST(AsciicastTests, KeepsSurrogatePairsSplitAcrossChunks)
+{
+    const auto text = Microsoft::Terminal::Core::Benchmarks::EmojiText(4096);
+    std::mt19937 random{ 1 };
+    std::vector<std::wstring> chunks;
+    for (size_t i = 0; i < text.size();)
+    {
+        const auto length = std::min<size_t>(1 + random() % 7, text.size() - i);
+        chunks.emplace_back(text.substr(i, length));
+        i += length;
+    }
+
+    EXPECT_EQ(chunks, roundTrip(chunks));
+}
+
+TEST(AsciicastTests, WritesWhatAsciinemaReads)
+{
+    std::string recording;
+    Asciicast::AppendHeader(recording, 120, 30, 1660000000);
+    Asciicast::AppendOutput(recording, 1.5s, L"a\"\\\r\n\x1b\xE9\x4E2D\xD83D\xDE00\xD83D");
+    Asciicast::AppendResize(recording, 2500ms, 100, 40);
+
+    EXPECT_EQ("{\"version\": 2, \"width\": 120, \"height\": 30, \"timestamp\": 1660000000}\n"
+              "[1.500000, \"o\", \"a\\\"\\\\\\r\\n\\u001b\xC3\xA9\xE4\xB8\xAD\xF0\x9F\x98\x80\\ud83d\"]\n"
+              "[2.500000, \"r\", \"100x40\"]\n",
+              recording);
+
+    Asciicast::Reader reader{ recording };
+    EXPECT_EQ(120, reader.Width());
+    EXPECT_EQ(30, reader.Height());
+
+    Asciicast::Event event{};
+    ASSERT_TRUE(reader.Next(event));
+    ASSERT_TRUE(reader.Next(event));
+    EXPECT_EQ(L'r', event.type);
+    EXPECT_EQ(2500ms, event.time);
+    EXPECT_EQ((std::pair{ 100, 40 }), Asciicast::ParseSize(event.data));
+    EXPECT_FALSE(reader.Next(event));
+
+    reader.Rewind();
+    ASSERT_TRUE(reader.Next(event));
+    EXPECT_EQ(L'o', event.type);
+}
+
+TEST(AsciicastTests, ReadsInvalidUtf8AsReplacementCharacters)
+{
+    Asciicast::Reader reader{ "{\"width\": 80, \"height\": 24}\n[0, \"o\", \"a\x80" "b\xE4\xB8" "c\"]\n" };
+    Asciicast::Event event{};
+    ASSERT_TRUE(reader.Next(event));
+    EXPECT_EQ(L"a\xFFFD" L"b\xFFFD" L"c", event.data);
+}
+
+TEST(AsciicastTests, ParsesSizes)
+{
+    EXPECT_EQ((std::pair{ 1, 32767 }), Asciicast::ParseSize(L"1x32767"));
+    for (const auto size : { L"", L"80", L"x24", L"80x", L"0x24", L"80x32768", L"-1x24", L"80x24x1", L"999999999999x24" })
+    {
+        EXPECT_FALSE(Asciicast::ParseSize(size)) << size;
+    }
+}
+
+TEST(AsciicastTests, RejectsInvalidRecordings)
+{
+    for (const auto header : { "", "{\"version\": 2}", "{\"width\": 80}\n", "{\"width\": 0, \"height\": 24}\n", "{\"width\": 80, \"height\": 40000}\n" })
+    {
+        EXPECT_THROW(Asciicast::Reader{ header }, Asciicast::InvalidRecording) << header;
+    }
+
+    for (const auto events : { "[", "[1, \"o\"]", "[1, \"o\", \"abc]", "[1, \"o\", \"\\x\"]", "[1, \"o\", \"\\u12\"]", "[nan, \"o\", \"\"]", "{}" })
+    {
+        Asciicast::Reader reader{ std::string{ "{\"width\": 80, \"height\": 24}\n" } + events };
+        Asciicast::Event event{};
+        EXPECT_THROW(reader.Next(event), Asciicast::InvalidRecording) << events;
+    }
+}
@@ -0,0 +1,244 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "Corpus.hpp"
+
+#include <array>
+#include <cstdio>
+#include <random>
+#include <string_view>
+
+namespace
+{
+    constexpr std::array<std::wstring_view, 6> words{ L"request", L"worker", L"cache", L"connection", L"session", L"buffer" };
+    constexpr std::array<std::wstring_view, 4> levels{ L"INFO", L"WARN", L"DEBUG", L"\x1b[31mERROR\x1b[m" };
+    constexpr std::array<std::wstring_view, 4> files{ L"src/buffer/out/textBuffer.cpp", L"src/renderer/base/renderer.cpp", L"src/terminal/parser/stateMachine.cpp", L"src/types/viewport.cpp" };
+    constexpr std::array<std::wstring_view, 4> warnings{ L"C4100", L"C4244", L"C4267", L"C26481" };
+
+    // Picks a random element of the given array.
+    template<typename T, size_t N>
+    const T& pick(std::mt19937& random, const std::array<T, N>& array)
+    {
+        return array[std::uniform_int_distribution<size_t>{ 0, N - 1 }(random)];
+    }
+
+    unsigned number(std::mt19937& random, const unsigned limit)
+    {
+        return std::uniform_int_distribution<unsigned>{ 0, limit - 1 }(random);
+    }
+
+    // Calls appendLine until the text is long enough.
+    template<typename T>
+    std::wstring generate(const size_t length, T&& appendLine)
+    {
+        std::mt19937 random{ 0x5eed };
+        std::wstring text;
+        text.reserve(length + 256);
+        while (text.size() < length)
+        {
+            appendLine(random, text);
+            text.append(L"\r\n");
+        }
+        return text;
+    }
+}
+
+std::wstring Microsoft::Terminal::Core::Benchmarks::AsciiLog(const size_t length)
+{
+    return generate(length, [](std::mt19937& random, std::wstring& text) {
+        text.append(L"2022-08-01 12:");
+        text.append(std::to_wstring(10 + number(random, 50)));
+        text.append(L":");
+        text.append(std::to_wstring(10 + number(random, 50)));
+        text.append(L".");
+        text.append(std::to_wstring(100 + number(random, 900)));
+        text.append(L" ");
+        text.append(pick(random, levels));
+        text.append(L" [");
+        text.append(pick(random, words));
+        text.append(L"-");
+        text.append(std::to_wstring(number(random, 16)));
+        text.append(L"] ");
+        for (auto i = number(random, 12); i > 0; --i)
+        {
+            text.append(pick(random, words));
+            text.append(L" ");
+        }
+        text.append(L"completed in ");
+        text.append(std::to_wstring(number(random, 1000)));
+        text.append(L" ms");
+    });
+}
+
+std::wstring Microsoft::Terminal::Core::Benchmarks::CjkText(const size_t length)
+{
+    return generate(length, [](std::mt19937& random, std::wstring& text) {
+        for (auto i = 20 + number(random, 40); i > 0; --i)
+        {
+            text.push_back(static_cast<wchar_t>(0x4E00 + number(random, 0x5200)));
+        }
+    });
+}
+
+std::wstring Microsoft::Terminal::Core::Benchmarks::EmojiText(const size_t length)
+{
+    return generate(length, [](std::mt19937& random, std::wstring& text) {
+        for (auto i = 20 + number(random, 40); i > 0; --i)
+        {
+            const auto codepoint = 0x1F600 + number(random, 0x50) - 0x10000;
+            text.push_back(static_cast<wchar_t>(0xD800 + (codepoint >> 10)));
+            text.push_back(static_cast<wchar_t>(0xDC00 + (codepoint & 0x3FF)));
+        }
+    });
+}
+
+std::wstring Microsoft::Terminal::Core::Benchmarks::CompilerLog(const size_t length)
+{
+    return generate(length, [](std::mt19937& random, std::wstring& text) {
+        const auto& file = pick(random, files);
+        const auto& warning = pick(random, warnings);
+        text.append(file);
+        text.append(L"(");
+        text.append(std::to_wstring(1 + number(random, 2000)));
+        text.append(L",");
+        text.append(std::to_wstring(1 + number(random, 120)));
+        text.append(L"): warning ");
+        text.append(warning);
+        text.append(L": '");
+        text.append(pick(random, words));
+        text.append(L"': conversion from 'size_t' to 'int', possible loss of data");
+        if (number(random, 8) == 0)
+        {
+            text.append(L" (see https://docs.microsoft.com/cpp/error-messages/compiler-warnings/");
+            text.append(warning);
+            text.append(L"?view=msvc-170).");
+        }
+    });
+}
+
+std::wstring Microsoft::Terminal::Core::Benchmarks::JsonDump(const size_t length)
+{
+    return generate(length, [](std::mt19937& random, std::wstring& text) {
+        text.append(L"    {\"id\": ");
+        text.append(std::to_wstring(number(random, 100000)));
+        text.append(L", \"name\": \"");
+        text.append(pick(random, words));
+        text.append(L"\", \"size\": ");
+        text.append(std::to_wstring(number(random, 65536)));
+        if (number(random, 4) == 0)
+        {
+            text.append(L", \"href\": \"https://api.example.com/v1/");
+            text.append(pick(random, words));
+            text.append(L"s/");
+            text.append(std::to_wstring(number(random, 100000)));
+            text.append(L"?expand=true&format=json\"");
+        }
+        text.append(L"},");
+    });
+}
+
+std::string Microsoft::Terminal::Core::Benchmarks::SettingsJson(const size_t profiles)
+{
+    std::mt19937 random{ 0x5eed };
+    const auto append = [](std::string& json, const std::wstring_view& text) {
+        json.append(text.begin(), text.end());
+    };
+    const auto color = [&]() {
+        char hex[8];
+        snprintf(&hex[0], sizeof(hex), "#%06X", number(random, 0x1000000));
+        return std::string{ &hex[0] };
+    };
+
+    std::string json;
+    json.append("// This file was initially generated by Windows Terminal.\r\n");
+    json.append("{\r\n");
+    json.append("    \"$schema\": \"https://aka.ms/terminal-profiles-schema\",\r\n");
+    json.append("    \"defaultProfile\": \"{00000000-0000-0000-0000-000000000000}\",\r\n");
+    json.append("    \"copyOnSelect\": false,\r\n");
+    json.append("    \"profiles\": {\r\n");
+    json.append("        \"defaults\": { \"font\": { \"face\": \"Cascadia Mono\", \"size\": 11 }, \"historySize\": 9001 },\r\n");
+    json.append("        \"list\": [\r\n");
+    for (size_t i = 0; i < profiles; ++i)
+    {
+        char guid[48];
+        snprintf(&guid[0], sizeof(guid), "{%08X-0000-0000-0000-000000000000}", static_cast<unsigned>(i));
+        json.append("            {\r\n");
+        json.append("                // A profile the user added.\r\n");
+        json.append("                \"guid\": \"").append(&guid[0]).append("\",\r\n");
+        json.append("                \"name\": \"");
+        append(json, pick(random, words));
+        json.append(" ").append(std::to_string(i)).append("\",\r\n");
+        json.append("                \"commandline\": \"wsl.exe -d ");
+        append(json, pick(random, words));
+        json.append("\",\r\n");
+        json.append("                \"startingDirectory\": \"%USERPROFILE%\",\r\n");
+        json.append("                \"colorScheme\": \"Scheme ").append(std::to_string(i / 4)).append("\",\r\n");
+        json.append("                \"opacity\": ").append(std::to_string(50 + number(random, 50))).append(",\r\n");
+        json.append("                \"useAcrylic\": ").append(number(random, 2) ? "true" : "false").append(",\r\n");
+        json.append("                \"padding\": \"8, 8, 8, 8\",\r\n");
+        json.append("                \"cursorShape\": \"bar\",\r\n");
+        json.append("                \"hidden\": false\r\n");
+        json.append(i + 1 < profiles ? "            },\r\n" : "            }\r\n");
+    }
+    json.append("        ]\r\n");
+    json.append("    },\r\n");
+    json.append("    \"schemes\": [\r\n");
+    const auto schemes = (profiles + 3) / 4;
+    for (size_t i = 0; i < schemes; ++i)
+    {
+        json.append("        {\r\n");
+        json.append("            \"name\": \"Scheme ").append(std::to_string(i)).append("\",\r\n");
+        for (const auto key : { "background", "foreground", "black", "red", "green", "yellow", "blue", "purple", "cyan", "white" })
+        {
+            json.append("            \"").append(key).append("\": \"").append(color()).append("\",\r\n");
+        }
+        json.append("            \"cursorColor\": \"").append(color()).append("\"\r\n");
+        json.append(i + 1 < schemes ? "        },\r\n" : "        }\r\n");
+    }
+    json.append("    ],\r\n");
+    json.append("    \"actions\": [\r\n");
+    for (size_t i = 0; i < schemes; ++i)
+    {
+        json.append("        { \"command\": { \"action\": \"newTab\", \"index\": ").append(std::to_string(i)).append(" }, ");
+        json.append("\"keys\": \"ctrl+alt+shift+").append(std::to_string(i % 10)).append("\" }");
+        json.append(i + 1 < schemes ? ",\r\n" : "\r\n");
+    }
+    json.append("    ]\r\n");
+    json.append("}\r\n");
+    return json;
+}
+
+std::string Microsoft::Terminal::Core::Benchmarks::FragmentJson(const size_t index)
+{
+    std::mt19937 random{ static_cast<std::mt19937::result_type>(0x5eed + index) };
+    char hex[8];
+    char guid[48];
+
+    std::string json;
+    json.append("{\r\n");
+    json.append("    \"profiles\": [\r\n");
+    snprintf(&guid[0], sizeof(guid), "{%08X-0000-0000-0000-000000000000}", static_cast<unsigned>(index));
+    json.append("        { \"updates\": \"").append(&guid[0]).append("\", \"tabTitle\": \"Fragment ").append(std::to_string(index)).append("\" },\r\n");
+    snprintf(&guid[0], sizeof(guid), "{%08X-0000-0000-0000-00000000F4A6}", static_cast<unsigned>(index));
+    json.append("        {\r\n");
+    json.append("            \"guid\": \"").append(&guid[0]).append("\",\r\n");
+    json.append("            \"name\": \"Fragment ").append(std::to_string(index)).append("\",\r\n");
+    json.append("            \"commandline\": \"fragment.exe --index ").append(std::to_string(index)).append("\",\r\n");
+    json.append("            \"colorScheme\": \"Fragment Scheme ").append(std::to_string(index)).append("\"\r\n");
+    json.append("        }\r\n");
+    json.append("    ],\r\n");
+    json.append("    \"schemes\": [\r\n");
+    json.append("        {\r\n");
+    json.append("            \"name\": \"Fragment Scheme ").append(std::to_string(index)).append("\",\r\n");
+    for (const auto key : { "background", "foreground", "black", "red", "green", "yellow", "blue", "purple", "cyan", "white" })
+    {
+        snprintf(&hex[0], sizeof(hex), "#%06X", number(random, 0x1000000));
+        json.append("            \"").append(key).append("\": \"").append(&hex[0]).append("\",\r\n");
+    }
+    snprintf(&hex[0], sizeof(hex), "#%06X", number(random, 0x1000000));
+    json.append("            \"cursorColor\": \"").append(&hex[0]).append("\"\r\n");
+    json.append("        }\r\n");
+    json.append("    ]\r\n");
+    json.append("}\r\n");
+    return json;
+}
@@ -0,0 +1,46 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+// Module Name:
+// - Corpus.hpp
+//
+// Abstract:
+// - Generates the text the benchmarks feed to TerminalCore. The text looks
+//   like typical terminal output, but is made up from a fixed seed, so every
+//   run (and every machine) measures the exact same input.
+// - Every function returns whole lines, each one ending in "\r\n", that add up
+//   to at least `length` code units.
+// - It also generates settings.json files, for the benchmarks of the settings
+//   model.
+
+#pragma once
+
+#include <string>
+
+namespace Microsoft::Terminal::Core::Benchmarks
+{
+    // Timestamped log lines in plain ASCII, with the odd SGR sequence.
+    std::wstring AsciiLog(const size_t length);
+
+    // CJK ideographs, which all take up two columns.
+    std::wstring CjkText(const size_t length);
+
+    // Emoji outside of the BMP, so every glyph is a surrogate pair.
+    std::wstring EmojiText(const size_t length);
+
+    // Compiler diagnostics, some of which link to the documentation.
+    std::wstring CompilerLog(const size_t length);
+
+    // Pretty printed JSON, some of whose values are URLs.
+    std::wstring JsonDump(const size_t length);
+
+    // A settings.json with the given number of profiles, and a color scheme
+    // and a key binding for every few of them, the way users write it,
+    // comments included.
+    std::string SettingsJson(const size_t profiles);
+
+    // A fragment the way an application extension installs one: it updates
+    // one of the profiles of SettingsJson, and adds a profile and a color
+    // scheme of its own. `index` makes every fragment a different one.
+    std::string FragmentJson(const size_t index);
+}
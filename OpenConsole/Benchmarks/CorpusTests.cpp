@@ -0,0 +1,80 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include <gtest/gtest.h>
+
+#include "Corpus.hpp"
+
+using namespace Microsoft::Terminal::Core::Benchmarks;
+
+namespace
+{
+    constexpr size_t length = 64 * 1024;
+}
+
+TEST(CorpusTests, IsDeterministic)
+{
+    EXPECT_EQ(AsciiLog(length), AsciiLog(length));
+    EXPECT_EQ(CjkText(length), CjkText(length));
+    EXPECT_EQ(EmojiText(length), EmojiText(length));
+    EXPECT_EQ(CompilerLog(length), CompilerLog(length));
+    EXPECT_EQ(JsonDump(length), JsonDump(length));
+    EXPECT_EQ(SettingsJson(100), SettingsJson(100));
+    EXPECT_EQ(FragmentJson(7), FragmentJson(7));
+    EXPECT_NE(FragmentJson(7), FragmentJson(8));
+}
+
+TEST(CorpusTests, EndsInWholeLines)
+{
+    for (const auto& text : { AsciiLog(length), CjkText(length), EmojiText(length), CompilerLog(length), JsonDump(length) })
+    {
+        EXPECT_GE(text.size(), length);
+        EXPECT_LT(text.size(), length + 1024);
+        EXPECT_EQ(L"\r\n", text.substr(text.size() - 2));
+    }
+}
+
+TEST(CorpusTests, AsciiLogIsAscii)
+{
+    for (const auto ch : AsciiLog(length))
+    {
+        ASSERT_LT(ch, 0x80);
+    }
+}
+
+TEST(CorpusTests, CjkTextIsIdeographs)
+{
+    for (const auto ch : CjkText(length))
+    {
+        if (ch != L'\r' && ch != L'\n')
+        {
+            ASSERT_GE(ch, 0x4E00);
+            ASSERT_LE(ch, 0x9FFF);
+        }
+    }
+}
+
+TEST(CorpusTests, EmojiTextIsSurrogatePairs)
+{
+    const auto text = EmojiText(length);
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+        if (text[i] == L'\r' || text[i] == L'\n')
+        {
+            continue;
+        }
+        ASSERT_GE(text[i], 0xD800);
+        ASSERT_LE(text[i], 0xDBFF);
+        ASSERT_LT(i + 1, text.size());
+        ++i;
+        ASSERT_GE(text[i], 0xDC00);
+        ASSERT_LE(text[i], 0xDFFF);
+    }
+}
+
+TEST(CorpusTests, SomeLinesContainUrls)
+{
+    EXPECT_NE(std::wstring::npos, CompilerLog(length).find(L"https://"));
+    EXPECT_NE(std::wstring::npos, JsonDump(length).find(L"https://"));
+    EXPECT_EQ(std::wstring::npos, AsciiLog(length).find(L"://"));
+}
@@ -0,0 +1,145 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+// Once its settings were flattened, an IInheritable returns them without
+// walking its parents. They still have to follow every change to the object
+// itself and to any of its ancestors, and to the ancestors themselves.
+
+#include "pch.h"
+#include "winrt.h"
+#include "IInheritable.h"
+
+#include <gtest/gtest.h>
+
+namespace winrt::Microsoft::Terminal::Settings::Model::implementation
+{
+    struct Settings;
+
+    // What <NAME>OverrideSource() returns, like the projected type would.
+    struct SettingsSource
+    {
+        SettingsSource(std::nullptr_t) noexcept {}
+        SettingsSource(const Settings& settings) noexcept :
+            settings{ &settings } {}
+
+        explicit operator bool() const noexcept
+        {
+            return settings != nullptr;
+        }
+
+        const Settings* settings{ nullptr };
+    };
+
+    struct Settings : IInheritable<Settings>, std::enable_shared_from_this<Settings>
+    {
+        void FlattenInheritedSettings()
+        {
+            _FlattenValue();
+            _FlattenOther();
+        }
+
+        INHERITABLE_SETTING(SettingsSource, int, Value, 0);
+        INHERITABLE_SETTING(SettingsSource, int, Other, 0);
+    };
+}
+
+using winrt::com_ptr;
+using winrt::Microsoft::Terminal::Settings::Model::implementation::Settings;
+
+namespace
+{
+    com_ptr<Settings> makeSettings(const int value)
+    {
+        auto settings = winrt::make_self<Settings>();
+        settings->Value(value);
+        return settings;
+    }
+}
+
+TEST(InheritableTests, ChildSeesParentChangesAfterFlattening)
+{
+    const auto parent = makeSettings(1);
+    const auto child = parent->CreateChild();
+    child->FlattenInheritedSettings();
+    ASSERT_EQ(1, child->Value());
+
+    parent->Value(2);
+    EXPECT_EQ(2, child->Value());
+
+    // Again, now that the child cached the new value with its getter.
+    parent->Value(3);
+    EXPECT_EQ(3, child->Value());
+
+    parent->ClearValue();
+    EXPECT_EQ(0, child->Value());
+    EXPECT_FALSE(child->ValueOverrideSource());
+}
+
+TEST(InheritableTests, ChildSeesGrandparentChangesAfterFlattening)
+{
+    const auto grandparent = makeSettings(1);
+    const auto parent = grandparent->CreateChild();
+    const auto child = parent->CreateChild();
+    grandparent->FlattenInheritedSettings();
+    parent->FlattenInheritedSettings();
+    child->FlattenInheritedSettings();
+    ASSERT_EQ(1, child->Value());
+
+    grandparent->Value(2);
+    EXPECT_EQ(2, child->Value());
+    EXPECT_EQ(2, parent->Value());
+
+    // The parent overrides the grandparent from here on.
+    parent->Value(3);
+    grandparent->Value(4);
+    EXPECT_EQ(3, child->Value());
+    EXPECT_EQ(parent.get(), child->ValueOverrideSource().settings);
+}
+
+TEST(InheritableTests, ChildSeesParentChangesAfterSiblingChanged)
+{
+    // A change to one child doesn't make the other one's flattened settings
+    // stale. That mustn't hide a later change to their parent.
+    const auto parent = makeSettings(1);
+    const auto child = parent->CreateChild();
+    const auto sibling = parent->CreateChild();
+    child->FlattenInheritedSettings();
+    sibling->FlattenInheritedSettings();
+
+    sibling->Value(5);
+    EXPECT_EQ(1, child->Value());
+    EXPECT_EQ(5, sibling->Value());
+
+    parent->Value(2);
+    EXPECT_EQ(2, child->Value());
+    EXPECT_EQ(5, sibling->Value());
+
+    parent->Other(7);
+    EXPECT_EQ(7, child->Other());
+    EXPECT_EQ(7, sibling->Other());
+}
+
+TEST(InheritableTests, ChildSeesChangedParents)
+{
+    const auto parent = makeSettings(1);
+    const auto other = makeSettings(2);
+    const auto child = parent->CreateChild();
+    child->FlattenInheritedSettings();
+    ASSERT_EQ(1, child->Value());
+
+    child->AddMostImportantParent(other);
+    EXPECT_EQ(2, child->Value());
+
+    child->ClearParents();
+    EXPECT_EQ(0, child->Value());
+
+    child->AddLeastImportantParent(parent);
+    EXPECT_EQ(1, child->Value());
+
+    // Its own value beats any parent's.
+    child->Value(3);
+    parent->Value(4);
+    EXPECT_EQ(3, child->Value());
+    child->ClearValue();
+    EXPECT_EQ(4, child->Value());
+}
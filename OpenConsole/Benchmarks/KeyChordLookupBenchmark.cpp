@@ -0,0 +1,189 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+// Compares looking up the key chords of a stream of key presses in a
+// KeyChordTable with the layered lookup ActionMap did before: a hash map per
+// layer, asked one after the other until one of them has the key chord. The
+// layers are the bindings of defaults.json and a user's settings.json, which
+// also unbinds a few of the defaults. Most key presses are plain typing,
+// which isn't bound in any layer, and so had to ask all of them.
+//
+// The layered lookup here hashes and compares key chords as KeyChord::Hash()
+// and KeyChord::DeepEquals() do, but without calling them through WinRT, so
+// it's faster than what ActionMap did.
+
+#include "pch.h"
+#include "KeyChordTable.h"
+
+#include <random>
+#include <unordered_map>
+
+#include <benchmark/benchmark.h>
+
+using namespace Microsoft::Terminal::Settings::Model;
+
+namespace
+{
+    constexpr uint32_t Ctrl = 1;
+    constexpr uint32_t Alt = 2;
+    constexpr uint32_t Shift = 4;
+
+    struct KeyChord
+    {
+        uint32_t modifiers;
+        uint32_t vkey;
+        uint32_t scanCode;
+    };
+
+    struct KeyChordHash
+    {
+        size_t operator()(const KeyChord& keys) const noexcept
+        {
+            auto h = static_cast<uint64_t>(keys.modifiers) << 32;
+            h |= keys.vkey ? keys.vkey : (keys.scanCode | 0xBABE0000);
+            h ^= h >> 33;
+            h *= UINT64_C(0xff51afd7ed558ccd);
+            h ^= h >> 33;
+            h *= UINT64_C(0xc4ceb9fe1a85ec53);
+            h ^= h >> 33;
+            return static_cast<size_t>(h);
+        }
+    };
+
+    struct KeyChordEquality
+    {
+        bool operator()(const KeyChord& lhs, const KeyChord& rhs) const noexcept
+        {
+            return lhs.modifiers == rhs.modifiers && ((lhs.vkey | rhs.vkey) ? lhs.vkey == rhs.vkey : lhs.scanCode == rhs.scanCode);
+        }
+    };
+
+    // The command of a key chord. 0 stands for an explicitly unbound one.
+    using Layer = std::unordered_map<KeyChord, int, KeyChordHash, KeyChordEquality>;
+
+    // The bindings of defaults.json, followed by those of settings.json.
+    std::vector<Layer> layers()
+    {
+        Layer defaults;
+        auto command = 1;
+        for (uint32_t vkey = 'A'; vkey <= 'Z'; ++vkey)
+        {
+            defaults.emplace(KeyChord{ Ctrl | Shift, vkey, 0 }, command++);
+        }
+        for (uint32_t vkey = '0'; vkey <= '9'; ++vkey)
+        {
+            defaults.emplace(KeyChord{ Ctrl | Alt, vkey, 0 }, command++);
+            defaults.emplace(KeyChord{ Ctrl | Shift, vkey, 0 }, command++);
+        }
+        // F1 to F12, the arrow keys, page up and down, home and end.
+        for (uint32_t vkey = 0x70; vkey <= 0x7B; ++vkey)
+        {
+            defaults.emplace(KeyChord{ 0, vkey, 0 }, command++);
+        }
+        for (uint32_t vkey = 0x21; vkey <= 0x28; ++vkey)
+        {
+            defaults.emplace(KeyChord{ Alt | Shift, vkey, 0 }, command++);
+            defaults.emplace(KeyChord{ Ctrl | Shift, vkey, 0 }, command++);
+        }
+        // ctrl+shift+` and the like are bound by scan code.
+        defaults.emplace(KeyChord{ Ctrl | Shift, 0, 0x29 }, command++);
+
+        Layer user;
+        for (const auto vkey : { 'C', 'V', 'F', 'W' })
+        {
+            user.emplace(KeyChord{ Ctrl, static_cast<uint32_t>(vkey), 0 }, command++);
+        }
+        for (const auto vkey : { 'D', 'E', 'P' })
+        {
+            user.emplace(KeyChord{ Ctrl | Shift, static_cast<uint32_t>(vkey), 0 }, 0);
+        }
+        return { std::move(user), std::move(defaults) };
+    }
+
+    // Key presses: mostly typing, and a bound key chord every now and then.
+    std::vector<KeyChord> keyPresses(const std::vector<Layer>& layers)
+    {
+        std::vector<KeyChord> bound;
+        for (const auto& layer : layers)
+        {
+            for (const auto& [keys, command] : layer)
+            {
+                bound.emplace_back(keys);
+            }
+        }
+
+        std::mt19937 random{ 42 };
+        std::vector<KeyChord> presses;
+        for (size_t i = 0; i < 4096; ++i)
+        {
+            if (random() % 10 == 0)
+            {
+                presses.emplace_back(bound[random() % bound.size()]);
+            }
+            else
+            {
+                presses.emplace_back(KeyChord{ random() % 8 == 0 ? Shift : 0, static_cast<uint32_t>('A' + random() % 26), 0 });
+            }
+        }
+        return presses;
+    }
+
+    // What ActionMap::_GetActionByKeyChordInternal did: ask one layer after the other.
+    std::optional<int> findInLayers(const std::vector<Layer>& layers, const KeyChord& keys)
+    {
+        for (const auto& layer : layers)
+        {
+            if (const auto it = layer.find(keys); it != layer.end())
+            {
+                return it->second;
+            }
+        }
+        return std::nullopt;
+    }
+
+    void LookUpLayered(benchmark::State& state)
+    {
+        const auto bindings = layers();
+        const auto presses = keyPresses(bindings);
+        for (auto _ : state)
+        {
+            for (const auto& keys : presses)
+            {
+                benchmark::DoNotOptimize(findInLayers(bindings, keys));
+            }
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * presses.size()));
+    }
+
+    void LookUpFlattened(benchmark::State& state)
+    {
+        const auto bindings = layers();
+        const auto presses = keyPresses(bindings);
+
+        size_t count = 0;
+        for (const auto& layer : bindings)
+        {
+            count += layer.size();
+        }
+        KeyChordTable<int> table{ count };
+        for (const auto& layer : bindings)
+        {
+            for (const auto& [keys, command] : layer)
+            {
+                table.Insert(KeyChordTable<int>::Pack(keys.modifiers, keys.vkey, keys.scanCode), command);
+            }
+        }
+
+        for (auto _ : state)
+        {
+            for (const auto& keys : presses)
+            {
+                benchmark::DoNotOptimize(table.Find(KeyChordTable<int>::Pack(keys.modifiers, keys.vkey, keys.scanCode)));
+            }
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * presses.size()));
+    }
+}
+
+BENCHMARK(LookUpLayered);
+BENCHMARK(LookUpFlattened);
@@ -0,0 +1,114 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+// A KeyChordTable filled with the layers of an ActionMap, most important
+// first, has to find exactly what asking the layers one after the other finds.
+
+#include "pch.h"
+#include "KeyChordTable.h"
+
+#include <map>
+#include <random>
+
+#include <gtest/gtest.h>
+
+using namespace Microsoft::Terminal::Settings::Model;
+
+namespace
+{
+    using Table = KeyChordTable<std::string>;
+
+    constexpr auto pack = Table::Pack;
+}
+
+TEST(KeyChordTableTests, EmptyTableFindsNothing)
+{
+    const Table empty;
+    EXPECT_TRUE(empty.empty());
+    EXPECT_EQ(nullptr, empty.Find(pack(1, 'A', 0)));
+
+    const Table sized{ 0 };
+    EXPECT_FALSE(sized.empty());
+    EXPECT_EQ(nullptr, sized.Find(pack(1, 'A', 0)));
+}
+
+TEST(KeyChordTableTests, FirstValueWins)
+{
+    Table table{ 3 };
+    table.Insert(pack(1, 'A', 0), "user");
+    table.Insert(pack(1, 'A', 0), "defaults");
+    // An explicitly unbound key chord hides the bindings of the layers below.
+    table.Insert(pack(1, 'B', 0), "");
+    table.Insert(pack(1, 'B', 0), "defaults");
+
+    ASSERT_NE(nullptr, table.Find(pack(1, 'A', 0)));
+    EXPECT_EQ("user", *table.Find(pack(1, 'A', 0)));
+    ASSERT_NE(nullptr, table.Find(pack(1, 'B', 0)));
+    EXPECT_EQ("", *table.Find(pack(1, 'B', 0)));
+    EXPECT_EQ(nullptr, table.Find(pack(1, 'C', 0)));
+}
+
+TEST(KeyChordTableTests, PacksLikeDeepEquals)
+{
+    // The scan code only counts if there's no vkey...
+    EXPECT_EQ(pack(1, 'A', 0x1E), pack(1, 'A', 0));
+    EXPECT_NE(pack(1, 0, 0x1E), pack(1, 0, 0x1F));
+    // ...and a scan code is never mistaken for a vkey.
+    EXPECT_NE(pack(1, 0x1E, 0), pack(1, 0, 0x1E));
+    EXPECT_NE(pack(1, 'A', 0), pack(2, 'A', 0));
+    EXPECT_NE(0u, pack(0, 0, 0));
+}
+
+TEST(KeyChordTableTests, MatchesLayeredLookup)
+{
+    std::mt19937 random{ 1 };
+    const auto randomKeys = [&]() {
+        const auto modifiers = static_cast<uint32_t>(random() % 8);
+        return random() % 4 == 0 ? pack(modifiers, 0, static_cast<uint32_t>(random() % 64)) : pack(modifiers, static_cast<uint32_t>('A' + random() % 26), 0);
+    };
+
+    for (auto round = 0; round < 50; ++round)
+    {
+        std::vector<std::map<uint64_t, std::string>> layers(1 + random() % 3);
+        size_t count = 0;
+        for (size_t i = 0; i < layers.size(); ++i)
+        {
+            for (auto n = random() % 100; n > 0; --n)
+            {
+                const auto keys = randomKeys();
+                layers[i][keys] = random() % 8 == 0 ? "" : std::to_string(i) + ":" + std::to_string(keys);
+            }
+            count += layers[i].size();
+        }
+
+        Table table{ count };
+        for (const auto& layer : layers)
+        {
+            for (const auto& [keys, command] : layer)
+            {
+                table.Insert(keys, command);
+            }
+        }
+
+        for (auto i = 0; i < 1000; ++i)
+        {
+            const auto keys = randomKeys();
+            const std::string* expected = nullptr;
+            for (const auto& layer : layers)
+            {
+                if (const auto it = layer.find(keys); it != layer.end())
+                {
+                    expected = &it->second;
+                    break;
+                }
+            }
+
+            const auto found = table.Find(keys);
+            ASSERT_EQ(expected == nullptr, found == nullptr) << "for " << keys;
+            if (expected)
+            {
+                EXPECT_EQ(*expected, *found);
+            }
+        }
+    }
+}
@@ -0,0 +1,328 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+// Drives OutputBatcher the way the output thread of ConptyConnection does,
+// over a local pipe that a producer thread floods with output, and counts
+// how many TerminalOutput events each MB of output takes.
+
+#include "pch.h"
+#include "OutputBatcher.h"
+
+#include <iostream>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#ifndef _WIN32
+#include <poll.h>
+#endif
+
+using namespace Microsoft::Terminal::TerminalConnection;
+using namespace std::chrono_literals;
+
+namespace
+{
+    constexpr size_t MB = 1024 * 1024;
+
+    // A pipe, with the calls the output thread makes on it. On Windows, it's
+    // created like ConptyConnection's output pipe.
+    class Pipe
+    {
+    public:
+        Pipe()
+        {
+#ifdef _WIN32
+            static std::atomic<DWORD> serial{ 0 };
+            wchar_t name[MAX_PATH];
+            swprintf_s(&name[0], ARRAYSIZE(name), L"\\\\.\\pipe\\Local\\OutputBatcherTests.%lu.%lu", GetCurrentProcessId(), serial.fetch_add(1));
+            _read = CreateNamedPipeW(&name[0], PIPE_ACCESS_INBOUND | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE, PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS, 1, 0, 64 * 1024, 0, nullptr);
+            EXPECT_NE(INVALID_HANDLE_VALUE, _read);
+            _write = CreateFileW(&name[0], GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, 0, nullptr);
+            EXPECT_NE(INVALID_HANDLE_VALUE, _write);
+            _overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+#else
+            int fds[2];
+            EXPECT_EQ(0, pipe(&fds[0]));
+            _read = fds[0];
+            _write = fds[1];
+#endif
+        }
+
+        ~Pipe()
+        {
+            CloseWrite();
+#ifdef _WIN32
+            if (_pending)
+            {
+                DWORD read = 0;
+                CancelIoEx(_read, &_overlapped);
+                GetOverlappedResult(_read, &_overlapped, &read, TRUE);
+            }
+            CloseHandle(_read);
+            CloseHandle(_overlapped.hEvent);
+#else
+            close(_read);
+#endif
+        }
+
+        Pipe(const Pipe&) = delete;
+        Pipe& operator=(const Pipe&) = delete;
+
+        void Write(const char* data, size_t size)
+        {
+            while (size != 0)
+            {
+#ifdef _WIN32
+                DWORD written = 0;
+                ASSERT_TRUE(WriteFile(_write, data, static_cast<DWORD>(size), &written, nullptr));
+#else
+                const auto written = write(_write, data, size);
+                ASSERT_GT(written, 0);
+#endif
+                data += written;
+                size -= static_cast<size_t>(written);
+            }
+        }
+
+        void CloseWrite()
+        {
+            if (_writeOpen)
+            {
+#ifdef _WIN32
+                CloseHandle(_write);
+#else
+                close(_write);
+#endif
+                _writeOpen = false;
+            }
+        }
+
+        // Like ConptyConnection::_readOutput: waits for at most `timeout`, or
+        // for as long as it takes without one. Returns nothing if that wasn't
+        // long enough, and 0 once the pipe is closed. On Windows, a read that
+        // times out stays pending, and the next one picks it up.
+        std::optional<uint32_t> Read(const uint32_t size, const std::optional<std::chrono::milliseconds> timeout = std::nullopt)
+        {
+#ifdef _WIN32
+            if (!_pending)
+            {
+                _buffer.resize(std::max<size_t>(_buffer.size(), size));
+                const auto event = _overlapped.hEvent;
+                _overlapped = {};
+                _overlapped.hEvent = event;
+                if (!ReadFile(_read, _buffer.data(), size, nullptr, &_overlapped) && GetLastError() != ERROR_IO_PENDING)
+                {
+                    return 0;
+                }
+                _pending = true;
+            }
+            if (WaitForSingleObject(_overlapped.hEvent, timeout ? static_cast<DWORD>(timeout->count()) : INFINITE) == WAIT_TIMEOUT)
+            {
+                return std::nullopt;
+            }
+            _pending = false;
+            DWORD read = 0;
+            return GetOverlappedResult(_read, &_overlapped, &read, FALSE) ? read : 0;
+#else
+            if (timeout)
+            {
+                pollfd fd{ _read, POLLIN, 0 };
+                if (poll(&fd, 1, static_cast<int>(timeout->count())) == 0)
+                {
+                    return std::nullopt;
+                }
+            }
+            _buffer.resize(std::max<size_t>(_buffer.size(), size));
+            const auto read = ::read(_read, _buffer.data(), size);
+            return read > 0 ? static_cast<uint32_t>(read) : 0;
+#endif
+        }
+
+    private:
+#ifdef _WIN32
+        HANDLE _read;
+        HANDLE _write;
+        OVERLAPPED _overlapped{};
+        bool _pending{ false };
+#else
+        int _read;
+        int _write;
+#endif
+        bool _writeOpen{ true };
+        std::vector<char> _buffer;
+    };
+
+    struct Events
+    {
+        size_t count{ 0 };
+        size_t bytes{ 0 };
+    };
+
+    // The loop of ConptyConnection::_OutputThread, minus the decoding.
+    Events readAll(Pipe& pipe, OutputBatcher& batcher)
+    {
+        Events events;
+        while (true)
+        {
+            batcher.BeginBatch();
+            size_t batch = 0;
+            std::optional<std::chrono::milliseconds> timeout;
+            while (true)
+            {
+                const auto read = pipe.Read(batcher.ReadSize(), timeout);
+                if (!read || *read == 0)
+                {
+                    break;
+                }
+                batch += *read;
+                batcher.Read(*read);
+                if (!batcher.MayCoalesce())
+                {
+                    break;
+                }
+                timeout = std::chrono::ceil<std::chrono::milliseconds>(batcher.Patience());
+            }
+            if (batch == 0)
+            {
+                return events;
+            }
+            ++events.count;
+            events.bytes += batch;
+        }
+    }
+
+    // Floods a pipe with the given amount of output, in writes of 4KB like
+    // conpty's, and returns the events the output thread raised for it.
+    Events flood(const size_t size, const std::chrono::milliseconds window)
+    {
+        Pipe pipe;
+        std::thread producer{ [&]() {
+            const std::string chunk(4096, 'x');
+            for (size_t written = 0; written < size; written += chunk.size())
+            {
+                pipe.Write(chunk.data(), chunk.size());
+            }
+            pipe.CloseWrite();
+        } };
+
+        OutputBatcher batcher{ 64 * 1024, window };
+        const auto events = readAll(pipe, batcher);
+        producer.join();
+        return events;
+    }
+}
+
+TEST(OutputBatcherTests, CoalescesFloodsOfOutput)
+{
+    // With a single CPU, the producer only refills the pipe while the output
+    // thread waits, and it's preempted as soon as a write wakes the output
+    // thread up. Reads then rarely find more output waiting, so there's
+    // little to coalesce, which is just how it should be.
+    if (std::thread::hardware_concurrency() < 2)
+    {
+        GTEST_SKIP() << "needs the producer and the output thread to run at the same time";
+    }
+
+    constexpr size_t size = 64 * MB;
+    const auto uncoalesced = flood(size, 0ms);
+    const auto coalesced = flood(size, OutputBatcher::DefaultCoalescingWindow);
+    ASSERT_EQ(size, uncoalesced.bytes);
+    ASSERT_EQ(size, coalesced.bytes);
+
+    const auto perMB = [](const Events& events) { return static_cast<double>(events.count) / static_cast<double>(events.bytes / MB); };
+    RecordProperty("events_per_mb_uncoalesced", std::to_string(perMB(uncoalesced)));
+    RecordProperty("events_per_mb_coalesced", std::to_string(perMB(coalesced)));
+    std::cout << "TerminalOutput events per MB: " << perMB(uncoalesced) << " uncoalesced, " << perMB(coalesced) << " coalesced\n";
+
+    // Without coalescing, every read is an event. Reads are capped at
+    // 64KB, so that's at least 16 per MB. A coalesced batch takes up to
+    // 4MB, unless the pipe runs dry first, so there are far fewer.
+    EXPECT_GE(perMB(uncoalesced), 16.0);
+    EXPECT_LT(perMB(coalesced), perMB(uncoalesced) / 2);
+}
+
+TEST(OutputBatcherTests, PassesOnASingleEchoAtOnce)
+{
+    Pipe pipe;
+    OutputBatcher batcher{ 64 * 1024, OutputBatcher::MaxCoalescingWindow };
+
+    // A keystroke echo, and nothing after it: the batch ends with the read,
+    // instead of waiting out the window for more.
+    pipe.Write("a", 1);
+    const auto start = std::chrono::steady_clock::now();
+    batcher.BeginBatch();
+    ASSERT_EQ(1u, pipe.Read(batcher.ReadSize()));
+    batcher.Read(1);
+    EXPECT_TRUE(batcher.MayCoalesce());
+    EXPECT_EQ(std::chrono::steady_clock::duration::zero(), batcher.Patience());
+    EXPECT_FALSE(pipe.Read(batcher.ReadSize(), 0ms));
+    EXPECT_LT(std::chrono::steady_clock::now() - start, OutputBatcher::MaxCoalescingWindow);
+
+    // The same goes for a screenful of output, which only fills the read
+    // size it started out with.
+    const std::string screen(OutputBatcher::MinReadSize, 'x');
+    pipe.Write(screen.data(), screen.size());
+    batcher.BeginBatch();
+    ASSERT_EQ(OutputBatcher::MinReadSize, pipe.Read(batcher.ReadSize()));
+    batcher.Read(OutputBatcher::MinReadSize);
+    EXPECT_EQ(std::chrono::steady_clock::duration::zero(), batcher.Patience());
+}
+
+TEST(OutputBatcherTests, WaitsForOutputUntilItArrives)
+{
+    // Under sustained load, the output thread waits for more output, but
+    // only until it arrives, not for the rest of the window.
+    Pipe pipe;
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_FALSE(pipe.Read(OutputBatcher::MinReadSize, 20ms));
+    EXPECT_GE(std::chrono::steady_clock::now() - start, 20ms);
+
+    std::thread producer{ [&]() {
+        std::this_thread::sleep_for(20ms);
+        pipe.Write("a", 1);
+    } };
+    start = std::chrono::steady_clock::now();
+    EXPECT_EQ(1u, pipe.Read(OutputBatcher::MinReadSize, 10s));
+    EXPECT_LT(std::chrono::steady_clock::now() - start, 5s);
+    producer.join();
+}
+
+TEST(OutputBatcherTests, GrowsAndShrinksTheReadSize)
+{
+    OutputBatcher batcher{ 64 * 1024, 0ms };
+    EXPECT_EQ(OutputBatcher::MinReadSize, batcher.ReadSize());
+
+    // Full reads double it, up to the maximum.
+    for (auto i = 0; i < 10; ++i)
+    {
+        batcher.Read(batcher.ReadSize());
+    }
+    EXPECT_EQ(64u * 1024, batcher.ReadSize());
+
+    // A run of small reads halves it, but only a whole run.
+    for (auto i = 0; i < 7; ++i)
+    {
+        batcher.Read(1);
+    }
+    EXPECT_EQ(64u * 1024, batcher.ReadSize());
+    batcher.Read(1);
+    EXPECT_EQ(32u * 1024, batcher.ReadSize());
+}
+
+TEST(OutputBatcherTests, ClampsItsSettings)
+{
+    OutputBatcher tooSmall{ 1, 0ms };
+    tooSmall.Read(tooSmall.ReadSize());
+    EXPECT_EQ(OutputBatcher::MinReadSize, tooSmall.ReadSize());
+
+    OutputBatcher tooLarge{ UINT32_MAX, 0ms };
+    for (auto i = 0; i < 20; ++i)
+    {
+        tooLarge.Read(tooLarge.ReadSize());
+    }
+    EXPECT_EQ(OutputBatcher::MaxReadSize, tooLarge.ReadSize());
+
+    // No window, no coalescing.
+    tooLarge.BeginBatch();
+    EXPECT_FALSE(tooLarge.MayCoalesce());
+}
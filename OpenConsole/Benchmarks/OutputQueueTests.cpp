@@ -0,0 +1,148 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+// Every chunk pushed into an OutputQueue has to come out of it unchanged and
+// in order, while a producer and a consumer thread race each other. The queue
+// must neither hold on to more than its budget of code units, nor keep the
+// storage of a large chunk once it's been popped.
+
+#include "pch.h"
+#include "OutputQueue.h"
+
+#include <thread>
+
+#include <gtest/gtest.h>
+
+using namespace winrt::Microsoft::Terminal::Control::implementation;
+
+namespace
+{
+    std::wstring makeChunk(const size_t index)
+    {
+        const auto length = (index * 7919) % 3000 + 1;
+        return std::wstring(length, static_cast<wchar_t>(L'a' + index % 26));
+    }
+
+    size_t retainedCapacity(OutputQueue& queue)
+    {
+        // Fill every slot with an empty chunk and look at what each one kept.
+        for (size_t i = 0; i < OutputQueue::Capacity; ++i)
+        {
+            EXPECT_TRUE(queue.TryPush({}));
+        }
+        size_t capacity = 0;
+        for (size_t i = 0; i < OutputQueue::Capacity; ++i)
+        {
+            capacity += queue.Front()->capacity();
+            queue.Pop();
+        }
+        return capacity;
+    }
+}
+
+TEST(OutputQueueTests, HoldsCapacityChunks)
+{
+    OutputQueue queue;
+    for (size_t i = 0; i < OutputQueue::Capacity; ++i)
+    {
+        ASSERT_TRUE(queue.TryPush(makeChunk(i)));
+    }
+    EXPECT_FALSE(queue.TryPush(L"x"));
+    EXPECT_EQ(OutputQueue::Capacity, queue.Size());
+
+    for (size_t i = 0; i < OutputQueue::Capacity; ++i)
+    {
+        ASSERT_NE(nullptr, queue.Front());
+        EXPECT_TRUE(makeChunk(i) == *queue.Front());
+        queue.Pop();
+    }
+    EXPECT_EQ(nullptr, queue.Front());
+    EXPECT_EQ(0u, queue.Size());
+}
+
+TEST(OutputQueueTests, IsBoundedByCodeUnits)
+{
+    OutputQueue queue;
+    const std::wstring chunk(OutputQueue::MaxQueuedCodeUnits / 4, L'x');
+    for (auto i = 0; i < 4; ++i)
+    {
+        ASSERT_TRUE(queue.TryPush(chunk));
+    }
+    EXPECT_FALSE(queue.TryPush(L"x"));
+
+    queue.Pop();
+    EXPECT_FALSE(queue.TryPush(chunk + L"x"));
+    EXPECT_TRUE(queue.TryPush(chunk));
+
+    // A chunk that's larger than the whole budget fits into an empty queue.
+    while (queue.Front())
+    {
+        queue.Pop();
+    }
+    const std::wstring huge(OutputQueue::MaxQueuedCodeUnits + 1, L'y');
+    EXPECT_TRUE(queue.TryPush(huge));
+    EXPECT_FALSE(queue.TryPush(L"x"));
+    queue.Pop();
+    EXPECT_TRUE(queue.TryPush(L"x"));
+}
+
+TEST(OutputQueueTests, ReleasesLargeChunksOnPop)
+{
+    OutputQueue queue;
+    const std::wstring chunk(OutputQueue::MaxQueuedCodeUnits / OutputQueue::Capacity * 4, L'x');
+    for (auto round = 0; round < 16; ++round)
+    {
+        while (queue.TryPush(chunk))
+        {
+        }
+        while (queue.Front())
+        {
+            queue.Pop();
+        }
+    }
+    EXPECT_LE(retainedCapacity(queue), OutputQueue::Capacity * OutputQueue::RetainedSlotCapacity);
+
+    // Small chunks keep their storage, so that pushing them doesn't allocate.
+    const std::wstring small(OutputQueue::RetainedSlotCapacity / 2, L'x');
+    ASSERT_TRUE(queue.TryPush(small));
+    queue.Pop();
+    for (size_t i = 1; i < OutputQueue::Capacity; ++i)
+    {
+        ASSERT_TRUE(queue.TryPush({}));
+        queue.Pop();
+    }
+    ASSERT_TRUE(queue.TryPush({}));
+    EXPECT_GE(queue.Front()->capacity(), small.size());
+    queue.Pop();
+}
+
+TEST(OutputQueueTests, PassesChunksBetweenThreads)
+{
+    constexpr size_t count = 200000;
+    OutputQueue queue;
+
+    std::thread producer{ [&]() {
+        for (size_t i = 0; i < count; ++i)
+        {
+            const auto chunk = makeChunk(i);
+            while (!queue.TryPush(chunk))
+            {
+                std::this_thread::yield();
+            }
+        }
+    } };
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        auto chunk = queue.Front();
+        while (!chunk)
+        {
+            std::this_thread::yield();
+            chunk = queue.Front();
+        }
+        ASSERT_TRUE(makeChunk(i) == *chunk) << "chunk " << i;
+        queue.Pop();
+    }
+    producer.join();
+    EXPECT_EQ(0u, queue.Size());
+}
@@ -0,0 +1,162 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+// A lazy resize only reflows the rows around the viewport and leaves the rest
+// for FinishReflow. Once that's done, the buffer has to look exactly like the
+// one of a terminal that reflowed all of its rows on every resize, and still
+// hold every line that was written to it.
+
+#include "pch.h"
+#include "Terminal.hpp"
+
+#include <gtest/gtest.h>
+
+using namespace Microsoft::Terminal::Core;
+
+namespace
+{
+    constexpr SHORT Scrollback = 9001;
+    constexpr SHORT Height = 30;
+    constexpr size_t Lines = 1500;
+
+    // Lines of 7 to 156 characters, so most of them wrap at any of the widths
+    // below. None is a multiple of 10 long, so none of them ends right at the
+    // edge of the buffer, where a line that fits and one that wraps into an
+    // empty row look alike.
+    std::vector<std::wstring> makeLines()
+    {
+        std::vector<std::wstring> lines;
+        for (size_t i = 0; i < Lines; ++i)
+        {
+            auto length = 7 + (i * 37) % 150;
+            if (length % 10 == 0)
+            {
+                ++length;
+            }
+
+            std::wstring line = L"line " + std::to_wstring(i) + L":";
+            for (size_t j = 0; line.size() < length; ++j)
+            {
+                line.push_back(static_cast<wchar_t>(L'a' + (i + j) % 26));
+            }
+            lines.emplace_back(std::move(line));
+        }
+        return lines;
+    }
+
+    void write(Terminal& terminal, const std::vector<std::wstring>& lines)
+    {
+        for (const auto& line : lines)
+        {
+            terminal.Write(line + L"\r\n");
+        }
+    }
+
+    struct Row
+    {
+        std::wstring text;
+        bool wrapped;
+
+        bool operator==(const Row& other) const noexcept
+        {
+            return text == other.text && wrapped == other.wrapped;
+        }
+    };
+
+    // The rows of the main buffer down to the cursor, without trailing spaces.
+    std::vector<Row> readRows(Terminal& terminal)
+    {
+        const auto& buffer = terminal.GetTextBuffer();
+        const auto bottom = terminal.GetCursorPosition().Y;
+        std::vector<Row> rows;
+        for (SHORT y = 0; y <= bottom; ++y)
+        {
+            const auto& row = buffer.GetRowByOffset(y);
+            auto text = row.GetText();
+            text.erase(text.find_last_not_of(L' ') + 1);
+            rows.push_back({ std::move(text), row.WasWrapForced() });
+        }
+        return rows;
+    }
+
+    // The rows joined back into the lines they were written as.
+    std::vector<std::wstring> joinRows(const std::vector<Row>& rows)
+    {
+        std::vector<std::wstring> lines(1);
+        for (const auto& row : rows)
+        {
+            lines.back().append(row.text);
+            if (!row.wrapped)
+            {
+                lines.emplace_back();
+            }
+        }
+        // The cursor is on the empty row after the last line.
+        lines.pop_back();
+        return lines;
+    }
+}
+
+TEST(ReflowTests, LazyResizesMatchEagerResizes)
+{
+    const auto lines = makeLines();
+
+    Terminal lazy;
+    lazy.CreateHeadless({ 80, Height }, Scrollback);
+    write(lazy, lines);
+
+    Terminal eager;
+    eager.CreateHeadless({ 80, Height }, Scrollback);
+    write(eager, lines);
+
+    // Narrower first, so that a lazy resize that didn't start over from the
+    // rows it was given would have lines that were cut in two.
+    for (const auto width : { SHORT{ 50 }, SHORT{ 100 } })
+    {
+        auto lazyLock = lazy.LockForWriting();
+        ASSERT_EQ(S_OK, lazy.UserResize({ width, Height }));
+        EXPECT_TRUE(lazy.IsReflowPending()) << "at width " << width;
+
+        auto eagerLock = eager.LockForWriting();
+        ASSERT_EQ(S_OK, eager.UserResize({ width, Height }));
+        eager.FinishReflow();
+        EXPECT_FALSE(eager.IsReflowPending());
+    }
+
+    auto lock = lazy.LockForWriting();
+    lazy.FinishReflow();
+    EXPECT_FALSE(lazy.IsReflowPending());
+
+    const auto rows = readRows(lazy);
+    EXPECT_EQ(readRows(eager), rows);
+    EXPECT_EQ(lines, joinRows(rows));
+    EXPECT_EQ(eager.GetCursorPosition(), lazy.GetCursorPosition());
+    EXPECT_EQ(eager.ViewStartIndex(), lazy.ViewStartIndex());
+    EXPECT_EQ(eager.GetScrollOffset(), lazy.GetScrollOffset());
+}
+
+TEST(ReflowTests, OutputAfterLazyResizeIsKept)
+{
+    const auto lines = makeLines();
+    const std::vector<std::wstring> before{ lines.begin(), lines.end() - 100 };
+    const std::vector<std::wstring> after{ lines.end() - 100, lines.end() };
+
+    Terminal terminal;
+    terminal.CreateHeadless({ 80, Height }, Scrollback);
+    write(terminal, before);
+
+    {
+        auto lock = terminal.LockForWriting();
+        ASSERT_EQ(S_OK, terminal.UserResize({ 50, Height }));
+        ASSERT_TRUE(terminal.IsReflowPending());
+    }
+
+    // The output goes to the reflowed rows, so the next resize has to reflow
+    // those instead of starting over from the rows it was given.
+    write(terminal, after);
+
+    auto lock = terminal.LockForWriting();
+    ASSERT_EQ(S_OK, terminal.UserResize({ 100, Height }));
+    terminal.FinishReflow();
+    EXPECT_EQ(lines, joinRows(readRows(terminal)));
+}
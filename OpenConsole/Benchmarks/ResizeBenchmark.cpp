@@ -0,0 +1,118 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+// Measures how long a resize holds up a headless Terminal with a full
+// scrollback: the resize itself, followed by the repaint ConPTY sends after
+// every resize. That's what a window that's being dragged goes through.
+//
+// DragEveryStep resizes the buffer for every step of a drag. Compare it with
+// ResizeAndRepaint, which is what's left of that drag when ControlCore's
+// _resizeBuffer throttle only resizes the buffer for the last step.
+
+#include "pch.h"
+#include "Terminal.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include "Corpus.hpp"
+
+using namespace Microsoft::Terminal::Core;
+
+namespace
+{
+    constexpr SHORT Width = 120;
+    constexpr SHORT NarrowWidth = Width - 20;
+    constexpr SHORT Height = 30;
+    // The number of SizeChanged a drag raises within one throttle interval.
+    constexpr SHORT DragSteps = 10;
+
+    // A screenful of text, written the way ConPTY repaints the viewport:
+    // from the top left, every line erased to its end.
+    std::wstring repaint()
+    {
+        const auto text = Benchmarks::AsciiLog(16 * 1024);
+
+        std::wstring repaint{ L"\x1b[?25l\x1b[H" };
+        size_t begin = 0;
+        for (auto row = 0; row < Height; ++row)
+        {
+            const auto end = text.find(L"\r\n", begin);
+            repaint.append(text, begin, std::min<size_t>(end - begin, Width - 10));
+            repaint.append(row + 1 < Height ? L"\x1b[K\r\n" : L"\x1b[K");
+            begin = end + 2;
+        }
+        repaint.append(L"\x1b[?25h");
+        return repaint;
+    }
+
+    std::unique_ptr<Terminal> createTerminal(const SHORT scrollbackLines)
+    {
+        auto terminal = std::make_unique<Terminal>();
+        terminal->CreateHeadless({ Width, Height }, scrollbackLines);
+        terminal->Write(Benchmarks::AsciiLog((scrollbackLines + Height) * size_t{ Width }));
+        return terminal;
+    }
+
+    // Resizes back and forth and repaints, like a drag does. The rows that
+    // can't be seen are left for FinishReflow.
+    void ResizeAndRepaint(benchmark::State& state)
+    {
+        const auto terminal = createTerminal(gsl::narrow<SHORT>(state.range(0)));
+        const auto text = repaint();
+
+        auto narrow = true;
+        for (auto _ : state)
+        {
+            const auto lock = terminal->LockForWriting();
+            LOG_IF_FAILED(terminal->UserResize({ narrow ? NarrowWidth : Width, Height }));
+            terminal->WriteUnderLock(text);
+            narrow = !narrow;
+        }
+
+        state.counters["pending"] = terminal->IsReflowPending() ? 1 : 0;
+    }
+
+    // The same, but every resize reflows all of the buffer, which is what
+    // happens once the size settled.
+    void ResizeAndRepaintFully(benchmark::State& state)
+    {
+        const auto terminal = createTerminal(gsl::narrow<SHORT>(state.range(0)));
+        const auto text = repaint();
+
+        auto narrow = true;
+        for (auto _ : state)
+        {
+            const auto lock = terminal->LockForWriting();
+            LOG_IF_FAILED(terminal->UserResize({ narrow ? NarrowWidth : Width, Height }));
+            terminal->FinishReflow();
+            terminal->WriteUnderLock(text);
+            narrow = !narrow;
+        }
+    }
+
+    // Every step of a drag from one width to the other resizes the buffer,
+    // and the client repaints after each of them.
+    void DragEveryStep(benchmark::State& state)
+    {
+        const auto terminal = createTerminal(gsl::narrow<SHORT>(state.range(0)));
+        const auto text = repaint();
+
+        auto narrow = true;
+        for (auto _ : state)
+        {
+            for (SHORT step = 1; step <= DragSteps; ++step)
+            {
+                const auto offset = gsl::narrow_cast<SHORT>((Width - NarrowWidth) * step / DragSteps);
+                const auto width = gsl::narrow_cast<SHORT>(narrow ? Width - offset : NarrowWidth + offset);
+                const auto lock = terminal->LockForWriting();
+                LOG_IF_FAILED(terminal->UserResize({ width, Height }));
+                terminal->WriteUnderLock(text);
+            }
+            narrow = !narrow;
+        }
+    }
+}
+
+BENCHMARK(ResizeAndRepaint)->Arg(1000)->Arg(9001)->Arg(32000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(ResizeAndRepaintFully)->Arg(1000)->Arg(9001)->Arg(32000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(DragEveryStep)->Arg(9001)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,267 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+// Every row that's still in a ScrollbackArchive has to read back exactly as
+// it was appended: its text, whether it's wrapped, and its attributes, no
+// matter whether its block was compressed or spilled, and while other rows
+// are being appended. The spill file has to go away with the archive.
+
+#include "pch.h"
+#include "ScrollbackArchive.hpp"
+
+#include <random>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "Corpus.hpp"
+
+using namespace Microsoft::Terminal::Core;
+
+namespace
+{
+    constexpr size_t Width = 80;
+
+    struct Row
+    {
+        std::wstring text;
+        bool wrapped;
+        std::string attributes;
+    };
+
+    // The lines of the corpus, cut into rows of at most Width code units.
+    // Each row gets some attribute bytes of its own, nulls included.
+    std::vector<Row> makeRows(const size_t length)
+    {
+        const auto text = Benchmarks::AsciiLog(length) + Benchmarks::CjkText(length / 4) + Benchmarks::EmojiText(length / 4);
+        std::vector<Row> rows;
+        for (size_t begin = 0; begin < text.size();)
+        {
+            const auto end = text.find(L"\r\n", begin);
+            for (auto row = begin; row < end; row += Width)
+            {
+                std::string attributes;
+                for (auto i = rows.size() % 13; i > 0; --i)
+                {
+                    attributes.push_back(static_cast<char>(rows.size() * i));
+                }
+                rows.push_back({ text.substr(row, std::min(Width, end - row)), row + Width < end, std::move(attributes) });
+            }
+            begin = end + 2;
+        }
+        return rows;
+    }
+
+    void append(ScrollbackArchive& archive, const std::vector<Row>& rows)
+    {
+        for (const auto& row : rows)
+        {
+            archive.Append(row.text, row.wrapped, row.attributes);
+        }
+    }
+
+    // Reads the given row back, and compares it to what was appended.
+    void expectRow(const ScrollbackArchive& archive, const std::vector<Row>& rows, const int64_t row)
+    {
+        std::wstring text;
+        auto wrapped = false;
+        std::string attributes;
+        ASSERT_TRUE(archive.ReadRow(row, text, wrapped)) << "row " << row;
+        ASSERT_TRUE(archive.ReadRowAttributes(row, attributes)) << "row " << row;
+        const auto& expected = rows.at(static_cast<size_t>(row));
+        EXPECT_TRUE(expected.text == text) << "row " << row;
+        EXPECT_EQ(expected.wrapped, wrapped) << "row " << row;
+        EXPECT_EQ(expected.attributes, attributes) << "row " << row;
+    }
+
+    void expectMissing(const ScrollbackArchive& archive, const int64_t row)
+    {
+        std::wstring text;
+        auto wrapped = false;
+        std::string attributes;
+        EXPECT_FALSE(archive.ReadRow(row, text, wrapped)) << "row " << row;
+        EXPECT_FALSE(archive.ReadRowAttributes(row, attributes)) << "row " << row;
+    }
+}
+
+TEST(ScrollbackArchiveTests, ReadsBackEveryRow)
+{
+    const auto rows = makeRows(128 * 1024);
+    ScrollbackArchive archive{ SIZE_MAX };
+    append(archive, rows);
+
+    ASSERT_EQ(0, archive.FirstRow());
+    ASSERT_EQ(static_cast<int64_t>(rows.size()), archive.EndRow());
+    for (int64_t row = 0; row < archive.EndRow(); ++row)
+    {
+        expectRow(archive, rows, row);
+    }
+
+    // In any order, so that the blocks are decompressed again and again.
+    std::mt19937 random{ 1 };
+    for (auto i = 0; i < 1000; ++i)
+    {
+        expectRow(archive, rows, static_cast<int64_t>(random() % rows.size()));
+    }
+
+    expectMissing(archive, -1);
+    expectMissing(archive, archive.EndRow());
+}
+
+TEST(ScrollbackArchiveTests, DropsTheOldestRowsOverItsBudget)
+{
+    const auto rows = makeRows(1024 * 1024);
+    constexpr size_t budget = 64 * 1024;
+    ScrollbackArchive archive{ budget };
+    append(archive, rows);
+
+    // Whole blocks are dropped, and the rows that are left keep their numbers.
+    const auto firstRow = archive.FirstRow();
+    ASSERT_GT(firstRow, 0);
+    EXPECT_EQ(0, firstRow % 256);
+    EXPECT_EQ(static_cast<int64_t>(rows.size()), archive.EndRow());
+    expectMissing(archive, firstRow - 1);
+    for (auto row = firstRow; row < archive.EndRow(); ++row)
+    {
+        expectRow(archive, rows, row);
+    }
+
+    // The budget doesn't count the block that's being filled, nor the
+    // decompressed copy of the block that was read last. Either holds the
+    // text of 256 rows, in a string that may have twice the capacity.
+    constexpr auto blockBytes = 2 * 256 * Width * sizeof(wchar_t);
+    EXPECT_LT(archive.MemoryUsage(), budget + 2 * blockBytes);
+}
+
+TEST(ScrollbackArchiveTests, NumbersRowsOnAfterClear)
+{
+    const auto rows = makeRows(64 * 1024);
+    const auto half = rows.size() / 2;
+    ScrollbackArchive archive{ SIZE_MAX };
+    append(archive, { rows.begin(), rows.begin() + half });
+
+    archive.Clear();
+    EXPECT_EQ(static_cast<int64_t>(half), archive.FirstRow());
+    EXPECT_EQ(static_cast<int64_t>(half), archive.EndRow());
+    expectMissing(archive, 0);
+
+    append(archive, { rows.begin() + half, rows.end() });
+    EXPECT_EQ(static_cast<int64_t>(rows.size()), archive.EndRow());
+    for (auto row = archive.FirstRow(); row < archive.EndRow(); ++row)
+    {
+        expectRow(archive, rows, row);
+    }
+}
+
+TEST(ScrollbackArchiveTests, ReadsWhileRowsAreAppended)
+{
+    // The search index reads rows without the terminal's lock, while the
+    // terminal appends more and the oldest ones are dropped.
+    const auto rows = makeRows(1024 * 1024);
+    ScrollbackArchive archive{ 64 * 1024 };
+    std::atomic<bool> done{ false };
+
+    std::thread reader{ [&]() {
+        std::mt19937 random{ 1 };
+        std::wstring text;
+        auto wrapped = false;
+        while (!done.load(std::memory_order_relaxed))
+        {
+            const auto first = archive.FirstRow();
+            const auto end = archive.EndRow();
+            if (first == end)
+            {
+                continue;
+            }
+            const auto row = first + static_cast<int64_t>(random() % static_cast<uint64_t>(end - first));
+            // The row may have been dropped since.
+            if (archive.ReadRow(row, text, wrapped))
+            {
+                ASSERT_TRUE(rows.at(static_cast<size_t>(row)).text == text) << "row " << row;
+            }
+        }
+    } };
+
+    append(archive, rows);
+    done = true;
+    reader.join();
+}
+
+TEST(ScrollbackArchiveTests, SpillsInsteadOfDropping)
+{
+    const auto rows = makeRows(1024 * 1024);
+    constexpr size_t budget = 64 * 1024;
+    ScrollbackArchive archive{ budget };
+    archive.EnableSpilling();
+    append(archive, rows);
+
+    const auto path = archive.SpillFilePath();
+    ASSERT_TRUE(std::filesystem::exists(path));
+    EXPECT_GT(std::filesystem::file_size(path), 0u);
+
+    EXPECT_EQ(0, archive.FirstRow());
+    EXPECT_EQ(static_cast<int64_t>(rows.size()), archive.EndRow());
+    for (int64_t row = 0; row < archive.EndRow(); ++row)
+    {
+        expectRow(archive, rows, row);
+    }
+    std::mt19937 random{ 1 };
+    for (auto i = 0; i < 1000; ++i)
+    {
+        expectRow(archive, rows, static_cast<int64_t>(random() % rows.size()));
+    }
+
+    // Like DropsTheOldestRowsOverItsBudget, plus the copy of the spilled block that was read last.
+    constexpr auto blockBytes = 2 * 256 * Width * sizeof(wchar_t);
+    EXPECT_LT(archive.MemoryUsage(), budget + 3 * blockBytes);
+}
+
+TEST(ScrollbackArchiveTests, ClearEmptiesTheSpillFile)
+{
+    const auto rows = makeRows(512 * 1024);
+    const auto half = rows.size() / 2;
+    ScrollbackArchive archive{ 16 * 1024 };
+    archive.EnableSpilling();
+    append(archive, { rows.begin(), rows.begin() + half });
+
+    const auto path = archive.SpillFilePath();
+    ASSERT_GT(std::filesystem::file_size(path), 0u);
+    archive.Clear();
+    EXPECT_EQ(0u, std::filesystem::file_size(path));
+
+    // The file is reused from its start.
+    append(archive, { rows.begin() + half, rows.end() });
+    EXPECT_EQ(static_cast<int64_t>(half), archive.FirstRow());
+    for (auto row = archive.FirstRow(); row < archive.EndRow(); ++row)
+    {
+        expectRow(archive, rows, row);
+    }
+}
+
+TEST(ScrollbackArchiveTests, DeletesTheSpillFileWithTheArchive)
+{
+    // Terminal::DiscardScrollbackArchive lets go of the archive when the
+    // control is closed. The search index only holds on to it while it
+    // reads a row.
+    auto archive = std::make_shared<ScrollbackArchive>(16 * 1024);
+    archive->EnableSpilling();
+    append(*archive, makeRows(256 * 1024));
+    const auto path = archive->SpillFilePath();
+    ASSERT_TRUE(std::filesystem::exists(path));
+
+    const std::weak_ptr<const ScrollbackArchive> searchIndexReader{ archive };
+    {
+        const auto reading = searchIndexReader.lock();
+        archive.reset();
+        EXPECT_TRUE(std::filesystem::exists(path));
+    }
+    EXPECT_FALSE(std::filesystem::exists(path));
+    EXPECT_FALSE(searchIndexReader.lock());
+}
+
+TEST(ScrollbackArchiveTests, HasNoSpillFileUnlessEnabled)
+{
+    ScrollbackArchive archive{ 16 * 1024 };
+    append(archive, makeRows(64 * 1024));
+    EXPECT_TRUE(archive.SpillFilePath().empty());
+}
@@ -0,0 +1,135 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+// Measures SearchIndex on a full scrollback: looking for text that isn't
+// there, which the filters should rule out block by block no matter how long
+// the rows are, and updating the index after a single row changed. The
+// regular expression benchmarks run with (1) and without (0) the literals
+// of the pattern, which is what the filters and lines are checked for.
+
+#include "pch.h"
+#include "SearchIndex.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include "Corpus.hpp"
+
+using namespace Microsoft::Terminal::Core;
+
+namespace
+{
+    constexpr size_t Rows = 10000;
+
+    bool isWide(const std::wstring_view)
+    {
+        return false;
+    }
+
+    // The rows of a scrollback of the given width, filled with a log.
+    std::vector<std::wstring> rowsOf(const size_t width)
+    {
+        const auto text = Benchmarks::AsciiLog(Rows * width);
+        std::vector<std::wstring> rows;
+        for (size_t begin = 0; begin < text.size() && rows.size() < Rows;)
+        {
+            auto end = text.find(L"\r\n", begin);
+            end = end == std::wstring::npos ? text.size() : end;
+            auto row = text.substr(begin, end - begin);
+            row.resize(width, L' ');
+            rows.emplace_back(std::move(row));
+            begin = end + 2;
+        }
+        return rows;
+    }
+
+    void index(SearchIndex& index, const std::vector<std::wstring>& rows, const int64_t dirtyTop, const int64_t dirtyBottom)
+    {
+        index.Update(
+            gsl::narrow_cast<int64_t>(rows.size()),
+            [&](const int64_t offset, std::wstring& text, bool& wrapped) {
+                text = rows.at(gsl::narrow_cast<size_t>(offset));
+                wrapped = false;
+            },
+            0,
+            dirtyTop,
+            dirtyBottom,
+            false);
+    }
+
+    void FindMissingText(benchmark::State& state)
+    {
+        const auto rows = rowsOf(gsl::narrow_cast<size_t>(state.range(0)));
+        SearchIndex searchIndex{ isWide };
+        index(searchIndex, rows, INT64_MAX, INT64_MIN);
+
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(searchIndex.FindNext(L"segfault", false, true, -1, 0));
+        }
+
+        state.SetBytesProcessed(gsl::narrow_cast<int64_t>(state.iterations() * rows.size() * rows.front().size() * sizeof(wchar_t)));
+    }
+
+    std::shared_ptr<const SearchIndex::Pattern> compile(const std::wstring_view text, const bool useLiterals)
+    {
+        auto pattern = std::make_shared<SearchIndex::Pattern>(*SearchIndex::CompilePattern(text, false));
+        if (!useLiterals)
+        {
+            pattern->literals.clear();
+        }
+        return pattern;
+    }
+
+    void FindMissingPattern(benchmark::State& state)
+    {
+        const auto rows = rowsOf(120);
+        SearchIndex searchIndex{ isWide };
+        index(searchIndex, rows, INT64_MAX, INT64_MIN);
+        const auto pattern = compile(L"segfault at 0x[0-9a-f]+", state.range(0) != 0);
+
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(searchIndex.FindNextRegex(*pattern, true, -1, 0));
+        }
+
+        state.SetBytesProcessed(gsl::narrow_cast<int64_t>(state.iterations() * rows.size() * rows.front().size() * sizeof(wchar_t)));
+    }
+
+    void FindAllPattern(benchmark::State& state)
+    {
+        const auto rows = rowsOf(120);
+        SearchIndex searchIndex{ isWide };
+        index(searchIndex, rows, INT64_MAX, INT64_MIN);
+        const auto pattern = compile(L"ERROR.*\\[session-[0-9]+\\] cache", state.range(0) != 0);
+
+        for (auto _ : state)
+        {
+            searchIndex.SetQuery(L"pattern", false, pattern);
+            while (searchIndex.SearchChunk(1000))
+            {
+            }
+            benchmark::DoNotOptimize(searchIndex.MatchCount());
+        }
+
+        state.SetBytesProcessed(gsl::narrow_cast<int64_t>(state.iterations() * rows.size() * rows.front().size() * sizeof(wchar_t)));
+    }
+
+    void UpdateOneRow(benchmark::State& state)
+    {
+        const auto rows = rowsOf(gsl::narrow_cast<size_t>(state.range(0)));
+        SearchIndex searchIndex{ isWide };
+        index(searchIndex, rows, INT64_MAX, INT64_MIN);
+
+        int64_t row = 0;
+        for (auto _ : state)
+        {
+            index(searchIndex, rows, row, row + 1);
+            row = (row + 997) % gsl::narrow_cast<int64_t>(rows.size());
+        }
+    }
+}
+
+BENCHMARK(FindMissingText)->Arg(120)->Arg(1000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(FindMissingPattern)->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond);
+BENCHMARK(FindAllPattern)->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond);
+BENCHMARK(UpdateOneRow)->Arg(120)->Arg(1000)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,564 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+// Tests SearchIndex against a buffer made up of plain strings. Find-all has
+// to find exactly what searching every line on its own finds, no matter
+// which rows changed in between.
+
+#include "pch.h"
+#include "SearchIndex.hpp"
+
+#include <random>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "Corpus.hpp"
+
+using namespace Microsoft::Terminal::Core;
+
+namespace
+{
+    using Match = SearchIndex::Match;
+
+    // A stand-in for IsGlyphFullWidth: CJK ideographs and everything outside
+    // of the BMP are wide, the rest isn't.
+    bool isWide(const std::wstring_view glyph)
+    {
+        return glyph.size() == 2 || (glyph.front() >= 0x4E00 && glyph.front() <= 0x9FFF);
+    }
+
+    // The rows of a buffer, and whether they wrapped.
+    struct Buffer
+    {
+        std::vector<std::pair<std::wstring, bool>> rows;
+        size_t reads = 0;
+
+        SearchIndex::ReadRow Reader()
+        {
+            return [this](const int64_t offset, std::wstring& text, bool& wrapped) {
+                const auto& row = rows.at(gsl::narrow_cast<size_t>(offset));
+                text = row.first;
+                wrapped = row.second;
+                ++reads;
+            };
+        }
+
+        void Update(SearchIndex& index, const int64_t rowBase = 0, const int64_t dirtyTop = INT64_MAX, const int64_t dirtyBottom = INT64_MIN, const bool full = false)
+        {
+            index.Update(gsl::narrow_cast<int64_t>(rows.size()), Reader(), rowBase, dirtyTop, dirtyBottom, full);
+        }
+    };
+
+    // A buffer that scrolls through the given rows, with the rows above it in
+    // a scrollback archive. The archive can drop its oldest rows.
+    struct History
+    {
+        Buffer all;
+        int64_t height;
+        int64_t rowBase = 0;
+        int64_t archiveFirst = 0;
+        size_t archiveReads = 0;
+        std::shared_ptr<const SearchIndex::ReadArchivedRow> readArchived;
+
+        History(Buffer rows, const int64_t height) :
+            all{ std::move(rows) },
+            height{ height },
+            readArchived{ std::make_shared<const SearchIndex::ReadArchivedRow>([this](const int64_t row, std::wstring& text, bool& wrapped) {
+                if (row < archiveFirst || row >= rowBase)
+                {
+                    return false;
+                }
+                const auto& archived = all.rows.at(gsl::narrow_cast<size_t>(row));
+                text = archived.first;
+                wrapped = archived.second;
+                ++archiveReads;
+                return true;
+            }) }
+        {
+        }
+        History(const History&) = delete;
+        History& operator=(const History&) = delete;
+
+        int64_t RowCount() const noexcept
+        {
+            return gsl::narrow_cast<int64_t>(all.rows.size());
+        }
+
+        void Update(SearchIndex& index, const bool full = false)
+        {
+            const SearchIndex::ArchivedRows archived{ archiveFirst, readArchived };
+            index.Update(
+                height,
+                [this](const int64_t offset, std::wstring& text, bool& wrapped) {
+                    const auto& row = all.rows.at(gsl::narrow_cast<size_t>(rowBase + offset));
+                    text = row.first;
+                    wrapped = row.second;
+                },
+                rowBase,
+                INT64_MAX,
+                INT64_MIN,
+                full,
+                &archived);
+        }
+
+        // The rows of the archive and the buffer.
+        Buffer Covered() const
+        {
+            Buffer covered;
+            covered.rows.assign(all.rows.begin() + gsl::narrow_cast<ptrdiff_t>(archiveFirst), all.rows.begin() + gsl::narrow_cast<ptrdiff_t>(rowBase + height));
+            return covered;
+        }
+    };
+
+    // Cuts the text into rows of the given width. Lines longer than that wrap.
+    Buffer layOut(const std::wstring_view text, const size_t width)
+    {
+        Buffer buffer;
+        for (size_t begin = 0; begin < text.size();)
+        {
+            auto end = text.find(L"\r\n", begin);
+            end = end == std::wstring_view::npos ? text.size() : end;
+            auto line = text.substr(begin, end - begin);
+            begin = end + 2;
+
+            do
+            {
+                const auto row = line.substr(0, width);
+                line = line.substr(row.size());
+                buffer.rows.emplace_back(std::wstring{ row }, !line.empty());
+            } while (!line.empty());
+        }
+        return buffer;
+    }
+
+    // Finds all the matches of needle the slow way: line by line, in the
+    // order they appear in. Only for ASCII text, where every character is a column.
+    std::vector<std::tuple<int64_t, size_t, int64_t, size_t>> findSlowly(const Buffer& buffer, const std::wstring_view needle, const int64_t rowBase)
+    {
+        std::vector<std::tuple<int64_t, size_t, int64_t, size_t>> matches;
+        for (size_t first = 0; first < buffer.rows.size();)
+        {
+            auto last = first;
+            std::wstring line;
+            std::vector<size_t> starts;
+            for (;; ++last)
+            {
+                starts.emplace_back(line.size());
+                line.append(buffer.rows[last].first);
+                if (!buffer.rows[last].second || last + 1 == buffer.rows.size())
+                {
+                    break;
+                }
+            }
+            starts.emplace_back(line.size());
+
+            const auto toPosition = [&](const size_t offset, const bool isEnd) {
+                auto row = gsl::narrow_cast<size_t>(std::upper_bound(starts.begin(), starts.end() - 1, offset) - starts.begin()) - 1;
+                if (isEnd && row != 0 && starts[row] == offset)
+                {
+                    --row;
+                }
+                return std::pair{ rowBase + gsl::narrow_cast<int64_t>(first + row), offset - starts[row] };
+            };
+            for (auto pos = line.find(needle); pos != std::wstring::npos; pos = line.find(needle, pos + 1))
+            {
+                const auto [row, startColumn] = toPosition(pos, false);
+                const auto [endRow, endColumn] = toPosition(pos + needle.size(), true);
+                matches.emplace_back(row, startColumn, endRow, endColumn);
+            }
+            first = last + 1;
+        }
+        return matches;
+    }
+
+    std::vector<std::tuple<int64_t, size_t, int64_t, size_t>> findAll(SearchIndex& index, const std::wstring_view needle, const bool caseSensitive = true)
+    {
+        index.SetQuery(needle, caseSensitive);
+        while (index.SearchChunk(100))
+        {
+        }
+
+        std::vector<Match> found;
+        index.GetMatchesInRows(INT64_MIN / 2, INT64_MAX / 2, found);
+        EXPECT_EQ(found.size(), index.MatchCount());
+
+        std::vector<std::tuple<int64_t, size_t, int64_t, size_t>> matches;
+        for (const auto& match : found)
+        {
+            matches.emplace_back(match.row, match.startColumn, match.endRow, match.endColumn);
+        }
+        return matches;
+    }
+
+    std::vector<std::tuple<int64_t, size_t, int64_t, size_t>> findAllRegex(SearchIndex& index, std::shared_ptr<const SearchIndex::Pattern> pattern)
+    {
+        const auto caseSensitive = pattern->caseSensitive;
+        index.SetQuery(L"pattern", caseSensitive, std::move(pattern));
+        while (index.SearchChunk(100))
+        {
+        }
+
+        std::vector<Match> found;
+        index.GetMatchesInRows(INT64_MIN / 2, INT64_MAX / 2, found);
+        std::vector<std::tuple<int64_t, size_t, int64_t, size_t>> matches;
+        for (const auto& match : found)
+        {
+            matches.emplace_back(match.row, match.startColumn, match.endRow, match.endColumn);
+        }
+        return matches;
+    }
+
+    std::tuple<int64_t, size_t, int64_t, size_t> asTuple(const std::optional<Match>& match)
+    {
+        EXPECT_TRUE(match.has_value());
+        return match ? std::tuple{ match->row, match->startColumn, match->endRow, match->endColumn } : std::tuple<int64_t, size_t, int64_t, size_t>{};
+    }
+}
+
+TEST(SearchIndexTests, MatchesSpanWrappedRows)
+{
+    auto buffer = layOut(L"hello world and more\r\nworld", 10);
+    SearchIndex index{ isWide };
+    buffer.Update(index);
+
+    // "hello worl" wraps onto "d and more".
+    using T = std::tuple<int64_t, size_t, int64_t, size_t>;
+    EXPECT_EQ((std::vector<T>{ { 0, 6, 1, 1 }, { 2, 0, 2, 5 } }), findAll(index, L"world"));
+    EXPECT_EQ(T(0, 6, 1, 1), asTuple(index.FindNext(L"world", true, true, -1, 0)));
+    EXPECT_EQ(T(0, 6, 1, 1), asTuple(index.FindNextRegex(*SearchIndex::CompilePattern(L"w.r.d", true), true, -1, 0)));
+}
+
+TEST(SearchIndexTests, MatchesEndAtTheEndOfTheirLastRow)
+{
+    auto buffer = layOut(L"abcdefghijklmnopqrst", 10);
+    SearchIndex index{ isWide };
+    buffer.Update(index);
+
+    using T = std::tuple<int64_t, size_t, int64_t, size_t>;
+    EXPECT_EQ((std::vector<T>{ { 0, 8, 0, 10 } }), findAll(index, L"ij"));
+    EXPECT_EQ((std::vector<T>{ { 0, 9, 1, 1 } }), findAll(index, L"jk"));
+}
+
+TEST(SearchIndexTests, MatchesDontSpanLines)
+{
+    auto buffer = layOut(L"hello\r\nworld", 5);
+    SearchIndex index{ isWide };
+    buffer.Update(index);
+
+    EXPECT_TRUE(findAll(index, L"ow").empty());
+    EXPECT_FALSE(index.FindNext(L"ow", true, true, -1, 0).has_value());
+    EXPECT_FALSE(index.FindNextRegex(*SearchIndex::CompilePattern(L"o.?w", true), true, -1, 0).has_value());
+}
+
+TEST(SearchIndexTests, FoldsCase)
+{
+    auto buffer = layOut(L"Hello HELLO hello", 80);
+    SearchIndex index{ isWide };
+    buffer.Update(index);
+
+    EXPECT_EQ(3u, findAll(index, L"hello", false).size());
+    EXPECT_EQ(1u, findAll(index, L"hello", true).size());
+    EXPECT_EQ(1u, findAll(index, L"HELLO", true).size());
+}
+
+TEST(SearchIndexTests, FindsNextAndPreviousWithWrapAround)
+{
+    auto buffer = layOut(L"a x\r\nb x x\r\nc", 80);
+    SearchIndex index{ isWide };
+    buffer.Update(index);
+
+    using T = std::tuple<int64_t, size_t, int64_t, size_t>;
+    EXPECT_EQ(T(1, 2, 1, 3), asTuple(index.FindNext(L"x", true, true, 0, 2)));
+    EXPECT_EQ(T(1, 4, 1, 5), asTuple(index.FindNext(L"x", true, true, 1, 2)));
+    EXPECT_EQ(T(0, 2, 0, 3), asTuple(index.FindNext(L"x", true, true, 1, 4)));
+    EXPECT_EQ(T(1, 4, 1, 5), asTuple(index.FindNext(L"x", true, false, 0, 2)));
+    EXPECT_EQ(T(1, 2, 1, 3), asTuple(index.FindNext(L"x", true, false, 1, 4)));
+    // A match that starts where the search does is only found if it's the only one.
+    EXPECT_EQ(T(2, 0, 2, 1), asTuple(index.FindNext(L"c", true, true, 2, 0)));
+}
+
+TEST(SearchIndexTests, CountsColumnsOfWideGlyphs)
+{
+    auto buffer = layOut(L"\u6f22\u5b57 x \xD83D\xDE00 x", 80);
+    SearchIndex index{ isWide };
+    buffer.Update(index);
+
+    using T = std::tuple<int64_t, size_t, int64_t, size_t>;
+    EXPECT_EQ((std::vector<T>{ { 0, 5, 0, 6 }, { 0, 10, 0, 11 } }), findAll(index, L"x"));
+}
+
+TEST(SearchIndexTests, SkipsEmptyRegexMatches)
+{
+    auto buffer = layOut(L"aaa b", 80);
+    SearchIndex index{ isWide };
+    buffer.Update(index);
+
+    index.SetQuery(L"a*", true, SearchIndex::CompilePattern(L"a*", true));
+    while (index.SearchChunk(100))
+    {
+    }
+    EXPECT_EQ(1u, index.MatchCount());
+}
+
+TEST(SearchIndexTests, FindsTheLiteralsOfPatterns)
+{
+    using Literals = std::vector<std::wstring>;
+    const auto literals = [](const std::wstring_view text, const bool caseSensitive = true) {
+        return SearchIndex::CompilePattern(text, caseSensitive)->literals;
+    };
+
+    // Longest first.
+    EXPECT_EQ((Literals{ L" request_id=", L"ERROR " }), literals(L"ERROR .* request_id=[0-9a-f]+"));
+    EXPECT_EQ((Literals{ L"error " }), literals(L"ERROR .*", false));
+    // A character that may be repeated zero times isn't in every match.
+    EXPECT_EQ((Literals{ L"ab", L"de" }), literals(L"abc?de"));
+    EXPECT_EQ((Literals{ L"ab", L"de" }), literals(L"abc*?de"));
+    EXPECT_EQ((Literals{ L"ab", L"de" }), literals(L"abc{0,2}de"));
+    EXPECT_EQ((Literals{ L"abc", L"de" }), literals(L"abc+de"));
+    EXPECT_EQ((Literals{ L"abc", L"de" }), literals(L"abc{2}de"));
+    // Escaped punctuation is literal, other escapes aren't.
+    EXPECT_EQ((Literals{ L"main.cpp" }), literals(L"main\\.cpp"));
+    EXPECT_EQ((Literals{ L"bc", L"ef" }), literals(L"\\x41bc\\dd\\u0041ef"));
+    EXPECT_EQ((Literals{ L"ab", L"cd" }), literals(L"(x)ab\\1cd"));
+    // Neither groups nor classes are looked into.
+    EXPECT_EQ((Literals{ L"end" }), literals(L"(abc|de(f))[(gh)]end"));
+    EXPECT_EQ((Literals{}), literals(L"abc|def"));
+    EXPECT_EQ((Literals{}), literals(L"^.x$"));
+
+    EXPECT_THROW(SearchIndex::CompilePattern(L"(abc", true), std::regex_error);
+    EXPECT_THROW(SearchIndex::CompilePattern(L"a{2", true), std::regex_error);
+}
+
+TEST(SearchIndexTests, LiteralsDontLoseMatchesOfPatterns)
+{
+    auto buffer = layOut(Benchmarks::AsciiLog(64 * 1024), 100);
+    SearchIndex index{ isWide };
+    buffer.Update(index);
+
+    for (const auto text : { L"ERROR.*\\[session-[0-9]+\\] cache", L"connection (worker|cache) ", L"in [0-9]{3} ms", L"error\\x1b\\[m \\[", L"segfault" })
+    {
+        for (const auto caseSensitive : { true, false })
+        {
+            const auto pattern = SearchIndex::CompilePattern(text, caseSensitive);
+            auto unfiltered = std::make_shared<SearchIndex::Pattern>(*pattern);
+            unfiltered->literals.clear();
+
+            const auto expected = findAllRegex(index, unfiltered);
+            EXPECT_EQ(expected, findAllRegex(index, pattern)) << "for " << ::testing::PrintToString(std::wstring{ text });
+            EXPECT_EQ(expected.empty(), !index.FindNextRegex(*pattern, true, -1, 0).has_value());
+        }
+    }
+}
+
+TEST(SearchIndexTests, FindsTextInLongRows)
+{
+    // Rows that are thousands of characters long used to have every bit of
+    // their signature set. Every one of them still has to be found, and
+    // nothing else.
+    const auto text = Benchmarks::AsciiLog(256 * 1024);
+    auto buffer = layOut(text, 4000);
+    SearchIndex index{ isWide };
+    buffer.Update(index);
+
+    for (const auto needle : { L"error", L"request", L"zqxj", L"0 ", L"e" })
+    {
+        EXPECT_EQ(findSlowly(buffer, needle, 0), findAll(index, needle)) << "for " << ::testing::PrintToString(std::wstring{ needle });
+    }
+}
+
+TEST(SearchIndexTests, OnlyReadsChangedRowsAgain)
+{
+    auto buffer = layOut(Benchmarks::AsciiLog(256 * 1024), 120);
+    ASSERT_GT(buffer.rows.size(), 10 * SearchIndex::BlockRows);
+
+    SearchIndex index{ isWide };
+    buffer.Update(index);
+    EXPECT_EQ(buffer.rows.size(), buffer.reads);
+
+    buffer.reads = 0;
+    buffer.Update(index);
+    EXPECT_EQ(0u, buffer.reads);
+
+    // Changing one row only reads the block it's in again, and maybe the
+    // lines up to the start of the next one.
+    const auto row = gsl::narrow_cast<int64_t>(buffer.rows.size() / 2);
+    buffer.rows.at(gsl::narrow_cast<size_t>(row)).first = L"changed";
+    buffer.Update(index, 0, row, row + 1);
+    EXPECT_LE(buffer.reads, 2 * SearchIndex::BlockRows);
+    EXPECT_EQ(findSlowly(buffer, L"changed", 0), findAll(index, L"changed"));
+}
+
+TEST(SearchIndexTests, KeepsUpWithChangingRows)
+{
+    // Changes random rows, with random line breaks, and scrolls rows out of
+    // the top. Find-all has to find what a fresh search finds every time,
+    // no matter whether the query was searched for before the change.
+    const auto text = Benchmarks::AsciiLog(128 * 1024);
+    auto buffer = layOut(text, 60);
+    SearchIndex index{ isWide };
+    buffer.Update(index);
+    index.SetQuery(L"err", true);
+
+    std::mt19937 random{ 42 };
+    std::uniform_int_distribution<size_t> rowOf{ 0, buffer.rows.size() - 1 };
+    std::uniform_int_distribution<size_t> count{ 1, 5 };
+    std::bernoulli_distribution coin{ 0.3 };
+
+    int64_t rowBase = 0;
+    for (auto i = 0; i < 200; ++i)
+    {
+        int64_t dirtyTop = INT64_MAX;
+        int64_t dirtyBottom = INT64_MIN;
+        for (auto n = count(random); n > 0; --n)
+        {
+            const auto row = rowOf(random);
+            auto& [rowText, wrapped] = buffer.rows.at(row);
+            rowText = buffer.rows.at(rowOf(random)).first;
+            wrapped = coin(random);
+            dirtyTop = std::min(dirtyTop, rowBase + gsl::narrow_cast<int64_t>(row));
+            dirtyBottom = std::max(dirtyBottom, rowBase + gsl::narrow_cast<int64_t>(row) + 1);
+        }
+
+        if (coin(random))
+        {
+            // Scroll a few rows out of the top, like IncrementCircularBuffer does.
+            const auto scrolled = count(random);
+            std::rotate(buffer.rows.begin(), buffer.rows.begin() + gsl::narrow_cast<ptrdiff_t>(scrolled), buffer.rows.end());
+            for (auto row = buffer.rows.size() - scrolled; row < buffer.rows.size(); ++row)
+            {
+                buffer.rows.at(row) = { L"err new", false };
+            }
+            rowBase += gsl::narrow_cast<int64_t>(scrolled);
+            dirtyBottom = std::max(dirtyBottom, rowBase + gsl::narrow_cast<int64_t>(buffer.rows.size()));
+            dirtyTop = std::min(dirtyTop, rowBase + gsl::narrow_cast<int64_t>(buffer.rows.size() - scrolled));
+        }
+
+        buffer.Update(index, rowBase, dirtyTop, dirtyBottom);
+        while (index.SearchChunk(100))
+        {
+        }
+
+        std::vector<Match> found;
+        index.GetMatchesInRows(INT64_MIN / 2, INT64_MAX / 2, found);
+        std::vector<std::tuple<int64_t, size_t, int64_t, size_t>> matches;
+        for (const auto& match : found)
+        {
+            matches.emplace_back(match.row, match.startColumn, match.endRow, match.endColumn);
+        }
+        ASSERT_EQ(findSlowly(buffer, L"err", rowBase), matches) << "after change " << i;
+        ASSERT_EQ(matches.size(), index.MatchCount());
+    }
+}
+
+TEST(SearchIndexTests, SearchesDontBlockUpdates)
+{
+    // A search works on the blocks that were current when it started. It
+    // doesn't hold anything Update has to wait for, and its matches of the
+    // blocks that were replaced in the meantime are thrown away.
+    auto buffer = layOut(Benchmarks::AsciiLog(64 * 1024), 120);
+    SearchIndex index{ isWide };
+    buffer.Update(index);
+    index.SetQuery(L"e", true);
+
+    std::atomic<bool> done{ false };
+    std::thread searcher{ [&]() {
+        while (!done.load())
+        {
+            index.FindNext(L"zqxj", true, true, -1, 0);
+            if (!index.SearchChunk(SearchIndex::BlockRows))
+            {
+                index.SetQuery(L"e", true);
+            }
+        }
+    } };
+
+    for (auto i = 0; i < 100; ++i)
+    {
+        buffer.rows.front().first = i % 2 ? L"e" : L"x";
+        buffer.Update(index, 0, 0, 1);
+    }
+    done = true;
+    searcher.join();
+
+    EXPECT_EQ(findSlowly(buffer, L"e", 0), findAll(index, L"e"));
+}
+
+TEST(SearchIndexTests, OrdinalsFollowTheBuffer)
+{
+    auto buffer = layOut(L"x\r\nx x\r\nx", 80);
+    SearchIndex index{ isWide };
+    buffer.Update(index);
+    findAll(index, L"x");
+
+    EXPECT_EQ(1u, index.MatchOrdinal({ 0, 0, 0, 1 }));
+    EXPECT_EQ(3u, index.MatchOrdinal({ 1, 2, 1, 3 }));
+    EXPECT_EQ(4u, index.MatchOrdinal({ 2, 0, 2, 1 }));
+    EXPECT_EQ(0u, index.MatchOrdinal({ 2, 1, 2, 2 }));
+}
+
+TEST(SearchIndexTests, CoversTheScrollbackArchive)
+{
+    // The buffer scrolls through the text a few rows at a time. Find-all has
+    // to find what a fresh search of the archive and the buffer finds, once
+    // the archived rows that never were in a block are indexed as well.
+    History history{ layOut(Benchmarks::AsciiLog(256 * 1024), 60), 200 };
+    SearchIndex index{ isWide };
+    history.Update(index);
+
+    std::mt19937 random{ 42 };
+    std::uniform_int_distribution<int64_t> step{ 1, 5 };
+    std::bernoulli_distribution coin{ 0.1 };
+    while (history.rowBase + history.height + 5 < history.RowCount())
+    {
+        history.rowBase += step(random);
+        history.Update(index);
+        if (coin(random))
+        {
+            index.IndexArchivedRows(SearchIndex::BlockRows);
+        }
+    }
+    while (index.IndexArchivedRows(1000))
+    {
+    }
+    EXPECT_EQ(findSlowly(history.Covered(), L"err", 0), findAll(index, L"err"));
+
+    // Rows that are dropped from the archive drop out of the index.
+    history.archiveFirst = history.rowBase / 2;
+    history.Update(index);
+    while (index.IndexArchivedRows(1000))
+    {
+    }
+    EXPECT_EQ(findSlowly(history.Covered(), L"err", history.archiveFirst), findAll(index, L"err"));
+}
+
+TEST(SearchIndexTests, OnlyReadsArchivedRowsThatMayMatch)
+{
+    auto rows = layOut(Benchmarks::AsciiLog(256 * 1024), 120);
+    rows.rows.at(10) = { L"xyzzy", false };
+    History history{ std::move(rows), 100 };
+    history.rowBase = history.RowCount() - history.height;
+    SearchIndex index{ isWide };
+    history.Update(index);
+    while (index.IndexArchivedRows(1000))
+    {
+    }
+    EXPECT_EQ(gsl::narrow_cast<size_t>(history.rowBase), history.archiveReads);
+
+    // The folded filters rule out nearly every archived block.
+    history.archiveReads = 0;
+    EXPECT_FALSE(index.FindNext(L"segfault", true, true, -1, 0).has_value());
+    EXPECT_LT(history.archiveReads, 2 * SearchIndex::BlockRows);
+    EXPECT_EQ((std::tuple<int64_t, size_t, int64_t, size_t>{ 10, 0, 10, 5 }), asTuple(index.FindNext(L"xyzzy", true, false, -1, 0)));
+
+    // The archived blocks are kept while the alternate buffer is active.
+    auto alternate = layOut(L"alternate", 80);
+    alternate.Update(index, 0, INT64_MAX, INT64_MIN, true);
+    EXPECT_FALSE(index.FindNext(L"xyzzy", true, false, -1, 0).has_value());
+
+    history.archiveReads = 0;
+    history.Update(index, true);
+    EXPECT_FALSE(index.IndexArchivedRows(1000));
+    EXPECT_EQ(0u, history.archiveReads);
+    EXPECT_EQ((std::tuple<int64_t, size_t, int64_t, size_t>{ 10, 0, 10, 5 }), asTuple(index.FindNext(L"xyzzy", true, false, -1, 0)));
+}
@@ -0,0 +1,152 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+// SessionRecorder has to write every chunk of output and every resize it's
+// given, from any number of threads, into a recording Asciicast can read.
+
+#include "pch.h"
+#include "SessionRecorder.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "Corpus.hpp"
+
+using namespace Microsoft::Terminal::Core;
+
+namespace
+{
+    std::filesystem::path recordingPath(const char* name)
+    {
+        return std::filesystem::temp_directory_path() / (std::string{ "SessionRecorderTests-" } + name + ".cast");
+    }
+
+    std::vector<Asciicast::Event> readRecording(const std::filesystem::path& path, int& width, int& height)
+    {
+        std::ifstream file{ path, std::ios::binary };
+        Asciicast::Reader reader{ std::string{ std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{} } };
+        width = reader.Width();
+        height = reader.Height();
+
+        std::vector<Asciicast::Event> events;
+        Asciicast::Event event{};
+        while (reader.Next(event))
+        {
+            events.emplace_back(event);
+        }
+        return events;
+    }
+}
+
+TEST(SessionRecorderTests, RecordsOutputAndResizes)
+{
+    const auto path = recordingPath("RecordsOutputAndResizes");
+    const auto text = Microsoft::Terminal::Core::Benchmarks::EmojiText(256 * 1024);
+    std::vector<std::wstring> chunks;
+    for (size_t i = 0; i < text.size(); i += 4093)
+    {
+        // An odd chunk size splits surrogate pairs.
+        chunks.emplace_back(text.substr(i, 4093));
+    }
+
+    {
+        SessionRecorder recorder{ path.wstring(), 120, 30 };
+        for (const auto& chunk : chunks)
+        {
+            recorder.Output(chunk);
+        }
+        recorder.Resize(100, 40);
+        EXPECT_TRUE(recorder.Recording());
+    }
+
+    int width = 0;
+    int height = 0;
+    const auto events = readRecording(path, width, height);
+    std::filesystem::remove(path);
+
+    EXPECT_EQ(120, width);
+    EXPECT_EQ(30, height);
+    ASSERT_EQ(chunks.size() + 1, events.size());
+    for (size_t i = 0; i < chunks.size(); ++i)
+    {
+        EXPECT_EQ(L'o', events[i].type);
+        EXPECT_EQ(chunks[i], events[i].data);
+        if (i > 0)
+        {
+            EXPECT_LE(events[i - 1].time, events[i].time);
+        }
+    }
+    EXPECT_EQ(L'r', events.back().type);
+    EXPECT_EQ(L"100x40", events.back().data);
+}
+
+TEST(SessionRecorderTests, FlushWritesEverythingSoFar)
+{
+    const auto path = recordingPath("FlushWritesEverythingSoFar");
+    std::vector<Asciicast::Event> events;
+    {
+        SessionRecorder recorder{ path.wstring(), 80, 24 };
+        recorder.Output(L"before");
+        recorder.Flush();
+
+        int width = 0;
+        int height = 0;
+        events = readRecording(path, width, height);
+    }
+    std::filesystem::remove(path);
+
+    ASSERT_EQ(1u, events.size());
+    EXPECT_EQ(L"before", events[0].data);
+}
+
+TEST(SessionRecorderTests, KeepsEveryChunkFromEveryThread)
+{
+    constexpr size_t threads = 4;
+    constexpr size_t chunksPerThread = 2000;
+    const auto path = recordingPath("KeepsEveryChunkFromEveryThread");
+
+    {
+        SessionRecorder recorder{ path.wstring(), 80, 24 };
+        std::vector<std::thread> writers;
+        for (size_t t = 0; t < threads; ++t)
+        {
+            writers.emplace_back([&, t]() {
+                for (size_t i = 0; i < chunksPerThread; ++i)
+                {
+                    recorder.Output(std::to_wstring(t) + L":" + std::to_wstring(i));
+                }
+            });
+        }
+        for (auto& writer : writers)
+        {
+            writer.join();
+        }
+    }
+
+    int width = 0;
+    int height = 0;
+    const auto events = readRecording(path, width, height);
+    std::filesystem::remove(path);
+
+    // Each thread's chunks have to be there, in the order it wrote them.
+    std::vector<size_t> next(threads, 0);
+    for (const auto& event : events)
+    {
+        const auto separator = event.data.find(L':');
+        ASSERT_NE(std::wstring::npos, separator);
+        const auto t = std::stoul(event.data.substr(0, separator));
+        ASSERT_LT(t, threads);
+        EXPECT_EQ(next[t]++, std::stoul(event.data.substr(separator + 1)));
+    }
+    EXPECT_EQ(std::vector<size_t>(threads, chunksPerThread), next);
+}
+
+TEST(SessionRecorderTests, ThrowsIfTheFileCantBeCreated)
+{
+    const auto path = std::filesystem::temp_directory_path() / "SessionRecorderTests-missing" / "recording.cast";
+    EXPECT_THROW((SessionRecorder{ path.wstring(), 80, 24 }), std::runtime_error);
+}
@@ -0,0 +1,162 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+// Measures the phases of CascadiaSettings::LoadAll that only take JSON, fed
+// with synthetic settings files: parsing settings.json and defaults.json,
+// and finding, reading and parsing the fragment files the way
+// SettingsLoader::FindFragmentsAndMergeIntoUserSettings does. The fragments
+// are written to a temporary directory, one per extension namespace like
+// %LOCALAPPDATA%\Microsoft\Windows Terminal\Fragments has them.
+//
+// Turning the documents into profiles and layering them needs C++/WinRT, so
+// those phases are only measured by SettingsLoadTimings in the app itself.
+
+#include "pch.h"
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <thread>
+
+#include <benchmark/benchmark.h>
+
+#include "Corpus.hpp"
+
+namespace
+{
+    // The namespaces the fragments are spread over.
+    constexpr size_t extensions = 8;
+
+    Json::Value parse(const std::string_view& content)
+    {
+        Json::Value json;
+        std::string errs;
+        const std::unique_ptr<Json::CharReader> reader{ Json::CharReaderBuilder{}.newCharReader() };
+        if (!reader->parse(content.data(), content.data() + content.size(), &json, &errs))
+        {
+            throw std::runtime_error{ errs };
+        }
+        return json;
+    }
+
+    std::string readFile(const std::filesystem::path& path)
+    {
+        std::ifstream file{ path, std::ios::binary };
+        if (!file)
+        {
+            throw std::runtime_error{ "can't read " + path.string() };
+        }
+        return { std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{} };
+    }
+
+    // A directory with the given number of fragment files, which is deleted again with it.
+    class FragmentsDirectory
+    {
+    public:
+        explicit FragmentsDirectory(const size_t fragments) :
+            _path{ std::filesystem::temp_directory_path() / ("SettingsLoadBenchmark-" + std::to_string(fragments)) }
+        {
+            std::filesystem::remove_all(_path);
+            for (size_t i = 0; i < fragments; ++i)
+            {
+                const auto directory = _path / ("Extension" + std::to_string(i % extensions));
+                std::filesystem::create_directories(directory);
+                std::ofstream{ directory / ("fragment" + std::to_string(i) + ".json"), std::ios::binary } << Microsoft::Terminal::Core::Benchmarks::FragmentJson(i);
+            }
+        }
+
+        ~FragmentsDirectory()
+        {
+            std::error_code ec;
+            std::filesystem::remove_all(_path, ec);
+        }
+
+        FragmentsDirectory(const FragmentsDirectory&) = delete;
+        FragmentsDirectory& operator=(const FragmentsDirectory&) = delete;
+
+        const std::filesystem::path& path() const noexcept
+        {
+            return _path;
+        }
+
+    private:
+        std::filesystem::path _path;
+    };
+
+    // What FindFragmentsAndMergeIntoUserSettings does before layering the
+    // fragments: walk the namespaces, then read and parse every .json file
+    // in them on the given number of threads.
+    std::vector<Json::Value> findFragments(const std::filesystem::path& root, const size_t threads)
+    {
+        std::vector<std::filesystem::path> paths;
+        for (const auto& extension : std::filesystem::directory_iterator{ root })
+        {
+            if (extension.is_directory())
+            {
+                for (const auto& file : std::filesystem::directory_iterator{ extension.path() })
+                {
+                    if (file.path().extension() == ".json")
+                    {
+                        paths.emplace_back(file.path());
+                    }
+                }
+            }
+        }
+
+        std::vector<Json::Value> fragments(paths.size());
+        std::atomic<size_t> next{ 0 };
+        const auto worker = [&]() {
+            for (auto i = next.fetch_add(1, std::memory_order_relaxed); i < paths.size(); i = next.fetch_add(1, std::memory_order_relaxed))
+            {
+                fragments[i] = parse(readFile(paths[i]));
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < std::min(threads, paths.size()); ++i)
+        {
+            workers.emplace_back(worker);
+        }
+        worker();
+        for (auto& thread : workers)
+        {
+            thread.join();
+        }
+        return fragments;
+    }
+
+    // The first argument is the number of profiles in settings.json.
+    void ParseSettings(benchmark::State& state)
+    {
+        const auto settings = Microsoft::Terminal::Core::Benchmarks::SettingsJson(static_cast<size_t>(state.range(0)));
+        const auto defaults = readFile(DEFAULTS_JSON);
+        for (auto _ : state)
+        {
+            auto user = parse(settings);
+            auto inbox = parse(defaults);
+            benchmark::DoNotOptimize(user);
+            benchmark::DoNotOptimize(inbox);
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * (settings.size() + defaults.size())));
+    }
+
+    // The first argument is the number of fragment files, the second one
+    // whether they're parsed on all cores like SettingsLoader::_parseFragments
+    // does, or one after the other.
+    void FindFragments(benchmark::State& state)
+    {
+        const FragmentsDirectory directory{ static_cast<size_t>(state.range(0)) };
+        const auto threads = state.range(1) ? std::max(1u, std::thread::hardware_concurrency()) : 1u;
+        for (auto _ : state)
+        {
+            auto fragments = findFragments(directory.path(), threads);
+            benchmark::DoNotOptimize(fragments);
+        }
+        state.counters["threads"] = static_cast<double>(threads);
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * state.range(0)));
+    }
+}
+
+BENCHMARK(ParseSettings)->Arg(10)->Arg(200)->Arg(2000);
+BENCHMARK(FindFragments)->Args({ 20, 0 })->Args({ 20, 1 })->Args({ 200, 0 })->Args({ 200, 1 })->UseRealTime();
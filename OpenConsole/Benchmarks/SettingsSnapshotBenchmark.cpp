@@ -0,0 +1,77 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+// Compares what a cold start of the settings costs with and without the
+// snapshot: parsing the JSON text of settings.json with jsoncpp, the way
+// SettingsLoader does, against reading the same document back from a
+// SettingsSnapshot. The argument is the number of profiles in settings.json.
+
+#include "pch.h"
+#include "SettingsSnapshot.h"
+
+#include <benchmark/benchmark.h>
+
+#include "Corpus.hpp"
+
+using namespace Microsoft::Terminal::Settings::Model;
+using Document = SettingsSnapshot::Document;
+
+namespace
+{
+    Json::Value parse(const std::string_view& content)
+    {
+        Json::Value json;
+        std::string errs;
+        const std::unique_ptr<Json::CharReader> reader{ Json::CharReaderBuilder{}.newCharReader() };
+        if (!reader->parse(content.data(), content.data() + content.size(), &json, &errs))
+        {
+            throw std::runtime_error{ errs };
+        }
+        return json;
+    }
+
+    std::string snapshotOf(const std::string& settings)
+    {
+        return SettingsSnapshot::Serialize({ { Document::Source::Content, settings, 0, 0, std::make_shared<const Json::Value>(parse(settings)) } });
+    }
+
+    void ParseJson(benchmark::State& state)
+    {
+        const auto settings = Microsoft::Terminal::Core::Benchmarks::SettingsJson(static_cast<size_t>(state.range(0)));
+        for (auto _ : state)
+        {
+            auto json = parse(settings);
+            benchmark::DoNotOptimize(json);
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * settings.size()));
+    }
+
+    void ReadSnapshot(benchmark::State& state)
+    {
+        const auto settings = Microsoft::Terminal::Core::Benchmarks::SettingsJson(static_cast<size_t>(state.range(0)));
+        const auto snapshot = snapshotOf(settings);
+        for (auto _ : state)
+        {
+            auto documents = SettingsSnapshot::Deserialize(snapshot);
+            benchmark::DoNotOptimize(documents);
+        }
+        state.counters["snapshot_bytes"] = static_cast<double>(snapshot.size());
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * settings.size()));
+    }
+
+    void WriteSnapshot(benchmark::State& state)
+    {
+        const auto settings = Microsoft::Terminal::Core::Benchmarks::SettingsJson(static_cast<size_t>(state.range(0)));
+        const std::vector<Document> documents{ { Document::Source::Content, settings, 0, 0, std::make_shared<const Json::Value>(parse(settings)) } };
+        for (auto _ : state)
+        {
+            auto snapshot = SettingsSnapshot::Serialize(documents);
+            benchmark::DoNotOptimize(snapshot);
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * settings.size()));
+    }
+}
+
+BENCHMARK(ParseJson)->Arg(10)->Arg(200)->Arg(2000);
+BENCHMARK(ReadSnapshot)->Arg(10)->Arg(200)->Arg(2000);
+BENCHMARK(WriteSnapshot)->Arg(10)->Arg(200)->Arg(2000);
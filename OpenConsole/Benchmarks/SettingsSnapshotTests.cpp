@@ -0,0 +1,135 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+// SettingsSnapshot has to give back exactly the documents it was given,
+// offsets included, and has to reject anything it didn't write itself.
+
+#include "pch.h"
+#include "SettingsSnapshot.h"
+
+#include <gtest/gtest.h>
+
+#include "Corpus.hpp"
+
+using namespace Microsoft::Terminal::Settings::Model;
+using Document = SettingsSnapshot::Document;
+
+namespace
+{
+    Json::Value parse(const std::string_view& content)
+    {
+        Json::Value json;
+        std::string errs;
+        const std::unique_ptr<Json::CharReader> reader{ Json::CharReaderBuilder{}.newCharReader() };
+        EXPECT_TRUE(reader->parse(content.data(), content.data() + content.size(), &json, &errs)) << errs;
+        return json;
+    }
+
+    std::vector<Document> documents()
+    {
+        std::vector<Document> documents;
+        const auto settings = Microsoft::Terminal::Core::Benchmarks::SettingsJson(20);
+        documents.push_back({ Document::Source::Content, settings, 0, 0, std::make_shared<const Json::Value>(parse(settings)) });
+        documents.push_back({ Document::Source::File, "C:\\Fragments\\wsl.json", 1234, -5678, std::make_shared<const Json::Value>(parse(R"({ "profiles": [ { "name": "Ubuntu", "hidden": true } ] })")) });
+        return documents;
+    }
+
+    // Compares the values, and the offsets of every value in them.
+    void expectSame(const Json::Value& expected, const Json::Value& actual)
+    {
+        ASSERT_EQ(expected, actual);
+        ASSERT_EQ(expected.getOffsetStart(), actual.getOffsetStart());
+        ASSERT_EQ(expected.getOffsetLimit(), actual.getOffsetLimit());
+        if (expected.isObject())
+        {
+            for (const auto& name : expected.getMemberNames())
+            {
+                expectSame(expected[name], actual[name]);
+            }
+        }
+        else if (expected.isArray())
+        {
+            for (Json::ArrayIndex i = 0; i < expected.size(); ++i)
+            {
+                expectSame(expected[i], actual[i]);
+            }
+        }
+    }
+}
+
+TEST(SettingsSnapshotTests, RoundTripsDocuments)
+{
+    const auto expected = documents();
+    const auto actual = SettingsSnapshot::Deserialize(SettingsSnapshot::Serialize(expected));
+    ASSERT_TRUE(actual.has_value());
+    ASSERT_EQ(expected.size(), actual->size());
+    for (size_t i = 0; i < expected.size(); ++i)
+    {
+        EXPECT_EQ(expected[i].source, actual->at(i).source);
+        EXPECT_EQ(expected[i].key, actual->at(i).key);
+        EXPECT_EQ(expected[i].size, actual->at(i).size);
+        EXPECT_EQ(expected[i].lastWriteTime, actual->at(i).lastWriteTime);
+        expectSame(*expected[i].json, *actual->at(i).json);
+    }
+}
+
+TEST(SettingsSnapshotTests, RoundTripsEveryKindOfValue)
+{
+    Json::Value value{ Json::objectValue };
+    value["null"] = Json::Value{};
+    value["true"] = true;
+    value["false"] = false;
+    value["int"] = Json::Value{ -(Json::LargestInt{ 1 } << 40) };
+    value["uint"] = Json::Value{ std::numeric_limits<Json::LargestUInt>::max() };
+    value["real"] = 0.125;
+    value["string"] = Json::Value{ std::string{ "a\0b", 3 } };
+    value["empty"] = Json::Value{ Json::arrayValue };
+    value[std::string{ "\0key", 4 }] = "embedded";
+    value["nested"].append(Json::Value{ Json::objectValue });
+    value["nested"].append(Json::Value{ "x" });
+
+    const auto actual = SettingsSnapshot::Deserialize(SettingsSnapshot::Serialize({ { Document::Source::Content, "", 0, 0, std::make_shared<const Json::Value>(value) } }));
+    ASSERT_TRUE(actual.has_value());
+    ASSERT_EQ(1u, actual->size());
+    EXPECT_EQ(value, *actual->front().json);
+    EXPECT_EQ(Json::intValue, (*actual->front().json)["int"].type());
+    EXPECT_EQ(Json::uintValue, (*actual->front().json)["uint"].type());
+}
+
+TEST(SettingsSnapshotTests, RoundTripsNoDocuments)
+{
+    const auto actual = SettingsSnapshot::Deserialize(SettingsSnapshot::Serialize({}));
+    ASSERT_TRUE(actual.has_value());
+    EXPECT_TRUE(actual->empty());
+}
+
+TEST(SettingsSnapshotTests, RejectsTruncatedSnapshots)
+{
+    const auto snapshot = SettingsSnapshot::Serialize(documents());
+    for (const auto size : { size_t{ 0 }, size_t{ 3 }, size_t{ 16 }, snapshot.size() / 2, snapshot.size() - 1 })
+    {
+        EXPECT_FALSE(SettingsSnapshot::Deserialize(std::string_view{ snapshot }.substr(0, size)).has_value()) << size;
+    }
+}
+
+TEST(SettingsSnapshotTests, RejectsCorruptSnapshots)
+{
+    const auto snapshot = SettingsSnapshot::Serialize(documents());
+    for (const auto offset : { size_t{ 0 }, size_t{ 4 }, size_t{ 8 }, size_t{ 20 }, snapshot.size() / 2, snapshot.size() - 1 })
+    {
+        auto corrupt = snapshot;
+        corrupt[offset] ^= 0x5A;
+        EXPECT_FALSE(SettingsSnapshot::Deserialize(corrupt).has_value()) << offset;
+    }
+
+    // Trailing data is just as wrong.
+    EXPECT_FALSE(SettingsSnapshot::Deserialize(snapshot + '\0').has_value());
+}
+
+TEST(SettingsSnapshotTests, RejectsOtherVersions)
+{
+    auto snapshot = SettingsSnapshot::Serialize(documents());
+    const auto version = SettingsSnapshot::FormatVersion + 1;
+    memcpy(snapshot.data() + 4, &version, sizeof(version));
+    EXPECT_FALSE(SettingsSnapshot::Deserialize(snapshot).has_value());
+}
@@ -0,0 +1,80 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+// Thread 0 is a writer, the others are readers, like the VT parser and the
+// render thread, UIA and the UI thread are. SharedTicketLock lets the readers
+// in at the same time. ExclusiveTicketLock is how the terminal was locked
+// before, with every reader taking the lock exclusively.
+
+#include "pch.h"
+#include "SharedTicketLock.hpp"
+
+#include <benchmark/benchmark.h>
+
+using namespace Microsoft::Terminal::Core;
+
+namespace
+{
+    struct ExclusiveTicketLock : til::ticket_lock
+    {
+        void lock_shared() noexcept
+        {
+            lock();
+        }
+
+        void unlock_shared() noexcept
+        {
+            unlock();
+        }
+    };
+
+    // About one row's worth of cells. Readers add them up, the writer
+    // changes them.
+    std::array<uint32_t, 120> cells{};
+
+    // Work done outside of the lock, like parsing the next chunk of output
+    // or laying out the next frame.
+    void workOutsideOfLock()
+    {
+        uint32_t sum = 0;
+        for (uint32_t i = 0; i < 200; ++i)
+        {
+            benchmark::DoNotOptimize(sum += i);
+        }
+    }
+
+    template<typename Lock>
+    void LockContention(benchmark::State& state)
+    {
+        static Lock lock;
+        const auto writer = state.thread_index() == 0;
+
+        for (auto _ : state)
+        {
+            workOutsideOfLock();
+            if (writer)
+            {
+                std::unique_lock<Lock> guard{ lock };
+                for (auto& cell : cells)
+                {
+                    ++cell;
+                }
+            }
+            else
+            {
+                std::shared_lock<Lock> guard{ lock };
+                uint32_t sum = 0;
+                for (const auto cell : cells)
+                {
+                    sum += cell;
+                }
+                benchmark::DoNotOptimize(sum);
+            }
+        }
+
+        state.SetItemsProcessed(state.iterations());
+    }
+}
+
+BENCHMARK_TEMPLATE(LockContention, ExclusiveTicketLock)->ThreadRange(2, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(LockContention, SharedTicketLock)->ThreadRange(2, 16)->UseRealTime();
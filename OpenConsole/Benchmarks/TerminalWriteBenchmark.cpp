@@ -0,0 +1,39 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+// Measures how fast a headless Terminal takes in output: the VT parser, the
+// print path and scrolling the buffer, without any rendering.
+
+#include "pch.h"
+#include "Terminal.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include "Corpus.hpp"
+
+using namespace Microsoft::Terminal::Core;
+
+namespace
+{
+    constexpr size_t CorpusLength = 1024 * 1024;
+
+    template<std::wstring (*Generate)(const size_t)>
+    void TerminalWrite(benchmark::State& state)
+    {
+        const auto text = Generate(CorpusLength);
+
+        Terminal terminal;
+        terminal.CreateHeadless({ 120, 30 }, gsl::narrow<SHORT>(state.range(0)));
+
+        for (auto _ : state)
+        {
+            terminal.Write(text);
+        }
+
+        state.SetBytesProcessed(gsl::narrow_cast<int64_t>(state.iterations() * text.size() * sizeof(wchar_t)));
+    }
+}
+
+BENCHMARK_TEMPLATE(TerminalWrite, Benchmarks::AsciiLog)->Arg(0)->Arg(9001);
+BENCHMARK_TEMPLATE(TerminalWrite, Benchmarks::CjkText)->Arg(0)->Arg(9001);
+BENCHMARK_TEMPLATE(TerminalWrite, Benchmarks::EmojiText)->Arg(0)->Arg(9001);
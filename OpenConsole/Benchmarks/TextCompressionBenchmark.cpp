@@ -0,0 +1,108 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+// Measures the compression the scrollback archive uses for blocks of rows
+// that left the buffer, and how many bytes a row ends up taking. The archive
+// compresses the text of 256 rows at a time, padded to the width of the
+// buffer like rows are. On top of what's reported here, it keeps 12 bytes per
+// row for where the row ends, and one attribute run per change of colors.
+
+#include "pch.h"
+#include "TextCompression.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include "Corpus.hpp"
+
+using namespace Microsoft::Terminal::Core;
+
+namespace
+{
+    constexpr size_t BlockRows = 256;
+    constexpr size_t Blocks = 64;
+
+    // The text of the blocks of a scrollback of the given width: every line
+    // of the text cut into rows, and every row padded to the width.
+    std::vector<std::wstring> blocksOf(const std::wstring& text, const size_t width)
+    {
+        std::vector<std::wstring> blocks(1);
+        size_t rows = 0;
+        for (size_t begin = 0; begin < text.size() && blocks.size() <= Blocks;)
+        {
+            auto end = text.find(L"\r\n", begin);
+            end = end == std::wstring::npos ? text.size() : end;
+            for (auto line = std::wstring_view{ text }.substr(begin, end - begin);;)
+            {
+                const auto row = line.substr(0, width);
+                line = line.substr(row.size());
+                blocks.back().append(row);
+                blocks.back().append(width - row.size(), L' ');
+                if (++rows % BlockRows == 0)
+                {
+                    blocks.emplace_back();
+                }
+                if (line.empty())
+                {
+                    break;
+                }
+            }
+            begin = end + 2;
+        }
+        blocks.pop_back();
+        return blocks;
+    }
+
+    void CompressBlocks(benchmark::State& state, std::wstring (*corpus)(size_t))
+    {
+        const auto width = gsl::narrow_cast<size_t>(state.range(0));
+        const auto blocks = blocksOf(corpus(Blocks * BlockRows * width), width);
+
+        std::wstring compressed;
+        size_t compressedUnits = 0;
+        for (auto _ : state)
+        {
+            compressedUnits = 0;
+            for (const auto& block : blocks)
+            {
+                TextCompression::Compress(block, compressed);
+                compressedUnits += compressed.size();
+            }
+            benchmark::DoNotOptimize(compressed.data());
+        }
+
+        // UTF-16 code units, as on Windows, no matter what wchar_t is here.
+        const auto rows = blocks.size() * BlockRows;
+        state.counters["bytes_per_row"] = static_cast<double>(compressedUnits * 2) / static_cast<double>(rows);
+        state.counters["ratio"] = static_cast<double>(rows * width) / static_cast<double>(compressedUnits);
+        state.SetBytesProcessed(gsl::narrow_cast<int64_t>(state.iterations() * rows * width * 2));
+    }
+
+    void DecompressBlocks(benchmark::State& state, std::wstring (*corpus)(size_t))
+    {
+        const auto width = gsl::narrow_cast<size_t>(state.range(0));
+        const auto blocks = blocksOf(corpus(Blocks * BlockRows * width), width);
+
+        std::vector<std::wstring> compressed(blocks.size());
+        for (size_t i = 0; i < blocks.size(); ++i)
+        {
+            TextCompression::Compress(blocks[i], compressed[i]);
+        }
+
+        std::wstring decompressed;
+        for (auto _ : state)
+        {
+            for (size_t i = 0; i < blocks.size(); ++i)
+            {
+                TextCompression::Decompress(compressed[i], blocks[i].size(), decompressed);
+            }
+            benchmark::DoNotOptimize(decompressed.data());
+        }
+
+        state.SetBytesProcessed(gsl::narrow_cast<int64_t>(state.iterations() * blocks.size() * BlockRows * width * 2));
+    }
+}
+
+BENCHMARK_CAPTURE(CompressBlocks, AsciiLog, Benchmarks::AsciiLog)->Arg(80)->Arg(120)->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(CompressBlocks, CompilerLog, Benchmarks::CompilerLog)->Arg(80)->Arg(120)->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(CompressBlocks, CjkText, Benchmarks::CjkText)->Arg(80)->Arg(120)->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(DecompressBlocks, AsciiLog, Benchmarks::AsciiLog)->Arg(80)->Arg(120)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,65 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+// TextCompression has to give back exactly the text it was given, including
+// runs of literals and matches that don't fit into a single code unit.
+
+#include "pch.h"
+#include "TextCompression.hpp"
+
+#include <random>
+
+#include <gtest/gtest.h>
+
+#include "Corpus.hpp"
+
+using namespace Microsoft::Terminal::Core;
+
+namespace
+{
+    std::wstring roundTrip(const std::wstring_view text)
+    {
+        std::wstring compressed;
+        TextCompression::Compress(text, compressed);
+        std::wstring decompressed;
+        TextCompression::Decompress(compressed, text.size(), decompressed);
+        return decompressed;
+    }
+}
+
+TEST(TextCompressionTests, RoundTripsShortText)
+{
+    for (const auto text : { L"", L"a", L"abc", L"abcd", L"abcdabcd", L"    " })
+    {
+        EXPECT_EQ(text, roundTrip(text));
+    }
+}
+
+TEST(TextCompressionTests, RoundTripsTheCorpus)
+{
+    constexpr size_t length = 256 * 1024;
+    EXPECT_EQ(Benchmarks::AsciiLog(length), roundTrip(Benchmarks::AsciiLog(length)));
+    EXPECT_EQ(Benchmarks::CjkText(length), roundTrip(Benchmarks::CjkText(length)));
+    EXPECT_EQ(Benchmarks::EmojiText(length), roundTrip(Benchmarks::EmojiText(length)));
+    EXPECT_EQ(Benchmarks::CompilerLog(length), roundTrip(Benchmarks::CompilerLog(length)));
+    EXPECT_EQ(Benchmarks::JsonDump(length), roundTrip(Benchmarks::JsonDump(length)));
+}
+
+TEST(TextCompressionTests, RoundTripsLongRuns)
+{
+    // Padding longer than a match can be, and noise longer than a run of
+    // literals can be.
+    std::wstring text(200000, L' ');
+    std::mt19937 random{ 42 };
+    std::uniform_int_distribution<int> unit{ 0x21, 0xFFFF };
+    for (size_t i = 0; i < 150000; ++i)
+    {
+        text.push_back(static_cast<wchar_t>(unit(random)));
+    }
+    text.append(70000, L'x');
+
+    std::wstring compressed;
+    TextCompression::Compress(text, compressed);
+    EXPECT_LT(compressed.size(), 160000u);
+    EXPECT_EQ(text, roundTrip(text));
+}
@@ -0,0 +1,105 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+// Compares UrlMatcher with running linkPattern through std::wregex, the way
+// TextBuffer::GetPatterns does, one viewport at a time.
+
+#include "pch.h"
+#include "UrlMatcher.hpp"
+
+#include <regex>
+
+#include <benchmark/benchmark.h>
+
+#include "Corpus.hpp"
+
+using namespace Microsoft::Terminal::Core;
+
+namespace
+{
+    constexpr size_t CorpusLength = 256 * 1024;
+    constexpr size_t ViewportRows = 30;
+
+    // Splits the text into viewports of ViewportRows lines each. Just like
+    // the rows of a viewport, they're searched without the line breaks.
+    std::vector<std::wstring> splitIntoViewports(const std::wstring_view text)
+    {
+        std::vector<std::wstring> viewports;
+        std::wstring viewport;
+        size_t rows = 0;
+        for (size_t begin = 0; begin < text.size();)
+        {
+            auto end = text.find(L"\r\n", begin);
+            end = end == std::wstring_view::npos ? text.size() : end;
+            viewport.append(text.substr(begin, end - begin));
+            begin = end + 2;
+
+            if (++rows == ViewportRows)
+            {
+                viewports.emplace_back(std::move(viewport));
+                viewport.clear();
+                rows = 0;
+            }
+        }
+        return viewports;
+    }
+
+    size_t bytesIn(const std::vector<std::wstring>& viewports)
+    {
+        size_t bytes = 0;
+        for (const auto& viewport : viewports)
+        {
+            bytes += viewport.size() * sizeof(wchar_t);
+        }
+        return bytes;
+    }
+
+    template<std::wstring (*Generate)(const size_t)>
+    void FindUrlsWithMatcher(benchmark::State& state)
+    {
+        const auto viewports = splitIntoViewports(Generate(CorpusLength));
+        std::vector<UrlMatcher::Match> matches;
+
+        for (auto _ : state)
+        {
+            for (const auto& viewport : viewports)
+            {
+                UrlMatcher::FindAll(viewport, matches);
+                benchmark::DoNotOptimize(matches.data());
+            }
+        }
+
+        state.SetBytesProcessed(gsl::narrow_cast<int64_t>(state.iterations() * bytesIn(viewports)));
+    }
+
+    template<std::wstring (*Generate)(const size_t)>
+    void FindUrlsWithRegex(benchmark::State& state)
+    {
+        const auto viewports = splitIntoViewports(Generate(CorpusLength));
+        const std::wregex regex{ linkPattern.data(), linkPattern.size() };
+        std::vector<UrlMatcher::Match> matches;
+
+        for (auto _ : state)
+        {
+            for (const auto& viewport : viewports)
+            {
+                matches.clear();
+                for (std::wsregex_iterator it{ viewport.begin(), viewport.end(), regex }, end; it != end; ++it)
+                {
+                    const auto begin = gsl::narrow_cast<size_t>(it->position());
+                    matches.emplace_back(UrlMatcher::Match{ begin, begin + gsl::narrow_cast<size_t>(it->length()) });
+                }
+                benchmark::DoNotOptimize(matches.data());
+            }
+        }
+
+        state.SetBytesProcessed(gsl::narrow_cast<int64_t>(state.iterations() * bytesIn(viewports)));
+    }
+}
+
+BENCHMARK_TEMPLATE(FindUrlsWithMatcher, Benchmarks::CompilerLog);
+BENCHMARK_TEMPLATE(FindUrlsWithRegex, Benchmarks::CompilerLog);
+BENCHMARK_TEMPLATE(FindUrlsWithMatcher, Benchmarks::JsonDump);
+BENCHMARK_TEMPLATE(FindUrlsWithRegex, Benchmarks::JsonDump);
+BENCHMARK_TEMPLATE(FindUrlsWithMatcher, Benchmarks::AsciiLog);
+BENCHMARK_TEMPLATE(FindUrlsWithRegex, Benchmarks::AsciiLog);
@@ -0,0 +1,205 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+// UrlMatcher has to find exactly what std::wregex finds for linkPattern.
+// These tests run both over the same text and compare the results.
+
+#include "pch.h"
+#include "UrlMatcher.hpp"
+
+#include <random>
+#include <regex>
+
+#include <gtest/gtest.h>
+
+#include "Corpus.hpp"
+
+using namespace Microsoft::Terminal::Core;
+
+namespace
+{
+    using Matches = std::vector<std::pair<size_t, size_t>>;
+
+    Matches matchWithRegex(const std::wstring_view text)
+    {
+        static const std::wregex regex{ linkPattern.data(), linkPattern.size() };
+
+        Matches matches;
+        for (std::wcregex_iterator it{ text.data(), text.data() + text.size(), regex }, end; it != end; ++it)
+        {
+            const auto begin = gsl::narrow_cast<size_t>(it->position());
+            matches.emplace_back(begin, begin + gsl::narrow_cast<size_t>(it->length()));
+        }
+        return matches;
+    }
+
+    Matches matchWithMatcher(const std::wstring_view text)
+    {
+        std::vector<UrlMatcher::Match> found;
+        UrlMatcher::FindAll(text, found);
+
+        Matches matches;
+        for (const auto& match : found)
+        {
+            matches.emplace_back(match.begin, match.end);
+        }
+        return matches;
+    }
+
+    // Compares the two line by line. std::regex recurses for every character
+    // it matches, so it can't take a whole corpus at once.
+    void expectSameMatches(const std::wstring_view text)
+    {
+        for (size_t begin = 0; begin < text.size();)
+        {
+            auto end = text.find(L'\n', begin);
+            end = end == std::wstring_view::npos ? text.size() : end + 1;
+
+            const auto line = text.substr(begin, end - begin);
+            ASSERT_EQ(matchWithRegex(line), matchWithMatcher(line)) << "in line at offset " << begin;
+            begin = end;
+        }
+    }
+
+    // A stand-in for IsGlyphFullWidth: CJK ideographs and everything outside
+    // of the BMP are wide, the rest isn't.
+    bool isWide(const std::wstring_view glyph)
+    {
+        return glyph.size() == 2 || (glyph.front() >= 0x4E00 && glyph.front() <= 0x9FFF);
+    }
+
+    Matches toColumns(const std::wstring_view text)
+    {
+        std::vector<UrlMatcher::Match> found;
+        UrlMatcher::FindAll(text, found);
+        UrlMatcher::ToColumns(text, found, isWide);
+
+        Matches matches;
+        for (const auto& match : found)
+        {
+            matches.emplace_back(match.begin, match.end);
+        }
+        return matches;
+    }
+}
+
+TEST(UrlMatcherTests, MatchesRegexOnCorpus)
+{
+    constexpr size_t length = 256 * 1024;
+    expectSameMatches(Benchmarks::CompilerLog(length));
+    expectSameMatches(Benchmarks::JsonDump(length));
+    expectSameMatches(Benchmarks::AsciiLog(length));
+}
+
+TEST(UrlMatcherTests, MatchesRegexAtWordBoundaries)
+{
+    for (const auto text : {
+             L"http://a",
+             L" http://a",
+             L"xhttp://a",
+             L"_http://a",
+             L"1http://a",
+             L"-http://a",
+             L"(http://a)",
+             L"\"http://a\"",
+             L"sftp://a",
+             L"s-ftp://a",
+             L"afile:///c:/x",
+             L"xhttps://a",
+             L"ahttps://a http://b",
+             L"\u00e9http://a",
+             L"\u6f22http://a",
+             L"\u00e9 http://a",
+             L"HTTP://a",
+         })
+    {
+        EXPECT_EQ(matchWithRegex(text), matchWithMatcher(text)) << "for " << ::testing::PrintToString(std::wstring{ text });
+    }
+}
+
+TEST(UrlMatcherTests, MatchesRegexAtTheEnd)
+{
+    for (const auto text : {
+             L"http://",
+             L"http:/",
+             L"http:",
+             L"http://.",
+             L"http://a.",
+             L"http://a..b,",
+             L"http://a.b.c/d?",
+             L"http://a.b.c/d?e=f&g=h#i",
+             L"https://a/b-",
+             L"https://a/b--c-",
+             L"https://a/b;c;",
+             L"http://a:8080/",
+             L"http://a://b",
+             L"http://a http://b",
+             L"http://a,http://b",
+             L"http://a\thttp://b",
+             L"ftp://x:21/a.txt.",
+             L"file:///c:/x/y.z!",
+             L"see http://example.com/a_(b)",
+             L"http://a/\u00e9",
+             L"http://\u6f22\u5b57",
+         })
+    {
+        EXPECT_EQ(matchWithRegex(text), matchWithMatcher(text)) << "for " << ::testing::PrintToString(std::wstring{ text });
+    }
+}
+
+TEST(UrlMatcherTests, MatchesRegexOnRandomText)
+{
+    // The pieces that make it interesting for the matcher: schemes, parts of
+    // them, separators, and characters that may or may not be part of a URL
+    // or a word.
+    static constexpr std::array<std::wstring_view, 26> pieces{
+        L"http", L"https", L"ftp", L"file", L"htt", L"s", L"://", L":", L"/", L"//",
+        L".", L",", L";", L"?", L"!", L"-", L"a", L"Z", L"9", L"_",
+        L" ", L"\t", L")", L"\u00e9", L"\u6f22", L"\xD83D\xDE00"
+    };
+
+    std::mt19937 random{ 42 };
+    std::uniform_int_distribution<size_t> piece{ 0, pieces.size() - 1 };
+    std::uniform_int_distribution<size_t> count{ 0, 24 };
+
+    std::wstring text;
+    for (auto i = 0; i < 50000; ++i)
+    {
+        text.clear();
+        for (auto n = count(random); n > 0; --n)
+        {
+            text.append(pieces.at(piece(random)));
+        }
+        ASSERT_EQ(matchWithRegex(text), matchWithMatcher(text)) << "for " << ::testing::PrintToString(text);
+    }
+}
+
+TEST(UrlMatcherTests, ColumnsOfAsciiText)
+{
+    EXPECT_EQ((Matches{ { 4, 12 }, { 13, 21 } }), toColumns(L"see http://a http://b"));
+}
+
+TEST(UrlMatcherTests, ColumnsAfterWideGlyphs)
+{
+    // Two ideographs and a space take up 5 columns.
+    EXPECT_EQ((Matches{ { 5, 13 } }), toColumns(L"\u6f22\u5b57 http://a"));
+    // So do two emoji, each of which is a surrogate pair. They are spelled
+    // out, because wchar_t is 4 bytes on some platforms.
+    EXPECT_EQ((Matches{ { 5, 13 } }), toColumns(L"\xD83D\xDE00\xD83D\xDE00 http://a"));
+    // Narrow glyphs that aren't ASCII take up 1 column each.
+    EXPECT_EQ((Matches{ { 3, 11 } }), toColumns(L"\u00e9\u00e9 http://a"));
+}
+
+TEST(UrlMatcherTests, ColumnsBetweenWideGlyphs)
+{
+    // The columns of the second URL depend on the width of everything
+    // before it, including the first URL.
+    EXPECT_EQ((Matches{ { 3, 11 }, { 15, 23 } }), toColumns(L"\u6f22 http://a \u5b57 http://b"));
+}
+
+TEST(UrlMatcherTests, ColumnsOfUnpairedSurrogates)
+{
+    // A lone surrogate is a glyph of its own, and narrow.
+    EXPECT_EQ((Matches{ { 2, 10 } }), toColumns(L"\xD83D http://a"));
+    EXPECT_EQ((Matches{ { 2, 10 } }), toColumns(L"\xDE00 http://a"));
+}
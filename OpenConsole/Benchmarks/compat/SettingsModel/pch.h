@@ -0,0 +1,38 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+// Module Name:
+// - pch.h
+//
+// Abstract:
+// - Stands in for Microsoft.Terminal.Settings.Model/pch.h when the portable
+//   parts of the settings model are built by CMake (see ../../CMakeLists.txt).
+//   Like ../pch.h, it only provides what those parts use: the standard
+//   library, jsoncpp and til::at.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <json.h>
+
+namespace til
+{
+    template<typename T, typename I>
+    constexpr auto at(T&& cont, const I i) noexcept -> decltype(auto)
+    {
+        return cont[i];
+    }
+}
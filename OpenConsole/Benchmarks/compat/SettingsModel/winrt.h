@@ -0,0 +1,38 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+// Module Name:
+// - winrt.h
+//
+// Abstract:
+// - Stands in for the few parts of C++/WinRT that IInheritable.h uses, so that
+//   its inheritance can be tested without Windows. Objects are reference
+//   counted by std::shared_ptr here, so T has to derive from
+//   std::enable_shared_from_this<T>.
+
+#pragma once
+
+namespace winrt
+{
+    template<typename T>
+    struct com_ptr : std::shared_ptr<T>
+    {
+        com_ptr() = default;
+        com_ptr(std::shared_ptr<T> other) noexcept :
+            std::shared_ptr<T>{ std::move(other) }
+        {
+        }
+    };
+
+    template<typename T>
+    com_ptr<T> make_self()
+    {
+        return std::make_shared<T>();
+    }
+
+    template<typename T>
+    void copy_from_abi(com_ptr<T>& object, T* const value)
+    {
+        object = value->shared_from_this();
+    }
+}
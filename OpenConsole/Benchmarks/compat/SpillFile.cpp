@@ -0,0 +1,79 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "pch.h"
+#include "SpillFile.hpp"
+
+#include <random>
+
+using namespace Microsoft::Terminal::Core;
+
+SpillFile::SpillFile()
+{
+    std::random_device random;
+    for (auto attempt = 0; attempt < 100 && !_file.is_open(); ++attempt)
+    {
+        _path = std::filesystem::temp_directory_path() / ("wts" + std::to_string(random()) + ".tmp");
+        if (!std::filesystem::exists(_path))
+        {
+            // Creates the file. Opening it for reading as well doesn't.
+            std::ofstream{ _path, std::ios::binary };
+            _file.open(_path, std::ios::in | std::ios::out | std::ios::binary);
+        }
+    }
+    if (!_file.is_open())
+    {
+        throw std::runtime_error{ "can't create the spill file" };
+    }
+}
+
+SpillFile::~SpillFile()
+{
+    _file.close();
+    std::error_code ec;
+    std::filesystem::remove(_path, ec);
+}
+
+const std::filesystem::path& SpillFile::Path() const noexcept
+{
+    return _path;
+}
+
+SpillFile::Position SpillFile::Reserve(const size_t size)
+{
+    const Position position{ 0, _size };
+    _size += size;
+    return position;
+}
+
+bool SpillFile::Write(const Position position, const void* const source, const size_t size) noexcept
+{
+    _file.seekp(static_cast<std::streamoff>(position.offset));
+    _file.write(static_cast<const char*>(source), static_cast<std::streamsize>(size));
+    if (!_file)
+    {
+        _file.clear();
+        return false;
+    }
+    return true;
+}
+
+bool SpillFile::Read(const Position position, void* const destination, const size_t size) const noexcept
+{
+    _file.seekg(static_cast<std::streamoff>(position.offset));
+    _file.read(static_cast<char*>(destination), static_cast<std::streamsize>(size));
+    if (!_file)
+    {
+        _file.clear();
+        return false;
+    }
+    return true;
+}
+
+void SpillFile::Clear() noexcept
+{
+    _size = 0;
+    _file.flush();
+    std::error_code ec;
+    std::filesystem::resize_file(_path, 0, ec);
+}
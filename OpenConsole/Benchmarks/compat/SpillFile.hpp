@@ -0,0 +1,44 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+// Module Name:
+// - SpillFile.hpp
+//
+// Abstract:
+// - Stands in for TerminalCore/SpillFile.hpp, which maps the file with the
+//   Windows API. This one reads and writes a file in the temp directory with
+//   the standard library instead, which is all the ScrollbackArchive tests
+//   need. The file is deleted when the SpillFile is destroyed.
+
+#pragma once
+
+namespace Microsoft::Terminal::Core
+{
+    class SpillFile final
+    {
+    public:
+        // There's only the one segment here.
+        struct Position
+        {
+            size_t segment;
+            size_t offset;
+        };
+
+        SpillFile();
+        ~SpillFile();
+        SpillFile(const SpillFile&) = delete;
+        SpillFile& operator=(const SpillFile&) = delete;
+
+        const std::filesystem::path& Path() const noexcept;
+
+        Position Reserve(const size_t size);
+        bool Write(const Position position, const void* const source, const size_t size) noexcept;
+        bool Read(const Position position, void* const destination, const size_t size) const noexcept;
+        void Clear() noexcept;
+
+    private:
+        std::filesystem::path _path;
+        mutable std::fstream _file;
+        size_t _size{ 0 };
+    };
+}
@@ -0,0 +1,113 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+// Module Name:
+// - pch.h
+//
+// Abstract:
+// - Stands in for TerminalCore/pch.h when the portable parts of TerminalCore
+//   are built by CMake (see ../CMakeLists.txt). It provides the standard
+//   library and the handful of til and gsl helpers those parts use, and
+//   nothing else. A source that starts depending on the rest of the
+//   OpenConsole tree, WIL or WinRT fails to build here instead of silently
+//   dragging it in.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cwctype>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <numeric>
+#include <optional>
+#include <regex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#pragma comment(lib, "synchronization.lib")
+#else
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// WaitOnAddress and friends, for 4 byte values, on top of futexes.
+#define INFINITE 0xFFFFFFFF
+
+inline bool WaitOnAddress(volatile void* address, void* compareAddress, size_t addressSize, unsigned long milliseconds) noexcept
+{
+    assert(addressSize == sizeof(uint32_t) && milliseconds == INFINITE);
+    (void)addressSize;
+    (void)milliseconds;
+    uint32_t expected;
+    memcpy(&expected, compareAddress, sizeof(expected));
+    return syscall(SYS_futex, address, FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0) == 0;
+}
+
+inline void WakeByAddressSingle(void* address) noexcept
+{
+    syscall(SYS_futex, address, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+}
+
+inline void WakeByAddressAll(void* address) noexcept
+{
+    syscall(SYS_futex, address, FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+}
+#endif
+
+namespace til
+{
+    template<typename T, typename I>
+    constexpr auto at(T&& cont, const I i) noexcept -> decltype(auto)
+    {
+        return cont[i];
+    }
+}
+
+namespace gsl
+{
+    struct narrowing_error : std::exception
+    {
+    };
+
+    template<typename T, typename U>
+    constexpr T narrow_cast(U&& u) noexcept
+    {
+        return static_cast<T>(std::forward<U>(u));
+    }
+
+    template<typename T, typename U>
+    constexpr T narrow(U u)
+    {
+        const auto t = static_cast<T>(u);
+        if (static_cast<U>(t) != u || (std::is_signed_v<T> != std::is_signed_v<U> && ((t < T{}) != (u < U{}))))
+        {
+            throw narrowing_error{};
+        }
+        return t;
+    }
+}
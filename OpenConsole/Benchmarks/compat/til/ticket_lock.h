@@ -0,0 +1,44 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+// Module Name:
+// - ticket_lock.h
+//
+// Abstract:
+// - The same FIFO ticket lock as til/ticket_lock.h in the OpenConsole
+//   submodule, for builds that don't have the submodule. It waits with the
+//   WaitOnAddress that ../pch.h provides, so both locks the benchmarks compare
+//   sleep and wake up the same way.
+
+#pragma once
+
+namespace til
+{
+    struct ticket_lock
+    {
+        void lock() noexcept
+        {
+            const auto ticket = _next_ticket.fetch_add(1, std::memory_order_relaxed);
+
+            for (;;)
+            {
+                auto current = _now_serving.load(std::memory_order_acquire);
+                if (current == ticket)
+                {
+                    break;
+                }
+                WaitOnAddress(&_now_serving, &current, sizeof(current), INFINITE);
+            }
+        }
+
+        void unlock() noexcept
+        {
+            _now_serving.fetch_add(1, std::memory_order_release);
+            WakeByAddressAll(&_now_serving);
+        }
+
+    private:
+        std::atomic<uint32_t> _next_ticket{ 0 };
+        std::atomic<uint32_t> _now_serving{ 0 };
+    };
+}
@@ -35,6 +35,25 @@ constexpr const auto TsfRedrawInterval = std::chrono::milliseconds(100);
 // The minimum delay between updating the locations of regex patterns
 constexpr const auto UpdatePatternLocationsInterval = std::chrono::milliseconds(500);
 
+// The minimum delay between updating the search results after new output.
+constexpr const auto UpdateSearchResultsInterval = std::chrono::milliseconds(100);
+
+// The minimum delay between resizing the buffer and the connection while the
+// swapchain is being resized.
+constexpr const auto ResizeBufferInterval = std::chrono::milliseconds(100);
+
+// The delay between a resize and reflowing the scrollback it left alone.
+constexpr const auto FinishReflowInterval = std::chrono::milliseconds(250);
+
+// The number of rows find-all searches with the search index locked, and the
+// number of archived rows the search index reads in one go.
+constexpr size_t FindAllChunkRows = 1000;
+
+// The longest the output worker will hold on to the terminal lock in one go.
+// Between slices the lock is released, so that input, selection and the
+// renderer get a chance to run while a flood of output is being parsed.
+constexpr const auto OutputSliceDuration = std::chrono::milliseconds(4);
+
 namespace winrt::Microsoft::Terminal::Control::implementation
 {
     // Helper static function to ensure that all ambiguous-width glyphs are reported as narrow.
@@ -80,6 +99,9 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         _terminal->SetWriteInputCallback([this](std::wstring_view wstr) {
             _sendInputToConnection(wstr);
         });
+        _terminal->SetReturnResponseCallback([this](std::wstring_view wstr) {
+            _sendResponseToConnection(wstr);
+        });
 
         // GH#8969: pre-seed working directory to prevent potential races
         _terminal->SetWorkingDirectory(_settings->StartingDirectory());
@@ -162,6 +184,13 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         //   need to hop across the process boundary every time text is output.
         //   We can throttle this to once every 8ms, which will get us out of
         //   the way of the main output & rendering threads.
+        // * _resizeBuffer: When the window is dragged, the swapchain changes
+        //   size many times a second. Each size would reflow the buffer and
+        //   make the client redraw, so we only do that for the latest size,
+        //   at most every 100ms.
+        // * _finishReflow: A resize only reflows the rows around the viewport.
+        //   The rest of the scrollback is reflowed once, after the window
+        //   stopped being resized for a bit, instead of on every step of it.
         _tsfTryRedrawCanvas = std::make_shared<ThrottledFuncTrailing<>>(
             _dispatcher,
             TsfRedrawInterval,
@@ -192,6 +221,38 @@ namespace winrt::Microsoft::Terminal::Control::implementation
                 }
             });
 
+        _updateSearchResults = std::make_shared<ThrottledFuncTrailing<>>(
+            _dispatcher,
+            UpdateSearchResultsInterval,
+            [weakThis = get_weak()]() {
+                if (auto core{ weakThis.get() }; !core->_IsClosing())
+                {
+                    core->_refreshSearchResults();
+                }
+            });
+
+        _resizeBuffer = std::make_shared<ThrottledFuncTrailing<>>(
+            _dispatcher,
+            ResizeBufferInterval,
+            [weakThis = get_weak()]() {
+                if (auto core{ weakThis.get() }; !core->_IsClosing())
+                {
+                    auto lock = core->_terminal->LockForWriting();
+                    core->_resizeBufferUnderLock();
+                }
+            });
+
+        _finishReflow = std::make_shared<ThrottledFuncTrailing<>>(
+            _dispatcher,
+            FinishReflowInterval,
+            [weakThis = get_weak()]() {
+                if (auto core{ weakThis.get() }; !core->_IsClosing())
+                {
+                    auto lock = core->_terminal->LockForWriting();
+                    core->_terminal->FinishReflow();
+                }
+            });
+
         UpdateSettings(settings, unfocusedAppearance);
     }
 
@@ -263,6 +324,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
             const auto width = vp.Width();
             const auto height = vp.Height();
             _connection.Resize(height, width);
+            _startRecording(width, height);
 
             if (_OwningHwnd != 0)
             {
@@ -304,6 +366,8 @@ namespace winrt::Microsoft::Terminal::Control::implementation
             _initializedTerminal = true;
         } // scope for TerminalLock
 
+        _startOutputWorker();
+
         // Start the connection outside of lock, because it could
         // start writing output immediately.
         _connection.Start();
@@ -330,6 +394,10 @@ namespace winrt::Microsoft::Terminal::Control::implementation
     // Method Description:
     // - Writes the given sequence as input to the active terminal connection.
     // - This method has been overloaded to allow zero-copy winrt::param::hstring optimizations.
+    // - While a long paste is being written, the input is held back until it's
+    //   done, so that it doesn't end up in the middle of the paste, or inside
+    //   its bracketed paste sequences. The terminal's replies to the client
+    //   don't come through here, see _sendResponseToConnection.
     // Arguments:
     // - wstr: the string of characters to write to the terminal connection.
     // Return Value:
@@ -339,6 +407,13 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         if (_isReadOnly)
         {
             _raiseReadOnlyWarning();
+            return;
+        }
+
+        const auto lock = _heldInputLock.lock_exclusive();
+        if (_pastesInFlight.load() != 0)
+        {
+            _heldInput.append(wstr);
         }
         else
         {
@@ -346,6 +421,26 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         }
     }
 
+    // Method Description:
+    // - Writes the terminal's reply to a query from the client, like DSR or DA,
+    //   to the connection.
+    // - Unlike user input, replies aren't held back during a long paste. The
+    //   client may be waiting for one before it reads the rest of the paste.
+    // Arguments:
+    // - wstr: the reply.
+    // Return Value:
+    // - <none>
+    void ControlCore::_sendResponseToConnection(std::wstring_view wstr)
+    {
+        if (_isReadOnly)
+        {
+            _raiseReadOnlyWarning();
+            return;
+        }
+
+        _connection.WriteInput(wstr);
+    }
+
     // Method Description:
     // - Writes the given sequence as input to the active terminal connection,
     // Arguments:
@@ -822,6 +917,14 @@ namespace winrt::Microsoft::Terminal::Control::implementation
     // Return Value:
     // - <none>
     void ControlCore::_refreshSizeUnderLock()
+    {
+        _refreshRenderSizeUnderLock();
+        _resizeBufferUnderLock();
+    }
+
+    // Method Description:
+    // - Returns the size of the swapchain, in pixels.
+    COORD ControlCore::_panelSizeInPixels() const
     {
         auto cx = gsl::narrow_cast<short>(_panelWidth * _compositionScale);
         auto cy = gsl::narrow_cast<short>(_panelHeight * _compositionScale);
@@ -830,19 +933,44 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         // in either dimension. The buffer really doesn't like being size 0.
         cx = std::max(cx, _actualFont.GetSize().X);
         cy = std::max(cy, _actualFont.GetSize().Y);
+        return { cx, cy };
+    }
 
-        // Convert our new dimensions to characters
-        const auto viewInPixels = Viewport::FromDimensions({ 0, 0 }, { cx, cy });
-        const auto vp = _renderEngine->GetViewportInCharacters(viewInPixels);
-        const auto currentVP = _terminal->GetViewport();
-
-        _terminal->ClearSelection();
-
+    // Method Description:
+    // - Tells the render engine about the current size of the swapchain, and
+    //   redraws everything. The buffer keeps its size, see _resizeBufferUnderLock.
+    // - The write lock should be held when calling this method.
+    // Arguments:
+    // - <none>
+    // Return Value:
+    // - <none>
+    void ControlCore::_refreshRenderSizeUnderLock()
+    {
         // Tell the dx engine that our window is now the new size.
-        THROW_IF_FAILED(_renderEngine->SetWindowSize({ cx, cy }));
+        const auto size = _panelSizeInPixels();
+        THROW_IF_FAILED(_renderEngine->SetWindowSize({ size.X, size.Y }));
 
         // Invalidate everything
         _renderer->TriggerRedrawAll();
+    }
+
+    // Method Description:
+    // - Resizes the buffer to fit the swapchain, and tells the connection
+    //   about its new size. This reflows the buffer, and the connection passes
+    //   the size on to the client, so this is only done once the size of the
+    //   swapchain settled, see SizeChanged.
+    // - The write lock should be held when calling this method.
+    // Arguments:
+    // - <none>
+    // Return Value:
+    // - <none>
+    void ControlCore::_resizeBufferUnderLock()
+    {
+        // Convert our new dimensions to characters
+        const auto viewInPixels = Viewport::FromDimensions({ 0, 0 }, _panelSizeInPixels());
+        const auto vp = _renderEngine->GetViewportInCharacters(viewInPixels);
+
+        _terminal->ClearSelection();
 
         // If this function succeeds with S_FALSE, then the terminal didn't
         // actually change size. No need to notify the connection of this no-op.
@@ -850,13 +978,22 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         if (SUCCEEDED(hr) && hr != S_FALSE)
         {
             _connection.Resize(vp.Height(), vp.Width());
+            if (_recorder)
+            {
+                _recorder->Resize(vp.Width(), vp.Height());
+            }
+        }
+
+        if (_terminal->IsReflowPending())
+        {
+            _finishReflow->Run();
         }
     }
 
     void ControlCore::SizeChanged(const double width,
                                   const double height)
     {
-        // _refreshSizeUnderLock redraws the entire terminal.
+        // _refreshRenderSizeUnderLock redraws the entire terminal.
         // Don't call it if we don't have to.
         if (_panelWidth == width && _panelHeight == height)
         {
@@ -866,8 +1003,13 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         _panelWidth = width;
         _panelHeight = height;
 
+        // While the window is being dragged, this is called many times a
+        // second. Only the render engine is resized right away. Reflowing the
+        // buffer and resizing the connection (which makes the client redraw)
+        // waits for the size to settle, so the sizes in between are skipped.
         auto lock = _terminal->LockForWriting();
-        _refreshSizeUnderLock();
+        _refreshRenderSizeUnderLock();
+        _resizeBuffer->Run();
     }
 
     void ControlCore::ScaleChanged(const double scale)
@@ -1004,14 +1146,129 @@ namespace winrt::Microsoft::Terminal::Control::implementation
     // Method Description:
     // - Pre-process text pasted (presumably from the clipboard)
     //   before sending it over the terminal's connection.
+    // - Text that doesn't fit into a single chunk is written on a background
+    //   thread instead, see _pasteInBackground.
     void ControlCore::PasteText(const winrt::hstring& hstr)
     {
-        _terminal->WritePastedText(hstr);
+        // Small pastes are written right away, unless a long paste is still
+        // being written. They need to wait their turn behind it.
+        if (_isReadOnly || (hstr.size() <= PasteChunkSize && _pastesInFlight.load() == 0))
+        {
+            _terminal->WritePastedText(hstr);
+        }
+        else
+        {
+            _pastesInFlight.fetch_add(1);
+            _pasteInBackground(hstr, _pasteGeneration.load());
+        }
+
         _terminal->ClearSelection();
         _renderer->TriggerSelection();
         _terminal->TrySnapOnInput();
     }
 
+    // Method Description:
+    // - Cancels all the pastes that are still being written. Whatever part of
+    //   them was already written stays written.
+    void ControlCore::CancelPaste() noexcept
+    {
+        _pasteGeneration.fetch_add(1);
+    }
+
+    // Method Description:
+    // - Writes a long paste on a background thread, so that neither filtering
+    //   nor writing it blocks the UI. If the connection can tell us about the
+    //   input it hasn't written yet, we only queue up a little more than a
+    //   chunk at a time, to not hold on to a second copy of the whole paste.
+    // - Raises PasteProgress after every chunk, and once it's done.
+    // - The user's input in the meantime is held back by
+    //   _sendInputToConnection, and written after the paste.
+    // Arguments:
+    // - text: the text to paste.
+    // - generation: the value of _pasteGeneration when the paste was started.
+    //   The paste is cancelled once that changes.
+    winrt::fire_and_forget ControlCore::_pasteInBackground(const winrt::hstring text, const uint64_t generation)
+    {
+        auto strongThis{ get_strong() };
+        co_await winrt::resume_background();
+
+        const auto lock = _pasteLock.lock_exclusive();
+        const auto total = gsl::narrow_cast<uint64_t>(text.size());
+        const auto cancelled = [&]() {
+            return _pasteGeneration.load() != generation;
+        };
+
+        uint64_t written{ 0 };
+        auto completed = false;
+        if (!cancelled())
+        {
+            const auto conpty = _connection.try_as<TerminalConnection::ConptyConnection>();
+            const auto chunkWritten = [&](const size_t chunkEnd) {
+                written = chunkEnd;
+                if (conpty)
+                {
+                    while (!conpty.WaitForPendingInput(PasteChunkSize, 10))
+                    {
+                        if (cancelled())
+                        {
+                            return false;
+                        }
+                    }
+                }
+                if (cancelled())
+                {
+                    return false;
+                }
+                if (written < total)
+                {
+                    _raisePasteProgress(written, total, false, false);
+                }
+                return true;
+            };
+            // This bypasses _sendInputToConnection, which holds input back
+            // while we're writing.
+            const auto writeInput = [&](const std::wstring_view wstr) {
+                if (!_isReadOnly && !_IsClosing())
+                {
+                    _connection.WriteInput(wstr);
+                }
+            };
+            completed = _terminal->WritePastedText(text, chunkWritten, writeInput);
+        }
+
+        // The closing bracketed paste sequence has been written, so whatever
+        // was typed in the meantime can go now. The next paste is still
+        // waiting for _pasteLock, so it goes before that one, too. If the
+        // control is being closed, or was made read-only, it's dropped.
+        {
+            const auto heldLock = _heldInputLock.lock_exclusive();
+            _pastesInFlight.fetch_sub(1);
+            if (!_heldInput.empty())
+            {
+                if (!_IsClosing() && !_isReadOnly)
+                {
+                    _connection.WriteInput(_heldInput);
+                }
+                _heldInput.clear();
+            }
+        }
+
+        _raisePasteProgress(completed ? total : written, total, true, !completed);
+    }
+
+    // Method Description:
+    // - Raises PasteProgress on the UI thread. The events of one paste are
+    //   raised in the order they were queued in.
+    void ControlCore::_raisePasteProgress(const uint64_t written, const uint64_t total, const bool finished, const bool cancelled)
+    {
+        _dispatcher.TryEnqueue(winrt::Microsoft::UI::Dispatching::DispatcherQueuePriority::Normal, [weakThis{ get_weak() }, written, total, finished, cancelled]() {
+            if (const auto core{ weakThis.get() }; core && !core->_IsClosing())
+            {
+                core->_PasteProgressHandlers(*core, winrt::make<PasteProgressEventArgs>(written, total, finished, cancelled));
+            }
+        });
+    }
+
     FontInfo ControlCore::GetFont() const
     {
         return _actualFont;
@@ -1249,43 +1506,310 @@ namespace winrt::Microsoft::Terminal::Control::implementation
     // Method Description:
     // - Search text in text buffer. This is triggered if the user click
     //   search button or press enter.
+    // - The terminal's search index is only brought up to date under the
+    //   lock. It's searched on a background thread after we let go of it, so
+    //   that a search doesn't hold up the output or the UI, no matter how much
+    //   scrollback there is.
     // Arguments:
     // - text: the text to search
     // - goForward: boolean that represents if the current search direction is forward
     // - caseSensitive: boolean that represents if the current search is case sensitive
+    // - regularExpression: whether text is a regular expression
     // Return Value:
     // - <none>
     void ControlCore::Search(const winrt::hstring& text,
                              const bool goForward,
-                             const bool caseSensitive)
+                             const bool caseSensitive,
+                             const bool regularExpression)
     {
         if (text.size() == 0)
         {
             return;
         }
 
-        const auto direction = goForward ?
-                                                Search::Direction::Forward :
-                                                Search::Direction::Backward;
+        std::shared_ptr<const ::Microsoft::Terminal::Core::SearchIndex::Pattern> pattern;
+        if (regularExpression)
+        {
+            winrt::hstring error;
+            pattern = _compileSearchPattern(text, caseSensitive, error);
+            if (!pattern)
+            {
+                // There's nothing to find with a pattern that doesn't compile.
+                // Tell the search box why, rather than that there's no results.
+                ClearSearch();
+                auto foundResults = winrt::make_self<implementation::FoundResultsArgs>(false, 0, 0, error);
+                _FoundMatchHandlers(*this, *foundResults);
+                return;
+            }
+        }
+
+        ::Microsoft::Terminal::Core::SearchIndex* index{ nullptr };
+        std::pair<int64_t, size_t> anchor{};
+        {
+            auto lock = _terminal->LockForWriting();
+            // A new search looks through all of the buffer. New output
+            // (_refreshSearchResults) doesn't need to, and leaves the rows
+            // a resize didn't get to for later.
+            _terminal->FinishReflow();
+            index = &_terminal->UpdateSearchIndexUnderLock();
+            anchor = _terminal->GetSearchAnchorUnderLock();
+        }
 
-        const auto sensitivity = caseSensitive ?
-                                                    Search::Sensitivity::CaseSensitive :
-                                                    Search::Sensitivity::CaseInsensitive;
+        // A new query throws away the matches find-all found for the last one.
+        if (!_findAllActive || text != _findAllQuery || caseSensitive != _findAllCaseSensitive || regularExpression != _findAllRegularExpression)
+        {
+            index->SetQuery(text, caseSensitive, pattern);
+            _findAllQuery = text;
+            _findAllCaseSensitive = caseSensitive;
+            _findAllRegularExpression = regularExpression;
+            _findAllActive = true;
+        }
 
-        ::Search search(*GetUiaData(), text.c_str(), direction, sensitivity);
-        auto lock = _terminal->LockForWriting();
-        const auto foundMatch{ search.FindNext() };
-        if (foundMatch)
+        _searchInBackground(text, goForward, caseSensitive, std::move(pattern), anchor);
+    }
+
+    // Function Description:
+    // - Describes why a regular expression didn't compile, for the search box.
+    // Arguments:
+    // - code: the error std::regex_error reported
+    // Return Value:
+    // - The description.
+    static winrt::hstring _describePatternError(const std::regex_constants::error_type code)
+    {
+        switch (code)
         {
-            _terminal->SetBlockSelection(false);
-            search.Select();
-            _renderer->TriggerSelection();
+        case std::regex_constants::error_paren:
+            return RS_(L"SearchBox_PatternErrorParen");
+        case std::regex_constants::error_brack:
+            return RS_(L"SearchBox_PatternErrorBracket");
+        case std::regex_constants::error_brace:
+        case std::regex_constants::error_badbrace:
+            return RS_(L"SearchBox_PatternErrorBrace");
+        case std::regex_constants::error_badrepeat:
+            return RS_(L"SearchBox_PatternErrorRepeat");
+        case std::regex_constants::error_escape:
+            return RS_(L"SearchBox_PatternErrorEscape");
+        case std::regex_constants::error_range:
+            return RS_(L"SearchBox_PatternErrorRange");
+        case std::regex_constants::error_collate:
+        case std::regex_constants::error_ctype:
+            return RS_(L"SearchBox_PatternErrorClass");
+        case std::regex_constants::error_backref:
+            return RS_(L"SearchBox_PatternErrorBackReference");
+        default:
+            return RS_(L"SearchBox_PatternErrorComplexity");
+        }
+    }
+
+    // Method Description:
+    // - Compiles the given regular expression, or returns the one compiled
+    //   for it before. The pattern is cached until the search is cleared, so
+    //   that stepping through the matches doesn't compile it over and over.
+    // Arguments:
+    // - text: the regular expression
+    // - caseSensitive: whether the regular expression is case sensitive
+    // - error: receives what's wrong with the regular expression, if it isn't valid
+    // Return Value:
+    // - The compiled regular expression, or nullptr if it isn't valid.
+    std::shared_ptr<const ::Microsoft::Terminal::Core::SearchIndex::Pattern> ControlCore::_compileSearchPattern(const winrt::hstring& text, const bool caseSensitive, winrt::hstring& error)
+    {
+        if (_searchPattern && text == _searchPatternText && caseSensitive == _searchPatternCaseSensitive)
+        {
+            return _searchPattern;
+        }
+
+        try
+        {
+            _searchPattern = ::Microsoft::Terminal::Core::SearchIndex::CompilePattern(text, caseSensitive);
+        }
+        catch (const std::regex_error& e)
+        {
+            _searchPattern.reset();
+            error = winrt::hstring{ fmt::format(std::wstring_view{ RS_(L"SearchBox_InvalidPattern") }, std::wstring_view{ _describePatternError(e.code()) }) };
+            return nullptr;
+        }
+        _searchPatternText = text;
+        _searchPatternCaseSensitive = caseSensitive;
+        return _searchPattern;
+    }
+
+    // Method Description:
+    // - Finds the next match of a search on a background thread, and selects
+    //   it. Once find-all is done, we'll raise a FoundMatch event, which the
+    //   control will use to notify narrator if there was any results in the
+    //   buffer, and to tell the user which of them this is.
+    // - If another search was started in the meantime, the results of this
+    //   one are thrown away.
+    // Arguments:
+    // - text: the text to search
+    // - goForward: whether to search towards the end of the buffer
+    // - caseSensitive: whether the search is case sensitive
+    // - pattern: if set, text is a regular expression, and this is it compiled
+    // - anchor: the absolute row and the column to search from
+    winrt::fire_and_forget ControlCore::_searchInBackground(const winrt::hstring text,
+                                                            const bool goForward,
+                                                            const bool caseSensitive,
+                                                            const std::shared_ptr<const ::Microsoft::Terminal::Core::SearchIndex::Pattern> pattern,
+                                                            const std::pair<int64_t, size_t> anchor)
+    {
+        auto weakThis{ get_weak() };
+        const auto generation = ++_searchGeneration;
+        auto& index = _terminal->GetSearchIndex();
+
+        co_await winrt::resume_background();
+
+        auto core{ weakThis.get() };
+        if (!core)
+        {
+            co_return;
+        }
+
+        std::optional<::Microsoft::Terminal::Core::SearchIndex::Match> match;
+        try
+        {
+            // The archived rows the index didn't see yet can't be skipped
+            // by their filters. Read them first.
+            while (generation == _searchGeneration && index.IndexArchivedRows(FindAllChunkRows))
+            {
+            }
+
+            match = pattern ? index.FindNextRegex(*pattern, goForward, anchor.first, anchor.second) :
+                              index.FindNext(text, caseSensitive, goForward, anchor.first, anchor.second);
+        }
+        CATCH_LOG();
+
+        auto foundMatch = false;
+        if (match && generation == _searchGeneration && !_IsClosing())
+        {
+            auto lock = _terminal->LockForWriting();
+            foundMatch = _terminal->SelectSearchMatchUnderLock(*match);
+            if (foundMatch)
+            {
+                _renderer->TriggerSelection();
+            }
+        }
+
+        co_await wil::resume_foreground(_dispatcher);
+        if (_IsClosing() || generation != _searchGeneration)
+        {
+            co_return;
+        }
+
+        _lastSearchMatch = foundMatch ? match : std::nullopt;
+        _findAllInBackground(true, foundMatch);
+    }
+
+    // Method Description:
+    // - Stops highlighting the matches of the last search. This is triggered
+    //   when the search box is closed.
+    void ControlCore::ClearSearch()
+    {
+        if (!_findAllActive)
+        {
+            return;
         }
 
-        // Raise a FoundMatch event, which the control will use to notify
-        // narrator if there was any results in the buffer
-        auto foundResults = winrt::make_self<implementation::FoundResultsArgs>(foundMatch);
-        _FoundMatchHandlers(*this, *foundResults);
+        ++_searchGeneration;
+        _findAllActive = false;
+        _findAllQuery = {};
+        _lastSearchMatch.reset();
+        _searchPattern.reset();
+        _terminal->GetSearchIndex().SetQuery({}, false);
+        {
+            auto lock = _terminal->LockForWriting();
+            _terminal->UpdateSearchHighlightsUnderLock();
+        }
+        _renderer->TriggerRedrawAll();
+    }
+
+    // Method Description:
+    // - Called a little while after new output arrived while there's a
+    //   search going on. Brings the search index up to date, which throws
+    //   away the matches of the rows that changed, and has find-all search
+    //   those rows again.
+    void ControlCore::_refreshSearchResults()
+    {
+        if (!_findAllActive)
+        {
+            return;
+        }
+
+        {
+            auto lock = _terminal->LockForWriting();
+            _terminal->UpdateSearchIndexUnderLock();
+        }
+        _findAllInBackground(false, _lastSearchMatch.has_value());
+    }
+
+    // Method Description:
+    // - Finds all the matches of the current query that the search index
+    //   doesn't know about yet, on a background thread. The rows are searched
+    //   in chunks, so that the output never has to wait for long to update the index.
+    // - Once that's done, the matches are highlighted and we let the control
+    //   know how many there are, and which of them is selected.
+    // - If another search was started or the search was cleared in the
+    //   meantime, this one stops and its results are thrown away.
+    // Arguments:
+    // - newSearch: true if this was started by Search. We raise FoundMatch
+    //   then, and SearchResultsUpdated otherwise.
+    // - foundMatch: whether the last search selected a match.
+    winrt::fire_and_forget ControlCore::_findAllInBackground(const bool newSearch, const bool foundMatch)
+    {
+        auto weakThis{ get_weak() };
+        const auto generation = _searchGeneration.load();
+        const auto match = _lastSearchMatch;
+        auto& index = _terminal->GetSearchIndex();
+
+        co_await winrt::resume_background();
+
+        auto core{ weakThis.get() };
+        if (!core)
+        {
+            co_return;
+        }
+
+        const auto stale = [&]() {
+            return _IsClosing() || generation != _searchGeneration;
+        };
+
+        try
+        {
+            while (!stale() && index.IndexArchivedRows(FindAllChunkRows))
+            {
+            }
+            while (!stale() && index.SearchChunk(FindAllChunkRows))
+            {
+            }
+        }
+        CATCH_LOG();
+        if (stale())
+        {
+            co_return;
+        }
+        const auto totalMatches = index.MatchCount();
+        const auto currentMatch = match ? index.MatchOrdinal(*match) : 0;
+
+        {
+            auto lock = _terminal->LockForWriting();
+            _terminal->UpdateSearchHighlightsUnderLock();
+        }
+        _renderer->TriggerRedrawAll();
+
+        co_await wil::resume_foreground(_dispatcher);
+        if (stale())
+        {
+            co_return;
+        }
+
+        auto foundResults = winrt::make_self<implementation::FoundResultsArgs>(foundMatch, currentMatch, totalMatches);
+        if (newSearch)
+        {
+            _FoundMatchHandlers(*this, *foundResults);
+        }
+        else
+        {
+            _SearchResultsUpdatedHandlers(*this, *foundResults);
+        }
     }
 
     // Method Description:
@@ -1324,6 +1848,29 @@ namespace winrt::Microsoft::Terminal::Control::implementation
             _connection.TerminalOutput(_connectionOutputEventToken);
             _connectionStateChangedRevoker.revoke();
 
+            // Whatever output is still queued up is dropped on the floor.
+            _stopOutputWorker();
+
+            // The recording has everything we received, though.
+            if (_recorder)
+            {
+                _recorder->Flush();
+            }
+
+            // Nobody is going to read the scrollback anymore. Get rid of the
+            // file it was spilled to right away, instead of when we're destroyed.
+            {
+                const auto lock = _terminal->LockForWriting();
+                _terminal->DiscardScrollbackArchive();
+            }
+
+            // The same goes for the rest of a long paste. Wait for the one
+            // that's being written to notice, because it uses _connection.
+            CancelPaste();
+            {
+                const auto lock = _pasteLock.lock_exclusive();
+            }
+
             // GH#1996 - Close the connection asynchronously on a background
             // thread.
             // Since TermControl::Close is only ever triggered by the UI, we
@@ -1500,12 +2047,206 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         auto noticeArgs = winrt::make<NoticeEventArgs>(NoticeLevel::Info, RS_(L"TermControlReadOnly"));
         _RaiseNoticeHandlers(*this, std::move(noticeArgs));
     }
+    // Method Description:
+    // - Called on the connection's thread whenever it has received output.
+    //   The output is handed off to the output worker, which feeds it to the
+    //   terminal. If the worker has fallen behind and the queue is full, we
+    //   block here until there's room again, which in turn stops the
+    //   connection from reading any more output from the client.
+    // Arguments:
+    // - hstr: the output that was received.
+    // Return Value:
+    // - <none>
     void ControlCore::_connectionOutputHandler(const hstring& hstr)
     {
-        _terminal->Write(hstr);
+        if (_outputWorkerExit.load(std::memory_order_relaxed))
+        {
+            // We haven't been initialized yet, or we've already been closed.
+            return;
+        }
 
-        // Start the throttled update of where our hyperlinks are.
-        _updatePatternLocations->Run();
+        if (_recorder)
+        {
+            _recorder->Output(hstr);
+        }
+
+        while (!_outputQueue.TryPush(hstr))
+        {
+            if (_outputWorkerExit.load(std::memory_order_relaxed))
+            {
+                return;
+            }
+            _outputProducerStalls.fetch_add(1, std::memory_order_relaxed);
+            _outputAvailable.SetEvent();
+            _outputSpaceAvailable.wait();
+        }
+
+        _outputChunks.fetch_add(1, std::memory_order_relaxed);
+        const auto depth = _outputQueue.Size();
+        auto maxDepth = _outputMaxQueueDepth.load(std::memory_order_relaxed);
+        while (depth > maxDepth && !_outputMaxQueueDepth.compare_exchange_weak(maxDepth, depth, std::memory_order_relaxed))
+        {
+        }
+
+        _outputAvailable.SetEvent();
+    }
+
+    // Method Description:
+    // - Starts recording the output of the session, if the profile has a
+    //   directory to record it to. Every session gets a file of its own,
+    //   named after the time it started. See SessionRecorder.hpp.
+    // Arguments:
+    // - width, height: the size of the terminal, in characters
+    void ControlCore::_startRecording(const int width, const int height)
+    try
+    {
+        const auto directory = _settings->SessionRecordingDirectory();
+        if (directory.empty())
+        {
+            return;
+        }
+
+        // Sessions that start within the same second still need different names.
+        static std::atomic<uint32_t> sessionNumber{ 0 };
+
+        SYSTEMTIME time{};
+        GetLocalTime(&time);
+        auto path = wil::ExpandEnvironmentStringsW<std::wstring>(directory.c_str());
+        if (!path.empty() && path.back() != L'\\')
+        {
+            path.push_back(L'\\');
+        }
+        path += fmt::format(L"{:04}{:02}{:02}-{:02}{:02}{:02}-{}-{}.cast",
+                            time.wYear,
+                            time.wMonth,
+                            time.wDay,
+                            time.wHour,
+                            time.wMinute,
+                            time.wSecond,
+                            GetCurrentProcessId(),
+                            sessionNumber.fetch_add(1, std::memory_order_relaxed));
+
+        _recorder = std::make_unique<SessionRecorder>(path, width, height);
+    }
+    CATCH_LOG()
+
+    void ControlCore::_startOutputWorker()
+    {
+        if (_outputWorker.joinable())
+        {
+            return;
+        }
+
+        _outputWorkerExit = false;
+        _outputWorker = std::thread{ [this]() { _outputWorkerLoop(); } };
+        LOG_IF_FAILED(SetThreadDescription(_outputWorker.native_handle(), L"ControlCore Output Worker"));
+    }
+
+    void ControlCore::_stopOutputWorker() noexcept
+    {
+        if (!_outputWorker.joinable())
+        {
+            return;
+        }
+
+        _outputWorkerExit = true;
+        // Wake up both the worker and a producer that might be stuck waiting
+        // for room in the queue.
+        _outputAvailable.SetEvent();
+        _outputSpaceAvailable.SetEvent();
+
+        try
+        {
+            _outputWorker.join();
+        }
+        CATCH_LOG();
+    }
+
+    // Method Description:
+    // - The body of the output worker. Drains the output queue into the
+    //   terminal in slices of at most OutputSliceDuration, releasing the
+    //   terminal lock between slices.
+    void ControlCore::_outputWorkerLoop() noexcept
+    {
+        while (!_outputWorkerExit.load(std::memory_order_relaxed))
+        {
+            if (!_outputQueue.Front())
+            {
+                _outputAvailable.wait();
+                continue;
+            }
+
+            try
+            {
+                const auto sliceStart = std::chrono::steady_clock::now();
+                {
+                    auto lock = _terminal->LockForWriting();
+                    while (auto chunk = _outputQueue.Front())
+                    {
+                        _terminal->WriteUnderLock(*chunk);
+                        _outputQueue.Pop();
+                        _outputSpaceAvailable.SetEvent();
+
+                        if (_outputWorkerExit.load(std::memory_order_relaxed) ||
+                            std::chrono::steady_clock::now() - sliceStart >= OutputSliceDuration)
+                        {
+                            break;
+                        }
+                    }
+                }
+                _recordOutputSlice(std::chrono::steady_clock::now() - sliceStart);
+
+                // Start the throttled update of where our hyperlinks are.
+                _updatePatternLocations->Run();
+                // The same goes for the matches of the search box.
+                if (_findAllActive.load(std::memory_order_relaxed))
+                {
+                    _updateSearchResults->Run();
+                }
+            }
+            CATCH_LOG();
+        }
+    }
+
+    void ControlCore::_recordOutputSlice(const std::chrono::steady_clock::duration duration) noexcept
+    {
+        const auto us = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+
+        _outputSlices.fetch_add(1, std::memory_order_relaxed);
+        if (us > _outputMaxSliceMicroseconds.load(std::memory_order_relaxed))
+        {
+            // Only the output worker ever writes this, so there's no need for a CAS loop.
+            _outputMaxSliceMicroseconds.store(us, std::memory_order_relaxed);
+        }
+
+        // Bucket N counts the slices that took less than 2^N microseconds.
+        size_t bucket = 0;
+        for (auto remaining = std::max<int64_t>(us, 0); remaining != 0 && bucket < _outputSliceLatencyHistogram.size() - 1; remaining >>= 1)
+        {
+            ++bucket;
+        }
+        til::at(_outputSliceLatencyHistogram, bucket).fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Method Description:
+    // - Returns a snapshot of the counters about how our output is being
+    //   processed: how deep the output queue got, how often the connection
+    //   had to wait for room in it, and how long the terminal lock was held
+    //   for each slice of parsing.
+    OutputQueueStatistics ControlCore::OutputStatistics() const noexcept
+    {
+        OutputQueueStatistics stats;
+        stats.chunks = _outputChunks.load(std::memory_order_relaxed);
+        stats.slices = _outputSlices.load(std::memory_order_relaxed);
+        stats.producerStalls = _outputProducerStalls.load(std::memory_order_relaxed);
+        stats.queueDepth = _outputQueue.Size();
+        stats.maxQueueDepth = _outputMaxQueueDepth.load(std::memory_order_relaxed);
+        stats.maxSliceLatency = std::chrono::microseconds{ _outputMaxSliceMicroseconds.load(std::memory_order_relaxed) };
+        for (size_t i = 0; i < stats.sliceLatencyHistogram.size(); ++i)
+        {
+            til::at(stats.sliceLatencyHistogram, i) = til::at(_outputSliceLatencyHistogram, i).load(std::memory_order_relaxed);
+        }
+        return stats;
     }
 
     // Method Description:
@@ -1524,6 +2265,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
     {
         if (clearType == Control::ClearBufferType::Scrollback || clearType == Control::ClearBufferType::All)
         {
+            auto lock = _terminal->LockForWriting();
             _terminal->EraseScrollback();
         }
 
@@ -1542,15 +2284,12 @@ namespace winrt::Microsoft::Terminal::Control::implementation
     hstring ControlCore::ReadEntireBuffer() const
     {
         auto terminalLock = _terminal->LockForWriting();
+        _terminal->FinishReflow();
 
         const auto& textBuffer = _terminal->GetTextBuffer();
 
         std::wstringstream ss;
-        const auto lastRow = textBuffer.GetLastNonSpaceCharacter().Y;
-        for (auto rowIndex = 0; rowIndex <= lastRow; rowIndex++)
-        {
-            const auto& row = textBuffer.GetRowByOffset(rowIndex);
-            auto rowText = row.GetText();
+        const auto appendRow = [&](std::wstring& rowText, const bool wrapped) {
             const auto strEnd = rowText.find_last_not_of(UNICODE_SPACE);
             if (strEnd != std::string::npos)
             {
@@ -1558,10 +2297,32 @@ namespace winrt::Microsoft::Terminal::Control::implementation
                 ss << rowText;
             }
 
-            if (!row.WasWrapForced())
+            if (!wrapped)
             {
                 ss << UNICODE_CARRIAGERETURN << UNICODE_LINEFEED;
             }
+        };
+
+        // With an unbounded scrollback, the oldest rows aren't in the buffer anymore.
+        if (const auto archive = _terminal->GetScrollbackArchive())
+        {
+            std::wstring rowText;
+            auto wrapped = false;
+            for (auto row = archive->FirstRow(); row < archive->EndRow(); ++row)
+            {
+                if (archive->ReadRow(row, rowText, wrapped))
+                {
+                    appendRow(rowText, wrapped);
+                }
+            }
+        }
+
+        const auto lastRow = textBuffer.GetLastNonSpaceCharacter().Y;
+        for (auto rowIndex = 0; rowIndex <= lastRow; rowIndex++)
+        {
+            const auto& row = textBuffer.GetRowByOffset(rowIndex);
+            auto rowText = row.GetText();
+            appendRow(rowText, row.WasWrapForced());
         }
 
         return hstring(ss.str());
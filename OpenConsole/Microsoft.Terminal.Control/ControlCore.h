@@ -22,8 +22,10 @@
 #include "../../external/terminal/src/renderer/uia/UiaRenderer.hpp"
 #include "../TerminalCore/ControlKeyStates.hpp"
 #include "../TerminalCore/Terminal.hpp"
+#include "../TerminalCore/SessionRecorder.hpp"
 #include "../../external/terminal/src/buffer/out/search.h"
 #include "ControlSettings.h"
+#include "OutputQueue.h"
 #include <cppwinrt_utils.h>
 
 #include <winrt/Microsoft.Terminal.TerminalConnection.h>
@@ -87,6 +89,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
 
         void SendInput(const winrt::hstring& wstr);
         void PasteText(const winrt::hstring& hstr);
+        void CancelPaste() noexcept;
         bool CopySelectionToClipboard(bool singleLine, const Windows::Foundation::IReference<CopyFormat>& formats);
         void SelectAll();
 
@@ -161,7 +164,9 @@ namespace winrt::Microsoft::Terminal::Control::implementation
 
         void Search(const winrt::hstring& text,
                     const bool goForward,
-                    const bool caseSensitive);
+                    const bool caseSensitive,
+                    const bool regularExpression);
+        void ClearSearch();
 
         void LeftClickOnTerminal(const til::point terminalPosition,
                                  const int numberOfClicks,
@@ -177,6 +182,8 @@ namespace winrt::Microsoft::Terminal::Control::implementation
 
         hstring ReadEntireBuffer() const;
 
+        OutputQueueStatistics OutputStatistics() const noexcept;
+
         static bool IsVintageOpacityAvailable() noexcept;
 
         void AdjustOpacity(const double opacity, const bool relative);
@@ -212,12 +219,15 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         TYPED_EVENT(TransparencyChanged,       IInspectable, Control::TransparencyChangedEventArgs);
         TYPED_EVENT(ReceivedOutput,            IInspectable, IInspectable);
         TYPED_EVENT(FoundMatch,                IInspectable, Control::FoundResultsArgs);
+        TYPED_EVENT(SearchResultsUpdated,      IInspectable, Control::FoundResultsArgs);
         TYPED_EVENT(ShowWindowChanged,         IInspectable, Control::ShowWindowArgs);
+        TYPED_EVENT(PasteProgress,             IInspectable, Control::PasteProgressEventArgs);
         // clang-format on
 
     private:
         bool _initializedTerminal{ false };
-        bool _closing{ false };
+        // Atomic, so that pastes and searches on background threads can check it.
+        std::atomic<bool> _closing{ false };
 
         TerminalConnection::ITerminalConnection _connection{ nullptr };
         event_token _connectionOutputEventToken;
@@ -246,7 +256,8 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         // Track the last hyperlink ID we hovered over
         uint16_t _lastHoveredId{ 0 };
 
-        bool _isReadOnly{ false };
+        // Atomic, because long pastes check it on a background thread.
+        std::atomic<bool> _isReadOnly{ false };
 
         std::optional<interval_tree::IntervalTree<til::point, size_t>::interval> _lastHoveredInterval{ std::nullopt };
 
@@ -260,14 +271,80 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         std::shared_ptr<ThrottledFuncTrailing<>> _tsfTryRedrawCanvas;
         std::shared_ptr<ThrottledFuncTrailing<>> _updatePatternLocations;
         std::shared_ptr<ThrottledFuncTrailing<Control::ScrollPositionChangedArgs>> _updateScrollBar;
+        std::shared_ptr<ThrottledFuncTrailing<>> _updateSearchResults;
+        std::shared_ptr<ThrottledFuncTrailing<>> _resizeBuffer;
+        std::shared_ptr<ThrottledFuncTrailing<>> _finishReflow;
+
+        // The query of the last search. All its matches are highlighted until
+        // the search is cleared. Apart from _findAllActive, which the output
+        // worker reads, these are only used on the UI thread.
+        winrt::hstring _findAllQuery;
+        bool _findAllCaseSensitive{ false };
+        bool _findAllRegularExpression{ false };
+        std::atomic<bool> _findAllActive{ false };
+        std::optional<::Microsoft::Terminal::Core::SearchIndex::Match> _lastSearchMatch;
+        // Bumped by every search, so that the results of the ones that were
+        // overtaken by a newer one are thrown away.
+        std::atomic<uint64_t> _searchGeneration{ 0 };
+
+        // The regular expression of the last search, compiled.
+        std::shared_ptr<const ::Microsoft::Terminal::Core::SearchIndex::Pattern> _searchPattern;
+        winrt::hstring _searchPatternText;
+        bool _searchPatternCaseSensitive{ false };
+
+        // Output from the connection is handed to _outputWorker through
+        // _outputQueue, so that the connection's thread never has to wait on
+        // the terminal lock. See _connectionOutputHandler.
+        OutputQueue _outputQueue;
+        std::thread _outputWorker;
+        std::atomic<bool> _outputWorkerExit{ true };
+        wil::slim_event_auto_reset _outputAvailable;
+        wil::slim_event_auto_reset _outputSpaceAvailable;
+
+        std::atomic<uint64_t> _outputChunks{ 0 };
+        std::atomic<uint64_t> _outputSlices{ 0 };
+        std::atomic<uint64_t> _outputProducerStalls{ 0 };
+        std::atomic<size_t> _outputMaxQueueDepth{ 0 };
+        std::atomic<int64_t> _outputMaxSliceMicroseconds{ 0 };
+        std::array<std::atomic<uint64_t>, std::tuple_size_v<decltype(OutputQueueStatistics::sliceLatencyHistogram)>> _outputSliceLatencyHistogram{};
+
+        // If the profile asked for it, everything _connectionOutputHandler
+        // receives is recorded here, along with the resizes of the connection.
+        std::unique_ptr<::Microsoft::Terminal::Core::SessionRecorder> _recorder;
+
+        // Long pastes are written on a background thread. They're written
+        // one after the other, under _pasteLock. CancelPaste bumps
+        // _pasteGeneration, which cancels every paste started before.
+        wil::srwlock _pasteLock;
+        std::atomic<uint64_t> _pasteGeneration{ 0 };
+        std::atomic<size_t> _pastesInFlight{ 0 };
+        // User input that was sent while a long paste was being written. It's
+        // written once the paste is done, unless we're closing or read-only by then. _pastesInFlight only drops under
+        // _heldInputLock, so input can't slip past the held input.
+        wil::srwlock _heldInputLock;
+        std::wstring _heldInput;
 
         winrt::fire_and_forget _asyncCloseConnection();
+        winrt::fire_and_forget _pasteInBackground(const winrt::hstring text, const uint64_t generation);
+        void _raisePasteProgress(const uint64_t written, const uint64_t total, const bool finished, const bool cancelled);
+        std::shared_ptr<const ::Microsoft::Terminal::Core::SearchIndex::Pattern> _compileSearchPattern(const winrt::hstring& text, const bool caseSensitive, winrt::hstring& error);
+        winrt::fire_and_forget _searchInBackground(const winrt::hstring text,
+                                                   const bool goForward,
+                                                   const bool caseSensitive,
+                                                   const std::shared_ptr<const ::Microsoft::Terminal::Core::SearchIndex::Pattern> pattern,
+                                                   const std::pair<int64_t, size_t> anchor);
+        winrt::fire_and_forget _findAllInBackground(const bool newSearch, const bool foundMatch);
+        void _refreshSearchResults();
 
         bool _setFontSizeUnderLock(int fontSize);
         void _updateFont(const bool initialUpdate = false);
         void _refreshSizeUnderLock();
+        COORD _panelSizeInPixels() const;
+        void _refreshRenderSizeUnderLock();
+        void _resizeBufferUnderLock();
 
         void _sendInputToConnection(std::wstring_view wstr);
+        void _sendResponseToConnection(std::wstring_view wstr);
 
 #pragma region TerminalCoreCallbacks
         void _terminalCopyToClipboard(std::wstring_view wstr);
@@ -291,6 +368,11 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         void _raiseReadOnlyWarning();
         void _updateAntiAliasingMode();
         void _connectionOutputHandler(const hstring& hstr);
+        void _startRecording(const int width, const int height);
+        void _startOutputWorker();
+        void _stopOutputWorker() noexcept;
+        void _outputWorkerLoop() noexcept;
+        void _recordOutputSlice(const std::chrono::steady_clock::duration duration) noexcept;
         void _updateHoveredCell(const std::optional<til::point> terminalPosition);
         void _setOpacity(const double opacity);
 
@@ -298,17 +380,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
 
         inline bool _IsClosing() const noexcept
         {
-#ifndef NDEBUG
-            if (_dispatcher)
-            {
-                // _closing isn't atomic and may only be accessed from the main thread.
-                //
-                // Though, the unit tests don't actually run in TAEF's main
-                // thread, so we don't care when we're running in tests.
-                assert(_inUnitTests || _dispatcher.HasThreadAccess());
-            }
-#endif
-            return _closing;
+            return _closing.load(std::memory_order_relaxed);
         }
 
         friend class ControlUnitTests::ControlCoreTests;
@@ -13,3 +13,4 @@
 #include "TransparencyChangedEventArgs.g.cpp"
 #include "FoundResultsArgs.g.cpp"
 #include "ShowWindowArgs.g.cpp"
+#include "PasteProgressEventArgs.g.cpp"
@@ -13,6 +13,7 @@
 #include "TransparencyChangedEventArgs.g.h"
 #include "FoundResultsArgs.g.h"
 #include "ShowWindowArgs.g.h"
+#include "PasteProgressEventArgs.g.h"
 #include <cppwinrt_utils.h>
 
 namespace winrt::Microsoft::Terminal::Control::implementation
@@ -140,12 +141,18 @@ namespace winrt::Microsoft::Terminal::Control::implementation
     struct FoundResultsArgs : public FoundResultsArgsT<FoundResultsArgs>
     {
     public:
-        FoundResultsArgs(const bool foundMatch) :
-            _FoundMatch(foundMatch)
+        FoundResultsArgs(const bool foundMatch, const uint64_t currentMatch, const uint64_t totalMatches, const winrt::hstring& patternError = {}) :
+            _FoundMatch(foundMatch),
+            _CurrentMatch(currentMatch),
+            _TotalMatches(totalMatches),
+            _PatternError(patternError)
         {
         }
 
         WINRT_PROPERTY(bool, FoundMatch);
+        WINRT_PROPERTY(uint64_t, CurrentMatch);
+        WINRT_PROPERTY(uint64_t, TotalMatches);
+        WINRT_PROPERTY(winrt::hstring, PatternError);
     };
 
     struct ShowWindowArgs : public ShowWindowArgsT<ShowWindowArgs>
@@ -158,4 +165,21 @@ namespace winrt::Microsoft::Terminal::Control::implementation
 
         WINRT_PROPERTY(bool, ShowOrHide);
     };
+
+    struct PasteProgressEventArgs : public PasteProgressEventArgsT<PasteProgressEventArgs>
+    {
+    public:
+        PasteProgressEventArgs(const uint64_t written, const uint64_t total, const bool finished, const bool cancelled) :
+            _Written(written),
+            _Total(total),
+            _Finished(finished),
+            _Cancelled(cancelled)
+        {
+        }
+
+        WINRT_PROPERTY(uint64_t, Written);
+        WINRT_PROPERTY(uint64_t, Total);
+        WINRT_PROPERTY(bool, Finished);
+        WINRT_PROPERTY(bool, Cancelled);
+    };
 }
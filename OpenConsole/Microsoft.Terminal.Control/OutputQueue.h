@@ -0,0 +1,119 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+// Module Name:
+// - OutputQueue.h
+//
+// Abstract:
+// - A bounded, lock-free, single-producer/single-consumer ring of output
+//   chunks. The connection's output thread pushes the text it received into
+//   it and ControlCore's output worker drains it into the Terminal.
+// - The slots hold on to their std::wstring storage, so once the queue has
+//   warmed up, pushing a chunk doesn't allocate anymore. A slot only keeps up
+//   to RetainedSlotCapacity of it though: ConPTY hands over batches of up to a
+//   few MB, and 64 slots that each kept the largest one would pin hundreds of
+//   MB long after the burst is over.
+// - The queue is bounded by the code units it holds as well as by the number
+//   of chunks, so that a burst of large chunks can't queue up hundreds of MB
+//   either. A chunk that's larger than the whole budget is still accepted
+//   once the queue is empty.
+
+#pragma once
+
+namespace winrt::Microsoft::Terminal::Control::implementation
+{
+    // A snapshot of the counters ControlCore keeps about its output queue.
+    // Slice latencies are bucketed by powers of two: bucket N counts slices
+    // that held the terminal lock for less than 2^N microseconds.
+    struct OutputQueueStatistics
+    {
+        uint64_t chunks{ 0 };
+        uint64_t slices{ 0 };
+        uint64_t producerStalls{ 0 };
+        size_t queueDepth{ 0 };
+        size_t maxQueueDepth{ 0 };
+        std::chrono::microseconds maxSliceLatency{ 0 };
+        std::array<uint64_t, 24> sliceLatencyHistogram{};
+    };
+
+    class OutputQueue
+    {
+    public:
+        static constexpr size_t Capacity = 64;
+        static constexpr size_t MaxQueuedCodeUnits = 4 * 1024 * 1024;
+        static constexpr size_t RetainedSlotCapacity = 64 * 1024;
+
+        OutputQueue() = default;
+        OutputQueue(const OutputQueue&) = delete;
+        OutputQueue& operator=(const OutputQueue&) = delete;
+        OutputQueue(OutputQueue&&) = delete;
+        OutputQueue& operator=(OutputQueue&&) = delete;
+
+        // Producer side. Copies the chunk into the next free slot.
+        // Returns false if the queue is full.
+        bool TryPush(const std::wstring_view chunk)
+        {
+            const auto tail = _tail.load(std::memory_order_relaxed);
+            const auto head = _head.load(std::memory_order_acquire);
+            if (tail - head == Capacity)
+            {
+                return false;
+            }
+
+            const auto queued = _queuedCodeUnits.load(std::memory_order_relaxed);
+            if (tail != head && queued + chunk.size() > MaxQueuedCodeUnits)
+            {
+                return false;
+            }
+
+            til::at(_slots, tail & Mask).assign(chunk);
+            _queuedCodeUnits.fetch_add(chunk.size(), std::memory_order_relaxed);
+            _tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer side. Returns the oldest chunk, or nullptr if the queue is
+        // empty. The chunk stays valid until the next call to Pop().
+        std::wstring* Front() noexcept
+        {
+            const auto head = _head.load(std::memory_order_relaxed);
+            const auto tail = _tail.load(std::memory_order_acquire);
+            return head == tail ? nullptr : &til::at(_slots, head & Mask);
+        }
+
+        // Consumer side. Releases the chunk returned by Front().
+        void Pop() noexcept
+        {
+            const auto head = _head.load(std::memory_order_relaxed);
+            auto& slot = til::at(_slots, head & Mask);
+            _queuedCodeUnits.fetch_sub(slot.size(), std::memory_order_relaxed);
+            if (slot.capacity() > RetainedSlotCapacity)
+            {
+                // Neither clear() nor shrink_to_fit() reliably give the storage back.
+                std::wstring{}.swap(slot);
+            }
+            _head.store(head + 1, std::memory_order_release);
+        }
+
+        size_t Size() const noexcept
+        {
+            const auto head = _head.load(std::memory_order_acquire);
+            const auto tail = _tail.load(std::memory_order_acquire);
+            return tail - head;
+        }
+
+    private:
+        static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+        static constexpr size_t Mask = Capacity - 1;
+
+        std::array<std::wstring, Capacity> _slots;
+
+        // The consumer and the producer each own one of these indices.
+        // Keep them on separate cache lines so they don't false share.
+        alignas(std::hardware_destructive_interference_size) std::atomic<size_t> _head{ 0 };
+        alignas(std::hardware_destructive_interference_size) std::atomic<size_t> _tail{ 0 };
+        // Counts the code units of the chunks between _head and _tail.
+        // A push may see a stale count, which only makes it more cautious.
+        std::atomic<size_t> _queuedCodeUnits{ 0 };
+    };
+}
@@ -27,6 +27,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         _focusableElements.insert(TextBox());
         _focusableElements.insert(CloseButton());
         _focusableElements.insert(CaseSensitivityButton());
+        _focusableElements.insert(RegularExpressionButton());
         _focusableElements.insert(GoForwardButton());
         _focusableElements.insert(GoBackwardButton());
     }
@@ -55,6 +56,17 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         return CaseSensitivityButton().IsChecked().GetBoolean();
     }
 
+    // Method Description:
+    // - Check if the current search text is a regular expression
+    // Arguments:
+    // - <none>
+    // Return Value:
+    // - bool: whether the regular expression button is checked
+    bool SearchBoxControl::RegularExpression()
+    {
+        return RegularExpressionButton().IsChecked().GetBoolean();
+    }
+
     // Method Description:
     // - Handler for pressing Enter on TextBox, trigger
     //   text search
@@ -70,11 +82,11 @@ namespace winrt::Microsoft::Terminal::Control::implementation
             const auto state = CoreWindow::GetForCurrentThread().GetKeyState(winrt::Windows::System::VirtualKey::Shift);
             if (WI_IsFlagSet(state, CoreVirtualKeyStates::Down))
             {
-                _SearchHandlers(TextBox().Text(), !_GoForward(), _CaseSensitive());
+                _SearchHandlers(TextBox().Text(), !_GoForward(), _CaseSensitive(), RegularExpression());
             }
             else
             {
-                _SearchHandlers(TextBox().Text(), _GoForward(), _CaseSensitive());
+                _SearchHandlers(TextBox().Text(), _GoForward(), _CaseSensitive(), RegularExpression());
             }
             e.Handled(true);
         }
@@ -129,6 +141,22 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         }
     }
 
+    // Method Description:
+    // - Shows the given status next to the search text, like which of the
+    //   matches is selected and how many there are. An empty status hides it.
+    // Arguments:
+    // - status: the text to show
+    // Return Value:
+    // - <none>
+    void SearchBoxControl::SetStatus(const winrt::hstring& status)
+    {
+        if (StatusBox())
+        {
+            StatusBox().Text(status);
+            StatusBox().Visibility(status.empty() ? Visibility::Collapsed : Visibility::Visible);
+        }
+    }
+
     // Method Description:
     // - Check if the current focus is on any element within the
     //   search box
@@ -165,7 +193,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         }
 
         // kick off search
-        _SearchHandlers(TextBox().Text(), _GoForward(), _CaseSensitive());
+        _SearchHandlers(TextBox().Text(), _GoForward(), _CaseSensitive(), RegularExpression());
     }
 
     // Method Description:
@@ -186,7 +214,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         }
 
         // kick off search
-        _SearchHandlers(TextBox().Text(), _GoForward(), _CaseSensitive());
+        _SearchHandlers(TextBox().Text(), _GoForward(), _CaseSensitive(), RegularExpression());
     }
 
     // Method Description:
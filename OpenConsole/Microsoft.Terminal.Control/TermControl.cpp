@@ -117,6 +117,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         _core.RaiseNotice({ this, &TermControl::_coreRaisedNotice });
         _core.HoveredHyperlinkChanged({ this, &TermControl::_hoveredHyperlinkChanged });
         _core.FoundMatch({ this, &TermControl::_coreFoundMatch });
+        _core.SearchResultsUpdated({ this, &TermControl::_coreSearchResultsUpdated });
         _interactivity.OpenHyperlink({ this, &TermControl::_HyperlinkHandler });
         _interactivity.ScrollPositionChanged({ this, &TermControl::_ScrollPositionChanged });
 
@@ -227,7 +228,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         }
         else
         {
-            _core.Search(_searchBox->TextBox().Text(), goForward, false);
+            _core.Search(_searchBox->TextBox().Text(), goForward, false, _searchBox->RegularExpression());
         }
     }
 
@@ -238,13 +239,15 @@ namespace winrt::Microsoft::Terminal::Control::implementation
     // - text: the text to search
     // - goForward: boolean that represents if the current search direction is forward
     // - caseSensitive: boolean that represents if the current search is case sensitive
+    // - regularExpression: whether text is a regular expression
     // Return Value:
     // - <none>
     void TermControl::_Search(const winrt::hstring& text,
         const bool goForward,
-        const bool caseSensitive)
+        const bool caseSensitive,
+        const bool regularExpression)
     {
-        _core.Search(text, goForward, caseSensitive);
+        _core.Search(text, goForward, caseSensitive, regularExpression);
     }
 
     // Method Description:
@@ -259,6 +262,8 @@ namespace winrt::Microsoft::Terminal::Control::implementation
                                              const RoutedEventArgs& /*args*/)
     {
         _searchBox->Visibility(Visibility::Collapsed);
+        _searchBox->SetStatus({});
+        _core.ClearSearch();
 
         // Set focus back to terminal control
         this->Focus(FocusState::Programmatic);
@@ -1874,6 +1879,14 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         _interactivity.RequestPasteTextFromClipboard();
     }
 
+    // Method Description:
+    // - Cancels the long pastes that are still being written. Hosts can use
+    //   this together with the PasteProgress event to let the user stop a paste.
+    void TermControl::CancelPaste()
+    {
+        _core.CancelPaste();
+    }
+
     void TermControl::SelectAll()
     {
         _core.SelectAll();
@@ -2857,12 +2870,52 @@ namespace winrt::Microsoft::Terminal::Control::implementation
     {
         if (auto automationPeer{ Automation::Peers::FrameworkElementAutomationPeer::FromElement(*this) })
         {
+            const auto announcement = !args.PatternError().empty() ? args.PatternError() :
+                                      args.FoundMatch()            ? RS_(L"SearchBox_MatchesAvailable") :
+                                                                     RS_(L"SearchBox_NoMatches");
             automationPeer.RaiseNotificationEvent(
                 Automation::Peers::AutomationNotificationKind::ActionCompleted,
                 Automation::Peers::AutomationNotificationProcessing::ImportantMostRecent,
-                args.FoundMatch() ? RS_(L"SearchBox_MatchesAvailable") : RS_(L"SearchBox_NoMatches"), // what to announce if results were found
+                announcement, // what to announce if results were found
                 L"SearchBoxResultAnnouncement" /* unique name for this group of notifications */);
         }
+
+        _updateSearchStatus(args);
+    }
+
+    // Method Description:
+    // - Called when the matches of the current search changed, because new
+    //   output arrived while the search box is open.
+    // Arguments:
+    // - args: contains the updated number of matches.
+    // Return Value:
+    // - <none>
+    void TermControl::_coreSearchResultsUpdated(const IInspectable& /*sender*/, const Control::FoundResultsArgs& args)
+    {
+        _updateSearchStatus(args);
+    }
+
+    // Method Description:
+    // - Shows which of the matches is selected and how many there are in the search box.
+    void TermControl::_updateSearchStatus(const Control::FoundResultsArgs& args)
+    {
+        if (!_searchBox)
+        {
+            return;
+        }
+
+        if (!args.PatternError().empty())
+        {
+            _searchBox->SetStatus(args.PatternError());
+        }
+        else if (args.TotalMatches() == 0)
+        {
+            _searchBox->SetStatus(RS_(L"SearchBox_NoMatches"));
+        }
+        else
+        {
+            _searchBox->SetStatus(winrt::hstring{ fmt::format(std::wstring_view{ RS_(L"SearchBox_MatchCount") }, args.CurrentMatch(), args.TotalMatches()) });
+        }
     }
 
     void TermControl::OwningHwnd(uint64_t owner)
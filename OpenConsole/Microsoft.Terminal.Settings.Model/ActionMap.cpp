@@ -100,6 +100,15 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
         return std::nullopt;
     }
 
+    // Function Description:
+    // - Packs a key chord for the key chord table. See KeyChordTable::Pack.
+    static uint64_t PackKeyChord(const Control::KeyChord& keys)
+    {
+        return ::Microsoft::Terminal::Settings::Model::KeyChordTable<Model::Command>::Pack(static_cast<uint32_t>(keys.Modifiers()),
+                                                                                           static_cast<uint32_t>(keys.Vkey()),
+                                                                                           static_cast<uint32_t>(keys.ScanCode()));
+    }
+
     static void RegisterShortcutAction(ShortcutAction shortcutAction, std::unordered_map<hstring, Model::ActionAndArgs>& list, std::unordered_set<InternalActionID>& visited)
     {
         const auto actionAndArgs{ make_self<ActionAndArgs>(shortcutAction) };
@@ -434,6 +443,7 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
         _NameMapCache = nullptr;
         _GlobalHotkeysCache = nullptr;
         _KeyBindingMapCache = nullptr;
+        _InvalidateFlattenedSettings();
 
         // Handle nested commands
         const auto cmdImpl{ get_self<Command>(cmd) };
@@ -726,6 +736,29 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
     // - nullptr if the key chord is explicitly unbound
     // - nullopt if it was not bound in this layer
     std::optional<Model::Command> ActionMap::_GetActionByKeyChordInternal(const Control::KeyChord& keys) const
+    {
+        // Use the flattened table of all layers, if it's up to date
+        if (_KeyChordTableGeneration == _InheritanceGeneration())
+        {
+            auto cmd = _GetActionFromKeyChordTable(keys);
+            // Debug builds make sure that the table still agrees with the layers it was built from.
+            assert(cmd == _GetActionByKeyChordFromLayers(keys));
+            return cmd;
+        }
+
+        return _GetActionByKeyChordFromLayers(keys);
+    }
+
+    // Method Description:
+    // - Retrieves the assigned command with the given key chord by asking
+    //   this layer and then each of our parents, without _KeyChordTable.
+    // Arguments:
+    // - keys: the key chord of the command to search for
+    // Return Value:
+    // - the command with the given key chord
+    // - nullptr if the key chord is explicitly unbound
+    // - nullopt if it was not bound in this layer
+    std::optional<Model::Command> ActionMap::_GetActionByKeyChordFromLayers(const Control::KeyChord& keys) const
     {
         // Check the current layer
         if (const auto actionIDPair = _KeyMap.find(keys); actionIDPair != _KeyMap.end())
@@ -740,7 +773,7 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
         assert(_parents.size() <= 1);
         for (const auto& parent : _parents)
         {
-            const auto& inheritedCmd{ parent->_GetActionByKeyChordInternal(keys) };
+            const auto& inheritedCmd{ parent->_GetActionByKeyChordFromLayers(keys) };
             if (inheritedCmd)
             {
                 return *inheritedCmd;
@@ -751,6 +784,74 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
         return std::nullopt;
     }
 
+    // Method Description:
+    // - Resolves the key chords of this layer and all of our parents into
+    //   _KeyChordTable, so that _GetActionByKeyChordInternal doesn't have to
+    //   ask every layer. This should be called once all layers are final.
+    // Arguments:
+    // - <none>
+    // Return Value:
+    // - <none>
+    void ActionMap::FlattenKeyBindings()
+    {
+        // Every layer's _KeyMap is an upper bound for the number of its key
+        // chords that end up in the table.
+        size_t count = 0;
+        for (auto layer = this; layer; layer = layer->_parents.empty() ? nullptr : layer->_parents.front().get())
+        {
+            assert(layer->_parents.size() <= 1);
+            count += layer->_KeyMap.size();
+        }
+
+        KeyChordTable table{ count };
+        _AddToKeyChordTable(table);
+
+        _KeyChordTable = std::move(table);
+        _KeyChordTableGeneration = _InheritanceGeneration();
+    }
+
+    // Method Description:
+    // - Adds the key chords of this layer and then those of our parents to the
+    //   given table. Like _GetActionByKeyChordInternal, the first layer that
+    //   binds (or unbinds) a key chord wins.
+    // Arguments:
+    // - table: the table to add the key chords to. It must have room for all of them.
+    // Return Value:
+    // - <none>
+    void ActionMap::_AddToKeyChordTable(KeyChordTable& table) const
+    {
+        for (const auto& [keys, actionID] : _KeyMap)
+        {
+            // This _cannot_ be nullopt because KeyMap can only map to
+            //   actions in this layer.
+            // This _can_ be nullptr, which we keep as the tombstone of
+            //   an explicitly unbound key chord.
+            table.Insert(PackKeyChord(keys), _GetActionByID(actionID).value());
+        }
+
+        for (const auto& parent : _parents)
+        {
+            parent->_AddToKeyChordTable(table);
+        }
+    }
+
+    // Method Description:
+    // - Retrieves the assigned command with the given key chord from _KeyChordTable.
+    // Arguments:
+    // - keys: the key chord of the command to search for
+    // Return Value:
+    // - the command with the given key chord
+    // - nullptr if the key chord is explicitly unbound
+    // - nullopt if it isn't bound in any layer
+    std::optional<Model::Command> ActionMap::_GetActionFromKeyChordTable(const Control::KeyChord& keys) const
+    {
+        if (const auto cmd = _KeyChordTable.Find(PackKeyChord(keys)))
+        {
+            return *cmd;
+        }
+        return std::nullopt;
+    }
+
     // Method Description:
     // - Retrieves the key chord for the provided action
     // Arguments:
@@ -844,6 +945,12 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
         cmd->ActionAndArgs(make<ActionAndArgs>());
         cmd->RegisterKey(keys);
         AddAction(*cmd);
+
+        // RebindKeys ends up here as well, so it's covered too.
+        if (!_KeyChordTable.empty())
+        {
+            FlattenKeyBindings();
+        }
     }
 
     // Method Description:
@@ -860,5 +967,10 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
         cmd->RegisterKey(keys);
         cmd->ActionAndArgs(action);
         AddAction(*cmd);
+
+        if (!_KeyChordTable.empty())
+        {
+            FlattenKeyBindings();
+        }
     }
 }
@@ -18,6 +18,7 @@ Author(s):
 #include "ActionMap.g.h"
 #include "IInheritable.h"
 #include "Command.h"
+#include "KeyChordTable.h"
 
 // fwdecl unittest classes
 namespace SettingsModelLocalTests
@@ -57,6 +58,7 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
         com_ptr<ActionMap> Copy() const;
 
         // queries
+        void FlattenKeyBindings();
         Model::Command GetActionByKeyChord(const Control::KeyChord& keys) const;
         bool IsKeyChordExplicitlyUnbound(const Control::KeyChord& keys) const;
         Control::KeyChord GetKeyBindingForAction(const ShortcutAction& action) const;
@@ -78,6 +80,12 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
     private:
         std::optional<Model::Command> _GetActionByID(const InternalActionID actionID) const;
         std::optional<Model::Command> _GetActionByKeyChordInternal(const Control::KeyChord& keys) const;
+        std::optional<Model::Command> _GetActionByKeyChordFromLayers(const Control::KeyChord& keys) const;
+
+        // The commands are nullptr if the key chord is explicitly unbound.
+        using KeyChordTable = ::Microsoft::Terminal::Settings::Model::KeyChordTable<Model::Command>;
+        void _AddToKeyChordTable(KeyChordTable& table) const;
+        std::optional<Model::Command> _GetActionFromKeyChordTable(const Control::KeyChord& keys) const;
 
         void _RefreshKeyBindingCaches();
         void _PopulateAvailableActionsWithStandardCommands(std::unordered_map<hstring, Model::ActionAndArgs>& availableActions, std::unordered_set<InternalActionID>& visitedActionIDs) const;
@@ -113,6 +121,16 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
         //   than is necessary to be serialized.
         std::unordered_map<InternalActionID, Model::Command> _MaskingActions;
 
+        // Key Chord Table:
+        // The key chords of this layer and all of our parents, resolved into
+        //   a single open-addressed table by FlattenKeyBindings(). Looking up
+        //   a key chord then only takes a probe or two, instead of a hash map
+        //   lookup per layer.
+        // It's only used while _KeyChordTableGeneration is current. Any change
+        //   to this ActionMap or its parents makes it stale. See IInheritable::_InheritanceGeneration.
+        KeyChordTable _KeyChordTable;
+        uint64_t _KeyChordTableGeneration{ 0 };
+
         friend class SettingsModelLocalTests::KeyBindingsTests;
         friend class SettingsModelLocalTests::DeserializationTests;
         friend class SettingsModelLocalTests::TerminalSettingsTests;
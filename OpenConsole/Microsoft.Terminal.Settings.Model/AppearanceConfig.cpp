@@ -86,6 +86,23 @@ void AppearanceConfig::LayerJson(const Json::Value& json)
 #undef APPEARANCE_SETTINGS_LAYER_JSON
 }
 
+// Method Description:
+// - Resolves all of our settings through our parents once, so that their
+//   getters don't have to. See IInheritable::_InvalidateFlattenedSettings.
+void AppearanceConfig::FlattenInheritedSettings()
+{
+    _FlattenForeground();
+    _FlattenBackground();
+    _FlattenSelectionBackground();
+    _FlattenCursorColor();
+    _FlattenOpacity();
+
+#define APPEARANCE_SETTINGS_FLATTEN(type, name, jsonKey, ...) \
+    _Flatten##name();
+    MTSM_APPEARANCE_SETTINGS(APPEARANCE_SETTINGS_FLATTEN)
+#undef APPEARANCE_SETTINGS_FLATTEN
+}
+
 winrt::Microsoft::Terminal::Settings::Model::Profile AppearanceConfig::SourceProfile()
 {
     return _sourceProfile.get();
@@ -107,6 +107,7 @@ Model::CascadiaSettings CascadiaSettings::Copy() const
         settings->_warnings = winrt::single_threaded_vector(std::move(warnings));
         settings->_loadError = _loadError;
         settings->_deserializationErrorMessage = _deserializationErrorMessage;
+        settings->_timedOutSources = _timedOutSources;
     }
 
     // defterm
@@ -376,6 +377,44 @@ winrt::hstring CascadiaSettings::GetSerializationErrorMessage() const
     return _deserializationErrorMessage;
 }
 
+// Method Description:
+// - Describes one of the Warnings() to the user, if its details are only
+//   known to the settings model (like which profile generators timed out).
+// Arguments:
+// - warning: one of the Warnings()
+// Return Value:
+// - The localized text, or an empty string if the app has to describe the warning itself.
+winrt::hstring CascadiaSettings::GetWarningMessage(const Model::SettingsLoadWarnings warning) const
+{
+    switch (warning)
+    {
+    case Model::SettingsLoadWarnings::ProfileGeneratorTimedOut:
+    {
+        std::wstring sources;
+        for (const auto& source : _timedOutSources)
+        {
+            if (!sources.empty())
+            {
+                sources.append(L", ");
+            }
+            sources.append(source);
+        }
+        return winrt::hstring{ fmt::format(std::wstring_view(RS_(L"ProfileGeneratorTimedOutWarning")), sources) };
+    }
+    default:
+        return {};
+    }
+}
+
+// Method Description:
+// - Gets how long each phase of loading these settings took. Only settings
+//   created by LoadAll have a total, and settings that failed to load have
+//   no timings at all.
+const SettingsLoadTimings& CascadiaSettings::LoadTimings() const noexcept
+{
+    return _loadTimings;
+}
+
 // As used by CreateNewProfile and DuplicateProfile this function
 // creates a new Profile instance with a random UUID and a given name.
 winrt::com_ptr<Profile> CascadiaSettings::_createNewProfile(const std::wstring_view& name) const
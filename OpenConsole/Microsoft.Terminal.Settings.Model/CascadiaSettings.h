@@ -48,6 +48,33 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
         void clear();
 };
 
+    // How long each phase of loading the settings took. SettingsLoader fills
+    // in the phases it runs and CascadiaSettings adds the validation. Only
+    // CascadiaSettings::LoadAll measures the total. Phases that didn't run stay at zero.
+    struct SettingsLoadTimings
+    {
+        std::chrono::microseconds parse{};
+        std::chrono::microseconds generateProfiles{};
+        // The time each dynamic profile generator took, by namespace.
+        std::vector<std::pair<std::wstring_view, std::chrono::microseconds>> generators;
+        std::chrono::microseconds mergeInbox{};
+        std::chrono::microseconds findFragments{};
+        size_t fragmentFiles = 0;
+        // How many JSON documents were found in the parse cache, and how
+        // many had to be parsed. See SettingsLoader::_parseJson.
+        size_t jsonCacheHits = 0;
+        size_t jsonCacheMisses = 0;
+        // How long it took to read the snapshot of the parsed documents, and
+        // how many it had. Only the first load of the process reads it. See
+        // JsonCache::LoadSnapshot.
+        std::chrono::microseconds snapshotLoad{};
+        size_t snapshotDocuments = 0;
+        std::chrono::microseconds finalizeLayering{};
+        std::chrono::microseconds fixup{};
+        std::chrono::microseconds validation{};
+        std::chrono::microseconds total{};
+    };
+
     struct SettingsLoader
 {
         static SettingsLoader Default(const std::string_view& userJSON, const std::string_view& inboxJSON);
@@ -65,11 +92,15 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
         ParsedSettings inboxSettings;
         ParsedSettings userSettings;
         bool duplicateProfile = false;
+        // The namespaces of the generators that didn't finish in time. Their
+        // profiles are missing, but the user's profiles of these sources are kept.
+        std::vector<winrt::hstring> timedOutSources;
+        SettingsLoadTimings timings;
 
     private:
         struct JsonSettings
         {
-            Json::Value root;
+            std::shared_ptr<const Json::Value> root;
             const Json::Value& colorSchemes;
             const Json::Value& profileDefaults;
             const Json::Value& profilesList;
@@ -81,12 +112,29 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
         static const Json::Value& _getJSONValue(const Json::Value& json, const std::string_view& key) noexcept;
         gsl::span<const winrt::com_ptr<implementation::Profile>> _getNonUserOriginProfiles() const;
         void _parse(const OriginTag origin, const winrt::hstring& source, const std::string_view& content, ParsedSettings& settings);
-        void _parseFragment(const winrt::hstring& source, const std::string_view& content, ParsedSettings& settings);
+        // A fragment file, as it's passed from FindFragmentsAndMergeIntoUserSettings
+        // to the threads that parse the fragments, and back.
+        struct ParsedFragment
+        {
+            std::filesystem::path path;
+            winrt::hstring source;
+            ParsedSettings settings;
+            bool duplicateProfile = false;
+            bool parsed = false;
+        };
+
+        static void _parseFragment(const winrt::hstring& source, const JsonSettings& json, ParsedFragment& fragment);
+        static void _parseFragments(std::vector<ParsedFragment>& fragments);
+        void _layerFragment(const ParsedFragment& fragment);
         static JsonSettings _parseJson(const std::string_view& content);
+        static JsonSettings _parseJsonFile(const std::filesystem::path& path);
+        static JsonSettings _makeJsonSettings(std::shared_ptr<const Json::Value> root);
         static winrt::com_ptr<implementation::Profile> _parseProfile(const OriginTag origin, const winrt::hstring& source, const Json::Value& profileJson);
-        void _appendProfile(winrt::com_ptr<Profile>&& profile, const winrt::guid& guid, ParsedSettings& settings);
+        static bool _appendProfile(winrt::com_ptr<Profile>&& profile, const winrt::guid& guid, ParsedSettings& settings);
         void _addUserProfileParent(const winrt::com_ptr<implementation::Profile>& profile);
-        void _executeGenerator(const IDynamicProfileGenerator& generator);
+        struct GeneratorRun;
+        std::shared_ptr<GeneratorRun> _startGenerator(std::shared_ptr<const IDynamicProfileGenerator> generator) const;
+        void _finishGenerator(GeneratorRun& run, const std::chrono::steady_clock::time_point deadline);
 
         std::unordered_set<std::wstring_view> _ignoredNamespaces;
         // See _getNonUserOriginProfiles().
@@ -133,6 +181,8 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
         winrt::Windows::Foundation::Collections::IVectorView<Model::SettingsLoadWarnings> Warnings() const;
         winrt::Windows::Foundation::IReference<Model::SettingsLoadErrors> GetLoadingError() const;
         winrt::hstring GetSerializationErrorMessage() const;
+        winrt::hstring GetWarningMessage(const Model::SettingsLoadWarnings warning) const;
+        const SettingsLoadTimings& LoadTimings() const noexcept;
 
         // defterm
         static std::wstring NormalizeCommandLine(LPCWSTR commandLine);
@@ -168,6 +218,8 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
         winrt::Windows::Foundation::Collections::IVector<Model::SettingsLoadWarnings> _warnings = winrt::single_threaded_vector<Model::SettingsLoadWarnings>();
         winrt::Windows::Foundation::IReference<Model::SettingsLoadErrors> _loadError;
         winrt::hstring _deserializationErrorMessage;
+        std::vector<winrt::hstring> _timedOutSources;
+        SettingsLoadTimings _loadTimings;
 
         // defterm
         winrt::Windows::Foundation::Collections::IObservableVector<Model::DefaultTerminal> _defaultTerminals{ nullptr };
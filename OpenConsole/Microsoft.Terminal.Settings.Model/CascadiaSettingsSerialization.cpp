@@ -26,14 +26,17 @@
 #include "ApplicationState.h"
 #include "DefaultTerminal.h"
 #include "FileUtils.h"
+#include "SettingsSnapshot.h"
 
 using namespace winrt::Windows::Foundation::Collections;
 //using namespace winrt::Windows::ApplicationModel::AppExtensions;
 using namespace winrt::Microsoft::Terminal::Settings;
 using namespace winrt::Microsoft::Terminal::Settings::Model::implementation;
+using ::Microsoft::Terminal::Settings::Model::SettingsSnapshot;
 
 static constexpr std::wstring_view SettingsFilename{ L"settings.json" };
 static constexpr std::wstring_view DefaultsFilename{ L"defaults.json" };
+static constexpr std::wstring_view SnapshotFilename{ L"settings.snapshot" };
 
 static constexpr std::string_view ProfilesKey{ "profiles" };
 static constexpr std::string_view DefaultSettingsKey{ "defaults" };
@@ -46,10 +49,331 @@ static constexpr std::wstring_view FragmentsPath{ L"\\Microsoft\\Windows Termina
 
 static constexpr std::wstring_view AppExtensionHostName{ L"com.microsoft.windows.terminal.settings" };
 
+// The longest we wait for the dynamic profile generators, all together. The
+// profiles of a generator that takes longer are left out of this launch, and
+// the user's profiles of its namespace are kept as they are (see timedOutSources).
+static constexpr std::chrono::milliseconds GeneratorTimeout{ 3000 };
+
 // make sure this matches defaults.json.
 static constexpr winrt::guid DEFAULT_WINDOWS_POWERSHELL_GUID{ 0x61c54bbd, 0xc2c6, 0x5271, { 0x96, 0xe7, 0x00, 0x9a, 0x87, 0xff, 0x44, 0xbf } };
 static constexpr winrt::guid DEFAULT_COMMAND_PROMPT_GUID{ 0x0caa0dad, 0x35be, 0x5f56, { 0xa8, 0xff, 0xaf, 0xce, 0xee, 0xaa, 0x61, 0x01 } };
 
+namespace
+{
+    // Adds the time between its construction and destruction to the given
+    // counter. That way a phase is measured even if it throws.
+    struct PhaseTimer
+    {
+        explicit PhaseTimer(std::chrono::microseconds& counter) noexcept :
+            _counter{ counter },
+            _start{ std::chrono::steady_clock::now() }
+        {
+        }
+
+        ~PhaseTimer()
+        {
+            _counter += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - _start);
+        }
+
+        PhaseTimer(const PhaseTimer&) = delete;
+        PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+    private:
+        std::chrono::microseconds& _counter;
+        std::chrono::steady_clock::time_point _start;
+    };
+
+    // The JSON documents parsed by the last loads of the settings. When the
+    // settings are reloaded, only the documents that changed since are parsed
+    // again. Documents given as a string are found by their content, and
+    // files by their path, size and last write time, so that those aren't
+    // even read again. The parsed documents are never modified, so they can
+    // be shared between loads.
+    // - The cache is saved into a SettingsSnapshot whenever it changes, and
+    //   the first load of the process seeds it from that. That way a cold
+    //   start only parses the documents that changed since the last load.
+    //   "experimental.settingsSnapshot": false turns that off, and deletes
+    //   the snapshot.
+    class JsonCache
+    {
+    public:
+        static JsonCache& Instance()
+        {
+            static JsonCache cache;
+            return cache;
+        }
+
+        std::shared_ptr<const Json::Value> Find(const std::string_view& content)
+        {
+            const auto lock = _lock.lock_exclusive();
+            const auto it = _byContent.find(std::hash<std::string_view>{}(content));
+            if (it == _byContent.end() || it->second.content != content)
+            {
+                _misses.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            _hits.fetch_add(1, std::memory_order_relaxed);
+            it->second.generation = _generation;
+            return it->second.json;
+        }
+
+        void Insert(const std::string_view& content, std::shared_ptr<const Json::Value> json)
+        {
+            const auto lock = _lock.lock_exclusive();
+            // Only LoadAll evicts what it didn't use. Make sure nothing else
+            // makes the cache grow without bounds.
+            if (_byContent.size() >= MaxContentEntries)
+            {
+                _byContent.clear();
+            }
+            _byContent.insert_or_assign(std::hash<std::string_view>{}(content), ContentEntry{ std::string{ content }, std::move(json), _generation });
+            _snapshotDirty = true;
+        }
+
+        std::shared_ptr<const Json::Value> Find(const std::filesystem::path& path, const uintmax_t size, const std::filesystem::file_time_type lastWriteTime)
+        {
+            const auto lock = _lock.lock_exclusive();
+            const auto it = _byPath.find(path.native());
+            if (it == _byPath.end() || it->second.size != size || it->second.lastWriteTime != lastWriteTime)
+            {
+                _misses.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            _hits.fetch_add(1, std::memory_order_relaxed);
+            it->second.generation = _generation;
+            return it->second.json;
+        }
+
+        void Insert(const std::filesystem::path& path, const uintmax_t size, const std::filesystem::file_time_type lastWriteTime, std::shared_ptr<const Json::Value> json)
+        {
+            const auto lock = _lock.lock_exclusive();
+            _byPath.insert_or_assign(path.native(), FileEntry{ size, lastWriteTime, std::move(json), _generation });
+            _snapshotDirty = true;
+        }
+
+        // Called when LoadAll starts. Returns the generation of the load.
+        uint64_t BeginLoad()
+        {
+            const auto lock = _lock.lock_exclusive();
+            return ++_generation;
+        }
+
+        // Called when LoadAll is done. Throws away the documents it didn't
+        // use, like the ones of fragments that were uninstalled.
+        void EndLoad(const uint64_t generation)
+        {
+            const auto lock = _lock.lock_exclusive();
+            _snapshotDirty |= _evict(_byContent, generation);
+            _snapshotDirty |= _evict(_byPath, generation);
+        }
+
+        // Seeds the cache with the documents of the snapshot at the given
+        // path, if there is one. Only the first load of the process reads
+        // it, later ones find everything it has in the cache already. The
+        // snapshot is mapped into memory, rather than read into a copy.
+        // Returns the number of documents the snapshot had.
+        size_t LoadSnapshot(const std::filesystem::path& path)
+        {
+            const auto lock = _lock.lock_exclusive();
+            if (std::exchange(_snapshotLoaded, true))
+            {
+                return 0;
+            }
+
+            const wil::unique_hfile file{ CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr) };
+            if (!file)
+            {
+                // There's no snapshot yet.
+                return 0;
+            }
+            LARGE_INTEGER size{};
+            THROW_IF_WIN32_BOOL_FALSE(GetFileSizeEx(file.get(), &size));
+            if (size.QuadPart == 0)
+            {
+                return 0;
+            }
+            const wil::unique_handle mapping{ CreateFileMappingW(file.get(), nullptr, PAGE_READONLY, 0, 0, nullptr) };
+            THROW_LAST_ERROR_IF_NULL(mapping);
+            const wil::unique_mapview_ptr<char> view{ static_cast<char*>(MapViewOfFile(mapping.get(), FILE_MAP_READ, 0, 0, 0)) };
+            THROW_LAST_ERROR_IF_NULL(view);
+
+            // A snapshot of another version of the format, or a corrupt one,
+            // is simply replaced by the next SaveSnapshot.
+            auto documents = SettingsSnapshot::Deserialize({ view.get(), gsl::narrow<size_t>(size.QuadPart) });
+            if (!documents)
+            {
+                return 0;
+            }
+
+            for (auto& document : *documents)
+            {
+                if (document.source == SettingsSnapshot::Document::Source::Content)
+                {
+                    const auto hash = std::hash<std::string_view>{}(document.key);
+                    _byContent.insert_or_assign(hash, ContentEntry{ std::move(document.key), std::move(document.json), _generation });
+                }
+                else
+                {
+                    const std::filesystem::file_time_type lastWriteTime{ std::filesystem::file_time_type::duration{ document.lastWriteTime } };
+                    _byPath.insert_or_assign(til::u8u16(document.key), FileEntry{ document.size, lastWriteTime, std::move(document.json), _generation });
+                }
+            }
+            _snapshotDirty = false;
+            return documents->size();
+        }
+
+        // Writes the documents in the cache into the snapshot at the given
+        // path, unless they didn't change since it was read or written.
+        void SaveSnapshot(const std::filesystem::path& path)
+        {
+            // Saves of this process that overlap write the same temporary file.
+            const std::scoped_lock saveLock{ _saveLock };
+
+            std::vector<SettingsSnapshot::Document> documents;
+            {
+                const auto lock = _lock.lock_exclusive();
+                if (!std::exchange(_snapshotDirty, false))
+                {
+                    return;
+                }
+                for (const auto& [hash, entry] : _byContent)
+                {
+                    documents.push_back({ SettingsSnapshot::Document::Source::Content, entry.content, 0, 0, entry.json });
+                }
+                for (const auto& [entryPath, entry] : _byPath)
+                {
+                    documents.push_back({ SettingsSnapshot::Document::Source::File, til::u16u8(entryPath), entry.size, entry.lastWriteTime.time_since_epoch().count(), entry.json });
+                }
+            }
+
+            try
+            {
+                _writeSnapshot(path, SettingsSnapshot::Serialize(documents));
+            }
+            catch (...)
+            {
+                // The next load tries again.
+                const auto lock = _lock.lock_exclusive();
+                _snapshotDirty = true;
+                throw;
+            }
+        }
+
+        // Deletes the snapshot at the given path, along with the temporary
+        // files of any saves that didn't finish. Used when the user turned the
+        // snapshot off. If they turn it back on, the next load writes it again.
+        void DeleteSnapshot(const std::filesystem::path& path)
+        {
+            const std::scoped_lock saveLock{ _saveLock };
+            {
+                const auto lock = _lock.lock_exclusive();
+                _snapshotDirty = true;
+            }
+
+            std::error_code ec;
+            std::filesystem::remove(path, ec);
+            LOG_HR_IF_MSG(HRESULT_FROM_WIN32(ec.value()), ec.value() != 0, "Failed to delete the settings snapshot");
+
+            const auto prefix = path.filename().native() + L'.';
+            for (const auto& entry : std::filesystem::directory_iterator{ path.parent_path(), ec })
+            {
+                const auto& name = entry.path().filename().native();
+                if (til::starts_with(name, prefix) && til::ends_with(name, SnapshotTemporaryExtension))
+                {
+                    std::filesystem::remove(entry.path(), ec);
+                }
+            }
+        }
+
+        size_t Hits() const noexcept
+        {
+            return _hits.load(std::memory_order_relaxed);
+        }
+
+        size_t Misses() const noexcept
+        {
+            return _misses.load(std::memory_order_relaxed);
+        }
+
+    private:
+        static constexpr size_t MaxContentEntries = 16;
+        static constexpr std::wstring_view SnapshotTemporaryExtension{ L".tmp" };
+
+        // Writes the snapshot into a temporary file of this process, which is
+        // then moved over the old snapshot in one go. Another process that
+        // loads the settings at the same time reads either the old snapshot
+        // or the new one, never a partial one. If several processes save at
+        // once, the last one wins. If anything fails, the temporary file is
+        // deleted again.
+        static void _writeSnapshot(const std::filesystem::path& path, const std::string_view& content)
+        {
+            auto tmpPath = path;
+            tmpPath += fmt::format(L".{}{}", GetCurrentProcessId(), SnapshotTemporaryExtension);
+            try
+            {
+                WriteUTF8File(tmpPath, content);
+                THROW_IF_WIN32_BOOL_FALSE(MoveFileExW(tmpPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH));
+            }
+            catch (...)
+            {
+                std::error_code ec;
+                std::filesystem::remove(tmpPath, ec);
+                throw;
+            }
+        }
+
+        // Returns whether any documents were evicted.
+        template<typename TMap>
+        static bool _evict(TMap& map, const uint64_t generation)
+        {
+            const auto size = map.size();
+            for (auto it = map.begin(); it != map.end();)
+            {
+                it = it->second.generation < generation ? map.erase(it) : std::next(it);
+            }
+            return map.size() != size;
+        }
+
+        struct ContentEntry
+        {
+            std::string content;
+            std::shared_ptr<const Json::Value> json;
+            uint64_t generation;
+        };
+
+        struct FileEntry
+        {
+            uintmax_t size;
+            std::filesystem::file_time_type lastWriteTime;
+            std::shared_ptr<const Json::Value> json;
+            uint64_t generation;
+        };
+
+        wil::srwlock _lock;
+        std::unordered_map<size_t, ContentEntry> _byContent;
+        std::unordered_map<std::wstring, FileEntry> _byPath;
+        uint64_t _generation = 0;
+        std::atomic<size_t> _hits{ 0 };
+        std::atomic<size_t> _misses{ 0 };
+
+        // Whether the snapshot was read yet, and whether the cache changed
+        // since it was read or written. See LoadSnapshot and SaveSnapshot.
+        bool _snapshotLoaded = false;
+        bool _snapshotDirty = true;
+        std::mutex _saveLock;
+    };
+}
+
+// Function Description:
+// - Runs the given function on a thread of the thread pool. The function is
+//   copied into the coroutine, so that it outlives the caller's temporaries.
+template<typename TFunc>
+static winrt::fire_and_forget runInBackground(TFunc func)
+{
+    co_await winrt::resume_background();
+    func();
+}
+
 // Function Description:
 // - Extracting the value from an async task (like talking to the app catalog) when we are on the
 //   UI thread causes C++/WinRT to complain quite loudly (and halt execution!)
@@ -108,6 +432,8 @@ SettingsLoader SettingsLoader::Default(const std::string_view& userJSON, const s
 // At a minimum you should do at least everything that SettingsLoader::Default does.
 SettingsLoader::SettingsLoader(const std::string_view& userJSON, const std::string_view& inboxJSON)
 {
+    const PhaseTimer timer{ timings.parse };
+
     _parse(OriginTag::InBox, {}, inboxJSON, inboxSettings);
 
     try
@@ -134,12 +460,29 @@ SettingsLoader::SettingsLoader(const std::string_view& userJSON, const std::stri
 
 // Generate dynamic profiles and add them to the list of "inbox" profiles
 // (meaning profiles specified by the application rather by the user).
+//
+// The generators run concurrently, each into a list of profiles of its own.
+// No matter which of them finishes first, their profiles are added in the
+// order below, so the result is the same as running them one by one.
 void SettingsLoader::GenerateProfiles()
 {
-    _executeGenerator(PowershellCoreProfileGenerator{});
-    _executeGenerator(WslDistroGenerator{});
-    _executeGenerator(AzureCloudShellGenerator{});
-    _executeGenerator(VisualStudioGenerator{});
+    const PhaseTimer timer{ timings.generateProfiles };
+
+    const std::array runs{
+        _startGenerator(std::make_shared<PowershellCoreProfileGenerator>()),
+        _startGenerator(std::make_shared<WslDistroGenerator>()),
+        _startGenerator(std::make_shared<AzureCloudShellGenerator>()),
+        _startGenerator(std::make_shared<VisualStudioGenerator>()),
+    };
+
+    const auto deadline = std::chrono::steady_clock::now() + GeneratorTimeout;
+    for (const auto& run : runs)
+    {
+        if (run)
+        {
+            _finishGenerator(*run, deadline);
+        }
+    }
 }
 
 // A new settings.json gets a special treatment:
@@ -183,6 +526,8 @@ void SettingsLoader::ApplyRuntimeInitialSettings()
 // If a matching profile doesn't exist yet in .userSettings, one will be created.
 void SettingsLoader::MergeInboxIntoUserSettings()
 {
+    const PhaseTimer timer{ timings.mergeInbox };
+
     for (const auto& profile : inboxSettings.profiles)
     {
         _addUserProfileParent(profile);
@@ -196,21 +541,23 @@ void SettingsLoader::MergeInboxIntoUserSettings()
 // merge them. Unfortunately however the "updates" key in fragment profiles make this impossible:
 // The targeted profile might be one that got created as part of SettingsLoader::MergeInboxIntoUserSettings.
 // Additionally the GUID in "updates" will conflict with existing GUIDs in .inboxSettings.
+//
+// The fragment files are found first, then read and parsed in parallel,
+// and finally layered one after another in the order they were found in.
+// That way the result is the same as if they were parsed one by one.
 void SettingsLoader::FindFragmentsAndMergeIntoUserSettings()
 {
-    ParsedSettings fragmentSettings;
+    const PhaseTimer timer{ timings.findFragments };
+    std::vector<ParsedFragment> fragments;
 
     const auto parseAndLayerFragmentFiles = [&](const std::filesystem::path& path, const winrt::hstring& source) {
         for (const auto& fragmentExt : std::filesystem::directory_iterator{ path })
         {
             if (fragmentExt.path().extension() == jsonExtension)
             {
-                try
-                {
-                    const auto content = ReadUTF8File(fragmentExt.path());
-                    _parseFragment(source, content, fragmentSettings);
-                }
-                CATCH_LOG();
+                auto& fragment = fragments.emplace_back();
+                fragment.path = fragmentExt.path();
+                fragment.source = source;
             }
         }
     };
@@ -288,6 +635,18 @@ void SettingsLoader::FindFragmentsAndMergeIntoUserSettings()
             parseAndLayerFragmentFiles(path, packageName);
         }
     }*/
+
+    timings.fragmentFiles = fragments.size();
+    _parseFragments(fragments);
+
+    for (const auto& fragment : fragments)
+    {
+        try
+        {
+            _layerFragment(fragment);
+        }
+        CATCH_LOG();
+    }
 }
 
 // See FindFragmentsAndMergeIntoUserSettings.
@@ -295,8 +654,53 @@ void SettingsLoader::FindFragmentsAndMergeIntoUserSettings()
 // and at the time of writing is used for unit tests only.
 void SettingsLoader::MergeFragmentIntoUserSettings(const winrt::hstring& source, const std::string_view& content)
 {
-    ParsedSettings fragmentSettings;
-    _parseFragment(source, content, fragmentSettings);
+    ParsedFragment fragment;
+    _parseFragment(source, _parseJson(content), fragment);
+    fragment.parsed = true;
+    _layerFragment(fragment);
+}
+
+// Reads and parses the given fragment files. A file that can't be read or
+// parsed is logged and skipped, just like it used to be when the files were
+// parsed one by one. The files are spread over a few threads of the thread pool.
+void SettingsLoader::_parseFragments(std::vector<ParsedFragment>& fragments)
+{
+    const auto parseOne = [](ParsedFragment& fragment) noexcept {
+        try
+        {
+            _parseFragment(fragment.source, _parseJsonFile(fragment.path), fragment);
+            fragment.parsed = true;
+        }
+        CATCH_LOG();
+    };
+
+    const auto threads = std::min<size_t>(fragments.size(), std::max(1u, std::thread::hardware_concurrency()));
+    if (threads <= 1)
+    {
+        for (auto& fragment : fragments)
+        {
+            parseOne(fragment);
+        }
+        return;
+    }
+
+    std::atomic<size_t> next{ 0 };
+    til::latch latch{ gsl::narrow_cast<ptrdiff_t>(threads) };
+    const auto worker = [&]() noexcept {
+        for (auto i = next.fetch_add(1, std::memory_order_relaxed); i < fragments.size(); i = next.fetch_add(1, std::memory_order_relaxed))
+        {
+            parseOne(til::at(fragments, i));
+        }
+        latch.count_down();
+    };
+
+    // The calling thread does its share of the work, too.
+    for (size_t i = 1; i < threads; ++i)
+    {
+        runInBackground(worker);
+    }
+    worker();
+    latch.wait();
 }
 
 // Call this method before passing SettingsLoader to the CascadiaSettings constructor.
@@ -304,6 +708,8 @@ void SettingsLoader::MergeFragmentIntoUserSettings(const winrt::hstring& source,
 // by MergeInboxIntoUserSettings/FindFragmentsAndMergeIntoUserSettings).
 void SettingsLoader::FinalizeLayering()
 {
+    const PhaseTimer timer{ timings.finalizeLayering };
+
     // Layer default globals -> user globals
     userSettings.globals->AddLeastImportantParent(inboxSettings.globals);
     userSettings.globals->_FinalizeInheritance();
@@ -339,6 +745,8 @@ void SettingsLoader::FinalizeLayering()
 // the settings need to be saved to disk.
 bool SettingsLoader::DisableDeletedProfiles()
 {
+    const PhaseTimer timer{ timings.fixup };
+
     const auto& state = winrt::get_self<ApplicationState>(ApplicationState::SharedInstance());
     auto generatedProfileIds = state->GeneratedProfiles();
     auto newGeneratedProfiles = false;
@@ -369,6 +777,8 @@ bool SettingsLoader::DisableDeletedProfiles()
 // the settings need to be saved to disk.
 bool SettingsLoader::FixupUserSettings()
 {
+    const PhaseTimer timer{ timings.fixup };
+
     struct CommandlinePatch
     {
         winrt::guid guid;
@@ -518,7 +928,7 @@ void SettingsLoader::_parse(const OriginTag origin, const winrt::hstring& source
     settings.clear();
 
     {
-        settings.globals = GlobalAppSettings::FromJson(json.root);
+        settings.globals = GlobalAppSettings::FromJson(*json.root);
 
         for (const auto& schemeJson : json.colorSchemes)
         {
@@ -548,7 +958,7 @@ void SettingsLoader::_parse(const OriginTag origin, const winrt::hstring& source
             // GH#9962: Discard Guid-less, Name-less profiles.
             if (profile->HasGuid())
             {
-                _appendProfile(std::move(profile), profile->Guid(), settings);
+                duplicateProfile |= !_appendProfile(std::move(profile), profile->Guid(), settings);
             }
         }
     }
@@ -556,10 +966,11 @@ void SettingsLoader::_parse(const OriginTag origin, const winrt::hstring& source
 
 // Just like _parse, but is to be used for fragment files, which don't support anything but color
 // schemes and profiles. Additionally this function supports profiles which specify an "updates" key.
-void SettingsLoader::_parseFragment(const winrt::hstring& source, const std::string_view& content, ParsedSettings& settings)
+// It doesn't touch the SettingsLoader, so that fragments can be parsed in parallel.
+// _layerFragment adds the results to .userSettings afterwards.
+void SettingsLoader::_parseFragment(const winrt::hstring& source, const JsonSettings& json, ParsedFragment& fragment)
 {
-    const auto json = _parseJson(content);
-
+    auto& settings = fragment.settings;
     settings.clear();
 
     {
@@ -595,12 +1006,24 @@ void SettingsLoader::_parseFragment(const winrt::hstring& source, const std::str
                 const auto guid = profile->HasGuid() ? profile->Guid() : profile->Updates();
                 if (guid != winrt::guid{})
                 {
-                    _appendProfile(std::move(profile), guid, settings);
+                    fragment.duplicateProfile |= !_appendProfile(std::move(profile), guid, settings);
                 }
             }
             CATCH_LOG()
         }
     }
+}
+
+// Adds the profiles and color schemes of a fragment parsed by _parseFragment to .userSettings.
+void SettingsLoader::_layerFragment(const ParsedFragment& fragment)
+{
+    if (!fragment.parsed)
+    {
+        return;
+    }
+
+    const auto& settings = fragment.settings;
+    duplicateProfile |= fragment.duplicateProfile;
 
     for (const auto& fragmentProfile : settings.profiles)
     {
@@ -623,11 +1046,49 @@ void SettingsLoader::_parseFragment(const winrt::hstring& source, const std::str
     }
 }
 
+// Parses the given JSON document, unless it was parsed by an earlier load
+// of the settings already. See JsonCache.
 SettingsLoader::JsonSettings SettingsLoader::_parseJson(const std::string_view& content)
 {
-    auto root = content.empty() ? Json::Value{ Json::ValueType::objectValue } : _parseJSON(content);
-    const auto& colorSchemes = _getJSONValue(root, SchemesKey);
-    const auto& profilesObject = _getJSONValue(root, ProfilesKey);
+    if (content.empty())
+    {
+        return _makeJsonSettings(std::make_shared<const Json::Value>(Json::ValueType::objectValue));
+    }
+
+    auto& cache = JsonCache::Instance();
+    auto root = cache.Find(content);
+    if (!root)
+    {
+        root = std::make_shared<const Json::Value>(_parseJSON(content));
+        cache.Insert(content, root);
+    }
+    return _makeJsonSettings(std::move(root));
+}
+
+// Like _parseJson, but reads the document from the given file. If the file
+// didn't change since it was parsed last, it isn't even read.
+SettingsLoader::JsonSettings SettingsLoader::_parseJsonFile(const std::filesystem::path& path)
+{
+    // If the file changes between here and reading it, it's cached with its
+    // old size and time. That just means we'll parse it again next time.
+    const auto size = std::filesystem::file_size(path);
+    const auto lastWriteTime = std::filesystem::last_write_time(path);
+
+    auto& cache = JsonCache::Instance();
+    auto root = cache.Find(path, size, lastWriteTime);
+    if (!root)
+    {
+        const auto content = ReadUTF8File(path);
+        root = std::make_shared<const Json::Value>(content.empty() ? Json::Value{ Json::ValueType::objectValue } : _parseJSON(content));
+        cache.Insert(path, size, lastWriteTime, root);
+    }
+    return _makeJsonSettings(std::move(root));
+}
+
+SettingsLoader::JsonSettings SettingsLoader::_makeJsonSettings(std::shared_ptr<const Json::Value> root)
+{
+    const auto& colorSchemes = _getJSONValue(*root, SchemesKey);
+    const auto& profilesObject = _getJSONValue(*root, ProfilesKey);
     const auto& profileDefaults = _getJSONValue(profilesObject, DefaultSettingsKey);
     const auto& profilesList = profilesObject.isArray() ? profilesObject : _getJSONValue(profilesObject, ProfilesListKey);
     return JsonSettings{ std::move(root), colorSchemes, profileDefaults, profilesList };
@@ -660,18 +1121,17 @@ winrt::com_ptr<Profile> SettingsLoader::_parseProfile(const OriginTag origin, co
 
 // Adds a profile to the ParsedSettings instance. Takes ownership of the profile.
 // It ensures no duplicate GUIDs are added to the ParsedSettings instance.
-void SettingsLoader::_appendProfile(winrt::com_ptr<Profile>&& profile, const winrt::guid& guid, ParsedSettings& settings)
+// Returns false if the profile was dropped as a duplicate.
+bool SettingsLoader::_appendProfile(winrt::com_ptr<Profile>&& profile, const winrt::guid& guid, ParsedSettings& settings)
 {
     // FYI: The static_cast ensures we don't move the profile into
     // `profilesByGuid`, even though we still need it later for `profiles`.
     if (settings.profilesByGuid.emplace(guid, static_cast<const winrt::com_ptr<Profile>&>(profile)).second)
     {
         settings.profiles.emplace_back(profile);
+        return true;
     }
-    else
-    {
-        duplicateProfile = true;
-    }
+    return false;
 }
 
 // If the given ParsedSettings instance contains a profile with the given profile's GUID,
@@ -719,23 +1179,83 @@ void SettingsLoader::_addUserProfileParent(const winrt::com_ptr<implementation::
     }
 }
 
-// As the name implies it executes a generator.
-// Generated profiles are added to .inboxSettings. Used by GenerateProfiles().
-void SettingsLoader::_executeGenerator(const IDynamicProfileGenerator& generator)
+// A generator running on a thread of the thread pool. It's shared with that
+// thread, so that a generator we gave up on can still finish safely.
+// Once abandoned is set, only that thread touches the profiles anymore.
+struct SettingsLoader::GeneratorRun
+{
+    std::shared_ptr<const IDynamicProfileGenerator> generator;
+    std::vector<winrt::com_ptr<Profile>> profiles;
+    std::chrono::microseconds duration{};
+    std::atomic<bool> abandoned{ false };
+    wil::slim_event_manual_reset done;
+};
+
+// Runs the given generator on a thread of the thread pool. Used by GenerateProfiles().
+// Returns nullptr if the user disabled the generator's namespace.
+std::shared_ptr<SettingsLoader::GeneratorRun> SettingsLoader::_startGenerator(std::shared_ptr<const IDynamicProfileGenerator> generator) const
 {
-    const auto generatorNamespace = generator.GetNamespace();
-    if (_ignoredNamespaces.count(generatorNamespace))
+    if (_ignoredNamespaces.count(generator->GetNamespace()))
     {
-        return;
+        return nullptr;
     }
 
-    const auto previousSize = inboxSettings.profiles.size();
+    auto run = std::make_shared<GeneratorRun>();
+    run->generator = std::move(generator);
 
-    try
+    runInBackground([run]() noexcept {
+        // The thread pool may have taken longer to get to us than we were given.
+        if (run->abandoned.load(std::memory_order_relaxed))
+        {
+            run->done.SetEvent();
+            return;
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        try
+        {
+            // Some of the generators talk to COM servers.
+            const auto coInit = wil::CoInitializeEx(COINIT_MULTITHREADED);
+            run->generator->GenerateProfiles(run->profiles);
+        }
+        CATCH_LOG_MSG("Dynamic Profile Namespace: \"%.*s\"", gsl::narrow<int>(run->generator->GetNamespace().size()), run->generator->GetNamespace().data())
+        run->duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+        // The settings were loaded without these profiles. Let go of
+        // them here, instead of whenever the last reference goes away.
+        if (run->abandoned.load(std::memory_order_relaxed))
+        {
+            run->profiles.clear();
+        }
+        run->done.SetEvent();
+    });
+
+    return run;
+}
+
+// Waits until the given generator finished, or the deadline passed.
+// Generated profiles are added to .inboxSettings. Used by GenerateProfiles().
+void SettingsLoader::_finishGenerator(GeneratorRun& run, const std::chrono::steady_clock::time_point deadline)
+{
+    const auto generatorNamespace = run.generator->GetNamespace();
+
+    const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+    if (!run.done.wait(gsl::narrow_cast<DWORD>(std::max<int64_t>(remaining.count(), 0))))
     {
-        generator.GenerateProfiles(inboxSettings.profiles);
+        // The generator keeps running in the background, but we won't wait for
+        // it, and whatever it generates is discarded. From here on, run.profiles
+        // belongs to the generator's thread.
+        run.abandoned.store(true, std::memory_order_relaxed);
+        LOG_HR_MSG(HRESULT_FROM_WIN32(ERROR_TIMEOUT), "Dynamic Profile Namespace: \"%.*s\"", gsl::narrow<int>(generatorNamespace.size()), generatorNamespace.data());
+        timings.generators.emplace_back(generatorNamespace, std::chrono::duration_cast<std::chrono::microseconds>(GeneratorTimeout));
+        timedOutSources.emplace_back(generatorNamespace);
+        return;
     }
-    CATCH_LOG_MSG("Dynamic Profile Namespace: \"%.*s\"", gsl::narrow<int>(generatorNamespace.size()), generatorNamespace.data())
+
+    timings.generators.emplace_back(generatorNamespace, run.duration);
+
+    const auto previousSize = inboxSettings.profiles.size();
+    inboxSettings.profiles.insert(inboxSettings.profiles.end(), std::make_move_iterator(run.profiles.begin()), std::make_move_iterator(run.profiles.end()));
 
     // If the generator produced some profiles we're going to give them default attributes.
     // By setting the Origin/Source/etc. here, we deduplicate some code and ensure they aren't missing accidentally.
@@ -766,6 +1286,26 @@ void SettingsLoader::_executeGenerator(const IDynamicProfileGenerator& generator
 Model::CascadiaSettings CascadiaSettings::LoadAll()
 try
 {
+    const auto start = std::chrono::steady_clock::now();
+    auto& jsonCache = JsonCache::Instance();
+    const auto cacheGeneration = jsonCache.BeginLoad();
+    const auto cacheHits = jsonCache.Hits();
+    const auto cacheMisses = jsonCache.Misses();
+    const auto snapshotPath = GetBaseSettingsPath() / SnapshotFilename;
+
+    // On a cold start, this seeds the cache from the snapshot the last load
+    // wrote, so that the JSON of unchanged files isn't parsed again.
+    std::chrono::microseconds snapshotLoad{};
+    size_t snapshotDocuments = 0;
+    {
+        const PhaseTimer timer{ snapshotLoad };
+        try
+        {
+            snapshotDocuments = jsonCache.LoadSnapshot(snapshotPath);
+        }
+        CATCH_LOG();
+    }
+
     const auto settingsString = ReadUTF8FileIfExists(_settingsPath()).value_or(std::string{});
     const auto firstTimeSetup = settingsString.empty();
 
@@ -807,6 +1347,32 @@ try
     mustWriteToDisk |= loader.DisableDeletedProfiles();
     mustWriteToDisk |= loader.FixupUserSettings();
 
+    // Anything that wasn't used by this load won't be used by the next one either.
+    jsonCache.EndLoad(cacheGeneration);
+    loader.timings.jsonCacheHits = jsonCache.Hits() - cacheHits;
+    loader.timings.jsonCacheMisses = jsonCache.Misses() - cacheMisses;
+    loader.timings.snapshotLoad = snapshotLoad;
+    loader.timings.snapshotDocuments = snapshotDocuments;
+
+    // The next cold start will need what this load parsed. Writing the
+    // snapshot doesn't hold up this one. If the user turned the snapshot
+    // off, it's deleted instead, and the next cold start parses everything.
+    // (This load may still have used it, since it's read before settings.json.)
+    runInBackground([snapshotPath, enabled = loader.userSettings.globals->SettingsSnapshot()]() noexcept {
+        try
+        {
+            if (enabled)
+            {
+                JsonCache::Instance().SaveSnapshot(snapshotPath);
+            }
+            else
+            {
+                JsonCache::Instance().DeleteSnapshot(snapshotPath);
+            }
+        }
+        CATCH_LOG();
+    });
+
     // If this throws, the app will catch it and use the default settings.
     const auto settings = winrt::make_self<CascadiaSettings>(std::move(loader));
 
@@ -825,6 +1391,7 @@ try
         }
     }
 
+    settings->_loadTimings.total = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
     return *settings;
 }
 catch (const SettingsException& ex)
@@ -896,10 +1463,15 @@ CascadiaSettings::CascadiaSettings(SettingsLoader&& loader) :
         // matching user's profile in _allProfiles (since they aren't functional anyways).
         //
         // A user profile has a valid, dynamic parent if it has a parent with identical source.
+        //
+        // If the generator of the source merely didn't finish in time, the profile most likely
+        // still works. It's kept without the generated parent, so that it's still there to be
+        // launched, and so that a defaultProfile that refers to it doesn't fall back to another one.
         if (const auto source = profile->Source(); !source.empty())
         {
             const auto& parents = profile->Parents();
-            if (std::none_of(parents.begin(), parents.end(), [&](const auto& parent) { return parent->Source() == source; }))
+            if (std::none_of(parents.begin(), parents.end(), [&](const auto& parent) { return parent->Source() == source; }) &&
+                std::find(loader.timedOutSources.begin(), loader.timedOutSources.end(), source) == loader.timedOutSources.end())
             {
                 continue;
             }
@@ -925,6 +1497,10 @@ CascadiaSettings::CascadiaSettings(SettingsLoader&& loader) :
     {
         warnings.emplace_back(Model::SettingsLoadWarnings::DuplicateProfile);
     }
+    if (!loader.timedOutSources.empty())
+    {
+        warnings.emplace_back(Model::SettingsLoadWarnings::ProfileGeneratorTimedOut);
+    }
 
     // SettingsLoader and ParsedSettings are supposed to always
     // create these two members. We don't want null-pointer exceptions.
@@ -936,9 +1512,22 @@ CascadiaSettings::CascadiaSettings(SettingsLoader&& loader) :
     _allProfiles = winrt::single_threaded_observable_vector(std::move(allProfiles));
     _activeProfiles = winrt::single_threaded_observable_vector(std::move(activeProfiles));
     _warnings = winrt::single_threaded_vector(std::move(warnings));
+    _timedOutSources = loader.timedOutSources;
+    _loadTimings = std::move(loader.timings);
 
+    const PhaseTimer timer{ _loadTimings.validation };
     _resolveDefaultProfile();
     _validateSettings();
+
+    // The inheritance graph won't change anymore, unless the settings UI
+    // modifies a copy of these settings. Resolve all the inheritable
+    // settings once, so that reading them doesn't walk the parents.
+    _globals->FlattenInheritedSettings();
+    _baseLayerProfile->FlattenInheritedSettings();
+    for (const auto& profile : loader.userSettings.profiles)
+    {
+        profile->FlattenInheritedSettings();
+    }
 }
 
 // Method Description:
@@ -31,6 +31,185 @@ static constexpr std::string_view ProfileNameToken{ "${profile.name}" };
 static constexpr std::string_view ProfileIconToken{ "${profile.icon}" };
 static constexpr std::string_view SchemeNameToken{ "${scheme.name}" };
 
+namespace
+{
+    // The values that the tokens in an expandable command are replaced with,
+    // indexed by ExpansionToken.
+    enum class ExpansionToken : size_t
+    {
+        ProfileName,
+        ProfileIcon,
+        SchemeName,
+    };
+    using ExpansionValues = std::array<std::string, 3>;
+
+    // The JSON of an expandable command, together with the location of every
+    // string in it that contains one of the tokens. Each string is split into
+    // its literal text and its tokens once. Expanding the command for a
+    // profile or scheme then only has to copy the JSON and fill in those
+    // strings, instead of serializing and re-parsing the whole thing.
+    class ExpansionTemplate
+    {
+    public:
+        ExpansionTemplate(const Json::Value& json, const ExpandCommandType iterateOn) :
+            _json{ json }
+        {
+            if (iterateOn == ExpandCommandType::Profiles)
+            {
+                _tokens.emplace_back(ProfileNameToken, ExpansionToken::ProfileName);
+                _tokens.emplace_back(ProfileIconToken, ExpansionToken::ProfileIcon);
+            }
+            else if (iterateOn == ExpandCommandType::ColorSchemes)
+            {
+                _tokens.emplace_back(SchemeNameToken, ExpansionToken::SchemeName);
+            }
+
+            std::vector<PathElement> path;
+            _collectSlots(_json, path);
+        }
+
+        Json::Value Instantiate(const ExpansionValues& values) const
+        {
+            auto result{ _json };
+            for (const auto& slot : _slots)
+            {
+                std::string text;
+                for (const auto& piece : slot.pieces)
+                {
+                    text.append(piece.token ? til::at(values, static_cast<size_t>(*piece.token)) : piece.literal);
+                }
+
+                // The path of a key leads to the member it names. Navigate to
+                // the object that contains it instead, so we can rename it.
+                const auto depth = slot.isKey ? slot.path.size() - 1 : slot.path.size();
+                auto value = &result;
+                for (size_t i = 0; i < depth; ++i)
+                {
+                    const auto& element = til::at(slot.path, i);
+                    value = element.index ? &(*value)[*element.index] : &(*value)[element.key];
+                }
+
+                if (slot.isKey)
+                {
+                    Json::Value member;
+                    value->removeMember(slot.path.back().key, &member);
+                    (*value)[text] = std::move(member);
+                }
+                else
+                {
+                    *value = Json::Value{ text };
+                }
+            }
+            return result;
+        }
+
+    private:
+        // An object key, or an array index if index is set.
+        struct PathElement
+        {
+            std::string key;
+            std::optional<Json::ArrayIndex> index;
+        };
+
+        // Literal text, or a token if token is set.
+        struct Piece
+        {
+            std::string literal;
+            std::optional<ExpansionToken> token;
+        };
+
+        struct Slot
+        {
+            // The object keys and array indices that lead to the string.
+            std::vector<PathElement> path;
+            // Whether the string is the key of the member at path, rather than its value.
+            bool isKey;
+            std::vector<Piece> pieces;
+        };
+
+        // Method Description:
+        // - Finds all the strings below value that contain a token. The slots
+        //   for the contents of a member come before the slot for its key, so
+        //   renaming the member doesn't change the path to its contents.
+        void _collectSlots(const Json::Value& value, std::vector<PathElement>& path)
+        {
+            std::vector<Piece> pieces;
+            if (value.isString())
+            {
+                if (_split(value.asString(), pieces))
+                {
+                    _slots.emplace_back(Slot{ path, false, std::move(pieces) });
+                }
+            }
+            else if (value.isObject())
+            {
+                for (const auto& key : value.getMemberNames())
+                {
+                    path.emplace_back(PathElement{ key, std::nullopt });
+                    _collectSlots(value[key], path);
+                    if (_split(key, pieces))
+                    {
+                        _slots.emplace_back(Slot{ path, true, std::move(pieces) });
+                        pieces.clear();
+                    }
+                    path.pop_back();
+                }
+            }
+            else if (value.isArray())
+            {
+                for (Json::ArrayIndex i = 0; i < value.size(); ++i)
+                {
+                    path.emplace_back(PathElement{ {}, i });
+                    _collectSlots(value[i], path);
+                    path.pop_back();
+                }
+            }
+        }
+
+        // Method Description:
+        // - Splits text into its literal text and its tokens.
+        // Return Value:
+        // - false if text doesn't contain any tokens.
+        bool _split(const std::string_view text, std::vector<Piece>& pieces) const
+        {
+            size_t literalStart = 0;
+            for (auto pos = text.find("${"); pos != std::string_view::npos; pos = text.find("${", pos))
+            {
+                const auto match = std::find_if(_tokens.begin(), _tokens.end(), [&](const auto& token) {
+                    return text.compare(pos, token.first.size(), token.first) == 0;
+                });
+                if (match == _tokens.end())
+                {
+                    pos += 2;
+                    continue;
+                }
+
+                if (pos > literalStart)
+                {
+                    pieces.emplace_back(Piece{ std::string{ text.substr(literalStart, pos - literalStart) }, std::nullopt });
+                }
+                pieces.emplace_back(Piece{ {}, match->second });
+                pos += match->first.size();
+                literalStart = pos;
+            }
+
+            if (pieces.empty())
+            {
+                return false;
+            }
+            if (literalStart < text.size())
+            {
+                pieces.emplace_back(Piece{ std::string{ text.substr(literalStart) }, std::nullopt });
+            }
+            return true;
+        }
+
+        const Json::Value& _json;
+        std::vector<std::pair<std::string_view, ExpansionToken>> _tokens;
+        std::vector<Slot> _slots;
+    };
+}
+
 namespace winrt::Microsoft::Terminal::Settings::Model::implementation
 {
     Command::Command()
@@ -442,29 +621,6 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
         return cmdList;
     }
 
-    // Function Description:
-    // - Helper to escape a string as a json string. This function will also
-    //   trim off the leading and trailing double-quotes, so the output string
-    //   can be inserted directly into another json blob.
-    // Arguments:
-    // - input: the string to JSON escape.
-    // Return Value:
-    // - the input string escaped properly to be inserted into another json blob.
-    std::string _escapeForJson(const std::string& input)
-    {
-        Json::Value inJson{ input };
-        Json::StreamWriterBuilder builder;
-        builder.settings_["indentation"] = "";
-        auto out{ Json::writeString(builder, inJson) };
-        if (out.size() >= 2)
-        {
-            // trim off the leading/trailing '"'s
-            auto ss{ out.substr(1, out.size() - 2) };
-            return ss;
-        }
-        return out;
-    }
-
     // Method Description:
     // - Iterate over all the provided commands, and recursively expand any
     //   commands with `iterateOn` set. If we successfully generated expanded
@@ -524,8 +680,8 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
     //   * For the new commands, we'll replace any instance of "${profile.name}"
     //     in the original json used to create this action with the name of the
     //     given profile.
-    // - If we encounter any errors while re-parsing the json with the replaced
-    //   name, we'll just return immediately.
+    // - The original json is only walked once, to find the strings that
+    //   contain any tokens. See ExpansionTemplate.
     // - At the end, we'll return all the new commands we've build for the given command.
     // Arguments:
     // - expandable: the Command to potentially turn into more commands
@@ -552,32 +708,25 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
             return newCommands;
         }
 
-        std::string errs; // This string will receive any error text from failing to parse.
-        std::unique_ptr<Json::CharReader> reader{ Json::CharReaderBuilder::CharReaderBuilder().newCharReader() };
+        // FromJson only ever keeps the json of objects around. If this
+        // isn't one, there's nothing we could expand.
+        if (!expandable->_originalJson.isObject())
+        {
+            warnings.Append(SettingsLoadWarnings::FailedToParseCommandJson);
+            return newCommands;
+        }
 
-        // First, get a string for the original Json::Value
-        auto oldJsonString = expandable->_originalJson.toStyledString();
+        const ExpansionTemplate expansion{ expandable->_originalJson, expandable->_IterateOn };
+        ExpansionValues values;
 
-        auto reParseJson = [&](const auto& newJsonString) -> bool {
-            // - Now, re-parse the modified value.
-            Json::Value newJsonValue;
-            const auto actualDataStart = newJsonString.data();
-            const auto actualDataEnd = newJsonString.data() + newJsonString.size();
-            if (!reader->parse(actualDataStart, actualDataEnd, &newJsonValue, &errs))
-            {
-                warnings.Append(SettingsLoadWarnings::FailedToParseCommandJson);
-                // If we encounter a re-parsing error, just stop processing the rest of the commands.
-                return false;
-            }
-
-            // Pass the new json back though FromJson, to get the new expanded value.
+        const auto expand = [&]() {
+            // Pass the new json though FromJson, to get the new expanded value.
             std::vector<SettingsLoadWarnings> newWarnings;
-            if (auto newCmd{ Command::FromJson(newJsonValue, newWarnings) })
+            if (auto newCmd{ Command::FromJson(expansion.Instantiate(values), newWarnings) })
             {
                 newCommands.push_back(*newCmd);
             }
             std::for_each(newWarnings.begin(), newWarnings.end(), [warnings](auto& warn) { warnings.Append(warn); });
-            return true;
         };
 
         if (expandable->_IterateOn == ExpandCommandType::Profiles)
@@ -591,24 +740,9 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
                 // * for the action, we'll take the original json, replace any
                 //   instances of "${profile.name}" with the profile's name,
                 //   then re-attempt to parse the action and args.
-
-                // Replace all the keywords in the original json, and try and parse that
-
-                // - Escape the profile name for JSON appropriately
-                auto escapedProfileName = _escapeForJson(til::u16u8(p.Name()));
-                auto escapedProfileIcon = _escapeForJson(til::u16u8(p.Icon()));
-                auto newJsonString = til::replace_needle_in_haystack(oldJsonString,
-                                                                     ProfileNameToken,
-                                                                     escapedProfileName);
-                til::replace_needle_in_haystack_inplace(newJsonString,
-                                                        ProfileIconToken,
-                                                        escapedProfileIcon);
-
-                // If we encounter a re-parsing error, just stop processing the rest of the commands.
-                if (!reParseJson(newJsonString))
-                {
-                    break;
-                }
+                til::at(values, static_cast<size_t>(ExpansionToken::ProfileName)) = til::u16u8(p.Name());
+                til::at(values, static_cast<size_t>(ExpansionToken::ProfileIcon)) = til::u16u8(p.Icon());
+                expand();
             }
         }
         else if (expandable->_IterateOn == ExpandCommandType::ColorSchemes)
@@ -619,18 +753,8 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
                 // original json, replace any instances of "${scheme.name}" with
                 // the scheme's name, then re-attempt to parse the action and
                 // args.
-
-                // - Escape the profile name for JSON appropriately
-                auto escapedSchemeName = _escapeForJson(til::u16u8(s.Name()));
-                auto newJsonString = til::replace_needle_in_haystack(oldJsonString,
-                                                                     SchemeNameToken,
-                                                                     escapedSchemeName);
-
-                // If we encounter a re-parsing error, just stop processing the rest of the commands.
-                if (!reParseJson(newJsonString))
-                {
-                    break;
-                }
+                til::at(values, static_cast<size_t>(ExpansionToken::SchemeName)) = til::u16u8(s.Name());
+                expand();
             }
         }
 
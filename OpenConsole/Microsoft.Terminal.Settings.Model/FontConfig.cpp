@@ -78,6 +78,17 @@ void FontConfig::LayerJson(const Json::Value& json)
     }
 }
 
+// Method Description:
+// - Resolves all of our settings through our parents once, so that their
+//   getters don't have to. See IInheritable::_InvalidateFlattenedSettings.
+void FontConfig::FlattenInheritedSettings()
+{
+#define FONT_SETTINGS_FLATTEN(type, name, jsonKey, ...) \
+    _Flatten##name();
+    MTSM_FONT_SETTINGS(FONT_SETTINGS_FLATTEN)
+#undef FONT_SETTINGS_FLATTEN
+}
+
 bool FontConfig::HasAnyOptionSet() const
 {
     return HasFontFace() || HasFontSize() || HasFontWeight();
@@ -142,6 +142,21 @@ void GlobalAppSettings::LayerJson(const Json::Value& json)
     }
 }
 
+// Method Description:
+// - Resolves all of our settings through our parents once, so that their
+//   getters don't have to. This includes the key bindings of our action map.
+//   See IInheritable::_InvalidateFlattenedSettings.
+void GlobalAppSettings::FlattenInheritedSettings()
+{
+    _FlattenUnparsedDefaultProfile();
+    _actionMap->FlattenKeyBindings();
+
+#define GLOBAL_SETTINGS_FLATTEN(type, name, jsonKey, ...) \
+    _Flatten##name();
+    MTSM_GLOBAL_SETTINGS(GLOBAL_SETTINGS_FLATTEN)
+#undef GLOBAL_SETTINGS_FLATTEN
+}
+
 // Method Description:
 // - Adds the given colorscheme to our map of schemes, using its name as the key.
 // Arguments:
@@ -44,16 +44,19 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
         void ClearParents()
         {
             _parents.clear();
+            _InvalidateFlattenedSettings();
         }
 
         void AddLeastImportantParent(com_ptr<T> parent)
         {
             _parents.emplace_back(std::move(parent));
+            _InvalidateFlattenedSettings();
         }
 
         void AddMostImportantParent(com_ptr<T> parent)
         {
             _parents.emplace(_parents.begin(), std::move(parent));
+            _InvalidateFlattenedSettings();
         }
 
         const std::vector<com_ptr<T>>& Parents()
@@ -72,6 +75,54 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
         // Return Value:
         // - <none>
         virtual void _FinalizeInheritance() {}
+
+        // Method Description:
+        // - Returns the generation of this instance and all of its ancestors:
+        //   the largest of their generations. It grows whenever a setting or
+        //   the parents of any of them change, and only then. Settings that
+        //   were resolved by _Flatten<NAME>() at this generation are returned
+        //   without walking the parents.
+        // - Walking the ancestors is only needed once after any instance of T
+        //   changed. Until the next change, the result is remembered.
+        uint64_t _InheritanceGeneration() const noexcept
+        {
+            const auto changes = _changes.load(std::memory_order_acquire);
+            if (_ancestryCheckedAt.load(std::memory_order_acquire) == changes)
+            {
+                return _ancestryGeneration.load(std::memory_order_relaxed);
+            }
+
+            auto generation = _generation;
+            for (const auto& parent : _parents)
+            {
+                generation = std::max(generation, parent->_InheritanceGeneration());
+            }
+            _ancestryGeneration.store(generation, std::memory_order_relaxed);
+            _ancestryCheckedAt.store(changes, std::memory_order_release);
+            return generation;
+        }
+
+        // Method Description:
+        // - Called whenever a setting or the parents of this instance change.
+        //   It gets a generation that's larger than that of any instance
+        //   before, which invalidates the flattened settings of this instance
+        //   and of its descendants, but not those of any other instance.
+        void _InvalidateFlattenedSettings() noexcept
+        {
+            _generation = _changes.fetch_add(1, std::memory_order_acq_rel) + 1;
+        }
+
+    private:
+        // The number of changes to any instance of T, which is also where the
+        // generations of the instances are taken from. 0 is never a valid
+        // generation, so that settings that were never flattened are never
+        // considered to be up to date.
+        static inline std::atomic<uint64_t> _changes{ 1 };
+
+        uint64_t _generation{ 1 };
+        // The result of _InheritanceGeneration(), and the value of _changes it's for.
+        mutable std::atomic<uint64_t> _ancestryGeneration{ 0 };
+        mutable std::atomic<uint64_t> _ancestryCheckedAt{ 0 };
     };
 
     // This is like std::optional, but we can use it in inheritance to determine whether the user explicitly cleared it
@@ -109,13 +160,32 @@ public:                                                                     \
     void Clear##name()                                                      \
     {                                                                       \
         _##name = std::nullopt;                                             \
+        _InvalidateFlattenedSettings();                                     \
     }                                                                       \
                                                                             \
 private:                                                                    \
     storageType _##name{ std::nullopt };                                    \
+    /* The resolved value, as cached by _Flatten##name() */                 \
+    storageType _##name##Flattened{ std::nullopt };                         \
+    uint64_t _##name##FlattenedGeneration{ 0 };                             \
+                                                                            \
+    /* Resolve the value once, so that the getter doesn't have to walk */   \
+    /* the parents until any setting or parent changes. */                  \
+    void _Flatten##name()                                                   \
+    {                                                                       \
+        _##name##FlattenedGeneration = 0;                                   \
+        _##name##Flattened = _get##name##Impl();                            \
+        _##name##FlattenedGeneration = _InheritanceGeneration();            \
+    }                                                                       \
                                                                             \
     storageType _get##name##Impl() const                                    \
     {                                                                       \
+        /*return the flattened value, if it's still up to date*/            \
+        if (_##name##FlattenedGeneration == _InheritanceGeneration())       \
+        {                                                                   \
+            return _##name##Flattened;                                      \
+        }                                                                   \
+                                                                            \
         /*return user set value*/                                           \
         if (_##name)                                                        \
         {                                                                   \
@@ -183,6 +253,7 @@ public:                                                                      \
     void name(const type& value)                                             \
     {                                                                        \
         _##name = value;                                                     \
+        _InvalidateFlattenedSettings();                                      \
     }
 
 // This macro is similar to the one above, but is reserved for optional settings
@@ -220,4 +291,5 @@ public:                                                                     \
             /* note we're setting the _inner_ value */                      \
             _##name = std::optional<type>{ std::nullopt };                  \
         }                                                                   \
+        _InvalidateFlattenedSettings();                                     \
     }
@@ -0,0 +1,114 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+/*++
+Module Name:
+- KeyChordTable.h
+
+Abstract:
+- The key chords of all the layers of an ActionMap, resolved into a single
+  open-addressed hash table. Looking up a key chord then only takes a probe
+  or two, instead of a hash map lookup per layer. Key chords are packed into
+  integers by Pack.
+- The table is filled once and then only read. Like with the layers of an
+  ActionMap, the first value added for a key chord wins. ActionMap adds an
+  explicitly unbound key chord with a null command, which is kept as the
+  tombstone that hides the bindings of the layers below.
+- This only depends on the standard library, so that it can be benchmarked
+  on its own.
+--*/
+
+#pragma once
+
+namespace Microsoft::Terminal::Settings::Model
+{
+    template<typename T>
+    class KeyChordTable final
+    {
+    public:
+        // Packs a key chord into a single integer. Two key chords are
+        // DeepEquals() if and only if their packed values are equal: like
+        // KeyChord::Hash(), this uses the scan code only if there's no vkey,
+        // and taints it so that it can't be mistaken for a vkey. Since a key
+        // chord has either, the result is never 0.
+        static constexpr uint64_t Pack(const uint32_t modifiers, const uint32_t vkey, const uint32_t scanCode) noexcept
+        {
+            return (uint64_t{ modifiers } << 32) | (vkey ? vkey : (scanCode | 0x80000000));
+        }
+
+        KeyChordTable() = default;
+
+        // Creates an empty table that's at most half full with the given
+        // number of key chords.
+        explicit KeyChordTable(const size_t count)
+        {
+            size_t capacity = 8;
+            while (capacity < count * 2)
+            {
+                capacity *= 2;
+            }
+            _slots.resize(capacity);
+            _values.reserve(count);
+        }
+
+        bool empty() const noexcept
+        {
+            return _slots.empty();
+        }
+
+        // Adds the packed key chord with the given value, unless it's in the
+        // table already. The table must have been created with room for it.
+        void Insert(const uint64_t keys, T value)
+        {
+            auto& slot = _probe(keys);
+            if (slot.keys == 0)
+            {
+                slot.keys = keys;
+                slot.index = _values.size();
+                _values.emplace_back(std::move(value));
+            }
+        }
+
+        // Returns the value of the packed key chord, or nullptr if it isn't in the table.
+        const T* Find(const uint64_t keys) const noexcept
+        {
+            if (_slots.empty())
+            {
+                return nullptr;
+            }
+            const auto& slot = _probe(keys);
+            return slot.keys == keys ? &til::at(_values, slot.index) : nullptr;
+        }
+
+    private:
+        struct Slot
+        {
+            // The packed key chord. 0 marks an empty slot.
+            uint64_t keys{ 0 };
+            size_t index{ 0 };
+        };
+
+        // Returns the slot of the key chord, or the empty slot it belongs in.
+        const Slot& _probe(const uint64_t keys) const noexcept
+        {
+            const auto mask = _slots.size() - 1;
+            // Fibonacci hashing: the upper bits of the product are well mixed.
+            auto i = static_cast<size_t>((keys * UINT64_C(0x9E3779B97F4A7C15)) >> 32) & mask;
+            while (til::at(_slots, i).keys != 0 && til::at(_slots, i).keys != keys)
+            {
+                i = (i + 1) & mask;
+            }
+            return til::at(_slots, i);
+        }
+
+        Slot& _probe(const uint64_t keys) noexcept
+        {
+            return const_cast<Slot&>(std::as_const(*this)._probe(keys));
+        }
+
+        std::vector<Slot> _slots;
+        // The values, in the order they were added. Unlike the slots, they
+        // don't have to be default constructible.
+        std::vector<T> _values;
+    };
+}
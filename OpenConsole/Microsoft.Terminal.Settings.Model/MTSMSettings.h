@@ -30,6 +30,7 @@ Author(s):
     X(bool, ForceVTInput, "experimental.input.forceVT", false)                                                                                             \
     X(bool, TrimBlockSelection, "trimBlockSelection", true)                                                                                                \
     X(bool, DetectURLs, "experimental.detectURLs", true)                                                                                                   \
+    X(bool, SettingsSnapshot, "experimental.settingsSnapshot", true)                                                                                       \
     X(bool, AlwaysShowTabs, "alwaysShowTabs", true)                                                                                                        \
     X(bool, ShowTitleInTitlebar, "showTerminalTitleInTitlebar", true)                                                                                      \
     X(bool, ConfirmCloseAllTabs, "confirmCloseAllTabs", true)                                                                                              \
@@ -78,7 +79,10 @@ Author(s):
     X(bool, UseAtlasEngine, "experimental.useAtlasEngine", false)                                                                                              \
     X(Windows::Foundation::Collections::IVector<winrt::hstring>, BellSound, "bellSound", nullptr)                                                              \
     X(bool, Elevate, "elevate", false)                                                                                                                         \
-    X(bool, VtPassthrough, "experimental.connection.passthroughMode", false)
+    X(bool, VtPassthrough, "experimental.connection.passthroughMode", false)                                                                                   \
+    X(uint32_t, OutputCoalescingWindow, "experimental.connection.outputCoalescingWindow", 8)                                                                   \
+    X(bool, SpillScrollbackToDisk, "experimental.spillScrollbackToDisk", false)                                                                                \
+    X(hstring, SessionRecordingDirectory, "experimental.sessionRecordingDirectory")
 
 // Intentionally omitted Profile settings:
 // * Name
@@ -198,6 +198,39 @@ void Profile::LayerJson(const Json::Value& json)
     }
 }
 
+// Method Description:
+// - Resolves all of our settings through our parents once, so that their
+//   getters don't have to. This includes the settings of our appearances
+//   and our font. See IInheritable::_InvalidateFlattenedSettings.
+void Profile::FlattenInheritedSettings()
+{
+    _FlattenTabColor();
+    _FlattenUnfocusedAppearance();
+    _FlattenName();
+    _FlattenSource();
+    _FlattenHidden();
+    _FlattenGuid();
+    _FlattenPadding();
+
+#define PROFILE_SETTINGS_FLATTEN(type, name, jsonKey, ...) \
+    _Flatten##name();
+    MTSM_PROFILE_SETTINGS(PROFILE_SETTINGS_FLATTEN)
+#undef PROFILE_SETTINGS_FLATTEN
+
+    if (const auto defaultAppearanceImpl = get_self<AppearanceConfig>(_DefaultAppearance))
+    {
+        defaultAppearanceImpl->FlattenInheritedSettings();
+    }
+    if (const auto fontInfoImpl = get_self<FontConfig>(_FontInfo))
+    {
+        fontInfoImpl->FlattenInheritedSettings();
+    }
+    if (_UnfocusedAppearance && *_UnfocusedAppearance)
+    {
+        winrt::get_self<AppearanceConfig>(*_UnfocusedAppearance)->FlattenInheritedSettings();
+    }
+}
+
 winrt::hstring Profile::EvaluatedStartingDirectory() const
 {
     auto path{ StartingDirectory() };
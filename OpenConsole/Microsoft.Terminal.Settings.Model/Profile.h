@@ -93,6 +93,7 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
 
         static com_ptr<Profile> FromJson(const Json::Value& json);
         void LayerJson(const Json::Value& json);
+        void FlattenInheritedSettings();
         Json::Value ToJson() const;
 
         hstring EvaluatedStartingDirectory() const;
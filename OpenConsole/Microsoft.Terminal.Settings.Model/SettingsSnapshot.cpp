@@ -0,0 +1,387 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "pch.h"
+#include "SettingsSnapshot.h"
+
+using namespace Microsoft::Terminal::Settings::Model;
+
+// The layout of a snapshot. All numbers are stored in the byte order of the
+// machine, since the snapshot never leaves it.
+//
+//   header:   magic, FormatVersion (u32), checksum of the body (u64)
+//   body:     document count (u32), followed by that many documents
+//   document: source (u8), key (string), size (u64), lastWriteTime (i64), value
+//   value:    tag (u8), offset start (u32), offset limit (u32), and then
+//             - Int: i64, UInt: u64, Real: double, String: string
+//             - Array: count (u32), followed by that many values
+//             - Object: count (u32), followed by that many (string, value) pairs
+//   string:   length (u32), followed by that many bytes
+static constexpr std::string_view Magic{ "WTSS" };
+static constexpr size_t HeaderSize = Magic.size() + sizeof(uint32_t) + sizeof(uint64_t);
+
+// Deeper documents are treated as corrupt, rather than risking the stack.
+static constexpr size_t MaxDepth = 256;
+
+namespace
+{
+    enum class Tag : uint8_t
+    {
+        Null,
+        False,
+        True,
+        Int,
+        UInt,
+        Real,
+        String,
+        Array,
+        Object,
+    };
+
+    // FNV-1a, which is plenty to notice a snapshot that was cut short or
+    // scribbled over. It hashes 8 bytes at a time, in 4 lanes that don't
+    // wait for each other's multiplications, which makes it about as fast as
+    // reading the snapshot.
+    uint64_t checksum(std::string_view data) noexcept
+    {
+        constexpr auto basis = UINT64_C(0xcbf29ce484222325);
+        constexpr auto prime = UINT64_C(0x100000001b3);
+
+        uint64_t lanes[4]{ basis, basis + 1, basis + 2, basis + 3 };
+        for (; data.size() >= sizeof(lanes); data.remove_prefix(sizeof(lanes)))
+        {
+            for (size_t i = 0; i < 4; ++i)
+            {
+                uint64_t word;
+                memcpy(&word, data.data() + i * sizeof(word), sizeof(word));
+                lanes[i] = (lanes[i] ^ word) * prime;
+            }
+        }
+
+        auto hash = basis;
+        for (const auto lane : lanes)
+        {
+            hash = (hash ^ lane) * prime;
+        }
+        for (const auto ch : data)
+        {
+            hash = (hash ^ static_cast<uint8_t>(ch)) * prime;
+        }
+        return hash;
+    }
+
+    class Writer
+    {
+    public:
+        explicit Writer(std::string& data) noexcept :
+            _data{ data }
+        {
+        }
+
+        template<typename T>
+        void Number(const T value)
+        {
+            static_assert(std::is_arithmetic_v<T>);
+            char bytes[sizeof(T)];
+            memcpy(&bytes[0], &value, sizeof(T));
+            _data.append(&bytes[0], sizeof(T));
+        }
+
+        void String(const char* const begin, const char* const end)
+        {
+            Number(_narrow(end - begin));
+            _data.append(begin, end);
+        }
+
+        void Value(const Json::Value& value)
+        {
+            switch (value.type())
+            {
+            case Json::nullValue:
+                _tag(Tag::Null, value);
+                break;
+            case Json::booleanValue:
+                _tag(value.asBool() ? Tag::True : Tag::False, value);
+                break;
+            case Json::intValue:
+                _tag(Tag::Int, value);
+                Number<int64_t>(value.asLargestInt());
+                break;
+            case Json::uintValue:
+                _tag(Tag::UInt, value);
+                Number<uint64_t>(value.asLargestUInt());
+                break;
+            case Json::realValue:
+                _tag(Tag::Real, value);
+                Number(value.asDouble());
+                break;
+            case Json::stringValue:
+            {
+                _tag(Tag::String, value);
+                const char* begin = nullptr;
+                const char* end = nullptr;
+                value.getString(&begin, &end);
+                String(begin, end);
+                break;
+            }
+            case Json::arrayValue:
+                _tag(Tag::Array, value);
+                Number(_narrow(value.size()));
+                for (const auto& element : value)
+                {
+                    Value(element);
+                }
+                break;
+            case Json::objectValue:
+                _tag(Tag::Object, value);
+                Number(_narrow(value.size()));
+                for (auto it = value.begin(); it != value.end(); ++it)
+                {
+                    const char* end = nullptr;
+                    const auto begin = it.memberName(&end);
+                    String(begin, end);
+                    Value(*it);
+                }
+                break;
+            }
+        }
+
+    private:
+        template<typename T>
+        static uint32_t _narrow(const T value)
+        {
+            if (value < 0 || static_cast<uint64_t>(value) > std::numeric_limits<uint32_t>::max())
+            {
+                throw std::length_error{ "settings document too large for a snapshot" };
+            }
+            return static_cast<uint32_t>(value);
+        }
+
+        void _tag(const Tag tag, const Json::Value& value)
+        {
+            Number(static_cast<uint8_t>(tag));
+            Number(_narrow(value.getOffsetStart()));
+            Number(_narrow(value.getOffsetLimit()));
+        }
+
+        std::string& _data;
+    };
+
+    // Reads what Writer wrote. Every read fails once the data ends, or once
+    // anything didn't make sense, and then Reader stays failed.
+    class Reader
+    {
+    public:
+        explicit Reader(const std::string_view& data) noexcept :
+            _data{ data }
+        {
+        }
+
+        bool Failed() const noexcept
+        {
+            return _failed;
+        }
+
+        bool AtEnd() const noexcept
+        {
+            return _data.empty();
+        }
+
+        template<typename T>
+        T Number() noexcept
+        {
+            static_assert(std::is_arithmetic_v<T>);
+            T value{};
+            if (_take(sizeof(T)))
+            {
+                memcpy(&value, _data.data() - sizeof(T), sizeof(T));
+            }
+            return value;
+        }
+
+        std::string_view String() noexcept
+        {
+            const auto length = Number<uint32_t>();
+            if (!_take(length))
+            {
+                return {};
+            }
+            return { _data.data() - length, length };
+        }
+
+        // Reads a value into the given one, which is null.
+        void Value(Json::Value& value, const size_t depth)
+        {
+            const auto tag = static_cast<Tag>(Number<uint8_t>());
+            const auto offsetStart = Number<uint32_t>();
+            const auto offsetLimit = Number<uint32_t>();
+            if (_failed)
+            {
+                return;
+            }
+
+            switch (tag)
+            {
+            case Tag::Null:
+                break;
+            case Tag::False:
+            case Tag::True:
+                value = tag == Tag::True;
+                break;
+            case Tag::Int:
+                value = Json::Value{ static_cast<Json::LargestInt>(Number<int64_t>()) };
+                break;
+            case Tag::UInt:
+                value = Json::Value{ static_cast<Json::LargestUInt>(Number<uint64_t>()) };
+                break;
+            case Tag::Real:
+                value = Number<double>();
+                break;
+            case Tag::String:
+            {
+                const auto string = String();
+                if (_failed)
+                {
+                    return;
+                }
+                value = Json::Value{ string.data(), string.data() + string.size() };
+                break;
+            }
+            case Tag::Array:
+            case Tag::Object:
+            {
+                const auto count = Number<uint32_t>();
+                // Every element takes at least a tag and its offsets, which
+                // keeps a corrupt count from allocating more than the data.
+                if (depth >= MaxDepth || count > _data.size() / 9)
+                {
+                    _failed = true;
+                    return;
+                }
+
+                if (tag == Tag::Array)
+                {
+                    value = Json::Value{ Json::arrayValue };
+                    for (uint32_t i = 0; i < count && !_failed; ++i)
+                    {
+                        Value(value.append(Json::Value{}), depth + 1);
+                    }
+                }
+                else
+                {
+                    value = Json::Value{ Json::objectValue };
+                    for (uint32_t i = 0; i < count && !_failed; ++i)
+                    {
+                        const auto name = String();
+                        if (!_failed)
+                        {
+                            Value(*value.demand(name.data(), name.data() + name.size()), depth + 1);
+                        }
+                    }
+                }
+                break;
+            }
+            default:
+                _failed = true;
+                return;
+            }
+
+            value.setOffsetStart(offsetStart);
+            value.setOffsetLimit(offsetLimit);
+        }
+
+    private:
+        bool _take(const size_t size) noexcept
+        {
+            if (_failed || _data.size() < size)
+            {
+                _failed = true;
+                return false;
+            }
+            _data.remove_prefix(size);
+            return true;
+        }
+
+        std::string_view _data;
+        bool _failed{ false };
+    };
+}
+
+// Function Description:
+// - Writes the given documents into a snapshot.
+// Arguments:
+// - documents: the documents to write. Their json must be set.
+// Return Value:
+// - The snapshot.
+std::string SettingsSnapshot::Serialize(const std::vector<Document>& documents)
+{
+    std::string data{ Magic };
+    Writer writer{ data };
+    writer.Number(FormatVersion);
+    writer.Number(uint64_t{ 0 });
+
+    writer.Number(static_cast<uint32_t>(documents.size()));
+    for (const auto& document : documents)
+    {
+        writer.Number(static_cast<uint8_t>(document.source));
+        writer.String(document.key.data(), document.key.data() + document.key.size());
+        writer.Number(document.size);
+        writer.Number(document.lastWriteTime);
+        writer.Value(*document.json);
+    }
+
+    const auto hash = checksum(std::string_view{ data }.substr(HeaderSize));
+    memcpy(data.data() + HeaderSize - sizeof(hash), &hash, sizeof(hash));
+    return data;
+}
+
+// Function Description:
+// - Reads the documents back from a snapshot.
+// Arguments:
+// - data: the snapshot, as written by Serialize.
+// Return Value:
+// - The documents, or nothing if the snapshot is of a different version of
+//   the format, or corrupt.
+std::optional<std::vector<SettingsSnapshot::Document>> SettingsSnapshot::Deserialize(const std::string_view& data)
+{
+    if (data.size() < HeaderSize || data.substr(0, Magic.size()) != Magic)
+    {
+        return std::nullopt;
+    }
+
+    Reader header{ data.substr(Magic.size(), HeaderSize - Magic.size()) };
+    const auto version = header.Number<uint32_t>();
+    const auto hash = header.Number<uint64_t>();
+    const auto body = data.substr(HeaderSize);
+    if (version != FormatVersion || hash != checksum(body))
+    {
+        return std::nullopt;
+    }
+
+    Reader reader{ body };
+    const auto count = reader.Number<uint32_t>();
+    std::vector<Document> documents;
+    for (uint32_t i = 0; i < count && !reader.Failed(); ++i)
+    {
+        auto& document = documents.emplace_back();
+        document.source = static_cast<Document::Source>(reader.Number<uint8_t>());
+        document.key = reader.String();
+        document.size = reader.Number<uint64_t>();
+        document.lastWriteTime = reader.Number<int64_t>();
+
+        auto json = std::make_shared<Json::Value>();
+        reader.Value(*json, 0);
+        document.json = std::move(json);
+
+        if (document.source != Document::Source::Content && document.source != Document::Source::File)
+        {
+            return std::nullopt;
+        }
+    }
+
+    if (reader.Failed() || !reader.AtEnd())
+    {
+        return std::nullopt;
+    }
+    return documents;
+}
@@ -0,0 +1,56 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+/*++
+Module Name:
+- SettingsSnapshot.h
+
+Abstract:
+- The JSON documents the settings were last loaded from, parsed, in a binary
+  form that's read back much faster than the JSON text can be parsed. On a
+  cold start, CascadiaSettings::LoadAll maps the snapshot file into memory,
+  and only parses the documents whose content changed since it was written.
+- A document is either given as a string (defaults.json and settings.json),
+  and then found by its content, or read from a file (fragments), and then
+  found by its path, size and last write time.
+- The snapshot starts with a magic number, the version of the format and a
+  checksum of the rest. If any of those don't match, or the data ends early,
+  it's thrown away as a whole and the documents are parsed from scratch.
+  Change FormatVersion whenever the layout changes.
+- Values keep the offsets they were parsed at, which the settings loader
+  uses to point at the line of an invalid setting. Comments are dropped.
+- This only depends on the standard library and jsoncpp, so that it can be
+  tested on its own.
+--*/
+
+#pragma once
+
+namespace Microsoft::Terminal::Settings::Model
+{
+    class SettingsSnapshot final
+    {
+    public:
+        static constexpr uint32_t FormatVersion = 1;
+
+        // A parsed document, and what it was parsed from.
+        struct Document
+        {
+            enum class Source : uint8_t
+            {
+                Content,
+                File
+            };
+
+            Source source{ Source::Content };
+            // The content of the document, or the UTF-8 path of its file.
+            std::string key;
+            // The size and last write time of the file. Unused for content.
+            uint64_t size{ 0 };
+            int64_t lastWriteTime{ 0 };
+            std::shared_ptr<const Json::Value> json;
+        };
+
+        static std::string Serialize(const std::vector<Document>& documents);
+        static std::optional<std::vector<Document>> Deserialize(const std::string_view& data);
+    };
+}
@@ -262,6 +262,8 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
 
         _Commandline = profile.Commandline();
         _VtPassthrough = profile.VtPassthrough();
+        _SpillScrollbackToDisk = profile.SpillScrollbackToDisk();
+        _SessionRecordingDirectory = profile.SessionRecordingDirectory();
 
         _StartingDirectory = profile.EvaluatedStartingDirectory();
 
@@ -95,6 +95,7 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
         INHERITABLE_SETTING(Model::TerminalSettings, bool, TrimBlockSelection, true);
         INHERITABLE_SETTING(Model::TerminalSettings, bool, DetectURLs, true);
         INHERITABLE_SETTING(Model::TerminalSettings, bool, VtPassthrough, false);
+        INHERITABLE_SETTING(Model::TerminalSettings, bool, SpillScrollbackToDisk, false);
 
         INHERITABLE_SETTING(Model::TerminalSettings, Windows::Foundation::IReference<Microsoft::Terminal::Core::Color>, TabColor, nullptr);
 
@@ -143,6 +144,7 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
         INHERITABLE_SETTING(Model::TerminalSettings, hstring, StartingTitle);
         INHERITABLE_SETTING(Model::TerminalSettings, bool, SuppressApplicationTitle);
         INHERITABLE_SETTING(Model::TerminalSettings, hstring, EnvironmentVariables);
+        INHERITABLE_SETTING(Model::TerminalSettings, hstring, SessionRecordingDirectory);
 
         INHERITABLE_SETTING(Model::TerminalSettings, Microsoft::Terminal::Control::ScrollbarState, ScrollState, Microsoft::Terminal::Control::ScrollbarState::Visible);
         INHERITABLE_SETTING(Model::TerminalSettings, bool, UseAtlasEngine, false);
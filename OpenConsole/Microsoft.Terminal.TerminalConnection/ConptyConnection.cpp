@@ -14,6 +14,10 @@
 #include "../../types/inc/Environment.hpp"
 #include "LibraryResources.h"
 
+#if defined(_M_X64) || defined(_M_IX86)
+#include <emmintrin.h>
+#endif
+
 using namespace ::Microsoft::Console;
 using namespace std::string_view_literals;
 
@@ -38,14 +42,20 @@ static constexpr auto _errorFormat = L"{0} ({0:#010x})"sv;
 namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
 {
     // Function Description:
-    // - creates some basic anonymous pipes and passes them to CreatePseudoConsole
+    // - creates the pipes and passes them to CreatePseudoConsole. The input pipe
+    //   is an anonymous pipe. The output pipe is a named pipe whose end we read
+    //   from is opened for overlapped I/O, so that the output thread can wait
+    //   for output with a timeout. The pipe only takes a single instance, which
+    //   the pseudoconsole's end connects to right away.
     // Arguments:
     // - size: The size of the conpty to create, in characters.
+    // - outputPipeSize: The size of the output pipe's buffer, in bytes. A read
+    //   can't return more than this, so it should match our read buffer.
     // - phInput: Receives the handle to the newly-created anonymous pipe for writing input to the conpty.
     // - phOutput: Receives the handle to the newly-created anonymous pipe for reading the output of the conpty.
     // - phPc: Receives a token value to identify this conpty
 #pragma warning(suppress : 26430) // This statement sufficiently checks the out parameters. Analyzer cannot find this.
-    static HRESULT _CreatePseudoConsoleAndPipes(const COORD size, const DWORD dwFlags, HANDLE* phInput, HANDLE* phOutput, HPCON* phPC) noexcept
+    static HRESULT _CreatePseudoConsoleAndPipes(const COORD size, const DWORD dwFlags, const DWORD outputPipeSize, HANDLE* phInput, HANDLE* phOutput, HPCON* phPC) noexcept
     {
         RETURN_HR_IF(E_INVALIDARG, phPC == nullptr || phInput == nullptr || phOutput == nullptr);
 
@@ -53,7 +63,23 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
         wil::unique_hfile inPipeOurSide, inPipePseudoConsoleSide;
 
         RETURN_IF_WIN32_BOOL_FALSE(CreatePipe(&inPipePseudoConsoleSide, &inPipeOurSide, nullptr, 0));
-        RETURN_IF_WIN32_BOOL_FALSE(CreatePipe(&outPipeOurSide, &outPipePseudoConsoleSide, nullptr, 0));
+
+        static std::atomic<DWORD> outputPipeSerial{ 0 };
+        wchar_t outputPipeName[MAX_PATH];
+        RETURN_HR_IF(E_UNEXPECTED, swprintf_s(&outputPipeName[0], ARRAYSIZE(outputPipeName), L"\\\\.\\pipe\\Local\\WindowsTerminal.ConptyOutput.%lu.%lu", GetCurrentProcessId(), outputPipeSerial.fetch_add(1)) < 0);
+
+        outPipeOurSide.reset(CreateNamedPipeW(&outputPipeName[0],
+                                              PIPE_ACCESS_INBOUND | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE,
+                                              PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+                                              1,
+                                              0,
+                                              outputPipeSize,
+                                              0,
+                                              nullptr));
+        RETURN_LAST_ERROR_IF(!outPipeOurSide);
+        outPipePseudoConsoleSide.reset(CreateFileW(&outputPipeName[0], GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, 0, nullptr));
+        RETURN_LAST_ERROR_IF(!outPipePseudoConsoleSide);
+
         RETURN_IF_FAILED(ConptyCreatePseudoConsole(size, inPipePseudoConsoleSide.get(), outPipePseudoConsoleSide.get(), dwFlags, phPC));
         *phInput = inPipeOurSide.release();
         *phOutput = outPipeOurSide.release();
@@ -228,7 +254,8 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
                                                                                 const Windows::Foundation::Collections::IMapView<hstring, hstring>& environment,
                                                                                 uint32_t rows,
                                                                                 uint32_t columns,
-                                                                                const winrt::guid& guid)
+                                                                                const winrt::guid& guid,
+                                                                                uint32_t outputCoalescingWindow)
     {
         Windows::Foundation::Collections::ValueSet vs{};
 
@@ -238,6 +265,7 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
         vs.Insert(L"initialRows", Windows::Foundation::PropertyValue::CreateUInt32(rows));
         vs.Insert(L"initialCols", Windows::Foundation::PropertyValue::CreateUInt32(columns));
         vs.Insert(L"guid", Windows::Foundation::PropertyValue::CreateGuid(guid));
+        vs.Insert(L"outputCoalescingWindow", Windows::Foundation::PropertyValue::CreateUInt32(outputCoalescingWindow));
 
         if (environment)
         {
@@ -266,6 +294,10 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
             _initialCols = winrt::unbox_value_or<uint32_t>(settings.TryLookup(L"initialCols").try_as<Windows::Foundation::IPropertyValue>(), _initialCols);
             _guid = winrt::unbox_value_or<winrt::guid>(settings.TryLookup(L"guid").try_as<Windows::Foundation::IPropertyValue>(), _guid);
             _environment = settings.TryLookup(L"environment").try_as<Windows::Foundation::Collections::ValueSet>();
+            // "outputBufferSize" isn't set by CreateSettings. Hosts that
+            // want to tune it can add it to the ValueSet themselves.
+            _outputBufferSize = winrt::unbox_value_or<uint32_t>(settings.TryLookup(L"outputBufferSize").try_as<Windows::Foundation::IPropertyValue>(), _outputBufferSize);
+            _outputCoalescingWindow = std::chrono::milliseconds{ winrt::unbox_value_or<uint32_t>(settings.TryLookup(L"outputCoalescingWindow").try_as<Windows::Foundation::IPropertyValue>(), gsl::narrow_cast<uint32_t>(_outputCoalescingWindow.count())) };
             /*if constexpr (Feature_VtPassthroughMode::IsEnabled())
             {
                 _passthroughMode = winrt::unbox_value_or<bool>(settings.TryLookup(L"passthroughMode").try_as<Windows::Foundation::IPropertyValue>(), _passthroughMode);
@@ -309,7 +341,8 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
                 }
             }*/
 
-            THROW_IF_FAILED(_CreatePseudoConsoleAndPipes(dimensions, flags, &_inPipe, &_outPipe, &_hPC));
+            THROW_IF_FAILED(_CreatePseudoConsoleAndPipes(dimensions, flags, _outputBufferSize, &_inPipe, &_outPipe, &_hPC));
+            _outPipeOverlapped = true;
 
             // NOTE: For some reason this works with regular WindowsTerminal but torches the conpty connection here.
             // Given that it's an internal API there's no documentation so... no idea why.
@@ -381,6 +414,27 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
 
         LOG_IF_FAILED(SetThreadDescription(_hOutputThread.get(), L"ConptyConnection Output Thread"));
 
+        // Writing input can block for as long as the client doesn't read
+        // it, so we do that on a thread of its own as well.
+        _hInputThread.reset(CreateThread(
+            nullptr,
+            0,
+            [](LPVOID lpParameter) noexcept {
+                const auto pInstance = static_cast<ConptyConnection*>(lpParameter);
+                if (pInstance)
+                {
+                    return pInstance->_InputThread();
+                }
+                return gsl::narrow_cast<DWORD>(E_INVALIDARG);
+            },
+            this,
+            0,
+            nullptr));
+
+        THROW_LAST_ERROR_IF_NULL(_hInputThread);
+
+        LOG_IF_FAILED(SetThreadDescription(_hInputThread.get(), L"ConptyConnection Input Thread"));
+
         _clientExitWait.reset(CreateThreadpoolWait(
             [](PTP_CALLBACK_INSTANCE /*callbackInstance*/, PVOID context, PTP_WAIT /*wait*/, TP_WAIT_RESULT /*waitResult*/) noexcept {
                 const auto pInstance = static_cast<ConptyConnection*>(context);
@@ -478,10 +532,128 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
             return;
         }
 
-        // convert from UTF-16LE to UTF-8 as ConPty expects UTF-8
-        // TODO GH#3378 reconcile and unify UTF-8 converters
-        auto str = winrt::to_string(data);
-        LOG_IF_WIN32_BOOL_FALSE(WriteFile(_inPipe.get(), str.c_str(), (DWORD)str.length(), nullptr, nullptr));
+        // Queue the input up for the input thread. Everything that's queued
+        // by the time it gets around to it is written in a single go.
+        {
+            const auto lock = _inputLock.lock_exclusive();
+            _inputQueue.append(data);
+        }
+        _inputAvailable.SetEvent();
+    }
+
+    // Method Description:
+    // - The body of the input thread. Waits for WriteInput to queue up input,
+    //   converts all of it to UTF-8 at once and writes it to the input pipe.
+    // - Both the UTF-16 and the UTF-8 string are reused, so once they've
+    //   grown large enough, writing input doesn't allocate anymore.
+    // Return Value:
+    // - 0 once _stopInputThread asks us to exit.
+    DWORD ConptyConnection::_InputThread() noexcept
+    {
+        while (true)
+        {
+            _inputAvailable.wait();
+
+            {
+                const auto lock = _inputLock.lock_exclusive();
+                if (_inputThreadExit.load(std::memory_order_relaxed))
+                {
+                    return 0;
+                }
+                // _inputPending was cleared after its last write, so this
+                // leaves WriteInput with an empty queue that still has its storage.
+                _inputQueue.swap(_inputPending);
+                _inputInFlight = _inputPending.size();
+            }
+
+            if (_inputPending.empty())
+            {
+                continue;
+            }
+
+            // convert from UTF-16LE to UTF-8 as ConPty expects UTF-8
+            // TODO GH#3378 reconcile and unify UTF-8 converters
+            const auto hr = til::u16u8(_inputPending, _inputScratch);
+            _inputPending.clear();
+            if (FAILED(hr))
+            {
+                LOG_HR(hr);
+                continue;
+            }
+
+            std::string_view remaining{ _inputScratch };
+            while (!remaining.empty() && !_inputThreadExit.load(std::memory_order_relaxed))
+            {
+                DWORD written{};
+                if (!WriteFile(_inPipe.get(), remaining.data(), gsl::narrow_cast<DWORD>(remaining.size()), &written, nullptr))
+                {
+                    LOG_LAST_ERROR();
+                    break;
+                }
+                remaining.remove_prefix(written);
+            }
+
+            {
+                const auto lock = _inputLock.lock_exclusive();
+                _inputInFlight = 0;
+            }
+            _inputWritten.SetEvent();
+        }
+    }
+
+    // Method Description:
+    // - Lets callers that write a lot of input, like a long paste, wait for
+    //   the client to catch up, instead of queueing up all of it at once.
+    // Arguments:
+    // - maxPendingSize: the number of characters that may still be waiting to
+    //   be written to the client.
+    // - timeoutMilliseconds: how long to wait for the input to drain.
+    // Return Value:
+    // - true if no more than maxPendingSize characters are still waiting.
+    bool ConptyConnection::WaitForPendingInput(const uint64_t maxPendingSize, const uint32_t timeoutMilliseconds)
+    {
+        const auto pendingSize = [&]() {
+            const auto lock = _inputLock.lock_shared();
+            return _inputQueue.size() + _inputInFlight;
+        };
+
+        if (pendingSize() <= maxPendingSize)
+        {
+            return true;
+        }
+        _inputWritten.wait(timeoutMilliseconds);
+        return pendingSize() <= maxPendingSize;
+    }
+
+    // Method Description:
+    // - Makes the input thread exit and waits for it to do so. Any input it
+    //   hasn't written yet is dropped.
+    void ConptyConnection::_stopInputThread() noexcept
+    {
+        if (auto localInputThreadHandle = std::move(_hInputThread))
+        {
+            {
+                const auto lock = _inputLock.lock_exclusive();
+                _inputThreadExit.store(true, std::memory_order_relaxed);
+            }
+            _inputAvailable.SetEvent();
+
+            // The input thread may be stuck in a WriteFile, if the client
+            // stopped reading its input. Keep cancelling that until the
+            // thread is gone, in case it only just entered another one.
+            while (WaitForSingleObject(localInputThreadHandle.get(), 10) == WAIT_TIMEOUT)
+            {
+                CancelSynchronousIo(localInputThreadHandle.get());
+            }
+
+            // Don't leave anyone waiting for that input to be written.
+            {
+                const auto lock = _inputLock.lock_exclusive();
+                _inputQueue.clear();
+                _inputInFlight = 0;
+            }
+            _inputWritten.SetEvent();
+        }
     }
 
     void ConptyConnection::Resize(uint32_t rows, uint32_t columns)
@@ -549,7 +721,10 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
 
             _hPC.reset(); // tear down the pseudoconsole (this is like clicking X on a console window)
 
+            _stopInputThread(); // the input thread must be done with _inPipe before we close it
+
             _inPipe.reset(); // break the pipes
+            CancelIoEx(_outPipe.get(), nullptr); // complete the output thread's pending read, if there is one
             _outPipe.reset();
 
             if (_hOutputThread)
@@ -610,38 +785,73 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
         // won't wait for us, and the known exit points _do_.
         auto strongThis{ get_strong() };
 
+        // Decides how much to read at a time, and which reads to pass on together.
+        ::Microsoft::Terminal::TerminalConnection::OutputBatcher batcher{ _outputBufferSize, _outputCoalescingWindow };
+
         // process the data of the output pipe in a loop
         while (true)
         {
-            DWORD read{};
-
-            const auto readFail{ !ReadFile(_outPipe.get(), _buffer.data(), gsl::narrow_cast<DWORD>(_buffer.size()), &read, nullptr) };
-            if (readFail) // reading failed (we must check this first, because read will also be 0.)
+            _u16Str.clear();
+            batcher.BeginBatch();
+
+            // Read until we've got a batch of output to pass on. That's a
+            // single read, unless there's more output already waiting for us.
+            // The first read of a batch waits for as long as it takes.
+            DWORD timeout = INFINITE;
+            while (true)
             {
-                const auto lastError = GetLastError();
-                if (lastError != ERROR_BROKEN_PIPE && !_isStateAtOrBeyond(ConnectionState::Closing))
+                DWORD read{};
+
+                const auto lastError = _readOutput(batcher.ReadSize(), timeout, read);
+                if (lastError == WAIT_TIMEOUT)
+                {
+                    // The read stays pending, and the next batch starts with it.
+                    break;
+                }
+                if (lastError != ERROR_SUCCESS) // reading failed (we must check this first, because read will also be 0.)
+                {
+                    if (lastError != ERROR_BROKEN_PIPE && !_isStateAtOrBeyond(ConnectionState::Closing))
+                    {
+                        // EXIT POINT
+                        _indicateExitWithStatus(HRESULT_FROM_WIN32(lastError)); // print a message
+                        _transitionToState(ConnectionState::Failed);
+                        return gsl::narrow_cast<DWORD>(HRESULT_FROM_WIN32(lastError));
+                    }
+                    // else we call convertUTF8ChunkToUTF16 with an empty string_view to convert possible remaining partials to U+FFFD
+                }
+
+                const auto result{ _decodeOutput(std::string_view{ _buffer.data(), read }) };
+                if (FAILED(result))
                 {
+                    if (_isStateAtOrBeyond(ConnectionState::Closing))
+                    {
+                        // This termination was expected.
+                        return 0;
+                    }
+
                     // EXIT POINT
-                    _indicateExitWithStatus(HRESULT_FROM_WIN32(lastError)); // print a message
+                    _indicateExitWithStatus(result); // print a message
                     _transitionToState(ConnectionState::Failed);
-                    return gsl::narrow_cast<DWORD>(HRESULT_FROM_WIN32(lastError));
+                    return gsl::narrow_cast<DWORD>(result);
                 }
-                // else we call convertUTF8ChunkToUTF16 with an empty string_view to convert possible remaining partials to U+FFFD
-            }
 
-            const auto result{ til::u8u16(std::string_view{ _buffer.data(), read }, _u16Str, _u8State) };
-            if (FAILED(result))
-            {
-                if (_isStateAtOrBeyond(ConnectionState::Closing))
+                if (read == 0)
                 {
-                    // This termination was expected.
-                    return 0;
+                    break;
                 }
 
-                // EXIT POINT
-                _indicateExitWithStatus(result); // print a message
-                _transitionToState(ConnectionState::Failed);
-                return gsl::narrow_cast<DWORD>(result);
+                batcher.Read(read);
+                if (_u16Str.empty())
+                {
+                    // The read ended in the middle of a character. There's
+                    // nothing to pass on yet, so wait for the rest of it.
+                    continue;
+                }
+                if (!batcher.MayCoalesce())
+                {
+                    break;
+                }
+                timeout = gsl::narrow_cast<DWORD>(std::chrono::ceil<std::chrono::milliseconds>(batcher.Patience()).count());
             }
 
             if (_u16Str.empty())
@@ -672,6 +882,150 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
         return 0;
     }
 
+    // Method Description:
+    // - Reads output from the pipe into _buffer.
+    // - If we created the pipe, it's opened for overlapped I/O. A read is
+    //   started unless the last one is still pending, and waited for for at
+    //   most `timeout`. A read that times out stays pending, and the next call
+    //   picks it up. _buffer mustn't be touched while it is.
+    // - A pipe we were handed off was opened by someone else, for synchronous
+    //   I/O. Reading from it can't time out, so unless the timeout is
+    //   INFINITE, it's only read if there's output waiting in it already.
+    // Arguments:
+    // - size: how much to read at most, if a read is started.
+    // - timeout: how long to wait for the read, in milliseconds, or INFINITE.
+    //   It's zero unless the client is flooding us. See OutputBatcher.
+    // - read: receives the number of bytes read.
+    // Return Value:
+    // - ERROR_SUCCESS once the read completed, WAIT_TIMEOUT if it didn't in
+    //   time, or the error the read failed with.
+    DWORD ConptyConnection::_readOutput(const DWORD size, const DWORD timeout, DWORD& read)
+    {
+        read = 0;
+
+        if (!_outputReadPending && _buffer.size() < size)
+        {
+            _buffer.resize(size);
+        }
+
+        if (!_outPipeOverlapped)
+        {
+            if (timeout != INFINITE)
+            {
+                DWORD available{};
+                if (!PeekNamedPipe(_outPipe.get(), nullptr, 0, nullptr, &available, nullptr) || available == 0)
+                {
+                    return WAIT_TIMEOUT;
+                }
+            }
+            return ReadFile(_outPipe.get(), _buffer.data(), size, &read, nullptr) ? ERROR_SUCCESS : GetLastError();
+        }
+
+        if (!_outputReadPending)
+        {
+            _outputRead = {};
+            _outputRead.hEvent = _outputReadEvent.get();
+            // Even if the read completes right away, it still signals the event.
+            if (!ReadFile(_outPipe.get(), _buffer.data(), size, nullptr, &_outputRead))
+            {
+                const auto lastError = GetLastError();
+                if (lastError != ERROR_IO_PENDING)
+                {
+                    return lastError;
+                }
+            }
+            _outputReadPending = true;
+        }
+
+        switch (WaitForSingleObject(_outputReadEvent.get(), timeout))
+        {
+        case WAIT_OBJECT_0:
+            break;
+        case WAIT_TIMEOUT:
+            return WAIT_TIMEOUT;
+        default:
+        {
+            // The output thread is about to give up. It mustn't leave behind
+            // a read that's still writing into _buffer.
+            const auto lastError = GetLastError();
+            CancelIoEx(_outPipe.get(), &_outputRead);
+            GetOverlappedResult(_outPipe.get(), &_outputRead, &read, TRUE);
+            _outputReadPending = false;
+            read = 0;
+            return lastError;
+        }
+        }
+
+        _outputReadPending = false;
+        return GetOverlappedResult(_outPipe.get(), &_outputRead, &read, FALSE) ? ERROR_SUCCESS : GetLastError();
+    }
+
+    // Function Description:
+    // - Appends the run of 7-bit ASCII at the start of `in` to `out`, widening
+    //   each byte to a wchar_t.
+    // Return Value:
+    // - The length of the run.
+    static size_t _widenAsciiPrefix(const std::string_view in, std::wstring& out)
+    {
+        const auto offset = out.size();
+        out.resize(offset + in.size());
+
+        const auto src = reinterpret_cast<const uint8_t*>(in.data());
+        const auto dst = out.data() + offset;
+        size_t i = 0;
+
+#if defined(_M_X64) || defined(_M_IX86)
+        const auto zero = _mm_setzero_si128();
+        for (; i + 16 <= in.size(); i += 16)
+        {
+            const auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            if (_mm_movemask_epi8(bytes) != 0)
+            {
+                break;
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_unpacklo_epi8(bytes, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 8), _mm_unpackhi_epi8(bytes, zero));
+        }
+#endif
+
+        for (; i < in.size() && src[i] < 0x80; ++i)
+        {
+            dst[i] = src[i];
+        }
+
+        out.resize(offset + i);
+        return i;
+    }
+
+    // Method Description:
+    // - Converts a chunk of output from UTF-8 and appends it to _u16Str.
+    // - Output is mostly 7-bit ASCII, which we simply widen. Only the part of
+    //   the chunk from the first non-ASCII byte on goes through the UTF-8
+    //   converter. Both strings are reused, so this doesn't allocate once
+    //   they've grown large enough.
+    // Arguments:
+    // - chunk: The output we read. Empty if the pipe was closed, which
+    //   flushes any incomplete UTF-8 sequence as U+FFFD.
+    // Return Value:
+    // - S_OK, or the error returned by the converter.
+    HRESULT ConptyConnection::_decodeOutput(const std::string_view chunk)
+    {
+        // If the previous chunk ended in the middle of a UTF-8 sequence,
+        // only the converter knows how to finish it.
+        const auto ascii = _u8Pending ? 0 : _widenAsciiPrefix(chunk, _u16Str);
+
+        if (ascii < chunk.size() || chunk.empty())
+        {
+            RETURN_IF_FAILED(til::u8u16(chunk.substr(ascii), _u16Tail, _u8State));
+            _u16Str.append(_u16Tail);
+        }
+
+        // If the chunk ended with an ASCII character, the converter can't be
+        // holding on to an incomplete sequence.
+        _u8Pending = !chunk.empty() && static_cast<uint8_t>(chunk.back()) >= 0x80;
+        return S_OK;
+    }
+
     static winrt::event<NewConnectionHandler> _newConnectionHandlers;
 
     winrt::event_token ConptyConnection::NewConnection(const NewConnectionHandler& handler) { return _newConnectionHandlers.add(handler); };
@@ -712,6 +1066,7 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
     winrt::fire_and_forget ConptyConnection::final_release(std::unique_ptr<ConptyConnection> connection)
     {
         co_await winrt::resume_background(); // move to background
+        connection->_stopInputThread(); // in case we were never closed
         connection.reset(); // explicitly destruct
     }
 
@@ -5,6 +5,7 @@
 
 #include "ConptyConnection.g.h"
 #include "ConnectionStateHolder.h"
+#include "OutputBatcher.h"
 
 #include <conpty-static.h>
 
@@ -18,6 +19,10 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
 {
     struct ConptyConnection : ConptyConnectionT<ConptyConnection>, ConnectionStateHolder<ConptyConnection>
     {
+        // The largest read of the output of the pseudoconsole, unless
+        // overridden by the "outputBufferSize" setting. See OutputBatcher.
+        static constexpr uint32_t DefaultOutputBufferSize{ 64 * 1024 };
+
         ConptyConnection(const HANDLE hSig,
                          const HANDLE hIn,
                          const HANDLE hOut,
@@ -40,6 +45,8 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
 
         void ReparentWindow(const uint64_t newParent);
 
+        bool WaitForPendingInput(const uint64_t maxPendingSize, const uint32_t timeoutMilliseconds);
+
         winrt::guid Guid() const noexcept;
         winrt::hstring Commandline() const;
 
@@ -55,7 +62,8 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
                                                                          const Windows::Foundation::Collections::IMapView<hstring, hstring>& environment,
                                                                          uint32_t rows,
                                                                          uint32_t columns,
-                                                                         const winrt::guid& guid);
+                                                                         const winrt::guid& guid,
+                                                                         uint32_t outputCoalescingWindow);
 
         WINRT_CALLBACK(TerminalOutput, TerminalOutputHandler);
 
@@ -84,16 +92,42 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
         wil::unique_hfile _inPipe; // The pipe for writing input to
         wil::unique_hfile _outPipe; // The pipe for reading output from
         wil::unique_handle _hOutputThread;
+        wil::unique_handle _hInputThread;
         wil::unique_process_information _piClient;
         wil::unique_static_pseudoconsole_handle _hPC;
         wil::unique_threadpool_wait _clientExitWait;
 
         til::u8state _u8State{};
         std::wstring _u16Str{};
-        std::array<char, 4096> _buffer{};
+        std::wstring _u16Tail{};
+        std::vector<char> _buffer{};
+        // Whether _outPipe was opened for overlapped I/O, which it is unless
+        // it was handed off to us. See _readOutput.
+        bool _outPipeOverlapped{ false };
+        OVERLAPPED _outputRead{};
+        wil::unique_event _outputReadEvent{ wil::EventOptions::ManualReset };
+        bool _outputReadPending{ false };
+        uint32_t _outputBufferSize{ DefaultOutputBufferSize };
+        std::chrono::milliseconds _outputCoalescingWindow{ ::Microsoft::Terminal::TerminalConnection::OutputBatcher::DefaultCoalescingWindow };
+        bool _u8Pending{ false };
         bool _passthroughMode{};
 
+        // Input queued up by WriteInput for the input thread.
+        wil::srwlock _inputLock;
+        wil::slim_event_auto_reset _inputAvailable;
+        wil::slim_event_auto_reset _inputWritten;
+        std::wstring _inputQueue{};
+        size_t _inputInFlight{ 0 };
+        std::atomic<bool> _inputThreadExit{ false };
+        // Owned by the input thread.
+        std::wstring _inputPending{};
+        std::string _inputScratch{};
+
         DWORD _OutputThread();
+        DWORD _InputThread() noexcept;
+        void _stopInputThread() noexcept;
+        HRESULT _decodeOutput(const std::string_view chunk);
+        DWORD _readOutput(const DWORD size, const DWORD timeout, DWORD& read);
     };
 }
 
@@ -0,0 +1,84 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "pch.h"
+#include "OutputBatcher.h"
+
+using namespace Microsoft::Terminal::TerminalConnection;
+
+// The read size is halved after this many reads in a row that filled less
+// than a quarter of it.
+static constexpr uint32_t SmallReadsToShrink{ 8 };
+
+// Arguments:
+// - maxReadSize: the largest read size to grow to. It's clamped to
+//   [MinReadSize, MaxReadSize].
+// - coalescingWindow: for how long the reads of a batch may be coalesced.
+//   It's clamped to MaxCoalescingWindow. Zero passes on every read by itself.
+OutputBatcher::OutputBatcher(const uint32_t maxReadSize, const std::chrono::milliseconds coalescingWindow) noexcept :
+    _maxReadSize{ std::clamp(maxReadSize, MinReadSize, MaxReadSize) },
+    _coalescingWindow{ std::clamp(coalescingWindow, std::chrono::milliseconds::zero(), MaxCoalescingWindow) }
+{
+}
+
+// Method Description:
+// - Returns how much the next read should ask for.
+uint32_t OutputBatcher::ReadSize() const noexcept
+{
+    return _readSize;
+}
+
+// Method Description:
+// - Starts a new batch of output, before its first read.
+void OutputBatcher::BeginBatch() noexcept
+{
+    _batchStart = std::chrono::steady_clock::now();
+    _batchSize = 0;
+}
+
+// Method Description:
+// - Adds the given read to the batch, and adjusts the read size to it.
+// Arguments:
+// - read: how much the read returned.
+void OutputBatcher::Read(const uint32_t read) noexcept
+{
+    _batchSize += read;
+    _sustained = read >= _readSize && _readSize > MinReadSize;
+
+    // Grow the read size while the client keeps us busy, and shrink it back
+    // once it has calmed down.
+    if (read >= _readSize && _readSize < _maxReadSize)
+    {
+        _readSize = std::min(_readSize * 2, _maxReadSize);
+        _smallReads = 0;
+    }
+    else if (read < _readSize / 4 && _readSize > MinReadSize && ++_smallReads >= SmallReadsToShrink)
+    {
+        _readSize /= 2;
+        _smallReads = 0;
+    }
+}
+
+// Method Description:
+// - Returns whether the batch may take another read, if there's output
+//   waiting for one already. The caller checks that last, since it's the
+//   only check that costs a system call.
+bool OutputBatcher::MayCoalesce() const noexcept
+{
+    return _coalescingWindow != std::chrono::milliseconds::zero() &&
+           _batchSize < MaxBatchSize &&
+           std::chrono::steady_clock::now() - _batchStart < _coalescingWindow;
+}
+
+// Method Description:
+// - Returns how long to wait for more output to arrive, if there's none
+//   waiting and MayCoalesce returned true: the rest of the window under
+//   sustained load, and no time at all otherwise.
+std::chrono::steady_clock::duration OutputBatcher::Patience() const noexcept
+{
+    if (!_sustained)
+    {
+        return {};
+    }
+    return std::max(_batchStart + _coalescingWindow - std::chrono::steady_clock::now(), std::chrono::steady_clock::duration::zero());
+}
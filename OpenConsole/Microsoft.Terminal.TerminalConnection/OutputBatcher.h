@@ -0,0 +1,55 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+/*++
+Module Name:
+- OutputBatcher.h
+
+Abstract:
+- Decides how much the output thread of a connection reads at a time, and
+  how many reads it passes on in a single TerminalOutput event.
+- Reads start out small. The read size doubles while reads keep filling it,
+  up to a maximum, and halves again after a run of small reads.
+- The reads of a coalescing window are passed on together, as long as more
+  output is waiting already. Under sustained load, when reads keep filling
+  the growing read size, the connection also waits for more output for the
+  rest of the window. After any other read, it doesn't wait at all, so the
+  echo of a single keystroke is still passed on at once.
+- This only depends on the standard library, so that it can be tested on
+  its own, with a local pipe.
+--*/
+
+#pragma once
+
+namespace Microsoft::Terminal::TerminalConnection
+{
+    class OutputBatcher final
+    {
+    public:
+        static constexpr uint32_t MinReadSize{ 4 * 1024 };
+        static constexpr uint32_t MaxReadSize{ 1024 * 1024 };
+        static constexpr std::chrono::milliseconds DefaultCoalescingWindow{ 8 };
+        static constexpr std::chrono::milliseconds MaxCoalescingWindow{ 100 };
+        // A batch is passed on once it's this large, whatever the window.
+        static constexpr size_t MaxBatchSize{ 4 * MaxReadSize };
+
+        OutputBatcher(const uint32_t maxReadSize, const std::chrono::milliseconds coalescingWindow) noexcept;
+
+        uint32_t ReadSize() const noexcept;
+        void BeginBatch() noexcept;
+        void Read(const uint32_t read) noexcept;
+        bool MayCoalesce() const noexcept;
+        std::chrono::steady_clock::duration Patience() const noexcept;
+
+    private:
+        uint32_t _maxReadSize;
+        std::chrono::milliseconds _coalescingWindow;
+        uint32_t _readSize{ MinReadSize };
+        // The number of reads in a row that were much smaller than _readSize.
+        uint32_t _smallReads{ 0 };
+        // Whether the last read filled a read size that had grown already.
+        bool _sustained{ false };
+        std::chrono::steady_clock::time_point _batchStart{};
+        size_t _batchSize{ 0 };
+    };
+}
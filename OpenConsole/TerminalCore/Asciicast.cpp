@@ -0,0 +1,451 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "pch.h"
+#include "Asciicast.hpp"
+
+#include <charconv>
+#include <cmath>
+
+using namespace Microsoft::Terminal::Core;
+
+static constexpr wchar_t _replacementCharacter = 0xFFFD;
+
+static constexpr bool _isSurrogate(const wchar_t ch) noexcept
+{
+    return ch >= 0xD800 && ch <= 0xDFFF;
+}
+
+static constexpr bool _isHighSurrogate(const wchar_t ch) noexcept
+{
+    return ch >= 0xD800 && ch <= 0xDBFF;
+}
+
+static constexpr bool _isLowSurrogate(const wchar_t ch) noexcept
+{
+    return ch >= 0xDC00 && ch <= 0xDFFF;
+}
+
+// Parses one of the dimensions of a resize event.
+static std::optional<int> _parseDimension(const std::wstring_view text) noexcept
+{
+    int value = 0;
+    for (const auto ch : text)
+    {
+        if (ch < L'0' || ch > L'9' || value > SHRT_MAX / 10)
+        {
+            return std::nullopt;
+        }
+        value = value * 10 + static_cast<int>(ch - L'0');
+    }
+
+    if (value <= 0 || value > SHRT_MAX)
+    {
+        return std::nullopt;
+    }
+    return value;
+}
+
+// Method Description:
+// - Appends the header of a recording.
+// Arguments:
+// - width, height: the size of the terminal, in characters
+// - timestamp: when the recording started, in seconds since the Unix epoch
+void Asciicast::AppendHeader(std::string& out, const int width, const int height, const int64_t timestamp)
+{
+    out.append(R"({"version": 2, "width": )");
+    out.append(std::to_string(width));
+    out.append(R"(, "height": )");
+    out.append(std::to_string(height));
+    out.append(R"(, "timestamp": )");
+    out.append(std::to_string(timestamp));
+    out.append("}\n");
+}
+
+// Method Description:
+// - Appends an output event.
+// Arguments:
+// - time: the time since the start of the recording
+// - text: the output, exactly as the connection handed it to us
+void Asciicast::AppendOutput(std::string& out, const std::chrono::duration<double> time, const std::wstring_view text)
+{
+    out.push_back('[');
+    _appendTime(out, time);
+    out.append(R"(, "o", )");
+    _appendString(out, text);
+    out.append("]\n");
+}
+
+// Method Description:
+// - Appends a resize event.
+// Arguments:
+// - time: the time since the start of the recording
+// - width, height: the new size of the terminal, in characters
+void Asciicast::AppendResize(std::string& out, const std::chrono::duration<double> time, const int width, const int height)
+{
+    out.push_back('[');
+    _appendTime(out, time);
+    out.append(R"(, "r", ")");
+    out.append(std::to_string(width));
+    out.push_back('x');
+    out.append(std::to_string(height));
+    out.append("\"]\n");
+}
+
+std::optional<std::pair<int, int>> Asciicast::ParseSize(const std::wstring_view text) noexcept
+{
+    const auto separator = text.find(L'x');
+    if (separator == std::wstring_view::npos)
+    {
+        return std::nullopt;
+    }
+
+    const auto width = _parseDimension(text.substr(0, separator));
+    const auto height = _parseDimension(text.substr(separator + 1));
+    if (!width || !height)
+    {
+        return std::nullopt;
+    }
+    return std::pair{ *width, *height };
+}
+
+// Appends the time in seconds with microsecond precision. Unlike printf,
+// to_chars doesn't depend on the locale.
+void Asciicast::_appendTime(std::string& out, const std::chrono::duration<double> time)
+{
+    char buffer[32];
+    const auto [end, error] = std::to_chars(&buffer[0], &buffer[0] + sizeof(buffer), time.count(), std::chars_format::fixed, 6);
+    if (error != std::errc{})
+    {
+        throw std::invalid_argument{ "time out of range" };
+    }
+    out.append(&buffer[0], end);
+}
+
+// Appends text as a JSON string, encoded as UTF-8. Lone surrogates can't be
+// encoded as UTF-8, so they're escaped.
+void Asciicast::_appendString(std::string& out, const std::wstring_view text)
+{
+    static constexpr std::string_view hex{ "0123456789abcdef" };
+    const auto appendEscape = [&](const wchar_t ch) {
+        const auto unit = static_cast<uint32_t>(ch);
+        out.append("\\u");
+        out.push_back(til::at(hex, (unit >> 12) & 0xF));
+        out.push_back(til::at(hex, (unit >> 8) & 0xF));
+        out.push_back(til::at(hex, (unit >> 4) & 0xF));
+        out.push_back(til::at(hex, unit & 0xF));
+    };
+
+    out.push_back('"');
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+        const auto ch = til::at(text, i);
+        switch (ch)
+        {
+        case L'"':
+            out.append("\\\"");
+            continue;
+        case L'\\':
+            out.append("\\\\");
+            continue;
+        case L'\n':
+            out.append("\\n");
+            continue;
+        case L'\r':
+            out.append("\\r");
+            continue;
+        case L'\t':
+            out.append("\\t");
+            continue;
+        default:
+            break;
+        }
+
+        const auto unit = static_cast<uint32_t>(ch);
+        if (unit < 0x20)
+        {
+            appendEscape(ch);
+        }
+        else if (unit < 0x80)
+        {
+            out.push_back(static_cast<char>(unit));
+        }
+        else if (unit < 0x800)
+        {
+            out.push_back(static_cast<char>(0xC0 | (unit >> 6)));
+            out.push_back(static_cast<char>(0x80 | (unit & 0x3F)));
+        }
+        else if (_isHighSurrogate(ch) && i + 1 < text.size() && _isLowSurrogate(til::at(text, i + 1)))
+        {
+            const auto codepoint = 0x10000 + ((unit - 0xD800) << 10) + (static_cast<uint32_t>(til::at(text, i + 1)) - 0xDC00);
+            out.push_back(static_cast<char>(0xF0 | (codepoint >> 18)));
+            out.push_back(static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+            ++i;
+        }
+        else if (_isSurrogate(ch) || unit > 0xFFFF)
+        {
+            // wchar_t is 32 bits wide outside of Windows, but the connection
+            // only ever hands us UTF-16 code units.
+            appendEscape(unit > 0xFFFF ? _replacementCharacter : ch);
+        }
+        else
+        {
+            out.push_back(static_cast<char>(0xE0 | (unit >> 12)));
+            out.push_back(static_cast<char>(0x80 | ((unit >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (unit & 0x3F)));
+        }
+    }
+    out.push_back('"');
+}
+
+// Method Description:
+// - Reads the size of the terminal from the header of a recording.
+// Arguments:
+// - contents: the whole asciicast v2 file
+Asciicast::Reader::Reader(std::string contents) :
+    _contents{ std::move(contents) }
+{
+    const auto headerEnd = _contents.find('\n');
+    if (headerEnd == std::string::npos)
+    {
+        throw InvalidRecording{};
+    }
+    const std::string_view header{ _contents.data(), headerEnd };
+
+    const auto field = [&](const std::string_view name) {
+        const auto key = header.find(name);
+        if (key == std::string_view::npos)
+        {
+            throw InvalidRecording{};
+        }
+        const auto value = header.find_first_not_of(" \t:", key + name.size());
+        if (value == std::string_view::npos)
+        {
+            throw InvalidRecording{};
+        }
+
+        int result = 0;
+        const auto [end, error] = std::from_chars(header.data() + value, header.data() + header.size(), result);
+        if (error != std::errc{} || result <= 0 || result > SHRT_MAX)
+        {
+            throw InvalidRecording{};
+        }
+        return result;
+    };
+    _width = field(R"("width")");
+    _height = field(R"("height")");
+
+    _firstEvent = headerEnd + 1;
+    _position = _firstEvent;
+}
+
+// Method Description:
+// - Returns the size the terminal had when the recording started.
+int Asciicast::Reader::Width() const noexcept
+{
+    return _width;
+}
+
+int Asciicast::Reader::Height() const noexcept
+{
+    return _height;
+}
+
+// Method Description:
+// - Reads the next event of the recording.
+// Arguments:
+// - event: receives the event
+// Return Value:
+// - false if there are no events left.
+bool Asciicast::Reader::Next(Event& event)
+{
+    _skipWhitespace();
+    if (_position >= _contents.size())
+    {
+        return false;
+    }
+
+    _expect('[');
+    const auto seconds = _parseNumber();
+    _expect(',');
+    _parseString(event.data);
+    event.type = event.data.empty() ? L'\0' : event.data.front();
+    _expect(',');
+    _parseString(event.data);
+    _expect(']');
+
+    event.time = std::chrono::microseconds{ std::llround(seconds * 1e6) };
+    return true;
+}
+
+// Method Description:
+// - Goes back to the first event of the recording.
+void Asciicast::Reader::Rewind() noexcept
+{
+    _position = _firstEvent;
+}
+
+void Asciicast::Reader::_skipWhitespace() noexcept
+{
+    while (_position < _contents.size())
+    {
+        const auto ch = til::at(_contents, _position);
+        if (ch != ' ' && ch != '\t' && ch != '\r' && ch != '\n')
+        {
+            break;
+        }
+        _position++;
+    }
+}
+
+void Asciicast::Reader::_expect(const char ch)
+{
+    _skipWhitespace();
+    if (_position >= _contents.size() || til::at(_contents, _position) != ch)
+    {
+        throw InvalidRecording{};
+    }
+    _position++;
+}
+
+double Asciicast::Reader::_parseNumber()
+{
+    _skipWhitespace();
+    const auto first = _contents.data() + _position;
+    const auto last = _contents.data() + _contents.size();
+
+    double value = 0;
+    const auto [end, error] = std::from_chars(first, last, value);
+    if (error != std::errc{} || !std::isfinite(value) || value < 0)
+    {
+        throw InvalidRecording{};
+    }
+    _position += gsl::narrow_cast<size_t>(end - first);
+    return value;
+}
+
+// Parses a JSON string, and decodes it from UTF-8 into UTF-16. \uXXXX escapes
+// become that code unit, whether it's a lone surrogate or not.
+void Asciicast::Reader::_parseString(std::wstring& out)
+{
+    out.clear();
+    _expect('"');
+
+    const auto next = [&]() {
+        if (_position >= _contents.size())
+        {
+            throw InvalidRecording{};
+        }
+        return static_cast<uint8_t>(til::at(_contents, _position++));
+    };
+
+    for (;;)
+    {
+        const auto byte = next();
+        if (byte == '"')
+        {
+            return;
+        }
+
+        if (byte == '\\')
+        {
+            switch (next())
+            {
+            case '"':
+                out.push_back(L'"');
+                break;
+            case '\\':
+                out.push_back(L'\\');
+                break;
+            case '/':
+                out.push_back(L'/');
+                break;
+            case 'b':
+                out.push_back(L'\b');
+                break;
+            case 'f':
+                out.push_back(L'\f');
+                break;
+            case 'n':
+                out.push_back(L'\n');
+                break;
+            case 'r':
+                out.push_back(L'\r');
+                break;
+            case 't':
+                out.push_back(L'\t');
+                break;
+            case 'u':
+            {
+                if (_position + 4 > _contents.size())
+                {
+                    throw InvalidRecording{};
+                }
+                unsigned int unit = 0;
+                const auto first = _contents.data() + _position;
+                const auto [end, error] = std::from_chars(first, first + 4, unit, 16);
+                if (error != std::errc{} || end != first + 4)
+                {
+                    throw InvalidRecording{};
+                }
+                _position += 4;
+                out.push_back(static_cast<wchar_t>(unit));
+                break;
+            }
+            default:
+                throw InvalidRecording{};
+            }
+            continue;
+        }
+
+        // Decode a UTF-8 sequence. Anything that isn't valid becomes U+FFFD.
+        uint32_t codepoint = byte;
+        size_t continuation = 0;
+        if (byte >= 0xF8)
+        {
+            codepoint = _replacementCharacter;
+        }
+        else if (byte >= 0xF0)
+        {
+            codepoint = byte & 0x07;
+            continuation = 3;
+        }
+        else if (byte >= 0xE0)
+        {
+            codepoint = byte & 0x0F;
+            continuation = 2;
+        }
+        else if (byte >= 0xC0)
+        {
+            codepoint = byte & 0x1F;
+            continuation = 1;
+        }
+        else if (byte >= 0x80)
+        {
+            codepoint = _replacementCharacter;
+        }
+
+        for (; continuation > 0; --continuation)
+        {
+            if (_position >= _contents.size() || (static_cast<uint8_t>(til::at(_contents, _position)) & 0xC0) != 0x80)
+            {
+                codepoint = _replacementCharacter;
+                break;
+            }
+            codepoint = (codepoint << 6) | (static_cast<uint8_t>(til::at(_contents, _position++)) & 0x3F);
+        }
+
+        if (codepoint >= 0x10000 && codepoint <= 0x10FFFF)
+        {
+            codepoint -= 0x10000;
+            out.push_back(static_cast<wchar_t>(0xD800 + (codepoint >> 10)));
+            out.push_back(static_cast<wchar_t>(0xDC00 + (codepoint & 0x3FF)));
+        }
+        else
+        {
+            out.push_back(codepoint > 0x10FFFF ? _replacementCharacter : static_cast<wchar_t>(codepoint));
+        }
+    }
+}
@@ -0,0 +1,81 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+// Module Name:
+// - Asciicast.hpp
+//
+// Abstract:
+// - Writes and reads the asciicast v2 files SessionRecorder and SessionPlayer
+//   record to and play back from: a JSON header with the size of the terminal,
+//   followed by one line per event. Output is [seconds, "o", text], a resize
+//   is [seconds, "r", "COLSxROWS"].
+// - Text is written as UTF-8, except for lone surrogates, which can't be
+//   encoded as UTF-8 and are written as \uXXXX escapes. Reader reads every
+//   \uXXXX escape back as that very code unit, so a recording gives back the
+//   exact code units it was given, even if a chunk ended in the middle of a
+//   surrogate pair.
+// - This only depends on the standard library, so that it can be tested on
+//   its own.
+
+#pragma once
+
+namespace Microsoft::Terminal::Core
+{
+    class Asciicast final
+    {
+    public:
+        // Thrown by Reader for anything that isn't a valid recording.
+        struct InvalidRecording : std::runtime_error
+        {
+            InvalidRecording() :
+                std::runtime_error{ "invalid asciicast recording" }
+            {
+            }
+        };
+
+        struct Event
+        {
+            // The time since the start of the recording.
+            std::chrono::microseconds time;
+            // 'o' for output, 'r' for a resize. Other types are returned as
+            // they are.
+            wchar_t type;
+            std::wstring data;
+        };
+
+        class Reader final
+        {
+        public:
+            explicit Reader(std::string contents);
+
+            int Width() const noexcept;
+            int Height() const noexcept;
+            bool Next(Event& event);
+            void Rewind() noexcept;
+
+        private:
+            void _skipWhitespace() noexcept;
+            void _expect(const char ch);
+            double _parseNumber();
+            void _parseString(std::wstring& out);
+
+            std::string _contents;
+            size_t _position{ 0 };
+            size_t _firstEvent{ 0 };
+            int _width{ 0 };
+            int _height{ 0 };
+        };
+
+        static void AppendHeader(std::string& out, const int width, const int height, const int64_t timestamp);
+        static void AppendOutput(std::string& out, const std::chrono::duration<double> time, const std::wstring_view text);
+        static void AppendResize(std::string& out, const std::chrono::duration<double> time, const int width, const int height);
+
+        // Parses the "COLSxROWS" of a resize event. Both have to be between
+        // 1 and SHRT_MAX.
+        static std::optional<std::pair<int, int>> ParseSize(const std::wstring_view text) noexcept;
+
+    private:
+        static void _appendTime(std::string& out, const std::chrono::duration<double> time);
+        static void _appendString(std::string& out, const std::wstring_view text);
+    };
+}
@@ -0,0 +1,341 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "pch.h"
+#include "ScrollbackArchive.hpp"
+#include "TextCompression.hpp"
+
+using namespace Microsoft::Terminal::Core;
+
+ScrollbackArchive::ScrollbackArchive(const size_t memoryBudget) noexcept :
+    _memoryBudget{ memoryBudget }
+{
+}
+
+// Method Description:
+// - Makes the archive move the blocks that exceed its memory budget into a
+//   temporary file, instead of dropping them.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void ScrollbackArchive::EnableSpilling()
+{
+    auto spillFile = std::make_unique<SpillFile>();
+    const std::lock_guard lock{ _lock };
+    _spillFile = std::move(spillFile);
+    _spillFailed = false;
+}
+
+size_t ScrollbackArchive::_sizeOf(const Block& block) noexcept
+{
+    return sizeof(Block) +
+           block.text.capacity() * sizeof(wchar_t) +
+           block.attributes.capacity() +
+           block.rows.capacity() * sizeof(RowEnd);
+}
+
+// Method Description:
+// - Compresses the text of a full block. While the archive is over its
+//   memory budget, the oldest blocks are spilled, or dropped if spilling
+//   isn't enabled.
+// Arguments:
+// - block: the block to compress, which has to be the last one
+// Return Value:
+// - <none>
+void ScrollbackArchive::_seal(Block& block)
+{
+    std::wstring compressed;
+    TextCompression::Compress(block.text, compressed);
+    compressed.shrink_to_fit();
+    block.textLength = block.text.size();
+    // Swapped, not moved: see _spill.
+    block.text.swap(compressed);
+    block.compressed = true;
+    block.attributes.shrink_to_fit();
+    block.rows.shrink_to_fit();
+    _memoryUsage += _sizeOf(block);
+
+    while (_memoryUsage > _memoryBudget && _spilledBlocks + 1 < _blocks.size())
+    {
+        if (_spillFile && !_spillFailed)
+        {
+            auto& oldest = til::at(_blocks, _spilledBlocks);
+            const auto sizeBefore = _sizeOf(oldest);
+            try
+            {
+                _spill(oldest);
+                _memoryUsage = _memoryUsage - sizeBefore + _sizeOf(oldest);
+                ++_spilledBlocks;
+                continue;
+            }
+            catch (...)
+            {
+                // The blocks we spilled so far stay readable. Drop blocks from now on.
+                _spillFailed = true;
+            }
+        }
+
+        _memoryUsage -= _sizeOf(_blocks.front());
+        _blocks.pop_front();
+        if (_spilledBlocks != 0)
+        {
+            --_spilledBlocks;
+        }
+        if (_cachedBlockRow == _firstRow)
+        {
+            _cachedBlockRow = -1;
+        }
+        if (_spilledBlockRow == _firstRow)
+        {
+            _spilledBlockRow = -1;
+        }
+        _firstRow += BlockRows;
+    }
+}
+
+// Copies the row numbers to where FirstRow() and EndRow() read them without the lock.
+void ScrollbackArchive::_updateRows() noexcept
+{
+    _publishedFirstRow.store(_firstRow, std::memory_order_relaxed);
+    const auto endRow = _blocks.empty() ? _firstRow : _firstRow + gsl::narrow_cast<int64_t>((_blocks.size() - 1) * BlockRows + _blocks.back().rows.size());
+    _publishedEndRow.store(endRow, std::memory_order_release);
+}
+
+// Method Description:
+// - Moves a block into the spill file and releases its memory. Its text is
+//   followed by its attributes and its rows.
+// Arguments:
+// - block: the block to spill. It has to be compressed already.
+// Return Value:
+// - <none>
+void ScrollbackArchive::_spill(Block& block)
+{
+    static_assert(std::is_trivially_copyable_v<RowEnd>);
+
+    const auto textBytes = block.text.size() * sizeof(wchar_t);
+    const auto rowsBytes = block.rows.size() * sizeof(RowEnd);
+    const auto position = _spillFile->Reserve(textBytes + block.attributes.size() + rowsBytes);
+    if (!_spillFile->Write(position, block.text.data(), textBytes) ||
+        !_spillFile->Write({ position.segment, position.offset + textBytes }, block.attributes.data(), block.attributes.size()) ||
+        !_spillFile->Write({ position.segment, position.offset + textBytes + block.attributes.size() }, block.rows.data(), rowsBytes))
+    {
+        throw std::runtime_error{ "can't write to the spill file" };
+    }
+
+    block.spilled = SpillLocation{ position, block.text.size(), block.attributes.size(), block.rows.size() };
+    // Moving an empty string into a string may keep the latter's buffer.
+    std::wstring{}.swap(block.text);
+    std::string{}.swap(block.attributes);
+    std::vector<RowEnd>{}.swap(block.rows);
+}
+
+// Method Description:
+// - Returns the contents of the given block. A spilled block is copied out of
+//   the spill file into _spilledBlock first, unless it's the one that's there
+//   already, so that reading the rows of a block one after the other only
+//   reads the file once.
+// Arguments:
+// - block: the block
+// - blockRow: the number of its first row
+// - view: receives the contents of the block
+// Return Value:
+// - false if the block couldn't be read from the spill file.
+bool ScrollbackArchive::_view(const Block& block, const int64_t blockRow, BlockView& view) const
+{
+    if (!block.spilled)
+    {
+        view = { block.text, block.attributes, &block.rows };
+        return true;
+    }
+
+    if (_spilledBlockRow != blockRow)
+    {
+        const auto& location = *block.spilled;
+        const auto textBytes = location.textSize * sizeof(wchar_t);
+        _spilledBlockRow = -1;
+        _spilledBlock.text.resize(location.textSize);
+        _spilledBlock.attributes.resize(location.attributesSize);
+        _spilledBlock.rows.resize(location.rowCount);
+        if (!_spillFile->Read(location.position, _spilledBlock.text.data(), textBytes) ||
+            !_spillFile->Read({ location.position.segment, location.position.offset + textBytes }, _spilledBlock.attributes.data(), location.attributesSize) ||
+            !_spillFile->Read({ location.position.segment, location.position.offset + textBytes + location.attributesSize }, _spilledBlock.rows.data(), location.rowCount * sizeof(RowEnd)))
+        {
+            return false;
+        }
+        _spilledBlockRow = blockRow;
+    }
+
+    view = { _spilledBlock.text, _spilledBlock.attributes, &_spilledBlock.rows };
+    return true;
+}
+
+// Method Description:
+// - Appends a row to the archive.
+// Arguments:
+// - text: the text of the row
+// - wrapped: whether the line continues on the next row
+// - attributes: the attributes of the row, in whatever form the caller
+//   wants them back in
+// Return Value:
+// - <none>
+void ScrollbackArchive::Append(const std::wstring_view text, const bool wrapped, const std::string_view attributes)
+{
+    const std::lock_guard lock{ _lock };
+    try
+    {
+        _append(text, wrapped, attributes);
+    }
+    catch (...)
+    {
+        _updateRows();
+        throw;
+    }
+    _updateRows();
+}
+
+void ScrollbackArchive::_append(const std::wstring_view text, const bool wrapped, const std::string_view attributes)
+{
+    if (_blocks.empty() || _blocks.back().rows.size() == BlockRows)
+    {
+        if (!_blocks.empty())
+        {
+            _seal(_blocks.back());
+        }
+        _blocks.emplace_back();
+    }
+
+    auto& block = _blocks.back();
+    block.text.append(text);
+    block.attributes.append(attributes);
+    block.rows.emplace_back(RowEnd{ gsl::narrow<uint32_t>(block.text.size()), gsl::narrow<uint32_t>(block.attributes.size()), wrapped });
+}
+
+// Method Description:
+// - Drops all rows. The rows appended after this are numbered after the
+//   ones that were dropped.
+void ScrollbackArchive::Clear() noexcept
+{
+    const std::lock_guard lock{ _lock };
+    _firstRow = _publishedEndRow.load(std::memory_order_relaxed);
+    _blocks.clear();
+    _spilledBlocks = 0;
+    _memoryUsage = 0;
+    _cachedBlockRow = -1;
+    _cachedText.clear();
+    _spilledBlockRow = -1;
+
+    // The spill file is reused from its start, and gives back its disk space.
+    if (_spillFile)
+    {
+        _spillFile->Clear();
+    }
+
+    _updateRows();
+}
+
+// Returns the block the given row is in, and its index in the block. Every
+// block but the last one has BlockRows rows, so that's a division, no matter
+// how many blocks there are, or whether they were spilled.
+std::pair<const ScrollbackArchive::Block&, size_t> ScrollbackArchive::_locate(const int64_t row) const noexcept
+{
+    const auto offset = gsl::narrow_cast<size_t>(row - _firstRow);
+    return { til::at(_blocks, offset / BlockRows), offset % BlockRows };
+}
+
+// Method Description:
+// - Reads a row back from the archive.
+// Arguments:
+// - row: the number of the row, in [FirstRow(), EndRow())
+// - text: receives the text of the row
+// - wrapped: receives whether the line continues on the next row
+// Return Value:
+// - false if the row isn't in the archive.
+bool ScrollbackArchive::ReadRow(const int64_t row, std::wstring& text, bool& wrapped) const
+{
+    const std::lock_guard lock{ _lock };
+    if (row < _firstRow || row >= _publishedEndRow.load(std::memory_order_relaxed))
+    {
+        return false;
+    }
+
+    const auto [block, index] = _locate(row);
+    const auto blockRow = row - gsl::narrow_cast<int64_t>(index);
+    BlockView view;
+    if (!_view(block, blockRow, view))
+    {
+        return false;
+    }
+
+    auto blockText = view.text;
+    if (block.compressed)
+    {
+        if (_cachedBlockRow != blockRow)
+        {
+            TextCompression::Decompress(view.text, block.textLength, _cachedText);
+            _cachedBlockRow = blockRow;
+        }
+        blockText = _cachedText;
+    }
+
+    const auto& end = til::at(*view.rows, index);
+    const size_t begin = index ? til::at(*view.rows, index - 1).textEnd : 0;
+    text.assign(blockText.substr(begin, end.textEnd - begin));
+    wrapped = end.wrapped;
+    return true;
+}
+
+// Method Description:
+// - Reads the attributes of a row back from the archive.
+// Arguments:
+// - row: the number of the row, in [FirstRow(), EndRow())
+// - attributes: receives the attributes of the row, as they were appended
+// Return Value:
+// - false if the row isn't in the archive.
+bool ScrollbackArchive::ReadRowAttributes(const int64_t row, std::string& attributes) const
+{
+    const std::lock_guard lock{ _lock };
+    if (row < _firstRow || row >= _publishedEndRow.load(std::memory_order_relaxed))
+    {
+        return false;
+    }
+
+    const auto [block, index] = _locate(row);
+    BlockView view;
+    if (!_view(block, row - gsl::narrow_cast<int64_t>(index), view))
+    {
+        return false;
+    }
+    const size_t begin = index ? til::at(*view.rows, index - 1).attributesEnd : 0;
+    const size_t end = til::at(*view.rows, index).attributesEnd;
+    attributes.assign(view.attributes.substr(begin, end - begin));
+    return true;
+}
+
+// Returns the number of the oldest row in the archive.
+int64_t ScrollbackArchive::FirstRow() const noexcept
+{
+    return _publishedFirstRow.load(std::memory_order_relaxed);
+}
+
+// Returns the number the next row appended to the archive will get.
+int64_t ScrollbackArchive::EndRow() const noexcept
+{
+    return _publishedEndRow.load(std::memory_order_acquire);
+}
+
+// Returns the number of bytes the archive takes up. Divided by the number of
+// rows, this is what a row of scrollback costs once it left the buffer.
+size_t ScrollbackArchive::MemoryUsage() const noexcept
+{
+    const std::lock_guard lock{ _lock };
+    return _memoryUsage + (_blocks.empty() ? 0 : _sizeOf(_blocks.back())) + _cachedText.capacity() * sizeof(wchar_t) + _sizeOf(_spilledBlock);
+}
+
+// Returns where the file the archive spills to is, or an empty path if
+// spilling isn't enabled. The file is deleted along with the archive.
+std::filesystem::path ScrollbackArchive::SpillFilePath() const
+{
+    const std::lock_guard lock{ _lock };
+    return _spillFile ? _spillFile->Path() : std::filesystem::path{};
+}
@@ -0,0 +1,143 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+// Module Name:
+// - ScrollbackArchive.hpp
+//
+// Abstract:
+// - The cold tier of an unbounded scrollback (a HistorySize of -1). The
+//   TextBuffer only keeps the most recent rows. Before IncrementCircularBuffer
+//   recycles the top row of the buffer, the Terminal appends it to the archive.
+// - A row is its text, whether it's wrapped, and its attributes. The archive
+//   doesn't look at the attributes, it keeps the bytes it's given for them.
+// - Rows are collected into blocks of BlockRows rows. Once a block is full, its
+//   text is compressed with TextCompression.
+// - The archive has a fixed memory budget. When it's exceeded, the oldest
+//   blocks are dropped. If spilling was enabled, they're moved into a
+//   SpillFile instead. Every block remembers where it is in the file, so
+//   reading any row of it only costs a lookup and reading its block. If that
+//   fails, the row reads as missing. The file is deleted when the archive is
+//   destroyed, or when the process goes away.
+// - This only depends on the standard library and SpillFile, so that it can
+//   be tested on its own.
+// - Rows are numbered in the order they were appended, starting at 0. Rows
+//   that were dropped keep their numbers: FirstRow() is the number of the
+//   oldest row that's left.
+// - The Terminal pages rows back in under its lock, but the search index
+//   reads them from the thread that searches, without it. The archive has a
+//   lock of its own for that, which is only held for as long as it takes to
+//   append or read a row. FirstRow() and EndRow() don't take it.
+
+#pragma once
+
+#include "SpillFile.hpp"
+
+namespace Microsoft::Terminal::Core
+{
+    class ScrollbackArchive final
+    {
+    public:
+        explicit ScrollbackArchive(const size_t memoryBudget) noexcept;
+        ScrollbackArchive(const ScrollbackArchive&) = delete;
+        ScrollbackArchive& operator=(const ScrollbackArchive&) = delete;
+
+        void EnableSpilling();
+
+        // These must be called with the terminal locked for writing.
+        void Append(const std::wstring_view text, const bool wrapped, const std::string_view attributes);
+        void Clear() noexcept;
+
+        // These can be called from any thread. They return false if the row
+        // isn't in the archive (anymore).
+        bool ReadRow(const int64_t row, std::wstring& text, bool& wrapped) const;
+        bool ReadRowAttributes(const int64_t row, std::string& attributes) const;
+
+        int64_t FirstRow() const noexcept;
+        int64_t EndRow() const noexcept;
+        size_t MemoryUsage() const noexcept;
+        std::filesystem::path SpillFilePath() const;
+
+    private:
+        static constexpr size_t BlockRows = 256;
+
+        struct RowEnd
+        {
+            // The offset the text of the row ends at in the uncompressed text
+            // of its block, and the offset its attributes end at.
+            uint32_t textEnd;
+            uint32_t attributesEnd;
+            // Whether the line continues on the next row.
+            bool wrapped;
+        };
+
+        // Where a spilled block is in the spill file. Its text is at
+        // position, followed by its attributes and its rows.
+        struct SpillLocation
+        {
+            SpillFile::Position position;
+            size_t textSize;
+            size_t attributesSize;
+            size_t rowCount;
+        };
+
+        struct Block
+        {
+            // The text of all the rows of the block. Once the block is full,
+            // it's compressed by _compress.
+            std::wstring text;
+            size_t textLength{ 0 };
+            bool compressed{ false };
+            std::string attributes;
+            std::vector<RowEnd> rows;
+            // If set, the block was spilled, and its text, attributes and rows are empty.
+            std::optional<SpillLocation> spilled;
+        };
+
+        // The contents of a block, wherever they are.
+        struct BlockView
+        {
+            std::wstring_view text;
+            std::string_view attributes;
+            const std::vector<RowEnd>* rows;
+        };
+
+        static size_t _sizeOf(const Block& block) noexcept;
+        void _seal(Block& block);
+        void _spill(Block& block);
+        void _append(const std::wstring_view text, const bool wrapped, const std::string_view attributes);
+        void _updateRows() noexcept;
+        bool _view(const Block& block, const int64_t blockRow, BlockView& view) const;
+        std::pair<const Block&, size_t> _locate(const int64_t row) const noexcept;
+
+        // Guards everything below, except for the copies of the row numbers.
+        mutable std::mutex _lock;
+
+        std::deque<Block> _blocks;
+        // The number of the first row of _blocks.front().
+        int64_t _firstRow{ 0 };
+        // Copies of FirstRow() and EndRow(), for reading without the lock.
+        std::atomic<int64_t> _publishedFirstRow{ 0 };
+        std::atomic<int64_t> _publishedEndRow{ 0 };
+        // The number of blocks at the front of _blocks that were spilled.
+        size_t _spilledBlocks{ 0 };
+        // The memory used by all the blocks but the last one, which isn't compressed yet.
+        size_t _memoryUsage{ 0 };
+        size_t _memoryBudget;
+
+        // The uncompressed text of the block that starts at row _cachedBlockRow,
+        // so that reading the rows of a block one after the other only
+        // decompresses it once.
+        mutable int64_t _cachedBlockRow{ -1 };
+        mutable std::wstring _cachedText;
+
+        // The block that starts at row _spilledBlockRow, copied out of the
+        // spill file. See _view.
+        mutable int64_t _spilledBlockRow{ -1 };
+        mutable Block _spilledBlock;
+
+        // The spill file, if spilling is enabled. If writing to it failed,
+        // _spillFailed is set, and blocks are dropped from then on.
+        std::unique_ptr<SpillFile> _spillFile;
+        bool _spillFailed{ false };
+    };
+}
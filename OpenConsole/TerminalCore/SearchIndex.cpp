@@ -0,0 +1,1194 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "pch.h"
+#include "SearchIndex.hpp"
+
+using namespace Microsoft::Terminal::Core;
+
+// The number of filter bits per character of text. Every character adds a
+// bigram and a trigram with 2 bits each, which leaves a filter about 1/4 full.
+static constexpr size_t FilterBitsPerChar = 16;
+
+// The same for archived blocks. Their filter is folded to a quarter of the
+// size, which leaves it about 2/3 full, and lets more of them through.
+static constexpr size_t ArchivedFilterBitsPerChar = 4;
+
+// Stands in for the second character of a bigram's trigram.
+static constexpr uint32_t NoChar = 0x110000;
+
+static wchar_t _fold(const wchar_t ch) noexcept
+{
+    return gsl::narrow_cast<wchar_t>(towlower(ch));
+}
+
+static std::wstring _foldString(const std::wstring_view text)
+{
+    std::wstring folded;
+    folded.reserve(text.size());
+    for (const auto ch : text)
+    {
+        folded.push_back(_fold(ch));
+    }
+    return folded;
+}
+
+static constexpr bool _isHighSurrogate(const wchar_t ch) noexcept
+{
+    return (ch & 0xFC00) == 0xD800;
+}
+
+static constexpr bool _isLowSurrogate(const wchar_t ch) noexcept
+{
+    return (ch & 0xFC00) == 0xDC00;
+}
+
+// Hashes the trigram a, b, c, or the bigram a, b if c is NoChar.
+static constexpr uint64_t _gramHash(const uint32_t a, const uint32_t b, const uint32_t c) noexcept
+{
+    auto x = (uint64_t{ a } << 42) ^ (uint64_t{ b } << 21) ^ c;
+    x *= 0x9E3779B97F4A7C15;
+    x ^= x >> 29;
+    x *= 0xBF58476D1CE4E5B9;
+    return x ^ (x >> 32);
+}
+
+// Calls func with the hash of every bigram and trigram of the given case folded text.
+template<typename Func>
+static void _forEachGram(const std::wstring_view text, Func&& func)
+{
+    for (size_t i = 1; i < text.size(); ++i)
+    {
+        const uint32_t a = til::at(text, i - 1);
+        const uint32_t b = til::at(text, i);
+        func(_gramHash(a, b, NoChar));
+        if (i + 1 < text.size())
+        {
+            func(_gramHash(a, b, til::at(text, i + 1)));
+        }
+    }
+}
+
+// Returns the index of the ] that ends the character class whose [ is at the given index.
+static size_t _skipClass(const std::wstring_view text, size_t i) noexcept
+{
+    for (++i; i < text.size() && til::at(text, i) != L']'; ++i)
+    {
+        if (til::at(text, i) == L'\\')
+        {
+            ++i;
+        }
+    }
+    return i;
+}
+
+// Method Description:
+// - Finds the runs of literal text that every match of the given ECMAScript
+//   regular expression contains. Only the top level of the pattern is looked
+//   at: groups, character classes, and escapes other than escaped punctuation
+//   end a run, and a character that may be repeated zero times is dropped
+//   from it. With an alternation at the top level, no run is certain to be
+//   in a match.
+// Arguments:
+// - text: the regular expression. It must be valid.
+// Return Value:
+// - The runs that are at least 2 characters long, which is what a filter has
+//   n-grams of.
+static std::vector<std::wstring> _patternLiterals(const std::wstring_view text)
+{
+    std::vector<std::wstring> literals;
+    std::wstring run;
+    const auto endRun = [&]() {
+        if (run.size() >= 2)
+        {
+            literals.emplace_back(std::move(run));
+        }
+        run.clear();
+    };
+
+    // Whether the last atom is the last character of run. If a quantifier
+    // follows, it applies to that character.
+    auto lastIsLiteral = false;
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+        const auto ch = til::at(text, i);
+        const auto next = i + 1 < text.size() ? til::at(text, i + 1) : L'\0';
+        switch (ch)
+        {
+        case L'*':
+        case L'?':
+        case L'+':
+        case L'{':
+            if (lastIsLiteral && (ch == L'*' || ch == L'?' || (ch == L'{' && (next == L'0' || next == L','))))
+            {
+                run.pop_back();
+            }
+            endRun();
+            if (ch == L'{')
+            {
+                i = text.find(L'}', i);
+            }
+            // A lazy quantifier.
+            if (i + 1 < text.size() && til::at(text, i + 1) == L'?')
+            {
+                ++i;
+            }
+            lastIsLiteral = false;
+            continue;
+        case L'\\':
+            if (i + 1 < text.size() && !iswalnum(next))
+            {
+                run.push_back(next);
+                ++i;
+                lastIsLiteral = true;
+                continue;
+            }
+            // \d, \w, \b, a back reference, and so on. Skip the digits of
+            // character codes and back references, they aren't literals.
+            ++i;
+            if (next == L'x' || next == L'u' || next == L'c')
+            {
+                i += next == L'x' ? 2 : next == L'u' ? 4 : 1;
+            }
+            while (iswdigit(next) && i + 1 < text.size() && iswdigit(til::at(text, i + 1)))
+            {
+                ++i;
+            }
+            break;
+        case L'[':
+            i = _skipClass(text, i);
+            break;
+        case L'(':
+            for (size_t depth = 0; i < text.size(); ++i)
+            {
+                const auto c = til::at(text, i);
+                if (c == L'\\')
+                {
+                    ++i;
+                }
+                else if (c == L'[')
+                {
+                    i = _skipClass(text, i);
+                }
+                else if (c == L'(')
+                {
+                    ++depth;
+                }
+                else if (c == L')' && --depth == 0)
+                {
+                    break;
+                }
+            }
+            break;
+        case L'|':
+            return {};
+        case L'.':
+        case L'^':
+        case L'$':
+            break;
+        default:
+            run.push_back(ch);
+            lastIsLiteral = true;
+            continue;
+        }
+
+        endRun();
+        lastIsLiteral = false;
+    }
+    endRun();
+    return literals;
+}
+
+// Returns the two bits of a filter of the given size that a hash sets.
+static std::pair<uint64_t, uint64_t> _filterBits(const uint64_t hash, const size_t words) noexcept
+{
+    const auto mask = words * 64 - 1;
+    return { hash & mask, (hash >> 32) & mask };
+}
+
+SearchIndex::SearchIndex(const IsWideGlyph isWideGlyph) noexcept :
+    _isWideGlyph{ isWideGlyph }
+{
+}
+
+// Returns the column the given text ends at, if it starts at column 0.
+size_t SearchIndex::_columnWidth(const std::wstring_view text) const
+{
+    size_t width = 0;
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+        const auto ch = til::at(text, i);
+        if (ch < 0x80)
+        {
+            ++width;
+            continue;
+        }
+
+        auto glyph = text.substr(i, 1);
+        if (_isHighSurrogate(ch) && i + 1 < text.size() && _isLowSurrogate(til::at(text, i + 1)))
+        {
+            glyph = text.substr(i, 2);
+            ++i;
+        }
+        width += _isWideGlyph(glyph) ? 2 : 1;
+    }
+    return width;
+}
+
+// Method Description:
+// - Compiles a regular expression for FindNextRegex and SetQuery.
+// Arguments:
+// - text: the ECMAScript regular expression.
+// - caseSensitive: whether the regular expression is case sensitive.
+// Return Value:
+// - The compiled pattern. Throws std::regex_error if it isn't valid.
+std::shared_ptr<const SearchIndex::Pattern> SearchIndex::CompilePattern(const std::wstring_view text, const bool caseSensitive)
+{
+    auto flags = std::regex_constants::ECMAScript | std::regex_constants::optimize;
+    if (!caseSensitive)
+    {
+        flags |= std::regex_constants::icase;
+    }
+
+    auto pattern = std::make_shared<Pattern>();
+    pattern->regex = std::wregex{ text.data(), text.size(), flags };
+    pattern->caseSensitive = caseSensitive;
+    pattern->literals = _patternLiterals(text);
+    if (!caseSensitive)
+    {
+        for (auto& literal : pattern->literals)
+        {
+            literal = _foldString(literal);
+        }
+    }
+    // The longest literal is the least likely to be in a line that doesn't match.
+    std::stable_sort(pattern->literals.begin(), pattern->literals.end(), [](const auto& a, const auto& b) {
+        return a.size() > b.size();
+    });
+    return pattern;
+}
+
+SearchIndex::Query SearchIndex::_makeQuery(const std::wstring_view needle, const bool caseSensitive, std::shared_ptr<const Pattern> pattern)
+{
+    Query query;
+    query.caseSensitive = caseSensitive;
+    query.pattern = std::move(pattern);
+    const auto addGrams = [&](const std::wstring_view text) {
+        _forEachGram(_foldString(text), [&](const uint64_t hash) {
+            query.grams.emplace_back(hash);
+        });
+    };
+
+    if (query.pattern)
+    {
+        for (const auto& literal : query.pattern->literals)
+        {
+            addGrams(literal);
+        }
+    }
+    else
+    {
+        query.needle = caseSensitive ? std::wstring{ needle } : _foldString(needle);
+        addGrams(needle);
+    }
+    return query;
+}
+
+// Returns whether the block may contain matches of the query: whether its
+// filter has all the n-grams of the query.
+bool SearchIndex::_mayMatch(const Block& block, const Query& query) noexcept
+{
+    const auto words = block.filter.size();
+    for (const auto hash : query.grams)
+    {
+        const auto [first, second] = _filterBits(hash, words);
+        if (!(til::at(block.filter, first / 64) & (uint64_t{ 1 } << (first % 64))) ||
+            !(til::at(block.filter, second / 64) & (uint64_t{ 1 } << (second % 64))))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::shared_ptr<const SearchIndex::Snapshot> SearchIndex::_snapshot() const noexcept
+{
+    return std::atomic_load(&_blocks);
+}
+
+// Method Description:
+// - Returns a copy of a block whose rows left the buffer for the scrollback
+//   archive. It keeps the id, so its find-all matches are still valid, but
+//   not the text, and its filter is folded: the bit every hash sets in the
+//   smaller filter is the one it sets in the larger one, modulo its size.
+// Arguments:
+// - block: the block of the buffer.
+// Return Value:
+// - The archived block.
+std::shared_ptr<const SearchIndex::Block> SearchIndex::_archive(const Block& block)
+{
+    auto archived = std::make_shared<Block>();
+    archived->id = block.id;
+    archived->firstRow = block.firstRow;
+    archived->rowStarts.resize(block.rowStarts.size());
+    archived->lineStarts = block.lineStarts;
+    archived->open = block.open;
+    archived->archived = true;
+
+    size_t words = 1;
+    while (words * 64 < block.text.size() * ArchivedFilterBitsPerChar && words < block.filter.size())
+    {
+        words *= 2;
+    }
+    archived->filter.resize(words);
+    for (size_t i = 0; i < block.filter.size(); ++i)
+    {
+        til::at(archived->filter, i % words) |= til::at(block.filter, i);
+    }
+    return archived;
+}
+
+// Method Description:
+// - Reads the text of an archived block back from the scrollback archive.
+//   The copy it returns has no filter, it's only searched.
+// Arguments:
+// - snapshot: the snapshot the block is in.
+// - block: the archived block.
+// Return Value:
+// - The block with its text, or nullptr if its rows were dropped from the archive.
+std::shared_ptr<const SearchIndex::Block> SearchIndex::_thaw(const Snapshot& snapshot, const Block& block)
+{
+    if (!snapshot.readArchivedRow)
+    {
+        return nullptr;
+    }
+
+    auto thawed = std::make_shared<Block>();
+    thawed->id = block.id;
+    thawed->firstRow = block.firstRow;
+    thawed->lineStarts = block.lineStarts;
+    thawed->open = block.open;
+    thawed->rowStarts.reserve(block.rowStarts.size());
+
+    std::wstring text;
+    auto wrapped = false;
+    for (auto row = block.firstRow; row < block.EndRow(); ++row)
+    {
+        if (!(*snapshot.readArchivedRow)(row, text, wrapped))
+        {
+            return nullptr;
+        }
+        thawed->rowStarts.emplace_back(thawed->text.size());
+        thawed->text.append(text);
+    }
+    thawed->rowStarts.emplace_back(thawed->text.size());
+    return thawed;
+}
+
+// Returns the block itself, or if it's archived, its text read back into
+// thawed. Returns nullptr if that failed.
+const SearchIndex::Block* SearchIndex::_withText(const Snapshot& snapshot, const std::shared_ptr<const Block>& block, std::shared_ptr<const Block>& thawed)
+{
+    if (!block->archived)
+    {
+        return block.get();
+    }
+    thawed = _thaw(snapshot, *block);
+    return thawed.get();
+}
+
+// Method Description:
+// - Reads the rows of a block, starting at the given row. It ends once it
+//   has BlockRows rows and a line ended, or once a line ended right where an
+//   old block can be reused.
+// Arguments:
+// - readRow: reads the row with the given absolute row number.
+// - row: the absolute row the block starts at.
+// - endRow: the absolute row after the last row to read.
+// - resumesAt: returns whether an old block starts at the given row, and
+//   can be reused.
+// Return Value:
+// - The block.
+std::shared_ptr<const SearchIndex::Block> SearchIndex::_readBlock(const ReadRow& readRow, int64_t row, const int64_t endRow, const std::function<bool(int64_t)>& resumesAt)
+{
+    auto block = std::make_shared<Block>();
+    block->id = _nextBlockId++;
+    block->firstRow = row;
+    block->lineStarts.emplace_back(0);
+
+    std::wstring text;
+    auto wrapped = false;
+    while (row < endRow)
+    {
+        readRow(row, text, wrapped);
+        block->rowStarts.emplace_back(block->text.size());
+        block->text.append(text);
+        ++row;
+
+        if (!wrapped)
+        {
+            block->lineStarts.emplace_back(block->rowStarts.size());
+            if (block->rowStarts.size() >= BlockRows || resumesAt(row))
+            {
+                break;
+            }
+        }
+    }
+    block->rowStarts.emplace_back(block->text.size());
+    block->open = wrapped;
+    if (wrapped)
+    {
+        block->lineStarts.emplace_back(block->RowCount());
+    }
+
+    size_t words = 1;
+    while (words * 64 < block->text.size() * FilterBitsPerChar)
+    {
+        words *= 2;
+    }
+    block->filter.resize(words);
+
+    std::wstring folded;
+    for (size_t line = 0; line < block->LineCount(); ++line)
+    {
+        const auto begin = block->rowStarts.at(block->lineStarts.at(line));
+        const auto end = block->rowStarts.at(block->lineStarts.at(line + 1));
+        folded = _foldString(std::wstring_view{ block->text }.substr(begin, end - begin));
+        _forEachGram(folded, [&](const uint64_t hash) {
+            const auto [first, second] = _filterBits(hash, words);
+            til::at(block->filter, first / 64) |= uint64_t{ 1 } << (first % 64);
+            til::at(block->filter, second / 64) |= uint64_t{ 1 } << (second % 64);
+        });
+    }
+    return block;
+}
+
+// Method Description:
+// - Returns the list of archived blocks with the given ones added to it, and
+//   the ones that aren't in the [firstRow, hotRow) range anymore dropped.
+//   Blocks that overlap one that's already there aren't added.
+// Arguments:
+// - archived: the current list, if any.
+// - blocks: the blocks to add, sorted by their rows.
+// - firstRow: the first row of the scrollback archive.
+// - hotRow: the first row of the blocks that aren't archived.
+// Return Value:
+// - The new list, or archived itself if nothing changed.
+std::shared_ptr<const SearchIndex::Blocks> SearchIndex::_insertArchived(const std::shared_ptr<const Blocks>& archived, const Blocks& blocks, const int64_t firstRow, const int64_t hotRow)
+{
+    // The blocks are sorted and don't overlap, so they're all in the range
+    // if the first and the last one are.
+    if (blocks.empty() && (!archived || archived->empty() || (archived->front()->firstRow >= firstRow && archived->back()->EndRow() <= hotRow)))
+    {
+        return archived;
+    }
+
+    auto merged = std::make_shared<Blocks>();
+    merged->reserve((archived ? archived->size() : 0) + blocks.size());
+    const auto add = [&](const std::shared_ptr<const Block>& block) {
+        if (block->firstRow < firstRow || block->EndRow() > hotRow || (!merged->empty() && merged->back()->EndRow() > block->firstRow))
+        {
+            return false;
+        }
+        merged->emplace_back(block);
+        return true;
+    };
+
+    auto next = blocks.begin();
+    if (archived)
+    {
+        for (const auto& block : *archived)
+        {
+            for (; next != blocks.end() && (*next)->firstRow < block->firstRow; ++next)
+            {
+                add(*next);
+            }
+            add(block);
+        }
+    }
+    for (; next != blocks.end(); ++next)
+    {
+        add(*next);
+    }
+    return merged;
+}
+
+// Method Description:
+// - Brings the index up to date with the buffer. The blocks that only have
+//   rows that didn't change are kept, the others are read again.
+// - With a scrollback archive, the blocks of the rows that left the buffer
+//   for the archive are kept as well, and archived once there are enough of
+//   them. The rows that left the buffer before they made it into a block
+//   are left for IndexArchivedRows.
+// Arguments:
+// - height: the number of rows of the buffer.
+// - readRow: reads a row of the buffer.
+// - rowBase: the absolute row number of the first row of the buffer.
+// - dirtyTop, dirtyBottom: the [top, bottom) range of absolute row numbers
+//   that changed since the last update. Rows that were added to the bottom of
+//   the buffer since then are read anyway.
+// - full: if true, the whole buffer is read again.
+// - archived: the rows in the scrollback archive, if the buffer has one.
+// Return Value:
+// - <none>
+void SearchIndex::Update(const int64_t height, const ReadRow& readRow, const int64_t rowBase, const int64_t dirtyTop, const int64_t dirtyBottom, const bool full, const ArchivedRows* archived)
+{
+    // Only Update replaces the blocks that aren't archived, and it's only
+    // called under the terminal's write lock, so they're still the current
+    // ones when we're done. IndexArchivedRows only adds archived blocks.
+    const auto old = _snapshot();
+    const auto endRow = rowBase + height;
+    const auto isClean = [&](const Block& block) {
+        return !block.open && (block.EndRow() <= dirtyTop || block.firstRow >= dirtyBottom);
+    };
+
+    Blocks blocks;
+    Blocks toArchive;
+    auto row = rowBase;
+    // The old blocks of rows that left the buffer are kept, unless they
+    // changed before they left, or the rows were renumbered, which comes
+    // with full. The block of the line that straddles the top of the buffer
+    // is kept too, since the part of it above the buffer can't be read from
+    // the buffer anymore.
+    if (archived && old && old->readArchivedRow && !full)
+    {
+        auto contiguous = true;
+        for (const auto& block : old->blocks)
+        {
+            if (block->firstRow >= rowBase)
+            {
+                break;
+            }
+            if (block->firstRow < archived->firstRow || !isClean(*block) || block->EndRow() > endRow)
+            {
+                contiguous = false;
+                continue;
+            }
+            contiguous = contiguous && (blocks.empty() || blocks.back()->EndRow() == block->firstRow);
+            blocks.emplace_back(block);
+            row = std::max(row, block->EndRow());
+        }
+        contiguous = contiguous && (blocks.empty() || blocks.back()->EndRow() >= rowBase);
+
+        // IndexArchivedRows can only fill the gaps above the blocks that
+        // have their text, so they're archived right away if there are gaps.
+        const auto straddles = !blocks.empty() && blocks.back()->EndRow() > rowBase;
+        const auto leftBuffer = blocks.size() - (straddles ? 1 : 0);
+        if (!contiguous || leftBuffer >= std::clamp<size_t>(old->ArchivedCount() / 16, 16, 256))
+        {
+            for (size_t i = 0; i < leftBuffer; ++i)
+            {
+                toArchive.emplace_back(_archive(*blocks[i]));
+            }
+            blocks.erase(blocks.begin(), blocks.begin() + leftBuffer);
+        }
+        if (!straddles)
+        {
+            row = rowBase;
+        }
+    }
+
+    // The index of the first old block that doesn't start above the row we're at.
+    size_t next = 0;
+    const auto canReuse = [&](const int64_t row) {
+        if (full || !old)
+        {
+            return false;
+        }
+        const auto& oldBlocks = old->blocks;
+        while (next < oldBlocks.size() && oldBlocks[next]->firstRow < row)
+        {
+            ++next;
+        }
+        if (next == oldBlocks.size() || oldBlocks[next]->firstRow != row)
+        {
+            return false;
+        }
+        const auto& block = *oldBlocks[next];
+        return block.EndRow() <= endRow && isClean(block);
+    };
+
+    const ReadRow readBufferRow = [&](const int64_t row, std::wstring& text, bool& wrapped) {
+        readRow(row - rowBase, text, wrapped);
+    };
+    while (row < endRow)
+    {
+        if (canReuse(row))
+        {
+            auto& block = old->blocks[next];
+            row = block->EndRow();
+            blocks.emplace_back(block);
+            continue;
+        }
+
+        auto block = _readBlock(readBufferRow, row, endRow, canReuse);
+        row = block->EndRow();
+        blocks.emplace_back(std::move(block));
+    }
+
+    auto snapshot = std::make_shared<Snapshot>();
+    snapshot->firstRow = archived ? archived->firstRow : rowBase;
+    snapshot->endRow = endRow;
+    snapshot->blocks = std::move(blocks);
+
+    const std::lock_guard lock{ _blocksLock };
+    if (archived)
+    {
+        _archivedBlocks = _insertArchived(_archivedBlocks, toArchive, archived->firstRow, snapshot->HotRow());
+        snapshot->archived = _archivedBlocks;
+        snapshot->readArchivedRow = archived->readRow;
+    }
+    std::atomic_store(&_blocks, std::shared_ptr<const Snapshot>{ std::move(snapshot) });
+}
+
+// Method Description:
+// - Reads up to maxRows archived rows that aren't in any block yet, and adds
+//   their blocks to the index. Those are the rows that left the buffer before
+//   the index read them, or whose block changed on its way out. The rows are
+//   read from the scrollback archive without holding any lock.
+// Arguments:
+// - maxRows: the number of rows to read, give or take a line.
+// Return Value:
+// - true if there may be rows left to read.
+bool SearchIndex::IndexArchivedRows(const size_t maxRows)
+{
+    const auto snapshot = _snapshot();
+    if (!snapshot || !snapshot->readArchivedRow)
+    {
+        return false;
+    }
+
+    // The gap closest to the buffer goes first, since its rows are the ones
+    // most likely to be searched for.
+    auto gapEnd = snapshot->HotRow();
+    int64_t gapBegin;
+    for (auto i = snapshot->ArchivedCount();; --i)
+    {
+        gapBegin = i == 0 ? snapshot->firstRow : snapshot->archived->at(i - 1)->EndRow();
+        if (gapBegin < gapEnd)
+        {
+            break;
+        }
+        if (i == 0)
+        {
+            return false;
+        }
+        gapEnd = snapshot->archived->at(i - 1)->firstRow;
+    }
+
+    // Rows that were dropped from the archive in the meantime are read as
+    // empty. Their blocks won't make it into the index.
+    const auto& readArchivedRow = *snapshot->readArchivedRow;
+    const ReadRow readRow = [&](const int64_t row, std::wstring& text, bool& wrapped) {
+        if (!readArchivedRow(row, text, wrapped))
+        {
+            text.clear();
+            wrapped = false;
+        }
+    };
+
+    Blocks blocks;
+    size_t rows = 0;
+    for (auto row = gapBegin; row < gapEnd && rows < maxRows;)
+    {
+        const auto block = _readBlock(readRow, row, gapEnd, [](const int64_t) { return false; });
+        row = block->EndRow();
+        rows += block->RowCount();
+        blocks.emplace_back(_archive(*block));
+    }
+
+    const std::lock_guard lock{ _blocksLock };
+    const auto current = _snapshot();
+    if (!current->readArchivedRow)
+    {
+        // The alternate buffer became active in the meantime.
+        return false;
+    }
+    _archivedBlocks = _insertArchived(_archivedBlocks, blocks, current->firstRow, current->HotRow());
+    auto updated = std::make_shared<Snapshot>(*current);
+    updated->archived = _archivedBlocks;
+    std::atomic_store(&_blocks, std::shared_ptr<const Snapshot>{ std::move(updated) });
+    return true;
+}
+
+// Method Description:
+// - Appends all the matches of the query in the given line of the block to
+//   matches, in the order they appear in. Matches of the text of the query
+//   may overlap. Empty matches of a regular expression are skipped, since
+//   there'd be nothing to select or highlight.
+// Arguments:
+// - block: the block the line is in.
+// - line: the index of the line in the block.
+// - query: what to search for.
+// - matches: receives the matches.
+void SearchIndex::_findInLine(const Block& block, const size_t line, const Query& query, std::vector<Match>& matches) const
+{
+    const auto firstRow = block.lineStarts.at(line);
+    const auto lastRow = block.lineStarts.at(line + 1);
+    const auto begin = block.rowStarts.at(firstRow);
+    const std::wstring_view text{ block.text };
+    const auto lineText = text.substr(begin, block.rowStarts.at(lastRow) - begin);
+
+    // Converts an offset into the line to the absolute row and the column
+    // it's at. If a match ends at the start of a row, it ends at the end of
+    // the previous one instead.
+    const auto toPosition = [&](const size_t offset, const bool isEnd) {
+        const auto starts = block.rowStarts.begin();
+        auto row = gsl::narrow_cast<size_t>(std::upper_bound(starts + firstRow, starts + lastRow, begin + offset) - starts) - 1;
+        if (isEnd && row != firstRow && block.rowStarts.at(row) == begin + offset)
+        {
+            --row;
+        }
+        const auto rowStart = block.rowStarts.at(row);
+        return std::pair{ block.firstRow + gsl::narrow_cast<int64_t>(row), _columnWidth(text.substr(rowStart, begin + offset - rowStart)) };
+    };
+    const auto addMatch = [&](const size_t offset, const size_t length) {
+        const auto [row, startColumn] = toPosition(offset, false);
+        const auto [endRow, endColumn] = toPosition(offset + length, true);
+        matches.emplace_back(Match{ row, startColumn, endRow, endColumn });
+    };
+
+    if (query.pattern)
+    {
+        // std::wregex is slow, even on lines it can't match. Skip the lines
+        // that don't have the text every match has.
+        const auto& literals = query.pattern->literals;
+        if (!literals.empty())
+        {
+            const auto folded = query.pattern->caseSensitive ? std::wstring{} : _foldString(lineText);
+            const auto haystack = query.pattern->caseSensitive ? lineText : std::wstring_view{ folded };
+            if (!std::all_of(literals.begin(), literals.end(), [&](const auto& literal) { return haystack.find(literal) != std::wstring_view::npos; }))
+            {
+                return;
+            }
+        }
+
+        const auto data = lineText.data();
+        for (std::wcregex_iterator it{ data, data + lineText.size(), query.pattern->regex }, end; it != end; ++it)
+        {
+            const auto length = gsl::narrow_cast<size_t>(it->length(0));
+            if (length != 0)
+            {
+                addMatch(gsl::narrow_cast<size_t>(it->position(0)), length);
+            }
+        }
+        return;
+    }
+
+    std::wstring folded;
+    auto haystack = lineText;
+    if (!query.caseSensitive)
+    {
+        folded = _foldString(lineText);
+        haystack = folded;
+    }
+
+    const std::wstring_view needle{ query.needle };
+    for (auto pos = haystack.find(needle); pos != std::wstring_view::npos; pos = haystack.find(needle, pos + 1))
+    {
+        addMatch(pos, needle.size());
+    }
+}
+
+// Appends all the matches of the query in the given block of the snapshot to matches.
+void SearchIndex::_findInBlock(const Snapshot& snapshot, const std::shared_ptr<const Block>& block, const Query& query, std::vector<Match>& matches) const
+{
+    if (!_mayMatch(*block, query))
+    {
+        return;
+    }
+    std::shared_ptr<const Block> thawed;
+    const auto text = _withText(snapshot, block, thawed);
+    if (!text)
+    {
+        return;
+    }
+    for (size_t line = 0; line < text->LineCount(); ++line)
+    {
+        _findInLine(*text, line, query, matches);
+    }
+}
+
+// Method Description:
+// - Finds the match of the query that comes after (or before) the given
+//   position, wrapping around at the end (or start) of the buffer. The line
+//   the search starts in is searched twice: first for the matches after the
+//   position, and once we wrapped around for the ones before it.
+// Arguments:
+// - query: what to search for.
+// - goForward: whether to search towards the end of the buffer.
+// - fromRow, fromColumn: the absolute row and the column to search from. A
+//   match that starts there is only returned if it's the only one. If the row
+//   isn't in the index, the search starts at the start (or end) of the buffer.
+// Return Value:
+// - The match, if there's any.
+std::optional<SearchIndex::Match> SearchIndex::_findNext(const Query& query, const bool goForward, const int64_t fromRow, const size_t fromColumn) const
+{
+    const auto snapshot = _snapshot();
+    const auto blockCount = snapshot ? snapshot->BlockCount() : 0;
+    if (blockCount == 0)
+    {
+        return std::nullopt;
+    }
+
+    size_t lineCount = 0;
+    for (size_t i = 0; i < blockCount; ++i)
+    {
+        lineCount += snapshot->BlockAt(i)->LineCount();
+    }
+
+    // The index of the block that has the given row, or blockCount if it's in
+    // a gap between archived blocks, or isn't in the index at all.
+    const auto findBlock = [&](const int64_t row) {
+        size_t begin = 0;
+        auto end = blockCount;
+        while (begin < end)
+        {
+            const auto mid = begin + (end - begin) / 2;
+            if (snapshot->BlockAt(mid)->firstRow <= row)
+            {
+                begin = mid + 1;
+            }
+            else
+            {
+                end = mid;
+            }
+        }
+        return begin != 0 && row < snapshot->BlockAt(begin - 1)->EndRow() ? begin - 1 : blockCount;
+    };
+
+    // The block and the line in it we're at.
+    auto blockIndex = findBlock(fromRow);
+    size_t line;
+    const auto hasFrom = blockIndex != blockCount;
+    if (hasFrom)
+    {
+        const auto& starts = snapshot->BlockAt(blockIndex)->lineStarts;
+        const auto row = gsl::narrow_cast<size_t>(fromRow - snapshot->BlockAt(blockIndex)->firstRow);
+        line = gsl::narrow_cast<size_t>(std::upper_bound(starts.begin(), starts.end(), row) - starts.begin()) - 1;
+    }
+    else
+    {
+        blockIndex = goForward ? 0 : blockCount - 1;
+        line = goForward ? 0 : snapshot->BlockAt(blockIndex)->LineCount() - 1;
+    }
+
+    const auto isAfterFrom = [&](const Match& match) {
+        return match.row > fromRow || (match.row == fromRow && match.startColumn > fromColumn);
+    };
+    const auto isBeforeFrom = [&](const Match& match) {
+        return match.row < fromRow || (match.row == fromRow && match.startColumn < fromColumn);
+    };
+
+    // Moves on to the next line, or with skipBlock to the first line of the
+    // next block, and returns the number of lines it moved past.
+    const auto advance = [&](const bool skipBlock) -> size_t {
+        const auto lines = snapshot->BlockAt(blockIndex)->LineCount();
+        if (goForward)
+        {
+            const size_t moved = skipBlock ? lines - line : 1;
+            line += moved;
+            if (line == lines)
+            {
+                blockIndex = blockIndex + 1 == blockCount ? 0 : blockIndex + 1;
+                line = 0;
+            }
+            return moved;
+        }
+        const size_t moved = skipBlock ? line + 1 : 1;
+        if (line < moved)
+        {
+            blockIndex = blockIndex == 0 ? blockCount - 1 : blockIndex - 1;
+            line = snapshot->BlockAt(blockIndex)->LineCount() - 1;
+        }
+        else
+        {
+            line -= moved;
+        }
+        return moved;
+    };
+
+    std::vector<Match> matches;
+    // The block at lastBlockIndex with its text, or nullptr if it can't have
+    // any matches. Archived blocks are only read back if they may have some.
+    auto lastBlockIndex = blockCount;
+    const Block* block = nullptr;
+    std::shared_ptr<const Block> thawed;
+    for (size_t visited = 0; visited < lineCount + (hasFrom ? 1 : 0);)
+    {
+        if (blockIndex != lastBlockIndex)
+        {
+            lastBlockIndex = blockIndex;
+            const auto& next = snapshot->BlockAt(blockIndex);
+            block = _mayMatch(*next, query) ? _withText(*snapshot, next, thawed) : nullptr;
+        }
+
+        if (!block)
+        {
+            visited += advance(true);
+            continue;
+        }
+
+        matches.clear();
+        _findInLine(*block, line, query, matches);
+
+        const auto first = hasFrom && visited == 0;
+        const auto last = hasFrom && visited == lineCount;
+        if (goForward)
+        {
+            for (const auto& match : matches)
+            {
+                if (first && !isAfterFrom(match))
+                {
+                    continue;
+                }
+                if (last && isAfterFrom(match))
+                {
+                    break;
+                }
+                return match;
+            }
+        }
+        else
+        {
+            for (auto it = matches.rbegin(); it != matches.rend(); ++it)
+            {
+                if (first && !isBeforeFrom(*it))
+                {
+                    continue;
+                }
+                if (last && isBeforeFrom(*it))
+                {
+                    break;
+                }
+                return *it;
+            }
+        }
+
+        visited += advance(false);
+    }
+    return std::nullopt;
+}
+
+// Method Description:
+// - Finds the match of the search text that comes after (or before) the
+//   given position, see _findNext.
+// Arguments:
+// - needle: the text to search for.
+// - caseSensitive: whether the search is case sensitive.
+// - goForward: whether to search towards the end of the buffer.
+// - fromRow, fromColumn: the absolute row and the column to search from.
+// Return Value:
+// - The match, if there's any.
+std::optional<SearchIndex::Match> SearchIndex::FindNext(const std::wstring_view needle, const bool caseSensitive, const bool goForward, const int64_t fromRow, const size_t fromColumn) const
+{
+    if (needle.empty())
+    {
+        return std::nullopt;
+    }
+    return _findNext(_makeQuery(needle, caseSensitive, nullptr), goForward, fromRow, fromColumn);
+}
+
+// Method Description:
+// - Finds the match of the regular expression that comes after (or before)
+//   the given position, see _findNext.
+// Arguments:
+// - pattern: the regular expression to search for.
+// - goForward: whether to search towards the end of the buffer.
+// - fromRow, fromColumn: the absolute row and the column to search from.
+// Return Value:
+// - The match, if there's any.
+std::optional<SearchIndex::Match> SearchIndex::FindNextRegex(const Pattern& pattern, const bool goForward, const int64_t fromRow, const size_t fromColumn) const
+{
+    // The query doesn't outlive this call, so it doesn't need to own the pattern.
+    std::shared_ptr<const Pattern> borrowed{ std::shared_ptr<void>{}, &pattern };
+    return _findNext(_makeQuery({}, false, std::move(borrowed)), goForward, fromRow, fromColumn);
+}
+
+// Method Description:
+// - Sets the query that find-all searches for, and throws away the matches
+//   of the previous one. An empty query turns find-all off.
+// - The matches are found by calling SearchChunk until it returns false.
+// Arguments:
+// - needle: the text to search for.
+// - caseSensitive: whether the search is case sensitive.
+// - pattern: if set, needle is a regular expression, and this is it compiled.
+void SearchIndex::SetQuery(const std::wstring_view needle, const bool caseSensitive, std::shared_ptr<const Pattern> pattern)
+{
+    auto query = needle.empty() ? nullptr : std::make_shared<const Query>(_makeQuery(needle, caseSensitive, std::move(pattern)));
+
+    const std::lock_guard lock{ _resultsLock };
+    _query = std::move(query);
+    _results.clear();
+    _matchCount = 0;
+}
+
+bool SearchIndex::HasQuery() const noexcept
+{
+    const std::lock_guard lock{ _resultsLock };
+    return _query != nullptr;
+}
+
+// Method Description:
+// - Searches up to maxRows rows of the blocks that haven't been searched for
+//   the find-all query yet. The blocks are searched without holding any
+//   lock. If the query changed in the meantime, the matches are thrown away.
+// Return Value:
+// - true if there are rows left to search.
+bool SearchIndex::SearchChunk(const size_t maxRows)
+{
+    std::shared_ptr<const Query> query;
+    Blocks blocks;
+    auto more = false;
+    const auto searched = _snapshot();
+    {
+        const std::lock_guard lock{ _resultsLock };
+        query = _query;
+        if (!query || !searched)
+        {
+            return false;
+        }
+
+        size_t rows = 0;
+        for (size_t i = 0; i < searched->BlockCount(); ++i)
+        {
+            const auto& block = searched->BlockAt(i);
+            if (_results.count(block->id))
+            {
+                continue;
+            }
+            if (rows >= maxRows)
+            {
+                more = true;
+                break;
+            }
+            blocks.emplace_back(block);
+            rows += block->RowCount();
+        }
+    }
+
+    std::vector<std::vector<Match>> results(blocks.size());
+    for (size_t i = 0; i < blocks.size(); ++i)
+    {
+        _findInBlock(*searched, blocks[i], *query, results[i]);
+    }
+
+    // Update may have replaced the snapshot while we were searching. The
+    // count only includes the blocks of the current one, and the matches of
+    // the blocks that aren't in it anymore are thrown away.
+    const auto snapshot = _snapshot();
+    const std::lock_guard lock{ _resultsLock };
+    if (query != _query)
+    {
+        return _query != nullptr;
+    }
+
+    for (size_t i = 0; i < blocks.size(); ++i)
+    {
+        _results.insert_or_assign(blocks[i]->id, std::move(results[i]));
+    }
+
+    std::unordered_map<uint64_t, std::vector<Match>> current;
+    _matchCount = 0;
+    for (size_t i = 0; i < snapshot->BlockCount(); ++i)
+    {
+        const auto it = _results.find(snapshot->BlockAt(i)->id);
+        if (it != _results.end())
+        {
+            _matchCount += it->second.size();
+            current.emplace(it->first, std::move(it->second));
+        }
+    }
+    _results = std::move(current);
+    return more;
+}
+
+// Method Description:
+// - Returns the number of find-all matches found so far.
+size_t SearchIndex::MatchCount() const noexcept
+{
+    const std::lock_guard lock{ _resultsLock };
+    return _matchCount;
+}
+
+// Method Description:
+// - Returns the position of the given match among all the find-all matches,
+//   counting from 1, or 0 if it isn't one of them.
+size_t SearchIndex::MatchOrdinal(const Match& match) const noexcept
+{
+    const auto snapshot = _snapshot();
+    if (!snapshot)
+    {
+        return 0;
+    }
+
+    const std::lock_guard lock{ _resultsLock };
+    size_t ordinal = 0;
+    for (size_t i = 0; i < snapshot->BlockCount(); ++i)
+    {
+        const auto& block = snapshot->BlockAt(i);
+        const auto it = _results.find(block->id);
+        if (it == _results.end())
+        {
+            continue;
+        }
+        if (match.row >= block->EndRow())
+        {
+            ordinal += it->second.size();
+            continue;
+        }
+
+        for (const auto& m : it->second)
+        {
+            ++ordinal;
+            if (m.row == match.row && m.startColumn == match.startColumn)
+            {
+                return ordinal;
+            }
+        }
+        break;
+    }
+    return 0;
+}
+
+// Method Description:
+// - Appends the find-all matches that cover any of the [top, bottom) range
+//   of absolute rows to matches. That includes the matches that start in a
+//   row above top and continue into it.
+void SearchIndex::GetMatchesInRows(const int64_t top, const int64_t bottom, std::vector<Match>& matches) const
+{
+    const auto snapshot = _snapshot();
+    if (!snapshot)
+    {
+        return;
+    }
+
+    // The first block that ends below top. Since blocks are made up of
+    // whole lines, no match that starts above it reaches top.
+    const std::lock_guard lock{ _resultsLock };
+    const auto getMatches = [&](const Blocks& blocks) {
+        auto it = std::upper_bound(blocks.begin(), blocks.end(), top, [](const int64_t row, const auto& block) {
+            return row < block->EndRow();
+        });
+        for (; it != blocks.end() && (*it)->firstRow < bottom; ++it)
+        {
+            const auto results = _results.find((*it)->id);
+            if (results == _results.end())
+            {
+                continue;
+            }
+            for (const auto& match : results->second)
+            {
+                if (match.endRow >= top && match.row < bottom)
+                {
+                    matches.emplace_back(match);
+                }
+            }
+        }
+    };
+    if (snapshot->archived)
+    {
+        getMatches(*snapshot->archived);
+    }
+    getMatches(snapshot->blocks);
+}
@@ -0,0 +1,224 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+// Module Name:
+// - SearchIndex.hpp
+//
+// Abstract:
+// - An index over the text of a buffer that the search box can query without
+//   holding the terminal lock. It keeps a copy of the text of every row,
+//   grouped into blocks of whole lines: rows that wrapped are always in the
+//   same block as the row after them, and a match may continue from one row
+//   of a line onto the next, just like it does on screen.
+// - Every block has a Bloom filter of the bigrams and trigrams of its text,
+//   sized to the length of the text, so it doesn't fill up with long rows. A
+//   search only looks at the blocks whose filter has all the n-grams of the
+//   search text.
+// - Blocks never change once they're built. Update builds a new list of
+//   blocks that shares the ones whose rows didn't change with the old list,
+//   and swaps it in. Searches work on whichever list was current when they
+//   started, so Update never waits for a search, and a search never waits
+//   for Update.
+// - Rows are identified by their absolute row number: the number of rows that
+//   scrolled out of the top of the buffer before it, plus its offset into the
+//   buffer. That's how rows that get recycled by IncrementCircularBuffer fall
+//   out of the index, without the rows after them having to be renumbered.
+// - The Terminal tells the index which rows changed since the last Update,
+//   and only the blocks with those rows are read from the buffer again.
+// - If the scrollback is unbounded, the rows above the buffer are in the
+//   scrollback archive, and the index covers them as well. Blocks of rows that
+//   left the buffer keep their filter, folded to a quarter of the size, and
+//   drop their text. When a query may match one of them, its rows are read
+//   back from the archive, which works without the terminal lock. Archived
+//   rows that never were in a block are read by IndexArchivedRows, also
+//   without the terminal lock.
+// - For find-all, the index also remembers the matches of one query in
+//   every block. They're found a chunk of rows at a time by SearchChunk.
+//   When a block is replaced, its matches are thrown away and searched for again.
+// - A query can also be a regular expression. Like the text of a query, it's
+//   matched against whole lines. CompilePattern finds the runs of literal text
+//   every match has to contain, and the blocks and lines that don't have them
+//   aren't run through the regular expression at all.
+// - This only depends on the standard library, so that it can be tested on
+//   its own. The Terminal hands it the rows of the buffer, and tells it which
+//   glyphs are wide.
+
+#pragma once
+
+#include <regex>
+
+namespace Microsoft::Terminal::Core
+{
+    class SearchIndex final
+    {
+    public:
+        // A match, as the absolute row and column it starts at, and the
+        // absolute row and column it ends before.
+        struct Match
+        {
+            int64_t row;
+            size_t startColumn;
+            int64_t endRow;
+            size_t endColumn;
+        };
+
+        // Returns whether the given glyph takes up two columns.
+        using IsWideGlyph = bool (*)(const std::wstring_view glyph);
+
+        // Reads the row at the given offset into the buffer: its text, and
+        // whether the line continues on the next row.
+        using ReadRow = std::function<void(const int64_t offset, std::wstring& text, bool& wrapped)>;
+
+        // Reads a row of the scrollback archive by its absolute row number.
+        // Archived rows never change. Unlike ReadRow, it's called without the
+        // terminal lock, from whichever thread searches. It returns false if
+        // the row was dropped from the archive.
+        using ReadArchivedRow = std::function<bool(const int64_t row, std::wstring& text, bool& wrapped)>;
+
+        // The rows above the buffer that are still in the scrollback archive:
+        // [firstRow, rowBase), where rowBase is the one passed to Update.
+        struct ArchivedRows
+        {
+            int64_t firstRow;
+            std::shared_ptr<const ReadArchivedRow> readRow;
+        };
+
+        // A compiled regular expression, and the runs of literal text every
+        // match of it has to contain. They're case folded, unless the
+        // pattern is case sensitive.
+        struct Pattern
+        {
+            std::wregex regex;
+            bool caseSensitive;
+            std::vector<std::wstring> literals;
+        };
+
+        // Blocks are cut after the first line that ends once they have this many rows.
+        static constexpr size_t BlockRows = 64;
+
+        // Throws std::regex_error if the pattern isn't valid.
+        static std::shared_ptr<const Pattern> CompilePattern(const std::wstring_view text, const bool caseSensitive);
+
+        explicit SearchIndex(const IsWideGlyph isWideGlyph) noexcept;
+        SearchIndex(const SearchIndex&) = delete;
+        SearchIndex& operator=(const SearchIndex&) = delete;
+
+        // This must be called with the terminal locked for writing.
+        void Update(const int64_t height, const ReadRow& readRow, const int64_t rowBase, const int64_t dirtyTop, const int64_t dirtyBottom, const bool full, const ArchivedRows* archived = nullptr);
+
+        // These don't need the terminal lock.
+        bool IndexArchivedRows(const size_t maxRows);
+        std::optional<Match> FindNext(const std::wstring_view needle, const bool caseSensitive, const bool goForward, const int64_t fromRow, const size_t fromColumn) const;
+        std::optional<Match> FindNextRegex(const Pattern& pattern, const bool goForward, const int64_t fromRow, const size_t fromColumn) const;
+
+        void SetQuery(const std::wstring_view needle, const bool caseSensitive, std::shared_ptr<const Pattern> pattern = nullptr);
+        bool HasQuery() const noexcept;
+        bool SearchChunk(const size_t maxRows);
+        size_t MatchCount() const noexcept;
+        size_t MatchOrdinal(const Match& match) const noexcept;
+        void GetMatchesInRows(const int64_t top, const int64_t bottom, std::vector<Match>& matches) const;
+
+    private:
+        struct Block
+        {
+            // Identifies the block in _results. Unlike its address, it's never reused.
+            uint64_t id;
+            // The absolute row number of the first row.
+            int64_t firstRow;
+            // The text of all the rows, and the offsets into it at which the
+            // rows start, followed by text.size().
+            std::wstring text;
+            std::vector<size_t> rowStarts;
+            // The indices of the rows at which the lines start, followed by
+            // the number of rows.
+            std::vector<size_t> lineStarts;
+            // Whether the last row wrapped. Its line continues on a row that
+            // wasn't there yet, so the block is read again by the next Update.
+            bool open;
+            // Whether the rows are in the scrollback archive. The text is empty
+            // then, and rowStarts only counts the rows. _thaw reads them back.
+            bool archived{ false };
+            // The Bloom filter of the case folded bigrams and trigrams of the
+            // lines. Its size is a power of 2.
+            std::vector<uint64_t> filter;
+
+            size_t RowCount() const noexcept { return rowStarts.size() - 1; }
+            size_t LineCount() const noexcept { return lineStarts.size() - 1; }
+            int64_t EndRow() const noexcept { return firstRow + gsl::narrow_cast<int64_t>(RowCount()); }
+        };
+
+        using Blocks = std::vector<std::shared_ptr<const Block>>;
+
+        struct Snapshot
+        {
+            // The [firstRow, endRow) range of absolute rows the blocks cover.
+            int64_t firstRow{ 0 };
+            int64_t endRow{ 0 };
+            // The archived blocks, which come first. There may be gaps between
+            // them, and before the first of the other blocks. The list is
+            // shared with the next snapshot, unless blocks were archived or
+            // dropped in the meantime.
+            std::shared_ptr<const Blocks> archived;
+            // The other blocks, which have their text. Some of them may be of
+            // archived rows too, until there are enough of them to archive.
+            Blocks blocks;
+            // Where the text of the archived blocks is read from, unless the
+            // active buffer doesn't have a scrollback archive.
+            std::shared_ptr<const ReadArchivedRow> readArchivedRow;
+
+            size_t ArchivedCount() const noexcept { return archived ? archived->size() : 0; }
+            size_t BlockCount() const noexcept { return ArchivedCount() + blocks.size(); }
+            const std::shared_ptr<const Block>& BlockAt(const size_t index) const
+            {
+                const auto archivedCount = ArchivedCount();
+                return index < archivedCount ? archived->at(index) : blocks.at(index - archivedCount);
+            }
+            int64_t HotRow() const noexcept { return blocks.empty() ? endRow : blocks.front()->firstRow; }
+        };
+
+        struct Query
+        {
+            // Already case folded, unless it's case sensitive.
+            std::wstring needle;
+            bool caseSensitive{ false };
+            // If set, the query is this regular expression, and needle is unused.
+            std::shared_ptr<const Pattern> pattern;
+            // The hashes of the n-grams of needle, or of the literals of the
+            // pattern, that a block has to contain.
+            std::vector<uint64_t> grams;
+        };
+
+        static Query _makeQuery(const std::wstring_view needle, const bool caseSensitive, std::shared_ptr<const Pattern> pattern);
+        static bool _mayMatch(const Block& block, const Query& query) noexcept;
+        static std::shared_ptr<const Block> _archive(const Block& block);
+        static std::shared_ptr<const Block> _thaw(const Snapshot& snapshot, const Block& block);
+        static const Block* _withText(const Snapshot& snapshot, const std::shared_ptr<const Block>& block, std::shared_ptr<const Block>& thawed);
+        std::shared_ptr<const Block> _readBlock(const ReadRow& readRow, int64_t row, const int64_t endRow, const std::function<bool(int64_t)>& resumesAt);
+        std::shared_ptr<const Snapshot> _snapshot() const noexcept;
+        static std::shared_ptr<const Blocks> _insertArchived(const std::shared_ptr<const Blocks>& archived, const Blocks& blocks, const int64_t firstRow, const int64_t hotRow);
+        size_t _columnWidth(const std::wstring_view text) const;
+        void _findInLine(const Block& block, const size_t line, const Query& query, std::vector<Match>& matches) const;
+        void _findInBlock(const Snapshot& snapshot, const std::shared_ptr<const Block>& block, const Query& query, std::vector<Match>& matches) const;
+        std::optional<Match> _findNext(const Query& query, const bool goForward, const int64_t fromRow, const size_t fromColumn) const;
+
+        const IsWideGlyph _isWideGlyph;
+
+        // Only ever replaced as a whole, with std::atomic_store.
+        std::shared_ptr<const Snapshot> _blocks;
+        std::atomic<uint64_t> _nextBlockId{ 0 };
+
+        // Guards replacing _blocks, and _archivedBlocks. It's only held to put
+        // a new snapshot together, never while rows are read.
+        std::mutex _blocksLock;
+        // The archived blocks. They're kept while the alternate buffer is
+        // active, even though its snapshots leave them out.
+        std::shared_ptr<const Blocks> _archivedBlocks;
+
+        // Guards the find-all query and its matches. It's only held for as
+        // long as it takes to look them up or store them, never for a search.
+        mutable std::mutex _resultsLock;
+        std::shared_ptr<const Query> _query;
+        std::unordered_map<uint64_t, std::vector<Match>> _results;
+        size_t _matchCount{ 0 };
+    };
+}
@@ -0,0 +1,137 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "pch.h"
+#include "Terminal.hpp"
+#include "SessionPlayer.hpp"
+
+using namespace Microsoft::Terminal::Core;
+
+static const auto _invalidRecording = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+// Method Description:
+// - Reads a recording, and the size of the terminal from its header.
+// Arguments:
+// - path: the asciicast v2 file to play back
+SessionPlayer::SessionPlayer(const std::wstring& path) :
+    _reader{ _open(path) }
+{
+}
+
+Asciicast::Reader SessionPlayer::_open(const std::wstring& path)
+{
+    wil::unique_hfile file{ CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr) };
+    THROW_LAST_ERROR_IF(!file);
+
+    LARGE_INTEGER fileSize{};
+    THROW_IF_WIN32_BOOL_FALSE(GetFileSizeEx(file.get(), &fileSize));
+    std::string contents(gsl::narrow<size_t>(fileSize.QuadPart), '\0');
+
+    DWORD read = 0;
+    THROW_IF_WIN32_BOOL_FALSE(ReadFile(file.get(), contents.data(), gsl::narrow<DWORD>(contents.size()), &read, nullptr));
+    contents.resize(read);
+
+    try
+    {
+        return Asciicast::Reader{ std::move(contents) };
+    }
+    catch (const Asciicast::InvalidRecording&)
+    {
+        THROW_HR(_invalidRecording);
+    }
+}
+
+// Method Description:
+// - Returns the size the terminal had when the recording started.
+COORD SessionPlayer::Size() const noexcept
+{
+    return { gsl::narrow_cast<SHORT>(_reader.Width()), gsl::narrow_cast<SHORT>(_reader.Height()) };
+}
+
+// Method Description:
+// - Reads the next event of the recording.
+// Arguments:
+// - event: receives the event
+// Return Value:
+// - false if there are no events left.
+bool SessionPlayer::Next(Event& event)
+{
+    try
+    {
+        return _reader.Next(event);
+    }
+    catch (const Asciicast::InvalidRecording&)
+    {
+        THROW_HR(_invalidRecording);
+    }
+}
+
+// Method Description:
+// - Goes back to the first event of the recording.
+void SessionPlayer::Rewind() noexcept
+{
+    _reader.Rewind();
+}
+
+// Method Description:
+// - Creates a headless terminal with the size the recording started at.
+// Arguments:
+// - scrollbackLines: the number of rows of scrollback the terminal gets
+std::unique_ptr<Terminal> SessionPlayer::CreateTerminal(const SHORT scrollbackLines) const
+{
+    auto terminal = std::make_unique<Terminal>();
+    terminal->CreateHeadless(Size(), scrollbackLines);
+    return terminal;
+}
+
+// Method Description:
+// - Plays the rest of the recording back into a terminal: the output is
+//   written to it in the chunks it was recorded in, and it's resized
+//   whenever the connection was.
+// Arguments:
+// - terminal: the terminal to play the recording into, usually one from CreateTerminal
+// - realTime: if true, every event waits for the time it was recorded at.
+//   Otherwise the events are played back as fast as the terminal takes them.
+// Return Value:
+// - The number of events and characters played back, and how long that took.
+SessionPlayer::Statistics SessionPlayer::Play(Terminal& terminal, const bool realTime)
+{
+    Statistics statistics;
+    Event event{};
+    const auto start = std::chrono::steady_clock::now();
+
+    while (Next(event))
+    {
+        if (realTime)
+        {
+            std::this_thread::sleep_until(start + event.time);
+        }
+
+        if (event.type == L'o')
+        {
+            terminal.Write(event.data);
+            statistics.characters += event.data.size();
+        }
+        else if (event.type == L'r')
+        {
+            const auto size = Asciicast::ParseSize(event.data);
+            if (!size)
+            {
+                continue;
+            }
+
+            const auto lock = terminal.LockForWriting();
+            LOG_IF_FAILED(terminal.UserResize({ gsl::narrow_cast<SHORT>(size->first), gsl::narrow_cast<SHORT>(size->second) }));
+            terminal.FinishReflow();
+        }
+        else
+        {
+            continue;
+        }
+
+        statistics.events++;
+    }
+
+    statistics.elapsed = std::chrono::steady_clock::now() - start;
+    return statistics;
+}
@@ -0,0 +1,48 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+// Module Name:
+// - SessionPlayer.hpp
+//
+// Abstract:
+// - Plays a recording SessionRecorder made back into a Terminal, at the
+//   recorded speed or as fast as it goes.
+// - The recording has the exact code units the connection handed us, in the
+//   exact chunks, so the parser is fed just like it was during the session.
+
+#pragma once
+
+#include "Asciicast.hpp"
+
+namespace Microsoft::Terminal::Core
+{
+    class Terminal;
+
+    class SessionPlayer final
+    {
+    public:
+        // Play ignores events other than output and resizes.
+        using Event = Asciicast::Event;
+
+        struct Statistics
+        {
+            size_t events{ 0 };
+            size_t characters{ 0 };
+            std::chrono::steady_clock::duration elapsed{};
+        };
+
+        explicit SessionPlayer(const std::wstring& path);
+
+        COORD Size() const noexcept;
+        bool Next(Event& event);
+        void Rewind() noexcept;
+
+        std::unique_ptr<Terminal> CreateTerminal(const SHORT scrollbackLines) const;
+        Statistics Play(Terminal& terminal, const bool realTime);
+
+    private:
+        static Asciicast::Reader _open(const std::wstring& path);
+
+        Asciicast::Reader _reader;
+    };
+}
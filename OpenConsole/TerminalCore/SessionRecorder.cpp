@@ -0,0 +1,105 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "pch.h"
+#include "SessionRecorder.hpp"
+
+#include <ctime>
+#include <filesystem>
+
+using namespace Microsoft::Terminal::Core;
+
+// Method Description:
+// - Creates the recording, and writes its header.
+// Arguments:
+// - path: the file to record to. It's overwritten if it already exists.
+// - width, height: the size of the terminal, in characters
+SessionRecorder::SessionRecorder(const std::wstring& path, const int width, const int height) :
+    _file{ std::filesystem::path{ path }, std::ios::binary | std::ios::trunc },
+    _start{ std::chrono::steady_clock::now() },
+    _lastFlush{ _start }
+{
+    if (!_file)
+    {
+        throw std::runtime_error{ "can't create the session recording" };
+    }
+
+    Asciicast::AppendHeader(_buffer, width, height, static_cast<int64_t>(std::time(nullptr)));
+    _flush();
+}
+
+SessionRecorder::~SessionRecorder()
+{
+    Flush();
+}
+
+// Method Description:
+// - Records a chunk of output, exactly as the connection handed it to us.
+void SessionRecorder::Output(const std::wstring_view text)
+{
+    const std::lock_guard lock{ _lock };
+    if (!_file.is_open())
+    {
+        return;
+    }
+
+    Asciicast::AppendOutput(_buffer, std::chrono::steady_clock::now() - _start, text);
+    _flushIfDue();
+}
+
+// Method Description:
+// - Records that the connection was resized.
+void SessionRecorder::Resize(const int width, const int height)
+{
+    const std::lock_guard lock{ _lock };
+    if (!_file.is_open())
+    {
+        return;
+    }
+
+    Asciicast::AppendResize(_buffer, std::chrono::steady_clock::now() - _start, width, height);
+    _flushIfDue();
+}
+
+// Method Description:
+// - Writes the events that were buffered so far to the file.
+void SessionRecorder::Flush() noexcept
+{
+    const std::lock_guard lock{ _lock };
+    _flush();
+}
+
+bool SessionRecorder::Recording() const noexcept
+{
+    const std::lock_guard lock{ _lock };
+    return _file.is_open();
+}
+
+// Writes the buffered events out once there are enough of them, or once they're old enough.
+void SessionRecorder::_flushIfDue()
+{
+    if (_buffer.size() >= FlushSize || std::chrono::steady_clock::now() - _lastFlush >= FlushInterval)
+    {
+        _flush();
+    }
+}
+
+// Method Description:
+// - Writes the buffered events to the file. If that fails, the recording
+//   stops, rather than leaving a hole in it.
+void SessionRecorder::_flush() noexcept
+{
+    _lastFlush = std::chrono::steady_clock::now();
+    if (!_file.is_open() || _buffer.empty())
+    {
+        return;
+    }
+
+    _file.write(_buffer.data(), gsl::narrow_cast<std::streamsize>(_buffer.size()));
+    _file.flush();
+    if (!_file)
+    {
+        _file.close();
+    }
+    _buffer.clear();
+}
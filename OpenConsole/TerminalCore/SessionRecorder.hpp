@@ -0,0 +1,58 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+// Module Name:
+// - SessionRecorder.hpp
+//
+// Abstract:
+// - Records the output a session receives from its connection into an
+//   asciicast v2 file, like the ones asciinema writes. See Asciicast.hpp.
+//   SessionPlayer plays a recording back into a Terminal.
+// - The times come from a monotonic clock, and are relative to the start of
+//   the recording.
+// - The connection hands us UTF-16, and a chunk of it may end in the middle of
+//   a surrogate pair. Recordings keep those lone surrogates, so that playing a
+//   recording feeds the parser the exact same code units, in the exact same
+//   chunks.
+// - This only depends on the standard library, so that it can be tested on
+//   its own.
+
+#pragma once
+
+#include "Asciicast.hpp"
+
+#include <fstream>
+
+namespace Microsoft::Terminal::Core
+{
+    class SessionRecorder final
+    {
+    public:
+        SessionRecorder(const std::wstring& path, const int width, const int height);
+        ~SessionRecorder();
+        SessionRecorder(const SessionRecorder&) = delete;
+        SessionRecorder& operator=(const SessionRecorder&) = delete;
+
+        // These may be called from any thread.
+        void Output(const std::wstring_view text);
+        void Resize(const int width, const int height);
+        void Flush() noexcept;
+        // Returns false once writing to the file failed. Nothing is recorded after that.
+        bool Recording() const noexcept;
+
+    private:
+        // The buffered events are written to the file once there are this
+        // many bytes of them, or once they're this old.
+        static constexpr size_t FlushSize = 64 * 1024;
+        static constexpr auto FlushInterval = std::chrono::seconds(1);
+
+        void _flushIfDue();
+        void _flush() noexcept;
+
+        mutable std::mutex _lock;
+        std::ofstream _file;
+        std::string _buffer;
+        std::chrono::steady_clock::time_point _start;
+        std::chrono::steady_clock::time_point _lastFlush;
+    };
+}
@@ -0,0 +1,69 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+// Module Name:
+// - SharedTicketLock.hpp
+//
+// Abstract:
+// - A reader/writer lock that keeps the FIFO fairness of til::ticket_lock.
+//   Readers and writers alike enter through a ticket_lock, so nobody can
+//   barge ahead of a thread that has been waiting for longer. Readers only
+//   hold on to the ticket for as long as it takes to register themselves,
+//   which lets any number of them be inside at the same time. A writer holds
+//   on to its ticket until it unlocks and additionally waits for the readers
+//   that came before it to leave.
+// - We don't use std::shared_mutex here, because SRWLOCKs aren't fair: the
+//   VT parser re-acquires the lock in a tight loop while output is flowing,
+//   and would starve the render thread.
+
+#pragma once
+
+#include <til/ticket_lock.h>
+
+namespace Microsoft::Terminal::Core
+{
+    class SharedTicketLock
+    {
+    public:
+        SharedTicketLock() = default;
+        SharedTicketLock(const SharedTicketLock&) = delete;
+        SharedTicketLock& operator=(const SharedTicketLock&) = delete;
+
+        void lock() noexcept
+        {
+            _entry.lock();
+
+            auto readers = _readers.load(std::memory_order_acquire);
+            while (readers != 0)
+            {
+                WaitOnAddress(&_readers, &readers, sizeof(readers), INFINITE);
+                readers = _readers.load(std::memory_order_acquire);
+            }
+        }
+
+        void unlock() noexcept
+        {
+            _entry.unlock();
+        }
+
+        void lock_shared() noexcept
+        {
+            _entry.lock();
+            _readers.fetch_add(1, std::memory_order_relaxed);
+            _entry.unlock();
+        }
+
+        void unlock_shared() noexcept
+        {
+            if (_readers.fetch_sub(1, std::memory_order_release) == 1)
+            {
+                // We were the last reader. A writer might be waiting for us.
+                WakeByAddressSingle(&_readers);
+            }
+        }
+
+    private:
+        til::ticket_lock _entry;
+        std::atomic<uint32_t> _readers{ 0 };
+    };
+}
@@ -0,0 +1,134 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "pch.h"
+#include "SpillFile.hpp"
+
+using namespace Microsoft::Terminal::Core;
+
+static constexpr size_t _alignUp(const size_t value, const size_t alignment) noexcept
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// Copies bytes from or to a mapped segment of the file. If the file can't be
+// read or written, touching the mapping raises EXCEPTION_IN_PAGE_ERROR
+// instead of failing, so that's caught here. There mustn't be anything to
+// unwind.
+static bool _copy(void* const destination, const void* const source, const size_t size) noexcept
+{
+    __try
+    {
+        memcpy(destination, source, size);
+        return true;
+    }
+    __except (GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+    {
+        return false;
+    }
+}
+
+// Method Description:
+// - Creates an empty file in the temp directory.
+SpillFile::SpillFile()
+{
+    wchar_t directory[MAX_PATH + 1];
+    const auto length = GetTempPathW(ARRAYSIZE(directory), &directory[0]);
+    THROW_LAST_ERROR_IF(length == 0 || length > ARRAYSIZE(directory));
+
+    // GetTempFileNameW creates the file, which reserves its name for us.
+    wchar_t path[MAX_PATH];
+    THROW_LAST_ERROR_IF(GetTempFileNameW(&directory[0], L"wts", 0, &path[0]) == 0);
+
+    wil::unique_hfile file{ CreateFileW(&path[0], GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr) };
+    if (!file)
+    {
+        const auto error = GetLastError();
+        LOG_IF_WIN32_BOOL_FALSE(DeleteFileW(&path[0]));
+        THROW_WIN32(error);
+    }
+
+    _path = &path[0];
+    _file = std::move(file);
+}
+
+// Returns where the file is. It's gone once the SpillFile is destroyed.
+const std::filesystem::path& SpillFile::Path() const noexcept
+{
+    return _path;
+}
+
+// Method Description:
+// - Reserves the given number of bytes at the end of the file. They're all in
+//   the same segment. The file is grown by a segment at a time.
+// Arguments:
+// - size: the number of bytes
+// Return Value:
+// - Where the bytes are.
+SpillFile::Position SpillFile::Reserve(const size_t size)
+{
+    if (_segments.empty() || _segmentUsed + size > _segments.back().size)
+    {
+        // Views have to start at a multiple of the allocation granularity,
+        // which every multiple of SegmentSize is.
+        const auto segmentSize = _alignUp(size, SegmentSize);
+        const uint64_t fileSize = _fileSize + segmentSize;
+
+        // Creating a mapping that's larger than the file grows the file.
+        Segment segment;
+        segment.mapping.reset(CreateFileMappingW(_file.get(), nullptr, PAGE_READWRITE, gsl::narrow_cast<DWORD>(fileSize >> 32), gsl::narrow_cast<DWORD>(fileSize), nullptr));
+        THROW_LAST_ERROR_IF(!segment.mapping);
+        segment.view.reset(static_cast<std::byte*>(MapViewOfFile(segment.mapping.get(), FILE_MAP_READ | FILE_MAP_WRITE, gsl::narrow_cast<DWORD>(uint64_t{ _fileSize } >> 32), gsl::narrow_cast<DWORD>(_fileSize), segmentSize)));
+        THROW_LAST_ERROR_IF(!segment.view);
+        segment.size = segmentSize;
+
+        _segments.emplace_back(std::move(segment));
+        _fileSize = gsl::narrow_cast<size_t>(fileSize);
+        _segmentUsed = 0;
+    }
+
+    const Position position{ _segments.size() - 1, _segmentUsed };
+    _segmentUsed += size;
+    return position;
+}
+
+// Method Description:
+// - Copies bytes into the file, at a position Reserve returned.
+// Return Value:
+// - false if the file couldn't be written.
+bool SpillFile::Write(const Position position, const void* const source, const size_t size) noexcept
+{
+    if (!_copy(til::at(_segments, position.segment).view.get() + position.offset, source, size))
+    {
+        LOG_HR_MSG(HRESULT_FROM_WIN32(ERROR_WRITE_FAULT), "Couldn't write archived rows to the spill file");
+        return false;
+    }
+    return true;
+}
+
+// Method Description:
+// - Copies bytes out of the file, from a position Reserve returned.
+// Return Value:
+// - false if the file couldn't be read.
+bool SpillFile::Read(const Position position, void* const destination, const size_t size) const noexcept
+{
+    if (!_copy(destination, til::at(_segments, position.segment).view.get() + position.offset, size))
+    {
+        LOG_HR_MSG(HRESULT_FROM_WIN32(ERROR_READ_FAULT), "Couldn't read archived rows from the spill file");
+        return false;
+    }
+    return true;
+}
+
+// Method Description:
+// - Unmaps all segments and truncates the file, which is reused from its start.
+void SpillFile::Clear() noexcept
+{
+    _segments.clear();
+    _fileSize = 0;
+    _segmentUsed = 0;
+
+    // A file can only be truncated once nothing maps it anymore.
+    LOG_IF_WIN32_BOOL_FALSE(SetFilePointerEx(_file.get(), LARGE_INTEGER{}, nullptr, FILE_BEGIN));
+    LOG_IF_WIN32_BOOL_FALSE(SetEndOfFile(_file.get()));
+}
@@ -0,0 +1,58 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+// Module Name:
+// - SpillFile.hpp
+//
+// Abstract:
+// - The temporary file a ScrollbackArchive moves the blocks that exceed its
+//   memory budget into. The file is mapped into memory in segments of (at
+//   least) SegmentSize bytes, which all stay mapped, so that reading a block
+//   back is just a copy out of the mapping.
+// - Nobody else can open the file, and the system deletes it once the last
+//   handle to it is closed, even if we crash. That's when the SpillFile is
+//   destroyed.
+
+#pragma once
+
+namespace Microsoft::Terminal::Core
+{
+    class SpillFile final
+    {
+    public:
+        // Where Reserve put some bytes: the segment, and the offset in it.
+        struct Position
+        {
+            size_t segment;
+            size_t offset;
+        };
+
+        SpillFile();
+        SpillFile(const SpillFile&) = delete;
+        SpillFile& operator=(const SpillFile&) = delete;
+
+        const std::filesystem::path& Path() const noexcept;
+
+        Position Reserve(const size_t size);
+        bool Write(const Position position, const void* const source, const size_t size) noexcept;
+        bool Read(const Position position, void* const destination, const size_t size) const noexcept;
+        void Clear() noexcept;
+
+    private:
+        static constexpr size_t SegmentSize = 64 * 1024 * 1024;
+
+        struct Segment
+        {
+            wil::unique_handle mapping;
+            wil::unique_mapview_ptr<std::byte> view;
+            size_t size;
+        };
+
+        std::filesystem::path _path;
+        wil::unique_hfile _file;
+        // Bytes are reserved at the end of the last segment, at _segmentUsed.
+        std::vector<Segment> _segments;
+        size_t _fileSize{ 0 };
+        size_t _segmentUsed{ 0 };
+    };
+}
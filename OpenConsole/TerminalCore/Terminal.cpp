@@ -18,9 +18,12 @@ using namespace Microsoft::Console::VirtualTerminal;
 
 using PointTree = interval_tree::IntervalTree<til::point, size_t>;
 
-static std::wstring _KeyEventsToText(std::deque<std::unique_ptr<IInputEvent>>& inEventsToWrite)
+// Collects the characters of the given key events into `wstr`, which is
+// cleared first. Passing the same string in every time lets us reuse its
+// storage instead of allocating one per key press.
+static void _KeyEventsToText(std::deque<std::unique_ptr<IInputEvent>>& inEventsToWrite, std::wstring& wstr)
 {
-    std::wstring wstr = L"";
+    wstr.clear();
     for (const auto& ev : inEventsToWrite)
     {
         if (ev->EventType() == InputEventType::KeyEvent)
@@ -30,7 +33,6 @@ static std::wstring _KeyEventsToText(std::deque<std::unique_ptr<IInputEvent>>& i
             wstr += wch;
         }
     }
-    return wstr;
 }
 
 #pragma warning(suppress : 26455) // default constructor is throwing, too much effort to rearrange at this time.
@@ -53,8 +55,8 @@ Terminal::Terminal() :
         {
             return;
         }
-        auto wstr = _KeyEventsToText(inEventsToWrite);
-        _pfnWriteInput(wstr);
+        _KeyEventsToText(inEventsToWrite, _keyEventText);
+        _pfnWriteInput(_keyEventText);
     };
 
     _terminalInput = std::make_unique<TerminalInput>(passAlongInput);
@@ -97,12 +99,52 @@ void Terminal::CreateFromSettings(ICoreSettings settings,
     const COORD viewportSize{ Utils::ClampToShortMax(settings.InitialCols(), 1),
                               Utils::ClampToShortMax(settings.InitialRows(), 1) };
 
-    // TODO:MSFT:20642297 - Support infinite scrollback here, if HistorySize is -1
-    Create(viewportSize, Utils::ClampToShortMax(settings.HistorySize(), 0), renderer);
+    // A HistorySize of -1 means that the scrollback is unbounded. The buffer
+    // keeps the most recent rows, and _AdjustCursorPosition moves the rows
+    // that scroll out of it into the archive.
+    const auto historySize = settings.HistorySize();
+    if (historySize < 0)
+    {
+        Create(viewportSize, InfiniteScrollbackBufferRows, renderer);
+        _scrollbackArchive = std::make_shared<ScrollbackArchive>(InfiniteScrollbackMemoryBudget);
+        if (settings.SpillScrollbackToDisk())
+        {
+            // If we can't, we'll just drop the oldest rows instead.
+            try
+            {
+                _scrollbackArchive->EnableSpilling();
+            }
+            CATCH_LOG();
+        }
+    }
+    else
+    {
+        Create(viewportSize, Utils::ClampToShortMax(historySize, 0), renderer);
+    }
 
     UpdateSettings(settings);
 }
 
+// Method Description:
+// - Initializes the Terminal without any render target attached. The Terminal
+//   owns a Renderer that has no engines and no render thread, so the parser
+//   and the buffer work just like usual, but nothing is ever painted.
+// - This is useful for replaying recorded sessions, fuzzing or indexing
+//   output on machines that don't have a GPU (or a window) at all.
+// Arguments:
+// - viewportSize: the size of the viewport, in characters
+// - scrollbackLines: the number of lines of history to keep
+void Terminal::CreateHeadless(COORD viewportSize, SHORT scrollbackLines)
+{
+    _headlessRenderer = std::make_unique<Renderer>(_renderSettings, this, nullptr, 0, nullptr);
+    Create(viewportSize, scrollbackLines, *_headlessRenderer);
+}
+
+bool Terminal::IsHeadless() const noexcept
+{
+    return _headlessRenderer != nullptr;
+}
+
 // Method Description:
 // - Update our internal properties to match the new values in the provided
 //   CoreSettings object.
@@ -221,8 +263,27 @@ void Terminal::SetCursorStyle(const DispatchTypes::CursorStyle cursorStyle)
     engine.Dispatch().SetCursorStyle(cursorStyle);
 }
 
+// Method Description:
+// - Throws away the rows that scrolled out of the buffer, if the scrollback is
+//   unbounded. This deletes the file they were spilled to, if there's one.
+void Terminal::DiscardScrollbackArchive() noexcept
+{
+    _LeaveHistory();
+    _scrollbackArchive.reset();
+    _searchArchiveReader.reset();
+    _searchIndexNeedsFullUpdate = true;
+}
+
 void Terminal::EraseScrollback()
 {
+    _LeaveHistory();
+    FinishReflow();
+
+    if (_scrollbackArchive)
+    {
+        _scrollbackArchive->Clear();
+    }
+
     auto& engine = reinterpret_cast<OutputStateMachineEngine&>(_stateMachine->Engine());
     engine.Dispatch().EraseInDisplay(DispatchTypes::EraseType::Scrollback);
 }
@@ -246,6 +307,29 @@ std::wstring_view Terminal::GetWorkingDirectory()
 //      nothing to do (the viewportSize is the same as our current size), or an
 //      appropriate HRESULT for failing to resize.
 [[nodiscard]] HRESULT Terminal::UserResize(const COORD viewportSize) noexcept
+{
+    const auto hr = _Resize(viewportSize, true);
+    UpdateSearchHighlightsUnderLock();
+    return hr;
+}
+
+// Method Description:
+// - Resize the terminal.
+// - If lazily is set, and there's enough scrollback above the visible region,
+//   only the rows from a screenful above the visible region down are reflowed.
+//   They're all that can be seen until the user scrolls up. The main buffer
+//   then only holds those rows, and the whole buffer is kept in _reflowSource
+//   until FinishReflow reflows the rest. Further resizes in the meantime start
+//   over from _reflowSource, so a window that's being dragged never reflows
+//   more than the tail of the buffer. Once output was written to the main
+//   buffer, they reflow the main buffer instead, and leave the rows above it
+//   where they are.
+// Arguments:
+// - viewportSize: the new size of the viewport, in chars
+// - lazily: whether to put off reflowing the rows that can't be seen
+// Return Value:
+// - See UserResize.
+[[nodiscard]] HRESULT Terminal::_Resize(const COORD viewportSize, const bool lazily) noexcept
 {
     const auto oldDimensions = _GetMutableViewport().Dimensions();
     if (viewportSize == oldDimensions)
@@ -253,6 +337,14 @@ std::wstring_view Terminal::GetWorkingDirectory()
         return S_FALSE;
     }
 
+    // The page of archived rows has the old width.
+    _LeaveHistory();
+
+    // The text is about to be reflowed, the patterns we found so far are useless.
+    _patternsNeedFullScan = true;
+    _searchIndexNeedsFullUpdate = true;
+    ++_rowGeneration;
+
     // Shortcut: if we're in the alt buffer, just resize the
     // alt buffer and put off resizing the main buffer till we switch back. Fortunately, this is easy. We don't need to
     // worry about the viewport and scrollback at all! The alt buffer never has
@@ -279,12 +371,62 @@ std::wstring_view Terminal::GetWorkingDirectory()
         return S_OK;
     }
 
-    const auto dx = ::base::ClampSub(viewportSize.X, oldDimensions.X);
+    if (!lazily)
+    {
+        FinishReflow();
+    }
+
+    if (_reflowSource && !_reflowTailWritten)
+    {
+        // The main buffer only holds the tail of _reflowSource, and nothing
+        // was written to it since. Start over from _reflowSource, so that the
+        // text isn't wrapped twice, and lines that were cut off by a narrower
+        // size in between get their text back.
+        _mainBuffer = std::move(_reflowSource);
+        _mutableViewport = _reflowSourceViewport;
+        _scrollOffset = _reflowSourceScrollOffset;
+
+        if (viewportSize == _mutableViewport.Dimensions())
+        {
+            // We're back to the size we started at, there's nothing to reflow.
+            _mainBuffer->GetCursor().EndDeferDrawing();
+            try
+            {
+                _activeBuffer().TriggerRedrawAll();
+            }
+            CATCH_LOG();
+            _NotifyScrollEvent();
+            return S_OK;
+        }
+    }
+
+    const auto dx = ::base::ClampSub(viewportSize.X, _mutableViewport.Width());
     const short newBufferHeight = ::base::ClampAdd(viewportSize.Y, _scrollbackLines);
 
     COORD bufferSize{ viewportSize.X, newBufferHeight };
 
+    // Whether the main buffer is the tail of _reflowSource, with output
+    // written to it. It's reflowed on its own then, and _reflowSource is kept.
+    const auto headPending = _reflowSource != nullptr;
+
+    // The first row to reflow. If it's not 0, the rows above it are left for FinishReflow.
+    SHORT tailTop = 0;
+    try
+    {
+        tailTop = lazily && !headPending ? _LazyReflowTop() : 0;
+    }
+    CATCH_LOG();
+
+    if (tailTop > 0 || headPending)
+    {
+        // Every row of the tail turns into at most this many rows at the new width.
+        const auto rowsPerRow = (_mutableViewport.Width() + viewportSize.X - 1) / viewportSize.X;
+        const auto tailRows = _mutableViewport.BottomExclusive() - tailTop;
+        bufferSize.Y = std::min(newBufferHeight, ::base::saturated_cast<short>(tailRows * rowsPerRow + viewportSize.Y));
+    }
+
     // This will be used to determine where the viewport should be in the new buffer.
+    const auto oldViewport = _mutableViewport;
     const auto oldViewportTop = _mutableViewport.Top();
     auto newViewportTop = oldViewportTop;
     auto newVisibleTop = ::base::saturated_cast<short>(_VisibleStartIndex());
@@ -331,11 +473,25 @@ std::wstring_view Terminal::GetWorkingDirectory()
         oldRows.mutableViewportTop = oldViewportTop;
         oldRows.visibleViewportTop = newVisibleTop;
 
-        const std::optional<short> oldViewStart{ oldViewportTop };
-        RETURN_IF_FAILED(TextBuffer::Reflow(*_mainBuffer.get(),
-                                            *newTextBuffer.get(),
-                                            _mutableViewport,
-                                            { oldRows }));
+        if (tailTop > 0)
+        {
+            // Only reflow the rows from tailTop down. They're copied into a
+            // buffer of their own, so all the rows are relative to tailTop.
+            const auto tail = _CopyRows(*_mainBuffer, tailTop, _mutableViewport.BottomExclusive());
+            oldRows.mutableViewportTop = ::base::ClampSub(oldRows.mutableViewportTop, tailTop);
+            oldRows.visibleViewportTop = ::base::ClampSub(oldRows.visibleViewportTop, tailTop);
+            RETURN_IF_FAILED(TextBuffer::Reflow(*tail.get(),
+                                                *newTextBuffer.get(),
+                                                Viewport::FromDimensions({ 0, oldRows.mutableViewportTop }, oldViewport.Dimensions()),
+                                                { oldRows }));
+        }
+        else
+        {
+            RETURN_IF_FAILED(TextBuffer::Reflow(*_mainBuffer.get(),
+                                                *newTextBuffer.get(),
+                                                _mutableViewport,
+                                                { oldRows }));
+        }
 
         newViewportTop = oldRows.mutableViewportTop;
         newVisibleTop = oldRows.visibleViewportTop;
@@ -450,6 +606,16 @@ std::wstring_view Terminal::GetWorkingDirectory()
 
     _mainBuffer.swap(newTextBuffer);
 
+    if (tailTop > 0)
+    {
+        // Hold on to the whole buffer for FinishReflow.
+        _reflowSource = std::move(newTextBuffer);
+        _reflowSourceViewport = oldViewport;
+        _reflowSourceScrollOffset = _scrollOffset;
+        _reflowTailTop = tailTop;
+        _reflowTailWritten = false;
+    }
+
     // GH#3494: Maintain scrollbar position during resize
     // Make sure that we don't scroll past the mutableViewport at the bottom of the buffer
     newVisibleTop = std::min(newVisibleTop, _mutableViewport.Top());
@@ -471,9 +637,242 @@ std::wstring_view Terminal::GetWorkingDirectory()
     return S_OK;
 }
 
+// Method Description:
+// - Returns whether the last resize left rows for FinishReflow.
+bool Terminal::IsReflowPending() const noexcept
+{
+    return _reflowSource != nullptr;
+}
+
+// Method Description:
+// - Reflows the rows that the last resize left alone, see _Resize. Until
+//   then, the main buffer only holds the rows around the viewport, and any
+//   output that arrives is written to those. Whatever needs all of the rows
+//   calls this first, and so does scrolling up to the top of the main buffer.
+//   The control also calls it once the size stopped changing.
+// - Only the rows above the main buffer are reflowed. The main buffer's rows
+//   are copied below them as they are, so the viewport and the selection
+//   just move down along with them.
+// - INVARIANT: this function can only be called if the caller has the writing lock on the terminal
+void Terminal::FinishReflow() noexcept
+try
+{
+    if (!_reflowSource)
+    {
+        return;
+    }
+
+    auto source = std::move(_reflowSource);
+    _reflowTailWritten = false;
+
+    auto& tail = *_mainBuffer;
+    const auto width = tail.GetSize().Width();
+    const short height = ::base::ClampAdd(_mutableViewport.Height(), _scrollbackLines);
+    auto newTextBuffer = std::make_unique<TextBuffer>(COORD{ width, height },
+                                                      TextAttribute{},
+                                                      0, // temporarily set size to 0 so it won't render.
+                                                      tail.IsActiveBuffer(),
+                                                      tail.GetRenderer());
+    newTextBuffer->GetCursor().StartDeferDrawing();
+
+    // Reflow copies the rows up to the last character in the given viewport,
+    // and the ones down to the cursor below it. With the cursor at the start
+    // of the last row above the tail, that's exactly the rows above the tail,
+    // blank ones included. _LazyReflowTop made sure that row isn't wrapped.
+    source->GetCursor().SetPosition({ 0, gsl::narrow_cast<SHORT>(_reflowTailTop - 1) });
+    THROW_IF_FAILED(TextBuffer::Reflow(*source,
+                                       *newTextBuffer,
+                                       Viewport::FromDimensions({ 0, 0 }, { source->GetSize().Width(), _reflowTailTop }),
+                                       std::nullopt));
+    source.reset();
+
+    const auto headCursor = newTextBuffer->GetCursor().GetPosition();
+    const auto headLastChar = newTextBuffer->GetLastNonSpaceCharacter();
+    auto tailTop = gsl::narrow_cast<SHORT>(std::max(headCursor.Y, headLastChar.Y) + 1);
+
+    // Make room for the tail, the way _AdjustCursorPosition would.
+    const auto tailRows = _mutableViewport.BottomExclusive();
+    for (auto overflow = tailTop + tailRows - height; overflow > 0; --overflow)
+    {
+        if (_scrollbackArchive)
+        {
+            _ArchiveRow(*newTextBuffer, 0);
+        }
+        newTextBuffer->IncrementCircularBuffer();
+        --tailTop;
+    }
+
+    _CopyRowsTo(tail, 0, tailRows, *newTextBuffer, tailTop);
+    newTextBuffer->CopyHyperlinkMaps(tail);
+    newTextBuffer->SetCurrentAttributes(tail.GetCurrentAttributes());
+
+    auto& cursor = newTextBuffer->GetCursor();
+    auto cursorPosition = tail.GetCursor().GetPosition();
+    cursorPosition.Y += tailTop;
+    cursor.CopyProperties(tail.GetCursor());
+    cursor.SetPosition(cursorPosition);
+
+    _mutableViewport = Viewport::FromDimensions({ 0, gsl::narrow_cast<SHORT>(_mutableViewport.Top() + tailTop) },
+                                                _mutableViewport.Dimensions());
+    if (_selection)
+    {
+        _selection->start.Y += tailTop;
+        _selection->end.Y += tailTop;
+        _selection->pivot.Y += tailTop;
+    }
+
+    // Every row moved, like they do for any other resize.
+    _patternsNeedFullScan = true;
+    _searchIndexNeedsFullUpdate = true;
+    ++_rowGeneration;
+
+    _mainBuffer.swap(newTextBuffer);
+    _mainBuffer->GetCursor().EndDeferDrawing();
+    UpdateSearchHighlightsUnderLock();
+
+    _activeBuffer().TriggerRedrawAll();
+    _NotifyScrollEvent();
+}
+CATCH_LOG()
+
+// Method Description:
+// - Makes room for more rows in the main buffer, while a lazy resize left
+//   rows in _reflowSource. They belong above the main buffer, so instead of
+//   circling it, it's grown up to the size the whole buffer would have.
+// - Once it's that big, the rows in _reflowSource would have scrolled out of
+//   the buffer by now. They go to the scrollback archive if there's one, at
+//   the width they have, and are thrown away otherwise.
+// Arguments:
+// - rows: the number of rows the main buffer has to hold.
+// Return Value:
+// - <none>
+void Terminal::_GrowReflowTail(const int rows)
+{
+    const auto size = _mainBuffer->GetSize().Dimensions();
+    const short capacity = ::base::ClampAdd(_mutableViewport.Height(), _scrollbackLines);
+    if (size.Y < capacity)
+    {
+        // Grow it by at least half, so the rows aren't moved for every line of output.
+        const auto height = std::min<int>(capacity, std::max(rows, size.Y + size.Y / 2));
+        THROW_IF_FAILED(_mainBuffer->ResizeTraditional({ size.X, gsl::narrow_cast<SHORT>(height) }));
+        if (rows <= height)
+        {
+            return;
+        }
+    }
+
+    if (_scrollbackArchive)
+    {
+        for (SHORT row = 0; row < _reflowTailTop; ++row)
+        {
+            _ArchiveRow(*_reflowSource, row);
+        }
+
+        // The rows of the main buffer come after the archive, see _SearchRowBase.
+        _searchIndexNeedsFullUpdate = true;
+    }
+    _reflowSource.reset();
+    _reflowTailWritten = false;
+}
+
+// Method Description:
+// - Finds the first row a lazy resize has to reflow: a screenful above the
+//   top of the visible region, or rather the start of the line that row is part of.
+// Return Value:
+// - The row, or 0 if there aren't enough rows above it to bother.
+SHORT Terminal::_LazyReflowTop() const
+{
+    auto top = std::min<int>(_VisibleStartIndex(), _mutableViewport.Top()) - _mutableViewport.Height();
+    while (top >= LazyReflowMinimumRows && _mainBuffer->GetRowByOffset(gsl::narrow_cast<SHORT>(top - 1)).WasWrapForced())
+    {
+        top--;
+    }
+    return top >= LazyReflowMinimumRows ? gsl::narrow_cast<SHORT>(top) : SHORT{ 0 };
+}
+
+// Method Description:
+// - Copies some rows of a buffer into a new buffer of the same width, along
+//   with the cursor. The cursor must be within those rows.
+// Arguments:
+// - buffer: the buffer to copy the rows of
+// - top: the first row to copy
+// - bottom: the row after the last row to copy
+// Return Value:
+// - A buffer that holds only those rows.
+std::unique_ptr<TextBuffer> Terminal::_CopyRows(TextBuffer& buffer, const SHORT top, const SHORT bottom)
+{
+    const auto width = buffer.GetSize().Width();
+    auto copy = std::make_unique<TextBuffer>(COORD{ width, gsl::narrow<SHORT>(bottom - top) },
+                                             TextAttribute{},
+                                             0,
+                                             false,
+                                             buffer.GetRenderer());
+    copy->CopyHyperlinkMaps(buffer);
+    copy->GetCursor().CopyProperties(buffer.GetCursor());
+
+    _CopyRowsTo(buffer, top, bottom, *copy, 0);
+
+    auto cursorPosition = buffer.GetCursor().GetPosition();
+    cursorPosition.Y = ::base::ClampSub(cursorPosition.Y, top);
+    copy->GetCursor().SetPosition(cursorPosition);
+    return copy;
+}
+
+// Method Description:
+// - Copies some rows of a buffer into another buffer of the same width,
+//   along with whether they're wrapped.
+// Arguments:
+// - buffer: the buffer to copy the rows of
+// - top: the first row to copy
+// - bottom: the row after the last row to copy
+// - target: the buffer to copy the rows to
+// - targetTop: the row of target to copy the first row to
+// Return Value:
+// - <none>
+void Terminal::_CopyRowsTo(TextBuffer& buffer, const SHORT top, const SHORT bottom, TextBuffer& target, const SHORT targetTop)
+{
+    const auto width = buffer.GetSize().Width();
+    std::vector<OutputCell> cells;
+    cells.reserve(gsl::narrow_cast<size_t>(width));
+    for (auto row = top; row < bottom; ++row)
+    {
+        cells.clear();
+        const auto limit = Viewport::FromDimensions({ 0, row }, { width, 1 });
+        for (auto it = buffer.GetCellDataAt({ 0, row }, limit); it; ++it)
+        {
+            cells.emplace_back(it->Chars(), it->DbcsAttr(), it->TextAttr());
+        }
+
+        const auto wrapped = buffer.GetRowByOffset(row).WasWrapForced();
+        target.Write(OutputCellIterator{ std::basic_string_view<OutputCell>{ cells.data(), cells.size() } },
+                     { 0, gsl::narrow_cast<SHORT>(targetTop + row - top) },
+                     wrapped);
+    }
+}
+
 void Terminal::Write(std::wstring_view stringView)
 {
     auto lock = LockForWriting();
+    WriteUnderLock(stringView);
+}
+
+// Method Description:
+// - Same as Write, for callers that want to batch several writes under a
+//   single acquisition of the lock.
+// - INVARIANT: this function can only be called if the caller has the writing lock on the terminal
+// Arguments:
+// - stringView: the output to feed to our parser
+// Return Value:
+// - <none>
+void Terminal::WriteUnderLock(std::wstring_view stringView)
+{
+    // If a lazy resize left rows for FinishReflow, the output goes to the
+    // rows that were reflowed already. Another resize can't start over from
+    // _reflowSource then, see _Resize.
+    if (_reflowSource)
+    {
+        _reflowTailWritten = true;
+    }
 
     auto& cursor = _activeBuffer().GetCursor();
     const til::point cursorPosBefore{ cursor.GetPosition() };
@@ -490,24 +889,89 @@ void Terminal::Write(std::wstring_view stringView)
     {
         _NotifyTerminalCursorPositionChanged();
     }
+
+    if (_searchIndex.HasQuery())
+    {
+        UpdateSearchHighlightsUnderLock();
+    }
 }
 
-void Terminal::WritePastedText(std::wstring_view stringView)
+// Method Description:
+// - Filters the given pasted text and writes it to the connection, wrapped in
+//   the bracketed paste sequences if the client asked for them.
+// - The text is filtered and written in chunks of about PasteChunkSize
+//   characters, so we never need to hold a filtered copy of all of it.
+// Arguments:
+// - stringView: the text to paste.
+// - chunkWritten: if given, called after each chunk with the number of
+//   characters of stringView that were written so far. Returning false from it
+//   cancels the rest of the paste.
+// - writeInput: if given, the paste is written with this instead of the write
+//   input callback.
+// - This must be called without holding the terminal lock. It's only taken
+//   to look up whether the client asked for bracketed paste.
+// Return Value:
+// - false if the paste was cancelled, true otherwise.
+bool Terminal::WritePastedText(std::wstring_view stringView,
+                               const std::function<bool(size_t)>& chunkWritten,
+                               const std::function<void(std::wstring_view)>& writeInput)
 {
+    const auto& write = writeInput ? writeInput : _pfnWriteInput;
+    if (!write)
+    {
+        return true;
+    }
+
     auto option = ::Microsoft::Console::Utils::FilterOption::CarriageReturnNewline |
                   ::Microsoft::Console::Utils::FilterOption::ControlCodes;
 
-    auto filtered = ::Microsoft::Console::Utils::FilterStringForPaste(stringView, option);
-    if (IsXtermBracketedPasteModeEnabled())
+    // The mode is changed by the output thread, under the write lock.
+    bool bracketedPaste;
     {
-        filtered.insert(0, L"\x1b[200~");
-        filtered.append(L"\x1b[201~");
+        const auto lock = LockForReading();
+        bracketedPaste = IsXtermBracketedPasteModeEnabled();
     }
 
-    if (_pfnWriteInput)
+    if (bracketedPaste)
     {
-        _pfnWriteInput(filtered);
+        write(L"\x1b[200~");
     }
+
+    auto completed = true;
+    for (size_t offset = 0; offset < stringView.size();)
+    {
+        auto end = std::min(stringView.size(), offset + PasteChunkSize);
+        // Don't split up a "\r\n" (the filter turns it into a single "\r"),
+        // or a surrogate pair.
+        while (end < stringView.size() && end - offset > 1)
+        {
+            const auto last = til::at(stringView, end - 1);
+            if (last != L'\r' && !IS_HIGH_SURROGATE(last))
+            {
+                break;
+            }
+            --end;
+        }
+
+        const auto filtered = ::Microsoft::Console::Utils::FilterStringForPaste(stringView.substr(offset, end - offset), option);
+        write(filtered);
+        offset = end;
+
+        if (chunkWritten && !chunkWritten(offset))
+        {
+            completed = false;
+            break;
+        }
+    }
+
+    // Even a cancelled paste needs to be terminated, or the client would
+    // treat everything that's typed afterwards as pasted, too.
+    if (bracketedPaste)
+    {
+        write(L"\x1b[201~");
+    }
+
+    return completed;
 }
 
 // Method Description:
@@ -520,9 +984,10 @@ void Terminal::WritePastedText(std::wstring_view stringView)
 // - <none>
 void Terminal::TrySnapOnInput()
 {
-    if (_snapOnInput && _scrollOffset != 0)
+    if (_snapOnInput && (_scrollOffset != 0 || _inHistoryView()))
     {
         auto lock = LockForWriting();
+        _LeaveHistory();
         _scrollOffset = 0;
         _NotifyScrollEvent();
     }
@@ -934,19 +1399,14 @@ WORD Terminal::_TakeVirtualKeyFromLastKeyEvent(const WORD scanCode) noexcept
 }
 
 // Method Description:
-// - Acquire a read lock on the terminal.
+// - Acquire a read lock on the terminal. Any number of readers may hold the
+//   lock at the same time, but nobody may modify the terminal while they do.
 // Return Value:
 // - a shared_lock which can be used to unlock the terminal. The shared_lock
 //      will release this lock when it's destructed.
-[[nodiscard]] std::unique_lock<til::ticket_lock> Terminal::LockForReading()
+[[nodiscard]] std::shared_lock<SharedTicketLock> Terminal::LockForReading()
 {
-#ifdef NDEBUG
-    return std::unique_lock{ _readWriteLock };
-#else
-    auto lock = std::unique_lock{ _readWriteLock };
-    _lastLocker = GetCurrentThreadId();
-    return lock;
-#endif
+    return std::shared_lock{ _readWriteLock };
 }
 
 // Method Description:
@@ -954,7 +1414,7 @@ WORD Terminal::_TakeVirtualKeyFromLastKeyEvent(const WORD scanCode) noexcept
 // Return Value:
 // - a unique_lock which can be used to unlock the terminal. The unique_lock
 //      will release this lock when it's destructed.
-[[nodiscard]] std::unique_lock<til::ticket_lock> Terminal::LockForWriting()
+[[nodiscard]] std::unique_lock<SharedTicketLock> Terminal::LockForWriting()
 {
 #ifdef NDEBUG
     return std::unique_lock{ _readWriteLock };
@@ -974,9 +1434,12 @@ Viewport Terminal::_GetMutableViewport() const noexcept
                             _mutableViewport;
 }
 
-short Terminal::GetBufferHeight() const noexcept
+// Method Description:
+// - Returns the number of rows the scrollbar covers: the ones in the buffer,
+//   and the ones in the scrollback archive, see _ArchivedRowsAbove.
+int Terminal::GetBufferHeight() const noexcept
 {
-    return _GetMutableViewport().BottomExclusive();
+    return ::base::ClampAdd(_ArchivedRowsAbove(), _GetMutableViewport().BottomExclusive());
 }
 
 // ViewStartIndex is also the length of the scrollback
@@ -991,18 +1454,268 @@ int Terminal::ViewEndIndex() const noexcept
 }
 
 // _VisibleStartIndex is the first visible line of the buffer
+// In the history view, that's the page of archived rows in _historyBuffer.
 int Terminal::_VisibleStartIndex() const noexcept
 {
+    if (_inHistoryView())
+    {
+        return gsl::narrow_cast<int>(_historyViewTop - _historyTop);
+    }
     return _inAltBuffer() ? ViewStartIndex() :
                             std::max(0, ViewStartIndex() - _scrollOffset);
 }
 
 int Terminal::_VisibleEndIndex() const noexcept
 {
+    if (_inHistoryView())
+    {
+        return _VisibleStartIndex() + _mutableViewport.Height() - 1;
+    }
     return _inAltBuffer() ? ViewEndIndex() :
                             std::max(0, ViewEndIndex() - _scrollOffset);
 }
 
+// Method Description:
+// - Returns the number of rows of the scrollback archive, which can be
+//   scrolled to above the rows of the main buffer. There's none in the
+//   alternate buffer.
+int Terminal::_ArchivedRowsAbove() const noexcept
+{
+    if (!_scrollbackArchive || _inAltBuffer())
+    {
+        return 0;
+    }
+    return ::base::saturated_cast<int>(_scrollbackArchive->EndRow() - _scrollbackArchive->FirstRow());
+}
+
+// Method Description:
+// - Returns the absolute row number of the first row of the active buffer, as
+//   the search index numbers them. Below an archive, the rows of the main
+//   buffer come right after the archived ones. Otherwise they're numbered
+//   like the patterns are.
+int64_t Terminal::_SearchRowBase() const noexcept
+{
+    return _scrollbackArchive && !_inAltBuffer() ? _scrollbackArchive->EndRow() : _patternRowBase;
+}
+
+// Method Description:
+// - Same as _SearchRowBase, for the buffer that's visible, which is
+//   _historyBuffer in the history view.
+int64_t Terminal::_ViewedSearchRowBase() const noexcept
+{
+    return _inHistoryView() ? _historyTop : _SearchRowBase();
+}
+
+bool Terminal::_inHistoryView() const noexcept
+{
+    return _showingHistory;
+}
+
+// Method Description:
+// - Returns the buffer that's visible: the one the renderer draws, and the
+//   selection is in. That's _historyBuffer in the history view, and the
+//   active buffer otherwise.
+TextBuffer& Terminal::_viewedBuffer() const noexcept
+{
+    return _inHistoryView() ? *_historyBuffer : _activeBuffer();
+}
+
+// Method Description:
+// - Scrolls the viewport into the scrollback archive. The archived rows are
+//   read back into _historyBuffer a page at a time. Scrolling within the
+//   page only moves the viewport, and reads nothing.
+// - The page is a copy: rows that change in the main buffer in the meantime
+//   only show up once it's read again. Archived rows never change.
+// - INVARIANT: this function can only be called if the caller has the writing lock on the terminal
+// Arguments:
+// - viewTop: the absolute row number of the first row to show. It must be
+//   one of the archived rows.
+void Terminal::_ShowHistory(const int64_t viewTop)
+{
+    const auto height = _mutableViewport.Height();
+    const auto pageRows = std::max<int>(HistoryPageRows, 3 * height);
+    if (!_inHistoryView() || viewTop < _historyTop || viewTop + height > _historyTop + pageRows)
+    {
+        // Put the viewport in the middle of the page, so that scrolling
+        // either way stays in it for a while.
+        const auto pageTop = std::max(_scrollbackArchive->FirstRow(), viewTop - (pageRows - height) / 2);
+        _PageHistory(pageTop);
+    }
+
+    _historyViewTop = viewTop;
+    _mainBuffer->TriggerScroll();
+}
+
+// Method Description:
+// - Reads the page of rows that starts at the given absolute row number into
+//   _historyBuffer. Rows past the end of the archive come from the main buffer.
+// - INVARIANT: this function can only be called if the caller has the writing lock on the terminal
+// Arguments:
+// - pageTop: the absolute row number of the first row of the page.
+void Terminal::_PageHistory(const int64_t pageTop)
+{
+    // The selection stays on the rows it's on, as far as they're in the page.
+    const auto oldRowBase = _ViewedSearchRowBase();
+    const auto width = _mainBuffer->GetSize().Width();
+    const auto pageRows = ::base::saturated_cast<SHORT>(std::max<int>(HistoryPageRows, 3 * _mutableViewport.Height()));
+    if (!_historyBuffer || til::size{ _historyBuffer->GetSize().Dimensions() } != til::size{ width, pageRows })
+    {
+        _historyBuffer = std::make_unique<TextBuffer>(COORD{ width, pageRows },
+                                                      TextAttribute{},
+                                                      0,
+                                                      false,
+                                                      _mainBuffer->GetRenderer());
+        _historyBuffer->GetCursor().SetIsVisible(false);
+    }
+    _historyBuffer->CopyHyperlinkMaps(*_mainBuffer);
+
+    const auto endRow = _scrollbackArchive->EndRow();
+    const auto archivedRows = gsl::narrow_cast<SHORT>(std::clamp<int64_t>(endRow - pageTop, 0, pageRows));
+    for (SHORT row = 0; row < archivedRows; ++row)
+    {
+        _ReadArchivedRow(pageTop + row, row);
+    }
+    const auto bufferRows = gsl::narrow_cast<SHORT>(std::min<int>(pageRows - archivedRows, _mutableViewport.BottomExclusive()));
+    _CopyRowsTo(*_mainBuffer, 0, bufferRows, *_historyBuffer, archivedRows);
+    for (auto row = archivedRows + bufferRows; row < pageRows; ++row)
+    {
+        _historyBuffer->GetRowByOffset(gsl::narrow_cast<SHORT>(row)).Reset(TextAttribute{});
+    }
+
+    _historyTop = pageTop;
+    _showingHistory = true;
+    _RebaseSelection(oldRowBase - pageTop, width, pageRows);
+    // The viewed buffer is a different one now.
+    ++_rowGeneration;
+    _mainBuffer->TriggerRedrawAll();
+}
+
+// Method Description:
+// - Appends a row of a buffer to the scrollback archive, with the attributes
+//   of its cells as runs of identical attributes.
+// Arguments:
+// - buffer: the buffer the row is in
+// - rowOffset: the offset of the row in the buffer
+// Return Value:
+// - <none>
+void Terminal::_ArchiveRow(const TextBuffer& buffer, const SHORT rowOffset)
+{
+    static_assert(std::is_trivially_copyable_v<AttributeRun>);
+
+    _archiveRuns.clear();
+    const auto limit = Viewport::FromDimensions({ 0, rowOffset }, { buffer.GetSize().Width(), 1 });
+    for (auto it = buffer.GetCellDataAt({ 0, rowOffset }, limit); it; ++it)
+    {
+        const auto& attr = it->TextAttr();
+        if (!_archiveRuns.empty() && _archiveRuns.back().attr == attr)
+        {
+            ++_archiveRuns.back().length;
+        }
+        else
+        {
+            _archiveRuns.emplace_back(AttributeRun{ attr, 1 });
+        }
+    }
+
+    const auto& row = buffer.GetRowByOffset(rowOffset);
+    const std::string_view attributes{ reinterpret_cast<const char*>(_archiveRuns.data()), _archiveRuns.size() * sizeof(AttributeRun) };
+    _scrollbackArchive->Append(row.GetText(), row.WasWrapForced(), attributes);
+}
+
+// Method Description:
+// - Writes the given archived row into the given row of _historyBuffer, with
+//   its attributes. Rows that were archived at a greater width are cut off,
+//   and rows that were dropped from the archive in the meantime are blank.
+// Arguments:
+// - row: the absolute row number of the archived row.
+// - targetRow: the row of _historyBuffer to write it to.
+void Terminal::_ReadArchivedRow(const int64_t row, const SHORT targetRow)
+{
+    const auto width = gsl::narrow_cast<size_t>(_historyBuffer->GetSize().Width());
+    _historyCells.clear();
+
+    auto wrapped = false;
+    auto& text = _historyText;
+    auto& runs = _historyRuns;
+    if (_scrollbackArchive->ReadRow(row, text, wrapped) && _scrollbackArchive->ReadRowAttributes(row, _historyAttributes))
+    {
+        runs.resize(_historyAttributes.size() / sizeof(AttributeRun));
+        memcpy(runs.data(), _historyAttributes.data(), runs.size() * sizeof(AttributeRun));
+    }
+    else
+    {
+        text.clear();
+        runs.clear();
+        wrapped = false;
+    }
+
+    // The runs have an attribute per column.
+    auto run = runs.begin();
+    size_t runColumns = run != runs.end() ? run->length : 0;
+    const auto nextAttribute = [&]() {
+        while (runColumns == 0 && run != runs.end() && ++run != runs.end())
+        {
+            runColumns = run->length;
+        }
+        if (run == runs.end())
+        {
+            return TextAttribute{};
+        }
+        --runColumns;
+        return run->attr;
+    };
+
+    for (size_t i = 0; i < text.size() && _historyCells.size() < width;)
+    {
+        const auto length = i + 1 < text.size() && IS_HIGH_SURROGATE(text[i]) && IS_LOW_SURROGATE(text[i + 1]) ? 2 : 1;
+        const std::wstring_view glyph{ text.data() + i, gsl::narrow_cast<size_t>(length) };
+        i += length;
+
+        if (IsGlyphFullWidth(glyph))
+        {
+            if (_historyCells.size() + 2 > width)
+            {
+                break;
+            }
+            _historyCells.emplace_back(glyph, DbcsAttribute{ DbcsAttribute::Attribute::Leading }, nextAttribute());
+            _historyCells.emplace_back(glyph, DbcsAttribute{ DbcsAttribute::Attribute::Trailing }, nextAttribute());
+        }
+        else
+        {
+            _historyCells.emplace_back(glyph, DbcsAttribute{}, nextAttribute());
+        }
+    }
+    while (_historyCells.size() < width)
+    {
+        _historyCells.emplace_back(std::wstring_view{ L" " }, DbcsAttribute{}, nextAttribute());
+    }
+
+    _historyBuffer->Write(OutputCellIterator{ std::basic_string_view<OutputCell>{ _historyCells.data(), _historyCells.size() } },
+                          { 0, targetRow },
+                          wrapped);
+}
+
+// Method Description:
+// - Scrolls the viewport back out of the scrollback archive, to the top of
+//   the main buffer, if it's in there. The rest is up to the caller.
+// - INVARIANT: this function can only be called if the caller has the writing lock on the terminal
+void Terminal::_LeaveHistory() noexcept
+try
+{
+    if (!_showingHistory)
+    {
+        return;
+    }
+
+    _showingHistory = false;
+    _scrollOffset = ViewStartIndex();
+    const auto bufferSize = _mainBuffer->GetSize();
+    _RebaseSelection(_historyTop - _SearchRowBase(), bufferSize.Width(), bufferSize.Height());
+    ++_rowGeneration;
+    _mainBuffer->TriggerRedrawAll();
+}
+CATCH_LOG()
+
 Viewport Terminal::_GetVisibleViewport() const noexcept
 {
     // GH#3493: if we're in the alt buffer, then it's possible that the mutable
@@ -1019,10 +1732,11 @@ Viewport Terminal::_GetVisibleViewport() const noexcept
 //      in accordance with the written text.
 // This method is our proverbial `WriteCharsLegacy`, and great care should be made to
 //      keep it minimal and orderly, lest it become WriteCharsLegacy2ElectricBoogaloo
-// TODO: MSFT 21006766
-//       This needs to become stream logic on the buffer itself sooner rather than later
-//       because it's otherwise impossible to avoid the Electric Boogaloo-ness here.
-//       I had to make a bunch of hacks to get Japanese and emoji to work-ish.
+// - The text is written in runs: each run is as much of the remaining string as
+//   fits onto the cursor's row, which is handed to the buffer in a single
+//   WriteLine call. The OutputCellIterator takes care of surrogate pairs and
+//   wide glyphs, so a run only ever ends at the right edge of the row, and the
+//   cursor is adjusted once per run instead of once per code unit.
 void Terminal::_WriteBuffer(const std::wstring_view& stringView)
 {
     auto& cursor = _activeBuffer().GetCursor();
@@ -1031,54 +1745,45 @@ void Terminal::_WriteBuffer(const std::wstring_view& stringView)
     // We can not waste time displaying a cursor event when we know more text is coming right behind it.
     cursor.StartDeferDrawing();
 
-    for (size_t i = 0; i < stringView.size(); i++)
+    size_t i = 0;
+    while (i < stringView.size())
     {
-        const auto wch = stringView.at(i);
         const auto cursorPosBefore = cursor.GetPosition();
         auto proposedCursorPosition = cursorPosBefore;
 
-        // TODO: MSFT 21006766
-        // This is not great but I need it demoable. Fix by making a buffer stream writer.
-        //
-        // If wch is a surrogate character we need to read 2 code units
-        // from the stringView to form a single code point.
-        const auto isSurrogate = wch >= 0xD800 && wch <= 0xDFFF;
-        const auto view = stringView.substr(i, isSurrogate ? 2 : 1);
-        const OutputCellIterator it{ view, _activeBuffer().GetCurrentAttributes() };
-        const auto end = _activeBuffer().Write(it);
+        // Write as much of the remaining text as fits onto the current row.
+        // setWrap=true marks the row as wrapped if we fill its last column,
+        // just like TextBuffer::Write does. If the next thing we process is a
+        // newline, Terminal::LineFeed will unmark it again.
+        const OutputCellIterator it{ stringView.substr(i), _activeBuffer().GetCurrentAttributes() };
+        const auto end = _activeBuffer().WriteLine(it, cursorPosBefore, true);
         const auto cellDistance = end.GetCellDistance(it);
+        _MarkRowsDirty(cursorPosBefore.Y, cursorPosBefore.Y + 1);
         const auto inputDistance = end.GetInputDistance(it);
 
-        if (inputDistance > 0)
-        {
-            // If "wch" was a surrogate character, we just consumed 2 code units above.
-            // -> Increment "i" by 1 in that case and thus by 2 in total in this iteration.
-            proposedCursorPosition.X += gsl::narrow<SHORT>(cellDistance);
-            i += inputDistance - 1;
-        }
-        else
-        {
-            // If _WriteBuffer() is called with a consecutive string longer than the viewport/buffer width
-            // the call to _buffer->Write() will refuse to write anything on the current line.
-            // GetInputDistance() thus returns 0, which would in turn cause i to be
-            // decremented by 1 below and force the outer loop to loop forever.
-            // This if() basically behaves as if "\r\n" had been encountered above and retries the write.
-            // With well behaving shells during normal operation this safeguard should normally not be encountered.
-            proposedCursorPosition.X = 0;
-            proposedCursorPosition.Y++;
-
-            // Try the character again.
-            i--;
-
-            // If we write the last cell of the row here, TextBuffer::Write will
-            // mark this line as wrapped for us. If the next character we
-            // process is a newline, the Terminal::CursorLineFeed will unmark
-            // this line as wrapped.
+        proposedCursorPosition.X += gsl::narrow<SHORT>(cellDistance);
+        i += inputDistance;
 
+        if (i < stringView.size())
+        {
+            // The row is full, but there's still text left to write. This
+            // behaves as if "\r\n" had been encountered and continues the
+            // run on the next row.
             // TODO: GH#780 - This should really be a _deferred_ newline. If
             // the next character to come in is a newline or a cursor
             // movement or anything, then we should _not_ wrap this line
             // here.
+            if (inputDistance == 0 && cursorPosBefore.X == 0)
+            {
+                // Not even a single glyph fits onto an empty row (for
+                // instance a wide glyph in a 1 column wide buffer). Drop the
+                // offending glyph, otherwise we'd loop here forever.
+                i += IS_HIGH_SURROGATE(stringView.at(i)) && i + 1 < stringView.size() ? 2 : 1;
+                continue;
+            }
+
+            proposedCursorPosition.X = 0;
+            proposedCursorPosition.Y++;
         }
 
         _AdjustCursorPosition(proposedCursorPosition);
@@ -1094,6 +1799,11 @@ void Terminal::_WriteBuffer(const std::wstring_view& stringView)
 
 void Terminal::_AdjustCursorPosition(const COORD proposedPosition)
 {
+    if (_reflowSource && !_inAltBuffer() && proposedPosition.Y >= _mainBuffer->GetSize().Height())
+    {
+        _GrowReflowTail(proposedPosition.Y + 1);
+    }
+
 #pragma warning(suppress : 26496) // cpp core checks wants this const but it's modified below.
     auto proposedCursorPosition = proposedPosition;
     auto& cursor = _activeBuffer().GetCursor();
@@ -1107,12 +1817,18 @@ void Terminal::_AdjustCursorPosition(const COORD proposedPosition)
     {
         for (auto dy = 0; dy < newRows; dy++)
         {
+            // The top row is about to be recycled. Keep it, if the scrollback is unbounded.
+            if (_scrollbackArchive && !_inAltBuffer())
+            {
+                _ArchiveRow(_activeBuffer(), 0);
+            }
             _activeBuffer().IncrementCircularBuffer();
             proposedCursorPosition.Y--;
             rowsPushedOffTopOfBuffer++;
 
             // Update our selection too, so it doesn't move as the buffer is cycled
-            if (_selection)
+            // In the history view, it's in a page of archived rows, which didn't move.
+            if (_selection && !_inHistoryView())
             {
                 // If the start of the selection is above 0, we can reduce both the start and end by 1
                 if (_selection->start.Y > 0)
@@ -1139,6 +1855,8 @@ void Terminal::_AdjustCursorPosition(const COORD proposedPosition)
 
         // manually erase our pattern intervals since the locations have changed now
         _patternIntervalTree = {};
+        // The rows we already searched for patterns moved up along with the text.
+        _patternRowBase += newRows;
     }
 
     // Update Cursor Position
@@ -1191,7 +1909,7 @@ void Terminal::_AdjustCursorPosition(const COORD proposedPosition)
     }
     }
 
-    if (rowsPushedOffTopOfBuffer != 0)
+    if (rowsPushedOffTopOfBuffer != 0 && !_inHistoryView())
     {
         // We have to report the delta here because we might have circled the text buffer.
         // That didn't change the viewport and therefore the TriggerScroll(void)
@@ -1211,22 +1929,54 @@ void Terminal::UserScrollViewport(const int viewTop)
     // we're going to modify state here that the renderer could be reading.
     auto lock = LockForWriting();
 
-    const auto clampedNewTop = std::max(0, viewTop);
+    // The rows of the scrollback archive come first, then those of the buffer.
+    auto archivedRows = _ArchivedRowsAbove();
+    auto clampedNewTop = std::max(0, viewTop);
+    if (clampedNewTop <= archivedRows && _reflowSource)
+    {
+        // The user scrolled up to the top of the rows that were reflowed so
+        // far. Reflow the rest now, and stay as far up from the viewport.
+        const auto rowsAbove = archivedRows + ViewStartIndex() - clampedNewTop;
+        FinishReflow();
+        archivedRows = _ArchivedRowsAbove();
+        clampedNewTop = std::max(0, archivedRows + ViewStartIndex() - rowsAbove);
+    }
+
+    if (clampedNewTop < archivedRows)
+    {
+        _ShowHistory(_scrollbackArchive->EndRow() - archivedRows + clampedNewTop);
+        UpdateSearchHighlightsUnderLock();
+        return;
+    }
+
+    _LeaveHistory();
+    clampedNewTop -= archivedRows;
+
     const auto realTop = ViewStartIndex();
     const auto newDelta = realTop - clampedNewTop;
     // if viewTop > realTop, we want the offset to be 0.
 
     _scrollOffset = std::max(0, newDelta);
 
+    UpdateSearchHighlightsUnderLock();
+
     // We can use the void variant of TriggerScroll here because
     // we adjusted the viewport so it can detect the difference
     // from the previous frame drawn.
     _activeBuffer().TriggerScroll();
 }
 
+// Method Description:
+// - Returns the position of the viewport, in the rows GetBufferHeight counts.
 int Terminal::GetScrollOffset() noexcept
 {
-    return _VisibleStartIndex();
+    const auto archivedRows = _ArchivedRowsAbove();
+    if (_inHistoryView())
+    {
+        const auto top = _historyViewTop - (_scrollbackArchive->EndRow() - archivedRows);
+        return gsl::narrow_cast<int>(std::clamp<int64_t>(top, 0, archivedRows));
+    }
+    return ::base::ClampAdd(archivedRows, _VisibleStartIndex());
 }
 
 void Terminal::_NotifyScrollEvent() noexcept
@@ -1235,7 +1985,7 @@ try
     if (_pfnScrollPositionChanged)
     {
         const auto visible = _GetVisibleViewport();
-        const auto top = visible.Top();
+        const auto top = GetScrollOffset();
         const auto height = visible.Height();
         const auto bottom = this->GetBufferHeight();
         _pfnScrollPositionChanged(top, height, bottom);
@@ -1260,6 +2010,14 @@ void Terminal::SetWriteInputCallback(std::function<void(std::wstring_view)> pfn)
     _pfnWriteInput.swap(pfn);
 }
 
+// Method Description:
+// - Sets the callback the replies to the client's queries (DSR, DA and the
+//   like) are written with. Without one, they're written like the input.
+void Terminal::SetReturnResponseCallback(std::function<void(std::wstring_view)> pfn) noexcept
+{
+    _pfnReturnResponse.swap(pfn);
+}
+
 void Terminal::SetWarningBellCallback(std::function<void()> pfn) noexcept
 {
     _pfnWarningBell.swap(pfn);
@@ -1333,19 +2091,212 @@ bool Terminal::IsCursorBlinkingAllowed() const noexcept
 // - Update our internal knowledge about where regex patterns are on the screen
 // - This is called by TerminalControl (through a throttled function) when the visible
 //   region changes (for example by text entering the buffer or scrolling)
+// - Only the rows that changed since the last call are searched again. A row
+//   is searched together with the rows it's wrapped into, so that patterns
+//   spanning multiple rows are found. Rows that scrolled into view count as
+//   changed, the matches on rows that are still visible are kept.
+// - Only the regions of patterns that appeared or disappeared are invalidated.
 // - INVARIANT: this function can only be called if the caller has the writing lock on the terminal
 void Terminal::UpdatePatternsUnderLock() noexcept
+try
 {
-    auto oldTree = _patternIntervalTree;
-    _patternIntervalTree = _activeBuffer().GetPatterns(_VisibleStartIndex(), _VisibleEndIndex());
-    _InvalidatePatternTree(oldTree);
-    _InvalidatePatternTree(_patternIntervalTree);
+    // Archived rows aren't searched for patterns.
+    if (_inHistoryView())
+    {
+        return;
+    }
+
+    const auto viewTop = _VisibleStartIndex();
+    const auto top = gsl::narrow_cast<size_t>(viewTop);
+    const auto height = gsl::narrow_cast<size_t>(std::max(0, _VisibleEndIndex() - viewTop + 1));
+    const auto scanTop = _patternRowBase + viewTop;
+    const auto moved = scanTop != _patternScanTop;
+
+    if (_patternsNeedFullScan || _patternDirtyRows.size() != height)
+    {
+        _patternIntervals.clear();
+        _patternDirtyRows.assign(height, true);
+        _patternsNeedFullScan = false;
+    }
+    else if (moved)
+    {
+        // The viewport moved by this many rows since the last scan.
+        // Move the matches and dirty rows along with it.
+        const auto delta = scanTop - _patternScanTop;
+        const auto tall = gsl::narrow_cast<int64_t>(height);
+
+        std::vector<bool> dirtyRows(height, false);
+        for (int64_t y = 0; y < tall; ++y)
+        {
+            const auto oldY = y + delta;
+            dirtyRows.at(gsl::narrow_cast<size_t>(y)) = oldY < 0 || oldY >= tall || _patternDirtyRows.at(gsl::narrow_cast<size_t>(oldY));
+        }
+        _patternDirtyRows = std::move(dirtyRows);
+
+        auto& intervals = _patternIntervals;
+        for (auto& interval : intervals)
+        {
+            interval.start.y = gsl::narrow<decltype(interval.start.y)>(interval.start.y - delta);
+            interval.stop.y = gsl::narrow<decltype(interval.stop.y)>(interval.stop.y - delta);
+        }
+        intervals.erase(std::remove_if(intervals.begin(), intervals.end(), [&](const auto& interval) {
+                            if (interval.start.y >= 0 && interval.stop.y < tall)
+                            {
+                                return false;
+                            }
+                            // This match got cut in half by the edge of the
+                            // viewport. Search what's still visible of it again.
+                            for (auto y = std::max<int64_t>(interval.start.y, 0); y <= std::min<int64_t>(interval.stop.y, tall - 1); ++y)
+                            {
+                                _patternDirtyRows.at(gsl::narrow_cast<size_t>(y)) = true;
+                            }
+                            return true;
+                        }),
+                        intervals.end());
+    }
+    _patternScanTop = scanTop;
+
+    if (!moved &&
+        std::find(_patternDirtyRows.begin(), _patternDirtyRows.end(), true) == _patternDirtyRows.end() &&
+        _patternIntervalTree.empty() == _patternIntervals.empty())
+    {
+        // Nothing changed since the last time.
+        return;
+    }
+
+    const auto& buffer = _activeBuffer();
+    const auto wrapped = [&](const size_t y) {
+        return buffer.GetRowByOffset(top + y).WasWrapForced();
+    };
+
+    for (size_t y = 0; y < height; ++y)
+    {
+        if (!_patternDirtyRows.at(y))
+        {
+            continue;
+        }
+
+        // Extend the run of rows to search to the beginning of the first
+        // row's line and the end of the last row's line.
+        auto first = y;
+        while (first > 0 && wrapped(first - 1))
+        {
+            --first;
+        }
+        auto last = y;
+        while (last + 1 < height && (_patternDirtyRows.at(last + 1) || wrapped(last)))
+        {
+            ++last;
+        }
+
+        const auto firstY = gsl::narrow_cast<int64_t>(first);
+        const auto lastY = gsl::narrow_cast<int64_t>(last);
+        auto& intervals = _patternIntervals;
+        intervals.erase(std::remove_if(intervals.begin(), intervals.end(), [&](const auto& interval) {
+                            // NOTE: A match that ends at the end of a row stops at x=0 of the next one.
+                            return interval.start.y <= lastY && (interval.stop.y > firstY || (interval.stop.y == firstY && interval.stop.x > 0));
+                        }),
+                        intervals.end());
+
+        if (_detectURLs)
+        {
+            // The matcher returns coordinates relative to the first row it searched.
+            const auto count = intervals.size();
+            _FindUrlsInRows(top + first, top + last, intervals);
+            for (auto i = count; i < intervals.size(); ++i)
+            {
+                auto& interval = til::at(intervals, i);
+                interval.start.y += gsl::narrow_cast<decltype(interval.start.y)>(first);
+                interval.stop.y += gsl::narrow_cast<decltype(interval.stop.y)>(first);
+            }
+        }
+
+        y = last;
+    }
+    _patternDirtyRows.assign(height, false);
+
+    // Only redraw the matches that actually changed.
+    const auto sameInterval = [](const auto& lhs, const auto& rhs) {
+        return lhs.start == rhs.start && lhs.stop == rhs.stop && lhs.value == rhs.value;
+    };
+    const auto contains = [&](const auto& intervals, const auto& interval) {
+        return std::any_of(intervals.begin(), intervals.end(), [&](const auto& other) { return sameInterval(interval, other); });
+    };
+
+    PointTree::interval_vector oldIntervals;
+    _patternIntervalTree.visit_all([&](const auto& interval) { oldIntervals.emplace_back(interval); });
+
+    _patternIntervalTree = PointTree{ PointTree::interval_vector{ _patternIntervals } };
+
+    PointTree::interval_vector changed;
+    for (const auto& interval : oldIntervals)
+    {
+        if (!contains(_patternIntervals, interval))
+        {
+            changed.emplace_back(interval);
+        }
+    }
+    for (const auto& interval : _patternIntervals)
+    {
+        if (!contains(oldIntervals, interval))
+        {
+            changed.emplace_back(interval);
+        }
+    }
+    if (!changed.empty())
+    {
+        PointTree changedTree{ std::move(changed) };
+        _InvalidatePatternTree(changedTree);
+    }
+}
+CATCH_LOG()
+
+// Method Description:
+// - Finds all the URLs in the given rows of the active buffer. Like
+//   TextBuffer::GetPatterns, the rows are searched as one long string, so
+//   URLs can span multiple rows.
+// Arguments:
+// - firstRow, lastRow: the (inclusive) range of rows to search
+// - intervals: receives the intervals of the URLs. Just like the ones returned
+//   by TextBuffer::GetPatterns, they're relative to firstRow.
+// Return Value:
+// - <none>
+void Terminal::_FindUrlsInRows(const size_t firstRow, const size_t lastRow, PointTree::interval_vector& intervals)
+{
+    const auto& buffer = _activeBuffer();
+
+    _urlText.clear();
+    for (auto row = firstRow; row <= lastRow; ++row)
+    {
+        _urlText.append(buffer.GetRowByOffset(row).GetText());
+    }
+
+    UrlMatcher::FindAll(_urlText, _urlMatches);
+    if (_urlMatches.empty())
+    {
+        return;
+    }
+
+    UrlMatcher::ToColumns(_urlText, _urlMatches, [](const std::wstring_view glyph) {
+        return IsGlyphFullWidth(glyph);
+    });
+
+    const auto rowSize = buffer.GetRowByOffset(0).size();
+    const auto toPoint = [&](const size_t column) {
+        return til::point{ gsl::narrow<SHORT>(column % rowSize), gsl::narrow<SHORT>(column / rowSize) };
+    };
+    for (const auto& match : _urlMatches)
+    {
+        intervals.emplace_back(toPoint(match.begin), toPoint(match.end), _hyperlinkPatternId);
+    }
 }
 
 // Method Description:
 // - Clears and invalidates the interval pattern tree
 // - This is called to prevent the renderer from rendering patterns while the
 //   visible region is changing
+// - The matches we found are remembered, so that the next call to
+//   UpdatePatternsUnderLock only needs to search the rows that changed.
 void Terminal::ClearPatternTree() noexcept
 {
     auto oldTree = _patternIntervalTree;
@@ -1353,6 +2304,209 @@ void Terminal::ClearPatternTree() noexcept
     _InvalidatePatternTree(oldTree);
 }
 
+// Method Description:
+// - Brings the search index up to date with the active buffer. Only the rows
+//   that changed since the last call are read again.
+// - While a lazy resize is pending, that's only the rows that were reflowed
+//   so far. Call FinishReflow first to search all of them.
+// - Below a scrollback archive, the index covers its rows as well. It reads
+//   them without the lock, see SearchIndex::IndexArchivedRows.
+// - The caller must hold the write lock. Once this returns, the index can be
+//   searched without holding any lock at all, and searches never hold up the
+//   next update.
+// Return Value:
+// - The search index.
+SearchIndex& Terminal::UpdateSearchIndexUnderLock()
+{
+    const auto& buffer = _activeBuffer();
+    const auto readRow = [&](const int64_t offset, std::wstring& text, bool& wrapped) {
+        const auto& row = buffer.GetRowByOffset(gsl::narrow_cast<size_t>(offset));
+        text = row.GetText();
+        wrapped = row.WasWrapForced();
+    };
+    std::optional<SearchIndex::ArchivedRows> archived;
+    if (_scrollbackArchive && !_inAltBuffer())
+    {
+        if (!_searchArchiveReader)
+        {
+            // The archive may be discarded while a search reads it. It stays
+            // around until the search is done with it, then.
+            const std::weak_ptr<const ScrollbackArchive> weakArchive{ _scrollbackArchive };
+            _searchArchiveReader = std::make_shared<const SearchIndex::ReadArchivedRow>([weakArchive](const int64_t row, std::wstring& text, bool& wrapped) {
+                const auto archive = weakArchive.lock();
+                return archive && archive->ReadRow(row, text, wrapped);
+            });
+        }
+        archived.emplace(SearchIndex::ArchivedRows{ _scrollbackArchive->FirstRow(), _searchArchiveReader });
+    }
+    _searchIndex.Update(gsl::narrow_cast<int64_t>(buffer.TotalRowCount()), readRow, _SearchRowBase(), _searchDirtyTop, _searchDirtyBottom, _searchIndexNeedsFullUpdate, archived ? &*archived : nullptr);
+    _searchDirtyTop = INT64_MAX;
+    _searchDirtyBottom = INT64_MIN;
+    _searchIndexNeedsFullUpdate = false;
+    return _searchIndex;
+}
+
+// Method Description:
+// - Returns the position a search should start from, in the absolute row
+//   numbers the search index uses: the start of the selection, if there's
+//   one. Otherwise the row is -1, which isn't in the index, and the search
+//   starts at the start (or end) of the buffer.
+std::pair<int64_t, size_t> Terminal::GetSearchAnchorUnderLock() const noexcept
+{
+    if (!IsSelectionActive())
+    {
+        return { -1, 0 };
+    }
+    const auto anchor = GetSelectionAnchor();
+    return { _ViewedSearchRowBase() + anchor.Y, gsl::narrow_cast<size_t>(anchor.X) };
+}
+
+// Method Description:
+// - Selects the given match of the search index, scrolling it into view.
+//   Matches in the scrollback archive are shown in the history view.
+// Arguments:
+// - match: the match to select.
+// Return Value:
+// - false if the match has been pushed out of the buffer since it was found.
+bool Terminal::SelectSearchMatchUnderLock(const SearchIndex::Match& match)
+{
+    if (match.endRow == match.row && match.endColumn == match.startColumn)
+    {
+        return false;
+    }
+
+    const auto searchRowBase = _SearchRowBase();
+    if (match.row < searchRowBase)
+    {
+        if (!_scrollbackArchive || _inAltBuffer() || match.row < _scrollbackArchive->FirstRow())
+        {
+            return false;
+        }
+
+        // Show the match as close to the middle of the viewport as it gets.
+        const auto height = _mutableViewport.Height();
+        const auto viewTop = std::clamp<int64_t>(match.row - height / 2, _scrollbackArchive->FirstRow(), searchRowBase - 1);
+        _ShowHistory(viewTop);
+        _NotifyScrollEvent();
+    }
+    else if (_inHistoryView())
+    {
+        _LeaveHistory();
+        _NotifyScrollEvent();
+    }
+
+    const auto viewedRowBase = _ViewedSearchRowBase();
+    const auto row = match.row - viewedRowBase;
+    const auto endRow = match.endRow - viewedRowBase;
+    const auto bufferSize = _viewedBuffer().GetSize();
+    if (row < 0 || endRow >= bufferSize.Height())
+    {
+        return false;
+    }
+
+    const auto lastColumn = gsl::narrow_cast<size_t>(bufferSize.RightInclusive());
+    const COORD start{ gsl::narrow<SHORT>(std::min(match.startColumn, lastColumn)), gsl::narrow<SHORT>(row) };
+    const COORD end{ gsl::narrow<SHORT>(std::min(match.endColumn == 0 ? 0 : match.endColumn - 1, lastColumn)), gsl::narrow<SHORT>(endRow) };
+    SetBlockSelection(false);
+    SelectNewRegion(start, end);
+    return true;
+}
+
+// Method Description:
+// - Highlights the find-all matches in the visible rows, for GetOverlays.
+//   They're copied into _searchHighlightBuffer, a viewport-sized buffer, with
+//   the highlight colors, right where they are on screen. Every visible row of
+//   a match gets an overlay of its own.
+// - _searchHighlightBuffer has a renderer of its own, without any engines or
+//   a thread, so writing to it doesn't make the real one paint another frame.
+// - This is called whenever the visible text, the viewport or the matches
+//   change.
+// - INVARIANT: this function can only be called if the caller has the writing lock on the terminal
+void Terminal::UpdateSearchHighlightsUnderLock() noexcept
+try
+{
+    _searchHighlightOverlays.clear();
+
+    const auto viewport = _GetVisibleViewport();
+    const auto rowBase = _ViewedSearchRowBase();
+    const auto top = rowBase + viewport.Top();
+    const auto bottom = rowBase + viewport.BottomExclusive();
+    _searchHighlightTop = top;
+    _searchHighlights.clear();
+    _searchIndex.GetMatchesInRows(top, bottom, _searchHighlights);
+    if (_searchHighlights.empty())
+    {
+        return;
+    }
+
+    if (!_searchHighlightRenderer)
+    {
+        _searchHighlightRenderer = std::make_unique<Renderer>(_renderSettings, this, nullptr, 0, nullptr);
+    }
+    if (!_searchHighlightBuffer || til::size{ _searchHighlightBuffer->GetSize().Dimensions() } != til::size{ viewport.Dimensions() })
+    {
+        _searchHighlightBuffer = std::make_unique<TextBuffer>(viewport.Dimensions(), TextAttribute{}, 0, false, *_searchHighlightRenderer);
+    }
+
+    TextAttribute highlight;
+    highlight.SetForeground(SearchHighlightForeground);
+    highlight.SetBackground(SearchHighlightBackground);
+
+    const auto& buffer = _viewedBuffer();
+    const auto width = gsl::narrow_cast<size_t>(viewport.Width());
+    for (const auto& match : _searchHighlights)
+    {
+        for (auto row = std::max(match.row, top); row <= std::min(match.endRow, bottom - 1); ++row)
+        {
+            const auto left = gsl::narrow_cast<SHORT>(row == match.row ? std::min(match.startColumn, width) : 0);
+            const auto right = gsl::narrow_cast<SHORT>(row == match.endRow ? std::min(match.endColumn, width) : width);
+            if (left >= right)
+            {
+                continue;
+            }
+
+            const auto bufferRow = gsl::narrow<SHORT>(row - rowBase);
+            const auto viewportRow = gsl::narrow<SHORT>(bufferRow - viewport.Top());
+
+            _searchHighlightCells.clear();
+            const auto limit = Viewport::FromInclusive({ left, bufferRow, gsl::narrow_cast<SHORT>(right - 1), bufferRow });
+            for (auto it = buffer.GetCellDataAt({ left, bufferRow }, limit); it; ++it)
+            {
+                _searchHighlightCells.emplace_back(it->Chars(), it->DbcsAttr(), highlight);
+            }
+            _searchHighlightBuffer->Write(OutputCellIterator{ std::basic_string_view<OutputCell>{ _searchHighlightCells.data(), _searchHighlightCells.size() } }, { left, viewportRow });
+
+            _searchHighlightOverlays.emplace_back(RenderOverlay{ *_searchHighlightBuffer, { 0, 0 }, Viewport::FromInclusive({ left, viewportRow, gsl::narrow_cast<SHORT>(right - 1), viewportRow }) });
+        }
+    }
+}
+CATCH_LOG()
+
+// Method Description:
+// - Remembers that the given rows of the buffer changed, so that the next
+//   call to UpdatePatternsUnderLock searches them for patterns again, and
+//   the next call to UpdateSearchIndexUnderLock indexes them again.
+// Arguments:
+// - top: the first buffer row that changed
+// - bottom: the row below the last buffer row that changed
+void Terminal::_MarkRowsDirty(const int top, const int bottom) noexcept
+{
+    const auto searchRowBase = _SearchRowBase();
+    _searchDirtyTop = std::min(_searchDirtyTop, searchRowBase + top);
+    _searchDirtyBottom = std::max(_searchDirtyBottom, searchRowBase + bottom);
+
+    // Rows outside of the last scan don't need to be tracked. If they become
+    // visible, it's because the viewport moved, and UpdatePatternsUnderLock
+    // treats all the rows that scrolled into view as changed anyway.
+    const auto size = gsl::narrow_cast<int64_t>(_patternDirtyRows.size());
+    const auto first = std::max<int64_t>(_patternRowBase + top - _patternScanTop, 0);
+    const auto last = std::min<int64_t>(_patternRowBase + bottom - _patternScanTop, size);
+    for (auto y = first; y < last; ++y)
+    {
+        _patternDirtyRows[gsl::narrow_cast<size_t>(y)] = true;
+    }
+}
+
 // Method Description:
 // - Returns the tab color
 // If the starting color exits, it's value is preferred
@@ -1447,6 +2601,8 @@ TextBuffer& Terminal::_activeBuffer() const noexcept
 
 void Terminal::_updateUrlDetection()
 {
+    _patternsNeedFullScan = true;
+
     if (_detectURLs)
     {
         // Add regex pattern recognizers to the buffer
@@ -8,6 +8,7 @@
 #include "../../inc/DefaultSettings.h"
 #include "../../buffer/out/textBuffer.hpp"
 #include "../../external/terminal/src/renderer/inc/IRenderData.hpp"
+#include "../../external/terminal/src/renderer/base/Renderer.hpp"
 #include "../../external/terminal/src/terminal/adapter/ITerminalApi.hpp"
 #include "../../terminal/parser/StateMachine.hpp"
 #include "../../terminal/input/terminalInput.hpp"
@@ -16,11 +17,26 @@
 #include "../../types/inc/GlyphWidth.hpp"
 #include "../../types/IUiaData.h"
 #include "ITerminalInput.hpp"
+#include "SharedTicketLock.hpp"
+#include "UrlMatcher.hpp"
+#include "SearchIndex.hpp"
+#include "ScrollbackArchive.hpp"
 
-#include <til/ticket_lock.h>
-
-static constexpr std::wstring_view linkPattern{ LR"(\b(https?|ftp|file)://[-A-Za-z0-9+&@#/%?=~_|$!:,.;]*[A-Za-z0-9+&@#/%=~_|$])" };
 static constexpr size_t TaskbarMinProgress{ 10 };
+// Pasted text is filtered and passed on in chunks of (about) this many characters.
+static constexpr size_t PasteChunkSize{ 64 * 1024 };
+// The colors find-all highlights the search matches with.
+static constexpr COLORREF SearchHighlightForeground{ RGB(0, 0, 0) };
+static constexpr COLORREF SearchHighlightBackground{ RGB(255, 214, 64) };
+// With a HistorySize of -1, the buffer keeps this many rows of scrollback.
+// Older rows move into a ScrollbackArchive that may take up this many bytes.
+static constexpr SHORT InfiniteScrollbackBufferRows{ 10000 };
+static constexpr size_t InfiniteScrollbackMemoryBudget{ 64 * 1024 * 1024 };
+// Scrolling into the archive shows a page of at least this many of its rows.
+static constexpr SHORT HistoryPageRows{ 1024 };
+// A resize only reflows the rows around the viewport right away if there are
+// at least this many rows above them. The rest are reflowed by FinishReflow.
+static constexpr int LazyReflowMinimumRows{ 1000 };
 
 // You have to forward decl the ICoreSettings here, instead of including the header.
 // If you include the header, there will be compilation errors with other
@@ -76,24 +92,35 @@ public:
     void CreateFromSettings(winrt::Microsoft::Terminal::Core::ICoreSettings settings,
                             Microsoft::Console::Render::Renderer& renderer);
 
+    void CreateHeadless(COORD viewportSize,
+                        SHORT scrollbackLines);
+    bool IsHeadless() const noexcept;
+
     void UpdateSettings(winrt::Microsoft::Terminal::Core::ICoreSettings settings);
     void UpdateAppearance(const winrt::Microsoft::Terminal::Core::ICoreAppearance& appearance);
     void SetFontInfo(const FontInfo& fontInfo);
     void SetCursorStyle(const ::Microsoft::Console::VirtualTerminal::DispatchTypes::CursorStyle cursorStyle);
     void EraseScrollback();
+    void DiscardScrollbackArchive() noexcept;
     bool IsXtermBracketedPasteModeEnabled() const;
     std::wstring_view GetWorkingDirectory();
 
+    bool IsReflowPending() const noexcept;
+    void FinishReflow() noexcept;
+
     // Write comes from the PTY and goes to our parser to be stored in the output buffer
     void Write(std::wstring_view stringView);
+    void WriteUnderLock(std::wstring_view stringView);
 
     // WritePastedText comes from our input and goes back to the PTY's input channel
-    void WritePastedText(std::wstring_view stringView);
+    bool WritePastedText(std::wstring_view stringView,
+                         const std::function<bool(size_t)>& chunkWritten = nullptr,
+                         const std::function<void(std::wstring_view)>& writeInput = nullptr);
 
-    [[nodiscard]] std::unique_lock<til::ticket_lock> LockForReading();
-    [[nodiscard]] std::unique_lock<til::ticket_lock> LockForWriting();
+    [[nodiscard]] std::shared_lock<SharedTicketLock> LockForReading();
+    [[nodiscard]] std::unique_lock<SharedTicketLock> LockForWriting();
 
-    short GetBufferHeight() const noexcept;
+    int GetBufferHeight() const noexcept;
 
     int ViewStartIndex() const noexcept;
     int ViewEndIndex() const noexcept;
@@ -194,6 +221,7 @@ public:
 #pragma endregion
 
     void SetWriteInputCallback(std::function<void(std::wstring_view)> pfn) noexcept;
+    void SetReturnResponseCallback(std::function<void(std::wstring_view)> pfn) noexcept;
     void SetWarningBellCallback(std::function<void()> pfn) noexcept;
     void SetTitleChangedCallback(std::function<void(std::wstring_view)> pfn) noexcept;
     void SetTabColorChangedCallback(std::function<void(const std::optional<til::color>)> pfn) noexcept;
@@ -209,6 +237,13 @@ public:
     void UpdatePatternsUnderLock() noexcept;
     void ClearPatternTree() noexcept;
 
+    SearchIndex& UpdateSearchIndexUnderLock();
+    SearchIndex& GetSearchIndex() noexcept { return _searchIndex; }
+    ScrollbackArchive* GetScrollbackArchive() noexcept { return _scrollbackArchive.get(); }
+    std::pair<int64_t, size_t> GetSearchAnchorUnderLock() const noexcept;
+    bool SelectSearchMatchUnderLock(const SearchIndex::Match& match);
+    void UpdateSearchHighlightsUnderLock() noexcept;
+
     const std::optional<til::color> GetTabColor() const noexcept;
 
     winrt::Microsoft::Terminal::Core::Scheme GetColorScheme() const noexcept;
@@ -250,6 +285,8 @@ public:
 
 private:
     std::function<void(std::wstring_view)> _pfnWriteInput;
+    std::function<void(std::wstring_view)> _pfnReturnResponse;
+    std::wstring _keyEventText;
     std::function<void()> _pfnWarningBell;
     std::function<void(std::wstring_view)> _pfnTitleChanged;
     std::function<void(std::wstring_view)> _pfnCopyToClipboard;
@@ -260,7 +297,7 @@ private:
     //
     // But we can abuse the fact that the surrounding members rarely change and are huge
     // (std::function is like 64 bytes) to create some natural padding without wasting space.
-    til::ticket_lock _readWriteLock;
+    SharedTicketLock _readWriteLock;
 #ifndef NDEBUG
     DWORD _lastLocker;
 #endif
@@ -272,6 +309,9 @@ private:
     std::function<void(bool)> _pfnShowWindowChanged;
 
     RenderSettings _renderSettings;
+    // Only set when we were created with CreateHeadless. It has neither
+    // render engines nor a render thread, so all invalidation is a no-op.
+    std::unique_ptr<Microsoft::Console::Render::Renderer> _headlessRenderer;
     std::unique_ptr<::Microsoft::Console::VirtualTerminal::StateMachine> _stateMachine;
     std::unique_ptr<::Microsoft::Console::VirtualTerminal::TerminalInput> _terminalInput;
 
@@ -324,6 +364,17 @@ private:
     til::size _altBufferSize;
     std::optional<til::size> _deferredResize{ std::nullopt };
 
+    // If the last resize only reflowed the rows around the viewport, this is
+    // the main buffer as it was before, with its viewport and scroll offset.
+    // Its rows above _reflowTailTop are the ones that weren't reflowed yet.
+    // Once output was written to the main buffer, _reflowTailWritten is set,
+    // and the main buffer holds everything below those rows.
+    std::unique_ptr<TextBuffer> _reflowSource;
+    Microsoft::Console::Types::Viewport _reflowSourceViewport{ Microsoft::Console::Types::Viewport::Empty() };
+    int _reflowSourceScrollOffset{ 0 };
+    SHORT _reflowTailTop{ 0 };
+    bool _reflowTailWritten{ false };
+
     // _scrollOffset is the number of lines above the viewport that are currently visible
     // If _scrollOffset is 0, then the visible region of the buffer is the viewport.
     int _scrollOffset;
@@ -344,6 +395,71 @@ private:
     void _InvalidatePatternTree(interval_tree::IntervalTree<til::point, size_t>& tree);
     void _InvalidateFromCoords(const COORD start, const COORD end);
 
+    // State for updating the pattern tree incrementally, see UpdatePatternsUnderLock.
+    // Rows are tracked as "pattern rows": buffer rows plus the number of rows
+    // that were pushed off the top of the buffer when it circled. That way a
+    // row keeps its number while output scrolls it up the screen.
+    // * _patternIntervals: the matches of the last scan, relative to _patternScanTop.
+    // * _patternDirtyRows: the rows of the last scan that have changed since.
+    interval_tree::IntervalTree<til::point, size_t>::interval_vector _patternIntervals;
+    std::vector<bool> _patternDirtyRows;
+    int64_t _patternRowBase{ 0 };
+    // Incremented whenever the rows get renumbered in some other way than by
+    // circling the buffer: resizing, switching buffers or moving the viewport
+    // contents around. Row numbers from before can't be trusted after that.
+    uint64_t _rowGeneration{ 0 };
+    int64_t _patternScanTop{ 0 };
+    bool _patternsNeedFullScan{ true };
+    std::wstring _urlText;
+    std::vector<UrlMatcher::Match> _urlMatches;
+    void _FindUrlsInRows(const size_t firstRow, const size_t lastRow, interval_tree::IntervalTree<til::point, size_t>::interval_vector& intervals);
+    void _MarkRowsDirty(const int top, const int bottom) noexcept;
+
+    // The search index uses the same row numbers. _searchDirtyTop and
+    // _searchDirtyBottom are the range of rows that changed since it was
+    // last updated.
+    SearchIndex _searchIndex{ [](const std::wstring_view glyph) { return IsGlyphFullWidth(glyph); } };
+    int64_t _searchDirtyTop{ INT64_MAX };
+    int64_t _searchDirtyBottom{ INT64_MIN };
+    bool _searchIndexNeedsFullUpdate{ true };
+    // The highlighted find-all matches GetOverlays hands to the renderer,
+    // for the visible rows from the absolute row _searchHighlightTop down.
+    // See UpdateSearchHighlightsUnderLock.
+    std::unique_ptr<Microsoft::Console::Render::Renderer> _searchHighlightRenderer;
+    std::unique_ptr<TextBuffer> _searchHighlightBuffer;
+    std::vector<Microsoft::Console::Render::RenderOverlay> _searchHighlightOverlays;
+    int64_t _searchHighlightTop{ INT64_MIN };
+    std::vector<SearchIndex::Match> _searchHighlights;
+    std::vector<OutputCell> _searchHighlightCells;
+
+    // The rows that scrolled out of the main buffer, if HistorySize is -1.
+    // The search index reads them without the lock, through a weak_ptr.
+    std::shared_ptr<ScrollbackArchive> _scrollbackArchive;
+    std::shared_ptr<const SearchIndex::ReadArchivedRow> _searchArchiveReader;
+
+    // The archive keeps the attributes of a row as the bytes of these runs
+    // of identical attributes. See _ArchiveRow.
+    struct AttributeRun
+    {
+        TextAttribute attr;
+        uint16_t length;
+    };
+    std::vector<AttributeRun> _archiveRuns;
+
+    // Scrolling above the main buffer, into the archive, shows the history
+    // view: a page of archived rows, read back into _historyBuffer, which the
+    // renderer and the selection use instead of the main buffer. The page
+    // starts at the absolute row _historyTop, as the search index numbers
+    // them, and the view at _historyViewTop. See _ShowHistory.
+    std::unique_ptr<TextBuffer> _historyBuffer;
+    int64_t _historyTop{ 0 };
+    int64_t _historyViewTop{ 0 };
+    bool _showingHistory{ false };
+    std::wstring _historyText;
+    std::string _historyAttributes;
+    std::vector<AttributeRun> _historyRuns;
+    std::vector<OutputCell> _historyCells;
+
     // Since virtual keys are non-zero, you assume that this field is empty/invalid if it is.
     struct KeyEventCodes
     {
@@ -362,20 +478,49 @@ private:
 
     int _VisibleStartIndex() const noexcept;
     int _VisibleEndIndex() const noexcept;
+    int _ArchivedRowsAbove() const noexcept;
+    int64_t _SearchRowBase() const noexcept;
+    int64_t _ViewedSearchRowBase() const noexcept;
+
+    void _ShowHistory(const int64_t viewTop);
+    void _PageHistory(const int64_t pageTop);
+    void _LeaveHistory() noexcept;
+    void _ArchiveRow(const TextBuffer& buffer, const SHORT rowOffset);
+    void _ReadArchivedRow(const int64_t row, const SHORT targetRow);
 
     Microsoft::Console::Types::Viewport _GetMutableViewport() const noexcept;
     Microsoft::Console::Types::Viewport _GetVisibleViewport() const noexcept;
 
     void _WriteBuffer(const std::wstring_view& stringView);
 
+    [[nodiscard]] HRESULT _Resize(const COORD viewportSize, const bool lazily) noexcept;
+    SHORT _LazyReflowTop() const;
+    static std::unique_ptr<TextBuffer> _CopyRows(TextBuffer& buffer, const SHORT top, const SHORT bottom);
+    static void _CopyRowsTo(TextBuffer& buffer, const SHORT top, const SHORT bottom, TextBuffer& target, const SHORT targetTop);
+    void _GrowReflowTail(const int rows);
+
     void _AdjustCursorPosition(const COORD proposedPosition);
 
     void _NotifyScrollEvent() noexcept;
 
     void _NotifyTerminalCursorPositionChanged() noexcept;
 
+    struct ConsoleLockUpgrade
+    {
+        bool upgraded{ false };
+        // What the writers that got in before we acquired the write lock
+        // did to the rows. See _UpgradeConsoleLock.
+        int64_t rowsCircled{ 0 };
+        bool rowsRenumbered{ false };
+    };
+    ConsoleLockUpgrade _UpgradeConsoleLock() noexcept;
+    void _DowngradeConsoleLock() noexcept;
+    void _SelectNewRegion(const COORD coordStart, const COORD coordEnd);
+
     bool _inAltBuffer() const noexcept;
     TextBuffer& _activeBuffer() const noexcept;
+    bool _inHistoryView() const noexcept;
+    TextBuffer& _viewedBuffer() const noexcept;
     void _updateUrlDetection();
 
 #pragma region TextSelection
@@ -388,6 +533,9 @@ private:
     void _MoveByWord(SelectionDirection direction, COORD& pos);
     void _MoveByViewport(SelectionDirection direction, COORD& pos);
     void _MoveByBuffer(SelectionDirection direction, COORD& pos);
+    short _SelectionBottom() const noexcept;
+    void _PrepareSelectionMove(const SelectionDirection direction, const SelectionExpansion mode);
+    void _RebaseSelection(const int64_t offset, const SHORT width, const SHORT height) noexcept;
 #pragma endregion
 
 #ifdef UNIT_TESTING
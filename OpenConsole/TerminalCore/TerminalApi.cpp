@@ -18,7 +18,11 @@ void Terminal::PrintString(const std::wstring_view string)
 
 void Terminal::ReturnResponse(const std::wstring_view response)
 {
-    if (_pfnWriteInput)
+    if (_pfnReturnResponse)
+    {
+        _pfnReturnResponse(response);
+    }
+    else if (_pfnWriteInput)
     {
         _pfnWriteInput(response);
     }
@@ -46,6 +50,8 @@ void Terminal::SetViewportPosition(const til::point position)
     {
         const auto dimensions = _GetMutableViewport().Dimensions();
         _mutableViewport = Viewport::FromDimensions(position.to_win32_coord(), dimensions);
+        _patternsNeedFullScan = true;
+        ++_rowGeneration;
         Terminal::_NotifyScrollEvent();
     }
 }
@@ -67,7 +73,10 @@ void Terminal::SetScrollingRegion(const til::inclusive_rect& /*scrollMargins*/)
 
 void Terminal::WarningBell()
 {
-    _pfnWarningBell();
+    if (_pfnWarningBell)
+    {
+        _pfnWarningBell();
+    }
 }
 
 bool Terminal::GetLineFeedMode() const
@@ -82,7 +91,13 @@ void Terminal::LineFeed(const bool withReturn)
 
     // since we explicitly just moved down a row, clear the wrap status on the
     // row we just came from
-    _activeBuffer().GetRowByOffset(cursorPos.Y).SetWrapForced(false);
+    auto& row = _activeBuffer().GetRowByOffset(cursorPos.Y);
+    if (row.WasWrapForced())
+    {
+        row.SetWrapForced(false);
+        // The row and the one below it aren't a single line anymore.
+        _MarkRowsDirty(cursorPos.Y, cursorPos.Y + 2);
+    }
 
     cursorPos.Y++;
     if (withReturn)
@@ -97,7 +112,10 @@ void Terminal::SetWindowTitle(const std::wstring_view title)
     if (!_suppressApplicationTitle)
     {
         _title.emplace(title);
-        _pfnTitleChanged(_title.value());
+        if (_pfnTitleChanged)
+        {
+            _pfnTitleChanged(_title.value());
+        }
     }
 }
 
@@ -130,7 +148,10 @@ void Terminal::EnableXtermBracketedPasteMode(const bool enabled)
 
 void Terminal::CopyToClipboard(std::wstring_view content)
 {
-    _pfnCopyToClipboard(content);
+    if (_pfnCopyToClipboard)
+    {
+        _pfnCopyToClipboard(content);
+    }
 }
 
 // Method Description:
@@ -195,8 +216,12 @@ void Terminal::UseAlternateScreenBuffer()
 
     const auto cursorSize = _mainBuffer->GetCursor().GetSize();
 
+    // The alternate buffer has no scrollback to show.
+    _LeaveHistory();
     ClearSelection();
     _mainBuffer->ClearPatternRecognizers();
+    _searchIndexNeedsFullUpdate = true;
+    ++_rowGeneration;
 
     // Create a new alt buffer
     _altBuffer = std::make_unique<TextBuffer>(_altBufferSize.to_win32_coord(),
@@ -267,10 +292,14 @@ void Terminal::UseMainScreenBuffer()
     _mainBuffer->SetAsActiveBuffer(true);
     // destroy the alt buffer
     _altBuffer = nullptr;
+    _searchIndexNeedsFullUpdate = true;
+    ++_rowGeneration;
 
     if (_deferredResize.has_value())
     {
-        LOG_IF_FAILED(UserResize(_deferredResize.value().to_win32_coord()));
+        // This happens in the middle of the output, which would reflow the
+        // rest of the buffer right away anyway.
+        LOG_IF_FAILED(_Resize(_deferredResize.value().to_win32_coord(), false));
         _deferredResize = std::nullopt;
     }
 
@@ -317,7 +346,11 @@ bool Terminal::IsVtInputEnabled() const
     return false;
 }
 
-void Terminal::NotifyAccessibilityChange(const til::rect& /*changedRect*/)
+void Terminal::NotifyAccessibilityChange(const til::rect& changedRect)
 {
     // This is only needed in conhost. Terminal handles accessibility in another way.
+    // But since it's called whenever the dispatcher modifies a region of the
+    // buffer directly (erasing, scrolling, filling), it tells us which rows
+    // need to be searched for patterns again.
+    _MarkRowsDirty(gsl::narrow_cast<int>(changedRect.top), gsl::narrow_cast<int>(changedRect.bottom));
 }
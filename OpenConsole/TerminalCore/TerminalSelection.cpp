@@ -54,7 +54,7 @@ std::vector<SMALL_RECT> Terminal::_GetSelectionRects() const noexcept
 
     try
     {
-        return _activeBuffer().GetTextRects(_selection->start, _selection->end, _blockSelection, false);
+        return _viewedBuffer().GetTextRects(_selection->start, _selection->end, _blockSelection, false);
     }
     CATCH_LOG();
     return result;
@@ -182,7 +182,7 @@ void Terminal::SetSelectionEnd(const COORD viewportPos, std::optional<SelectionE
 // - the new start/end for a selection
 std::pair<COORD, COORD> Terminal::_PivotSelection(const COORD targetPos, bool& targetStart) const
 {
-    if (targetStart = _activeBuffer().GetSize().CompareInBounds(targetPos, _selection->pivot) <= 0)
+    if (targetStart = _viewedBuffer().GetSize().CompareInBounds(targetPos, _selection->pivot) <= 0)
     {
         // target is before pivot
         // treat target as start
@@ -207,7 +207,7 @@ std::pair<COORD, COORD> Terminal::_ExpandSelectionAnchors(std::pair<COORD, COORD
     auto start = anchors.first;
     auto end = anchors.second;
 
-    const auto bufferSize = _activeBuffer().GetSize();
+    const auto bufferSize = _viewedBuffer().GetSize();
     switch (_multiClickSelectionMode)
     {
     case SelectionExpansion::Line:
@@ -215,8 +215,8 @@ std::pair<COORD, COORD> Terminal::_ExpandSelectionAnchors(std::pair<COORD, COORD
         end = { bufferSize.RightInclusive(), end.Y };
         break;
     case SelectionExpansion::Word:
-        start = _activeBuffer().GetWordStart(start, _wordDelimiters);
-        end = _activeBuffer().GetWordEnd(end, _wordDelimiters);
+        start = _viewedBuffer().GetWordStart(start, _wordDelimiters);
+        end = _viewedBuffer().GetWordEnd(end, _wordDelimiters);
         break;
     case SelectionExpansion::Char:
     default:
@@ -283,6 +283,9 @@ Terminal::UpdateSelectionParams Terminal::ConvertKeyEventToUpdateSelectionParams
 
 void Terminal::UpdateSelection(SelectionDirection direction, SelectionExpansion mode)
 {
+    // 0. Bring the rows the selection may move to into the viewed buffer
+    _PrepareSelectionMove(direction, mode);
+
     // 1. Figure out which endpoint to update
     // One of the endpoints is the pivot, signifying that the other endpoint is the one we want to move.
     const auto movingEnd{ _selection->start == _selection->pivot };
@@ -313,6 +316,16 @@ void Terminal::UpdateSelection(SelectionDirection direction, SelectionExpansion
     // 4. Scroll (if necessary)
     if (const auto viewport = _GetVisibleViewport(); !viewport.IsInBounds(targetPos))
     {
+        if (_inHistoryView())
+        {
+            // Scroll within the page of archived rows the selection is in.
+            const auto pageRows = _historyBuffer->GetSize().Height();
+            const auto lastTop = std::min<int64_t>(pageRows - viewport.Height(), _scrollbackArchive->EndRow() - 1 - _historyTop);
+            const auto top = std::clamp<int64_t>(targetPos.Y < viewport.Top() ? targetPos.Y : targetPos.Y - viewport.Height() + 1, 0, lastTop);
+            _ShowHistory(_historyTop + top);
+            _NotifyScrollEvent();
+            return;
+        }
         if (const auto amtAboveView = viewport.Top() - targetPos.Y; amtAboveView > 0)
         {
             // anchor is above visible viewport, scroll by that amount
@@ -331,10 +344,10 @@ void Terminal::UpdateSelection(SelectionDirection direction, SelectionExpansion
 
 void Terminal::SelectAll()
 {
-    const auto bufferSize{ _activeBuffer().GetSize() };
+    const auto bufferSize{ _viewedBuffer().GetSize() };
     _selection = SelectionAnchors{};
     _selection->start = bufferSize.Origin();
-    _selection->end = { bufferSize.RightInclusive(), _GetMutableViewport().BottomInclusive() };
+    _selection->end = { bufferSize.RightInclusive(), _SelectionBottom() };
     _selection->pivot = _selection->end;
 }
 
@@ -343,22 +356,22 @@ void Terminal::_MoveByChar(SelectionDirection direction, COORD& pos)
     switch (direction)
     {
     case SelectionDirection::Left:
-        _activeBuffer().GetSize().DecrementInBounds(pos);
-        pos = _activeBuffer().GetGlyphStart(til::point{ pos }).to_win32_coord();
+        _viewedBuffer().GetSize().DecrementInBounds(pos);
+        pos = _viewedBuffer().GetGlyphStart(til::point{ pos }).to_win32_coord();
         break;
     case SelectionDirection::Right:
-        _activeBuffer().GetSize().IncrementInBounds(pos);
-        pos = _activeBuffer().GetGlyphEnd(til::point{ pos }).to_win32_coord();
+        _viewedBuffer().GetSize().IncrementInBounds(pos);
+        pos = _viewedBuffer().GetGlyphEnd(til::point{ pos }).to_win32_coord();
         break;
     case SelectionDirection::Up:
     {
-        const auto bufferSize{ _activeBuffer().GetSize() };
+        const auto bufferSize{ _viewedBuffer().GetSize() };
         pos = { pos.X, std::clamp(base::ClampSub<short, short>(pos.Y, 1).RawValue(), bufferSize.Top(), bufferSize.BottomInclusive()) };
         break;
     }
     case SelectionDirection::Down:
     {
-        const auto bufferSize{ _activeBuffer().GetSize() };
+        const auto bufferSize{ _viewedBuffer().GetSize() };
         pos = { pos.X, std::clamp(base::ClampAdd<short, short>(pos.Y, 1).RawValue(), bufferSize.Top(), bufferSize.BottomInclusive()) };
         break;
     }
@@ -370,19 +383,19 @@ void Terminal::_MoveByWord(SelectionDirection direction, COORD& pos)
     switch (direction)
     {
     case SelectionDirection::Left:
-        const auto wordStartPos{ _activeBuffer().GetWordStart(pos, _wordDelimiters) };
-        if (_activeBuffer().GetSize().CompareInBounds(_selection->pivot, pos) < 0)
+        const auto wordStartPos{ _viewedBuffer().GetWordStart(pos, _wordDelimiters) };
+        if (_viewedBuffer().GetSize().CompareInBounds(_selection->pivot, pos) < 0)
         {
             // If we're moving towards the pivot, move one more cell
             pos = wordStartPos;
-            _activeBuffer().GetSize().DecrementInBounds(pos);
+            _viewedBuffer().GetSize().DecrementInBounds(pos);
         }
         else if (wordStartPos == pos)
         {
             // already at the beginning of the current word,
             // move to the beginning of the previous word
-            _activeBuffer().GetSize().DecrementInBounds(pos);
-            pos = _activeBuffer().GetWordStart(pos, _wordDelimiters);
+            _viewedBuffer().GetSize().DecrementInBounds(pos);
+            pos = _viewedBuffer().GetWordStart(pos, _wordDelimiters);
         }
         else
         {
@@ -391,19 +404,19 @@ void Terminal::_MoveByWord(SelectionDirection direction, COORD& pos)
         }
         break;
     case SelectionDirection::Right:
-        const auto wordEndPos{ _activeBuffer().GetWordEnd(pos, _wordDelimiters) };
-        if (_activeBuffer().GetSize().CompareInBounds(pos, _selection->pivot) < 0)
+        const auto wordEndPos{ _viewedBuffer().GetWordEnd(pos, _wordDelimiters) };
+        if (_viewedBuffer().GetSize().CompareInBounds(pos, _selection->pivot) < 0)
         {
             // If we're moving towards the pivot, move one more cell
-            pos = _activeBuffer().GetWordEnd(pos, _wordDelimiters);
-            _activeBuffer().GetSize().IncrementInBounds(pos);
+            pos = _viewedBuffer().GetWordEnd(pos, _wordDelimiters);
+            _viewedBuffer().GetSize().IncrementInBounds(pos);
         }
         else if (wordEndPos == pos)
         {
             // already at the end of the current word,
             // move to the end of the next word
-            _activeBuffer().GetSize().IncrementInBounds(pos);
-            pos = _activeBuffer().GetWordEnd(pos, _wordDelimiters);
+            _viewedBuffer().GetSize().IncrementInBounds(pos);
+            pos = _viewedBuffer().GetWordEnd(pos, _wordDelimiters);
         }
         else
         {
@@ -413,18 +426,18 @@ void Terminal::_MoveByWord(SelectionDirection direction, COORD& pos)
         break;
     case SelectionDirection::Up:
         _MoveByChar(direction, pos);
-        pos = _activeBuffer().GetWordStart(pos, _wordDelimiters);
+        pos = _viewedBuffer().GetWordStart(pos, _wordDelimiters);
         break;
     case SelectionDirection::Down:
         _MoveByChar(direction, pos);
-        pos = _activeBuffer().GetWordEnd(pos, _wordDelimiters);
+        pos = _viewedBuffer().GetWordEnd(pos, _wordDelimiters);
         break;
     }
 }
 
 void Terminal::_MoveByViewport(SelectionDirection direction, COORD& pos)
 {
-    const auto bufferSize{ _activeBuffer().GetSize() };
+    const auto bufferSize{ _viewedBuffer().GetSize() };
     switch (direction)
     {
     case SelectionDirection::Left:
@@ -443,7 +456,7 @@ void Terminal::_MoveByViewport(SelectionDirection direction, COORD& pos)
     case SelectionDirection::Down:
     {
         const auto viewportHeight{ _GetMutableViewport().Height() };
-        const auto mutableBottom{ _GetMutableViewport().BottomInclusive() };
+        const auto mutableBottom{ _SelectionBottom() };
         const auto newY{ base::ClampAdd<short, short>(pos.Y, viewportHeight) };
         pos = newY > mutableBottom ? COORD{ bufferSize.RightInclusive(), mutableBottom } : COORD{ pos.X, newY };
         break;
@@ -453,7 +466,7 @@ void Terminal::_MoveByViewport(SelectionDirection direction, COORD& pos)
 
 void Terminal::_MoveByBuffer(SelectionDirection direction, COORD& pos)
 {
-    const auto bufferSize{ _activeBuffer().GetSize() };
+    const auto bufferSize{ _viewedBuffer().GetSize() };
     switch (direction)
     {
     case SelectionDirection::Left:
@@ -462,16 +475,129 @@ void Terminal::_MoveByBuffer(SelectionDirection direction, COORD& pos)
         break;
     case SelectionDirection::Right:
     case SelectionDirection::Down:
-        pos = { bufferSize.RightInclusive(), _GetMutableViewport().BottomInclusive() };
+        pos = { bufferSize.RightInclusive(), _SelectionBottom() };
         break;
     }
 }
 
+// Method Description:
+// - Before the selection is moved with the keyboard, makes sure the rows it
+//   may move to are in the viewed buffer. The archived rows above the main
+//   buffer are shown in the history view, and the main buffer is shown again
+//   once the selection moves back into it. The selection moves along, see
+//   _RebaseSelection.
+// Arguments:
+// - direction: the direction the selection is moved in
+// - mode: how far it's moved
+void Terminal::_PrepareSelectionMove(const SelectionDirection direction, const SelectionExpansion mode)
+{
+    if (!_selection || !_scrollbackArchive || _inAltBuffer())
+    {
+        return;
+    }
+
+    const auto firstRow = _scrollbackArchive->FirstRow();
+    const auto endRow = _scrollbackArchive->EndRow();
+    const auto backwards = direction == SelectionDirection::Up || direction == SelectionDirection::Left;
+    if (mode == SelectionExpansion::Buffer)
+    {
+        if (!backwards)
+        {
+            _LeaveHistory();
+        }
+        else if (firstRow < endRow)
+        {
+            _ShowHistory(firstRow);
+        }
+        return;
+    }
+
+    // The selection moves by a viewport at most.
+    const auto movingEnd{ _selection->start == _selection->pivot };
+    const auto row = _ViewedSearchRowBase() + (movingEnd ? _selection->end : _selection->start).Y;
+    const auto height = _mutableViewport.Height();
+    if (backwards)
+    {
+        if (row - height < _ViewedSearchRowBase() && _ViewedSearchRowBase() > firstRow)
+        {
+            _ShowHistory(std::clamp<int64_t>(row - height, firstRow, endRow - 1));
+        }
+    }
+    else if (_inHistoryView() && row + height >= _historyTop + _historyBuffer->GetSize().Height())
+    {
+        if (row >= endRow)
+        {
+            _LeaveHistory();
+        }
+        else
+        {
+            _ShowHistory(row);
+        }
+    }
+}
+
+// Method Description:
+// - Moves the selection to where its rows are in the buffer that's viewed
+//   now. Endpoints that aren't in it are moved to its first or last cell,
+//   and the selection is cleared if none of it is in it.
+// Arguments:
+// - offset: the row the rows of the selection moved by
+// - width: the width of the buffer that's viewed now
+// - height: the height of the buffer that's viewed now
+void Terminal::_RebaseSelection(const int64_t offset, const SHORT width, const SHORT height) noexcept
+{
+    if (!_selection)
+    {
+        return;
+    }
+
+    if (_selection->end.Y + offset < 0 || _selection->start.Y + offset >= height)
+    {
+        _selection.reset();
+        return;
+    }
+
+    const auto rebase = [&](COORD& pos) noexcept {
+        const auto row = pos.Y + offset;
+        if (row < 0)
+        {
+            pos = { 0, 0 };
+        }
+        else if (row >= height)
+        {
+            pos = { gsl::narrow_cast<SHORT>(width - 1), gsl::narrow_cast<SHORT>(height - 1) };
+        }
+        else
+        {
+            pos.Y = gsl::narrow_cast<SHORT>(row);
+        }
+    };
+    rebase(_selection->start);
+    rebase(_selection->end);
+    rebase(_selection->pivot);
+}
+
+// Method Description:
+// - Returns the last row a selection can extend to: the bottom of the mutable
+//   viewport, or of the page of archived rows in the history view.
+short Terminal::_SelectionBottom() const noexcept
+{
+    return _inHistoryView() ? _historyBuffer->GetSize().BottomInclusive() : _GetMutableViewport().BottomInclusive();
+}
+
 // Method Description:
 // - clear selection data and disable rendering it
 #pragma warning(disable : 26440) // changing this to noexcept would require a change to ConHost's selection model
 void Terminal::ClearSelection()
 {
+    const auto upgrade = _UpgradeConsoleLock();
+    const auto downgrade = wil::scope_exit([&]() noexcept {
+        if (upgrade.upgraded)
+        {
+            _DowngradeConsoleLock();
+        }
+    });
+
     _selection = std::nullopt;
 }
 
@@ -498,7 +624,7 @@ const TextBuffer::TextAndColor Terminal::RetrieveSelectedTextFromBuffer(bool sin
     const auto includeCRLF = !singleLine || _blockSelection;
     const auto trimTrailingWhitespace = !singleLine && (!_blockSelection || _trimBlockSelection);
     const auto formatWrappedRows = _blockSelection;
-    return _activeBuffer().GetText(includeCRLF, trimTrailingWhitespace, selectionRects, GetAttributeColors, formatWrappedRows);
+    return _viewedBuffer().GetText(includeCRLF, trimTrailingWhitespace, selectionRects, GetAttributeColors, formatWrappedRows);
 }
 
 // Method Description:
@@ -511,7 +637,7 @@ COORD Terminal::_ConvertToBufferCell(const COORD viewportPos) const
 {
     const auto yPos = base::ClampedNumeric<short>(_VisibleStartIndex()) + viewportPos.Y;
     COORD bufferPos = { viewportPos.X, yPos };
-    _activeBuffer().GetSize().Clamp(bufferPos);
+    _viewedBuffer().GetSize().Clamp(bufferPos);
     return bufferPos;
 }
 
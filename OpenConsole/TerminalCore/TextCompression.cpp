@@ -0,0 +1,122 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "pch.h"
+#include "TextCompression.hpp"
+
+using namespace Microsoft::Terminal::Core;
+
+// Matches shorter than this aren't worth the two code units they take up.
+static constexpr size_t _minMatch = 4;
+// All the numbers in the compressed text are a single code unit.
+static constexpr size_t _maxValue = 0xFFFF;
+static constexpr size_t _hashBits = 12;
+
+// Hashes the _minMatch code units at the given position.
+static size_t _hash(const wchar_t* const text) noexcept
+{
+    const auto lo = static_cast<uint32_t>(static_cast<uint16_t>(til::at(text, 0))) | (static_cast<uint32_t>(static_cast<uint16_t>(til::at(text, 1))) << 16);
+    const auto hi = static_cast<uint32_t>(static_cast<uint16_t>(til::at(text, 2))) | (static_cast<uint32_t>(static_cast<uint16_t>(til::at(text, 3))) << 16);
+    return ((lo * 0x9E3779B1u) ^ (hi * 0x85EBCA77u)) >> (32 - _hashBits);
+}
+
+// Appends [literal count][literals] to out. Runs of literals that don't fit
+// into a single count are followed by an empty match.
+static void _emitLiterals(std::wstring& out, std::wstring_view literals)
+{
+    while (literals.size() > _maxValue)
+    {
+        out.push_back(gsl::narrow_cast<wchar_t>(_maxValue));
+        out.append(literals.substr(0, _maxValue));
+        out.push_back(0);
+        out.push_back(0);
+        literals = literals.substr(_maxValue);
+    }
+    out.push_back(gsl::narrow_cast<wchar_t>(literals.size()));
+    out.append(literals);
+}
+
+// Method Description:
+// - Compresses the given text. The result is a sequence of
+//   [literal count][literals][match length][match offset], where the match
+//   repeats the text that ends `offset` code units before it. The last
+//   sequence ends after its literals.
+// Arguments:
+// - text: the text to compress
+// - out: receives the compressed text
+// Return Value:
+// - <none>
+void TextCompression::Compress(const std::wstring_view text, std::wstring& out)
+{
+    out.clear();
+
+    // The last position every hash was seen at, or SIZE_MAX.
+    std::vector<size_t> table(size_t{ 1 } << _hashBits, SIZE_MAX);
+    size_t literalStart = 0;
+    size_t pos = 0;
+    while (pos + _minMatch <= text.size())
+    {
+        auto& slot = til::at(table, _hash(text.data() + pos));
+        const auto candidate = slot;
+        slot = pos;
+
+        if (candidate == SIZE_MAX || pos - candidate > _maxValue || text.compare(candidate, _minMatch, text.data() + pos, _minMatch) != 0)
+        {
+            ++pos;
+            continue;
+        }
+
+        // The match may overlap the text it's at, which is how runs of
+        // spaces turn into a single match with an offset of 1.
+        auto length = _minMatch;
+        const auto maxLength = std::min(text.size() - pos, _maxValue);
+        while (length < maxLength && til::at(text, candidate + length) == til::at(text, pos + length))
+        {
+            ++length;
+        }
+
+        _emitLiterals(out, text.substr(literalStart, pos - literalStart));
+        out.push_back(gsl::narrow_cast<wchar_t>(length));
+        out.push_back(gsl::narrow_cast<wchar_t>(pos - candidate));
+        pos += length;
+        literalStart = pos;
+    }
+
+    _emitLiterals(out, text.substr(literalStart));
+}
+
+// Method Description:
+// - Reverses Compress.
+// Arguments:
+// - in: the compressed text
+// - length: the length of the uncompressed text
+// - out: receives the uncompressed text
+// Return Value:
+// - <none>
+void TextCompression::Decompress(const std::wstring_view in, const size_t length, std::wstring& out)
+{
+    out.clear();
+    out.reserve(length);
+
+    size_t i = 0;
+    while (i < in.size())
+    {
+        const size_t literals = static_cast<uint16_t>(til::at(in, i++));
+        out.append(in.substr(i, literals));
+        i += literals;
+        if (i + 2 > in.size())
+        {
+            break;
+        }
+
+        const size_t matchLength = static_cast<uint16_t>(til::at(in, i++));
+        const size_t offset = static_cast<uint16_t>(til::at(in, i++));
+        // The match may overlap the text it produces, so it has to be
+        // copied one code unit at a time.
+        auto from = out.size() - offset;
+        for (size_t j = 0; j < matchLength; ++j)
+        {
+            out.push_back(til::at(out, from++));
+        }
+    }
+}
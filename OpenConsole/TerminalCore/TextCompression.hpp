@@ -0,0 +1,25 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+// Module Name:
+// - TextCompression.hpp
+//
+// Abstract:
+// - The compression the ScrollbackArchive uses for the text of its blocks: a
+//   small LZ77 variant that works on UTF-16 code units. Rows of a terminal
+//   are mostly padding and repeated prompts, so even this simple scheme, with
+//   a single candidate per hash, does well on them.
+// - This only depends on the standard library, so that it can be tested and
+//   benchmarked on its own.
+
+#pragma once
+
+namespace Microsoft::Terminal::Core
+{
+    class TextCompression final
+    {
+    public:
+        static void Compress(const std::wstring_view text, std::wstring& out);
+        static void Decompress(const std::wstring_view in, const size_t length, std::wstring& out);
+    };
+}
@@ -0,0 +1,229 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "pch.h"
+#include "UrlMatcher.hpp"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define URL_MATCHER_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace Microsoft::Terminal::Core;
+
+// Characters in [-A-Za-z0-9+&@#/%?=~_|$!:,.;]
+static constexpr bool _isUrlChar(const wchar_t ch) noexcept
+{
+    if ((ch >= L'A' && ch <= L'Z') || (ch >= L'a' && ch <= L'z') || (ch >= L'0' && ch <= L'9'))
+    {
+        return true;
+    }
+    switch (ch)
+    {
+    case L'-':
+    case L'+':
+    case L'&':
+    case L'@':
+    case L'#':
+    case L'/':
+    case L'%':
+    case L'?':
+    case L'=':
+    case L'~':
+    case L'_':
+    case L'|':
+    case L'$':
+    case L'!':
+    case L':':
+    case L',':
+    case L'.':
+    case L';':
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Characters in [A-Za-z0-9+&@#/%=~_|$], which a URL has to end with.
+static constexpr bool _isUrlEndChar(const wchar_t ch) noexcept
+{
+    switch (ch)
+    {
+    case L'-':
+    case L'?':
+    case L'!':
+    case L':':
+    case L',':
+    case L'.':
+    case L';':
+        return false;
+    default:
+        return _isUrlChar(ch);
+    }
+}
+
+// What std::wregex considers a \w character.
+static bool _isWordChar(const wchar_t ch) noexcept
+{
+    return ch == L'_' || iswalnum(ch);
+}
+
+static unsigned long _countTrailingZeros(const unsigned long mask) noexcept
+{
+    assert(mask != 0);
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return gsl::narrow_cast<unsigned long>(__builtin_ctzl(mask));
+#endif
+}
+
+// Returns the offset of the first ':' at or after `offset`, or text.size().
+static size_t _findColon(const std::wstring_view text, size_t offset) noexcept
+{
+    const auto data = text.data();
+    const auto size = text.size();
+
+#ifdef URL_MATCHER_SSE2
+    // wchar_t is 2 bytes on Windows, but 4 bytes on the other platforms the
+    // benchmarks run on.
+    constexpr size_t lanes = sizeof(__m128i) / sizeof(wchar_t);
+    for (; offset + lanes <= size; offset += lanes)
+    {
+        const auto chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + offset));
+        const auto equal = sizeof(wchar_t) == 2 ? _mm_cmpeq_epi16(chars, _mm_set1_epi16(L':')) : _mm_cmpeq_epi32(chars, _mm_set1_epi32(L':'));
+        const auto mask = gsl::narrow_cast<unsigned long>(_mm_movemask_epi8(equal));
+        if (mask != 0)
+        {
+            // Every wchar_t contributes one bit per byte to the mask.
+            return offset + _countTrailingZeros(mask) / sizeof(wchar_t);
+        }
+    }
+#endif
+
+    for (; offset < size; ++offset)
+    {
+        if (til::at(data, offset) == L':')
+        {
+            return offset;
+        }
+    }
+    return size;
+}
+
+// Returns the offset of the scheme that ends at the ':' at `colon`, or
+// std::wstring_view::npos if there's none.
+static size_t _findScheme(const std::wstring_view text, const size_t colon) noexcept
+{
+    static constexpr std::array<std::wstring_view, 4> schemes{ L"https", L"http", L"ftp", L"file" };
+
+    for (const auto scheme : schemes)
+    {
+        if (colon >= scheme.size() && text.substr(colon - scheme.size(), scheme.size()) == scheme)
+        {
+            return colon - scheme.size();
+        }
+    }
+    return std::wstring_view::npos;
+}
+
+
+// Method Description:
+// - Finds all the URLs in the given text, just like iterating over it with a
+//   std::wsregex_iterator for linkPattern would.
+// Arguments:
+// - text: the text to search
+// - matches: receives the matches. It's cleared first.
+// Return Value:
+// - <none>
+void UrlMatcher::FindAll(const std::wstring_view text, std::vector<Match>& matches)
+{
+    matches.clear();
+
+    // The earliest offset the next match may begin at.
+    size_t searchFrom = 0;
+    for (auto colon = _findColon(text, 0); colon < text.size(); colon = _findColon(text, colon + 1))
+    {
+        if (colon + 2 >= text.size() || til::at(text, colon + 1) != L'/' || til::at(text, colon + 2) != L'/')
+        {
+            continue;
+        }
+
+        // \b(https?|ftp|file)
+        const auto begin = _findScheme(text, colon);
+        if (begin == std::wstring_view::npos || begin < searchFrom || (begin > 0 && _isWordChar(til::at(text, begin - 1))))
+        {
+            continue;
+        }
+
+        // [-A-Za-z0-9+&@#/%?=~_|$!:,.;]*[A-Za-z0-9+&@#/%=~_|$]
+        // The first part is greedy, so the URL ends at the last
+        // character of the run that's allowed to end it.
+        auto end = std::wstring_view::npos;
+        for (auto i = colon + 3; i < text.size() && _isUrlChar(til::at(text, i)); ++i)
+        {
+            if (_isUrlEndChar(til::at(text, i)))
+            {
+                end = i + 1;
+            }
+        }
+        if (end == std::wstring_view::npos)
+        {
+            continue;
+        }
+
+        matches.emplace_back(Match{ begin, end });
+        searchFrom = end;
+        // The URL may contain more colons. Skip them.
+        colon = end - 1;
+    }
+}
+
+// Method Description:
+// - Turns the offsets of the given matches into the columns they begin and
+//   end at, for text with one column per glyph, and two for wide glyphs.
+//   That's what ROW::GetText returns, even if a wide glyph didn't fit at the
+//   end of a row: the column it left empty reads as a space.
+// Arguments:
+// - text: the text the matches were found in
+// - matches: the matches, in the order FindAll returned them. They're
+//   updated in place.
+// - isWide: returns whether a glyph is wide. It's only asked about glyphs
+//   that aren't ASCII.
+// Return Value:
+// - <none>
+void UrlMatcher::ToColumns(const std::wstring_view text, std::vector<Match>& matches, const IsWideGlyph isWide)
+{
+    size_t offset = 0;
+    size_t column = 0;
+    const auto advanceTo = [&](const size_t end) {
+        while (offset < end)
+        {
+            const auto ch = til::at(text, offset);
+            if (ch < 0x80)
+            {
+                ++offset;
+                ++column;
+                continue;
+            }
+
+            size_t length = 1;
+            if (ch >= 0xD800 && ch <= 0xDBFF && offset + 1 < text.size() && til::at(text, offset + 1) >= 0xDC00 && til::at(text, offset + 1) <= 0xDFFF)
+            {
+                length = 2;
+            }
+            column += isWide(text.substr(offset, length)) ? 2 : 1;
+            offset += length;
+        }
+    };
+
+    for (auto& match : matches)
+    {
+        advanceTo(match.begin);
+        match.begin = column;
+        advanceTo(match.end);
+        match.end = column;
+    }
+}
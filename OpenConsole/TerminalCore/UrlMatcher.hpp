@@ -0,0 +1,41 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+// Module Name:
+// - UrlMatcher.hpp
+//
+// Abstract:
+// - A hand-written recognizer for the URLs described by linkPattern. It finds
+//   exactly the same matches as running linkPattern through std::wregex, but
+//   it first scans for ":" with SIMD and only looks closer at the few places
+//   that are followed by "//" and preceded by one of the schemes. Most rows
+//   don't contain a URL at all, and for those we never get past the scan.
+// - If you change linkPattern, you have to change this as well. The
+//   UrlMatcherTests in OpenConsole/Benchmarks compare the two.
+// - This only depends on the standard library, so that it can be tested and
+//   benchmarked on its own.
+
+#pragma once
+
+static constexpr std::wstring_view linkPattern{ LR"(\b(https?|ftp|file)://[-A-Za-z0-9+&@#/%?=~_|$!:,.;]*[A-Za-z0-9+&@#/%=~_|$])" };
+
+namespace Microsoft::Terminal::Core
+{
+    class UrlMatcher final
+    {
+    public:
+        // A match, as a [begin, end) range of offsets into the searched text.
+        struct Match
+        {
+            size_t begin;
+            size_t end;
+        };
+
+        // Returns whether the given glyph (a single UTF-16 code unit or a
+        // surrogate pair) takes up two columns.
+        using IsWideGlyph = bool (*)(const std::wstring_view glyph);
+
+        static void FindAll(const std::wstring_view text, std::vector<Match>& matches);
+        static void ToColumns(const std::wstring_view text, std::vector<Match>& matches, const IsWideGlyph isWide);
+    };
+}
@@ -9,6 +9,10 @@ using namespace Microsoft::Terminal::Core;
 using namespace Microsoft::Console::Types;
 using namespace Microsoft::Console::Render;
 
+// The terminal this thread holds the lock of through LockConsole, if any.
+// See Terminal::_UpgradeConsoleLock.
+static thread_local const Terminal* t_consoleLockReader{ nullptr };
+
 Viewport Terminal::GetViewport() noexcept
 {
     return _GetVisibleViewport();
@@ -16,6 +20,13 @@ Viewport Terminal::GetViewport() noexcept
 
 COORD Terminal::GetTextBufferEndPosition() const noexcept
 {
+    // In the history view, the text ends with the page of archived rows.
+    if (_inHistoryView())
+    {
+        const auto pageSize = _historyBuffer->GetSize();
+        return { pageSize.RightInclusive(), pageSize.BottomInclusive() };
+    }
+
     // We use the end line of mutableViewport as the end
     // of the text buffer, it always moves with the written
     // text
@@ -25,7 +36,7 @@ COORD Terminal::GetTextBufferEndPosition() const noexcept
 
 const TextBuffer& Terminal::GetTextBuffer() const noexcept
 {
-    return _activeBuffer();
+    return _viewedBuffer();
 }
 
 const FontInfo& Terminal::GetFontInfo() const noexcept
@@ -47,7 +58,7 @@ COORD Terminal::GetCursorPosition() const noexcept
 bool Terminal::IsCursorVisible() const noexcept
 {
     const auto& cursor = _activeBuffer().GetCursor();
-    return cursor.IsVisible() && !cursor.IsPopupShown();
+    return cursor.IsVisible() && !cursor.IsPopupShown() && !_inHistoryView();
 }
 
 bool Terminal::IsCursorOn() const noexcept
@@ -78,8 +89,27 @@ bool Terminal::IsCursorDoubleWidth() const
     return IsGlyphFullWidth(*it);
 }
 
+// Method Description:
+// - Returns an overlay for each of the find-all search matches in the
+//   viewport, which is how the renderer highlights them. They're prepared
+//   under the write lock by UpdateSearchHighlightsUnderLock, this only hands
+//   them out. If the viewport changed since, there are none until the next
+//   call to it.
 const std::vector<RenderOverlay> Terminal::GetOverlays() const noexcept
+try
+{
+    const auto viewport = _GetVisibleViewport();
+    if (_searchHighlightOverlays.empty() ||
+        _searchHighlightTop != _ViewedSearchRowBase() + viewport.Top() ||
+        til::size{ _searchHighlightBuffer->GetSize().Dimensions() } != til::size{ viewport.Dimensions() })
+    {
+        return {};
+    }
+    return _searchHighlightOverlays;
+}
+catch (...)
 {
+    LOG_CAUGHT_EXCEPTION();
     return {};
 }
 
@@ -106,6 +136,12 @@ const std::wstring Microsoft::Terminal::Core::Terminal::GetHyperlinkCustomId(uin
 // - The pattern IDs of the location
 const std::vector<size_t> Terminal::GetPatternId(const COORD location) const noexcept
 {
+    // The archived rows in the history view aren't searched for patterns.
+    if (_inHistoryView())
+    {
+        return {};
+    }
+
     // Look through our interval tree for this location
     const auto intervals = _patternIntervalTree.findOverlapping(til::point{ location.X + 1, location.Y }, til::point{ location });
     if (intervals.size() == 0)
@@ -148,6 +184,43 @@ catch (...)
 }
 
 void Terminal::SelectNewRegion(const COORD coordStart, const COORD coordEnd)
+{
+    const auto upgrade = _UpgradeConsoleLock();
+    const auto downgrade = wil::scope_exit([&]() noexcept {
+        if (upgrade.upgraded)
+        {
+            _DowngradeConsoleLock();
+        }
+    });
+
+    if (upgrade.rowsCircled == 0 && !upgrade.rowsRenumbered)
+    {
+        _SelectNewRegion(coordStart, coordEnd);
+        return;
+    }
+
+    // UIA came up with these coordinates while it only held the read lock.
+    // The text they point at has moved since. If it's still there, select
+    // it where it is now.
+    if (upgrade.rowsRenumbered || coordEnd.Y < upgrade.rowsCircled)
+    {
+        return;
+    }
+    auto start = coordStart;
+    auto end = coordEnd;
+    end.Y -= gsl::narrow<SHORT>(upgrade.rowsCircled);
+    if (start.Y < upgrade.rowsCircled)
+    {
+        start = { 0, 0 };
+    }
+    else
+    {
+        start.Y -= gsl::narrow<SHORT>(upgrade.rowsCircled);
+    }
+    _SelectNewRegion(start, end);
+}
+
+void Terminal::_SelectNewRegion(const COORD coordStart, const COORD coordEnd)
 {
 #pragma warning(push)
 #pragma warning(disable : 26496) // cpp core checks wants these const, but they're decremented below.
@@ -156,7 +229,21 @@ void Terminal::SelectNewRegion(const COORD coordStart, const COORD coordEnd)
 #pragma warning(pop)
 
     auto notifyScrollChange = false;
-    if (coordStart.Y < _VisibleStartIndex())
+    if (_inHistoryView())
+    {
+        if (coordStart.Y < _VisibleStartIndex() || coordEnd.Y > _VisibleEndIndex())
+        {
+            // Scroll the start of the region into view. If that reads another
+            // page of archived rows, the rows of this one move along.
+            const auto pageTop = _historyTop;
+            _ShowHistory(std::min(pageTop + coordStart.Y, _scrollbackArchive->EndRow() - 1));
+            const auto delta = gsl::narrow<short>(_historyTop - pageTop);
+            realCoordStart.Y -= delta;
+            realCoordEnd.Y -= delta;
+            _NotifyScrollEvent();
+        }
+    }
+    else if (coordStart.Y < _VisibleStartIndex())
     {
         // recalculate the scrollOffset
         _scrollOffset = ViewStartIndex() - coordStart.Y;
@@ -206,19 +293,72 @@ catch (...)
 //      operation.
 //   Callers should make sure to also call Terminal::UnlockConsole once
 //      they're done with any querying they need to do.
+// - The lock is only taken for reading, so that the renderer and UIA can
+//   query the terminal at the same time. See _UpgradeConsoleLock for the
+//   few IUiaData methods that modify the terminal.
 void Terminal::LockConsole() noexcept
 {
+    _readWriteLock.lock_shared();
+    t_consoleLockReader = this;
+}
+
+// Method Description:
+// - Unlocks the terminal after a call to Terminal::LockConsole.
+void Terminal::UnlockConsole() noexcept
+{
+    t_consoleLockReader = nullptr;
+    _readWriteLock.unlock_shared();
+}
+
+// Method Description:
+// - IUiaData has a couple of methods that modify the terminal (selecting
+//   text can scroll the viewport, for instance), but UIA calls them while
+//   only holding the lock for reading through LockConsole. In that case,
+//   trade our read lock for the write lock for the duration of the change.
+//   Everyone else calls these methods while already holding the write lock.
+// - The lock can't be upgraded in place, so other writers may get in between
+//   us releasing the read lock and acquiring the write lock. Anything the
+//   caller worked out under the read lock has to be checked against what
+//   they did, which is what the returned ConsoleLockUpgrade tells.
+// Return Value:
+// - upgraded: true if the lock was upgraded and _DowngradeConsoleLock must
+//   be called.
+// - rowsCircled: the number of rows the buffer circled by in the meantime.
+//   The text of a row moved up by that many rows.
+// - rowsRenumbered: whether the rows were renumbered in any other way, after
+//   which earlier row numbers are meaningless.
+Terminal::ConsoleLockUpgrade Terminal::_UpgradeConsoleLock() noexcept
+{
+    if (t_consoleLockReader != this)
+    {
+        return {};
+    }
+
+    // The rows of the history view don't circle, see _ShowHistory.
+    const auto viewedRowBase = [this]() noexcept { return _inHistoryView() ? _historyTop : _patternRowBase; };
+    const auto rowBase = viewedRowBase();
+    const auto rowGeneration = _rowGeneration;
+    const auto buffer = &_viewedBuffer();
+
+    _readWriteLock.unlock_shared();
     _readWriteLock.lock();
 #ifndef NDEBUG
     _lastLocker = GetCurrentThreadId();
 #endif
+
+    ConsoleLockUpgrade upgrade;
+    upgrade.upgraded = true;
+    upgrade.rowsCircled = viewedRowBase() - rowBase;
+    upgrade.rowsRenumbered = _rowGeneration != rowGeneration || buffer != &_viewedBuffer();
+    return upgrade;
 }
 
 // Method Description:
-// - Unlocks the terminal after a call to Terminal::LockConsole.
-void Terminal::UnlockConsole() noexcept
+// - Returns to holding the read lock after a call to _UpgradeConsoleLock.
+void Terminal::_DowngradeConsoleLock() noexcept
 {
     _readWriteLock.unlock();
+    _readWriteLock.lock_shared();
 }
 
 const bool Terminal::IsUiaDataInitialized() const noexcept
@@ -131,7 +131,8 @@ namespace SampleApp
                     new Dictionary<string, string>() { ["WT_PROFILE_ID"] = newTermArgs.Profile, ["WSLENV"] = "WT_PROFILE_ID" },
                     (uint)terminalSettings.InitialRows,
                     (uint)terminalSettings.InitialCols,
-                    Guid.NewGuid()));
+                    Guid.NewGuid(),
+                    profile.OutputCoalescingWindow));
 
                 this.Title = "SampleApp: " + terminalSettings.StartingTitle;
 